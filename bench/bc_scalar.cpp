@@ -0,0 +1,17 @@
+#define BC_NO_SSE2
+#include "bc_scalar.h"
+
+void
+bc_decode_image_scalar (
+    BcFormat format, void const * blocks, size_t block_pitch,
+    int width, int height, void * out, size_t out_pitch
+) {
+    bc_decode_image(format, blocks, block_pitch, width, height, out, out_pitch);
+}
+bool
+bc_encode_image_scalar (
+    BcFormat format, BcQuality quality, void const * rgba, size_t pitch,
+    int width, int height, void * out, size_t block_pitch
+) {
+    return bc_encode_image(format, quality, rgba, pitch, width, height, out, block_pitch);
+}
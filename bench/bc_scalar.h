@@ -0,0 +1,15 @@
+#pragma once
+
+// The BC codecs built a second time with BC_NO_SSE2 (bc_scalar.cpp), so the
+// benches can check the SSE2 paths against the scalar ones.
+
+#include "bc_encode.h"
+
+void bc_decode_image_scalar (
+    BcFormat format, void const * blocks, size_t block_pitch,
+    int width, int height, void * out, size_t out_pitch
+);
+bool bc_encode_image_scalar (
+    BcFormat format, BcQuality quality, void const * rgba, size_t pitch,
+    int width, int height, void * out, size_t block_pitch
+);
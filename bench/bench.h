@@ -0,0 +1,71 @@
+#pragma once
+
+// Headless benchmarks and checks of the demo's CPU-side code. Nothing here
+// needs a window or a device, so it builds on Windows (bench.vcxproj) and on
+// Linux (Makefile) alike.
+//
+// Every bench prints its own numbers and counts failed checks in the
+// context; main() turns any failure into a nonzero exit code. --quick shrinks
+// the workloads so the checks can run on every build.
+
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+
+struct BenchContext {
+    bool    quick;
+    int     failures;
+};
+
+#define BENCH_CHECK(ctx, cond)                                                  \
+    do {                                                                        \
+        if (!(cond)) {                                                          \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            ++(ctx)->failures;                                                  \
+        }                                                                       \
+    } while (0)
+
+static inline double
+bench_now_ms () {
+    using namespace std::chrono;
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+// xorshift32, so runs are repeatable across compilers and platforms
+static inline uint32_t
+bench_rand (uint32_t * state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+// -- Benches, one per file
+void bench_range_alloc (BenchContext * ctx);
+void bench_tangents (BenchContext * ctx);
+void bench_terrain (BenchContext * ctx);
+void bench_terrain_lod (BenchContext * ctx);
+void bench_mesh_codec (BenchContext * ctx);
+void bench_tiles (BenchContext * ctx);
+void bench_shadow_volumes (BenchContext * ctx);
+void bench_bc_decode (BenchContext * ctx);
+void bench_bc_encode (BenchContext * ctx);
+
+// The DDS loader against the stand-in device in linux/, Makefile build only
+#ifndef _WIN32
+void bench_dds_load (BenchContext * ctx);
+void bench_dds_legacy (BenchContext * ctx);
+void bench_dds_mips (BenchContext * ctx);
+void bench_dds_stream (BenchContext * ctx);
+void bench_dds_batch (BenchContext * ctx);
+void bench_dds_cache (BenchContext * ctx);
+void bench_dds_size_policy (BenchContext * ctx);
+#endif
+void bench_bounds (BenchContext * ctx);
+void bench_mesh_table (BenchContext * ctx);
+void bench_obj (BenchContext * ctx);
+void bench_gltf (BenchContext * ctx);
+void bench_isosurface (BenchContext * ctx);
+void bench_adjacency (BenchContext * ctx);
+void bench_degenerate (BenchContext * ctx);
@@ -0,0 +1,144 @@
+// Half-edge adjacency: twins must pair up symmetrically across the same
+// welded edge, an open grid must have exactly its rim as boundary while the
+// welded sphere has none, and a two-triangle quad must emit the known
+// TRIANGLELIST_ADJ indices and edge list. Then the build, the adjacency
+// output and the edge list are timed on a grid of millions of triangles.
+
+#include "bench.h"
+#include "geometry.h"
+#include "adjacency.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+// Every twin link goes both ways, across the reversed edge, between
+// different triangles. Returns the number of half-edges that break this.
+static int
+asymmetric_twins (HalfEdgeMesh const * mesh, int const indices []) {
+    int bad = 0;
+    for (int he = 0; he < mesh->triangle_count * 3; ++he) {
+        int twin = mesh->twin[he];
+        if (twin < 0)
+            continue;
+        bad += twin >= mesh->triangle_count * 3 || he != mesh->twin[twin] ||
+            half_edge_face(he) == half_edge_face(twin) ||
+            half_edge_origin(mesh, indices, twin) != half_edge_origin(mesh, indices, half_edge_next(he)) ||
+            half_edge_origin(mesh, indices, half_edge_next(twin)) != half_edge_origin(mesh, indices, he);
+    }
+    return bad;
+}
+
+// Every neighbour vertex in the adjacency output is the corner of the twin's
+// triangle off the shared edge, or the triangle's own opposite corner on a
+// border. Returns the number of neighbour vertices that are not.
+static int
+wrong_neighbours (HalfEdgeMesh const * mesh, int const indices [], int const adjacency []) {
+    int bad = 0;
+    for (int he = 0; he < mesh->triangle_count * 3; ++he) {
+        int t = half_edge_face(he);
+        int k = he - t * 3;
+        int twin = mesh->twin[he];
+        int expected = indices[twin >= 0 ? half_edge_prev(twin) : half_edge_prev(he)];
+        bad += indices[he] != adjacency[t * 6 + k * 2] || expected != adjacency[t * 6 + k * 2 + 1];
+    }
+    return bad;
+}
+
+// Boundary, edge count and symmetry of one mesh, welded by position.
+// 'euler' is V - E + F for the surface: 1 for a disk, 2 for a sphere.
+static void
+check_mesh (BenchContext * ctx, char const * name, std::vector<Vertex> const & vertices,
+            std::vector<int> const & indices, int expected_boundary, int euler) {
+    HalfEdgeMesh mesh;
+    half_edge_build(indices.data(), (int)indices.size(), (int)vertices.size(), &vertices[0].position.x, sizeof(Vertex), &mesh);
+    std::vector<int> pairs(indices.size() * 2);
+    int edges = half_edge_unique_edges(&mesh, indices.data(), pairs.data());
+    std::vector<int> adjacency(indices.size() * 2);
+    half_edge_emit_adjacency(&mesh, indices.data(), adjacency.data());
+    int asymmetric = asymmetric_twins(&mesh, indices.data());
+    int wrong = wrong_neighbours(&mesh, indices.data(), adjacency.data());
+    printf(
+        "%-8s %6d welded vertices, %6d triangles, %6d edges: %d boundary, %d non-manifold, %d asymmetric, %d wrong neighbours\n",
+        name, mesh.welded_count, mesh.triangle_count, edges, mesh.boundary_edges, mesh.nonmanifold_edges, asymmetric, wrong
+    );
+    BENCH_CHECK(ctx, expected_boundary == mesh.boundary_edges && 0 == mesh.nonmanifold_edges);
+    BENCH_CHECK(ctx, euler == mesh.welded_count - edges + mesh.triangle_count);
+    BENCH_CHECK(ctx, 0 == asymmetric && 0 == wrong);
+    half_edge_destroy(&mesh);
+}
+
+void
+bench_adjacency (BenchContext * ctx) {
+    // -- Two triangles sharing the diagonal 0-2 of a quad
+    {
+        int const indices [6] = {0, 1, 2, 0, 2, 3};
+        HalfEdgeMesh mesh;
+        half_edge_build(indices, 6, 4, nullptr, 0, &mesh);
+        BENCH_CHECK(ctx, 3 == mesh.twin[2] && 2 == mesh.twin[3] && 4 == mesh.boundary_edges);
+        int adjacency [12];
+        half_edge_emit_adjacency(&mesh, indices, adjacency);
+        int const expected_adjacency [12] = {0, 2, 1, 0, 2, 3, 0, 1, 2, 0, 3, 2};
+        BENCH_CHECK(ctx, 0 == memcmp(adjacency, expected_adjacency, sizeof(adjacency)));
+        int pairs [12];
+        int edges = half_edge_unique_edges(&mesh, indices, pairs);
+        int const expected_pairs [10] = {0, 1, 1, 2, 2, 0, 2, 3, 3, 0};
+        BENCH_CHECK(ctx, 5 == edges && 0 == memcmp(pairs, expected_pairs, sizeof(expected_pairs)));
+        half_edge_destroy(&mesh);
+    }
+
+    // -- An open grid has its rim as boundary, the welded sphere none
+    {
+        int m = 60;
+        int n = 40;
+        std::vector<Vertex> vertices(m * n);
+        std::vector<int> indices((m - 1) * (n - 1) * 6);
+        create_grid(20.0f, 30.0f, m, n, vertices.data(), indices.data(), nullptr);
+        check_mesh(ctx, "grid", vertices, indices, 2 * (m - 1) + 2 * (n - 1), 1);
+
+        vertices.resize(401);
+        indices.resize(2280);
+        create_sphere(0.5f, vertices.data(), indices.data(), nullptr);
+        check_mesh(ctx, "sphere", vertices, indices, 0, 2);
+    }
+
+    // -- Throughput on a grid of millions of triangles
+    int m = ctx->quick ? 400 : 2000;
+    int n = ctx->quick ? 300 : 1000;
+    std::vector<Vertex> vertices((size_t)m * n);
+    std::vector<int> indices((size_t)(m - 1) * (n - 1) * 6);
+    create_grid(200.0f, 100.0f, m, n, vertices.data(), indices.data(), nullptr);
+    int index_count = (int)indices.size();
+
+    HalfEdgeMesh plain;
+    double t0 = bench_now_ms();
+    half_edge_build(indices.data(), index_count, (int)vertices.size(), nullptr, 0, &plain);
+    double plain_ms = bench_now_ms() - t0;
+    HalfEdgeMesh welded;
+    t0 = bench_now_ms();
+    half_edge_build(indices.data(), index_count, (int)vertices.size(), &vertices[0].position.x, sizeof(Vertex), &welded);
+    double welded_ms = bench_now_ms() - t0;
+
+    std::vector<int> adjacency((size_t)index_count * 2);
+    t0 = bench_now_ms();
+    half_edge_emit_adjacency(&welded, indices.data(), adjacency.data());
+    double adjacency_ms = bench_now_ms() - t0;
+    std::vector<int> pairs((size_t)index_count * 2);
+    t0 = bench_now_ms();
+    int edges = half_edge_unique_edges(&welded, indices.data(), pairs.data());
+    double edges_ms = bench_now_ms() - t0;
+
+    BENCH_CHECK(ctx, 2 * (m - 1) + 2 * (n - 1) == plain.boundary_edges && plain.boundary_edges == welded.boundary_edges);
+    BENCH_CHECK(ctx, 1 == welded.welded_count - edges + welded.triangle_count);
+    BENCH_CHECK(ctx, 0 == asymmetric_twins(&welded, indices.data()));
+    BENCH_CHECK(ctx, 0 == wrong_neighbours(&welded, indices.data(), adjacency.data()));
+    int triangles = welded.triangle_count;
+    printf(
+        "%d triangles: build %.1f ms (%.1f M triangles/s), welded %.1f ms (%.1f M triangles/s), "
+        "adjacency %.1f ms, %d edges %.1f ms, %.1f MB (%.1f MB welded)\n",
+        triangles, plain_ms, triangles / plain_ms / 1e3, welded_ms, triangles / welded_ms / 1e3,
+        adjacency_ms, edges, edges_ms, half_edge_memory(&plain) / 1048576.0, half_edge_memory(&welded) / 1048576.0
+    );
+    half_edge_destroy(&plain);
+    half_edge_destroy(&welded);
+}
@@ -0,0 +1,246 @@
+// CPU BC1-BC7 decoding: hand-computed blocks, BC1-BC5 texel for texel
+// against a literal reading of the D3D11 rules, BC6H and BC7 against
+// hashes of a reference decoder's output, the SSE2 against the scalar
+// paths, and decode throughput in megapixels per second per format.
+
+#include "bench.h"
+#include "bc_decode.h"
+#include "bc_scalar.h"
+
+#include <string.h>
+#include <vector>
+
+// Random blocks; BC7 blocks cycle through modes 0-7 and the reserved
+// mode, which random first bytes would hardly ever reach past mode 3.
+static void
+random_blocks (BcFormat format, int count, uint32_t seed, uint8_t * out) {
+    uint32_t state = seed;
+    int block_bytes = bc_block_bytes(format);
+    for (size_t i = 0; i < (size_t)count * block_bytes; ++i)
+        out[i] = (uint8_t)(bench_rand(&state) >> 24);
+    if (BC_FORMAT_BC7 == format) {
+        for (int i = 0; i < count; ++i) {
+            int mode = i % 9;
+            uint8_t * b = out + (size_t)i * 16;
+            b[0] = 8 == mode ? 0 : (uint8_t)((b[0] & ~((2u << mode) - 1)) | 1u << mode);
+        }
+    }
+}
+
+static uint64_t
+fnv1a (uint64_t h, void const * data, size_t bytes) {
+    for (size_t i = 0; i < bytes; ++i)
+        h = (h ^ ((uint8_t const *)data)[i]) * 0x100000001b3ull;
+    return h;
+}
+
+// -- Reference: one texel at a time, straight from the block bits.
+
+static int
+ref_expand (int v, int bits) {
+    return (v << (8 - bits)) | (v >> (2 * bits - 8));
+}
+static void
+ref_color (uint8_t const * block, bool four_colors, int t, uint8_t out [4]) {
+    int c [2] = {block[0] | block[1] << 8, block[2] | block[3] << 8};
+    int index = (block[4 + t / 4] >> (2 * (t % 4))) & 3;
+    int e [2][3];
+    for (int k = 0; k < 2; ++k) {
+        e[k][0] = ref_expand(c[k] >> 11, 5);
+        e[k][1] = ref_expand((c[k] >> 5) & 63, 6);
+        e[k][2] = ref_expand(c[k] & 31, 5);
+    }
+    bool three_colors = !four_colors && c[0] <= c[1];
+    out[3] = three_colors && 3 == index ? 0 : 255;
+    for (int ch = 0; ch < 3; ++ch) {
+        if (index < 2)
+            out[ch] = (uint8_t)e[index][ch];
+        else if (!three_colors)
+            out[ch] = (uint8_t)(2 == index ? (2 * e[0][ch] + e[1][ch] + 1) / 3 : (e[0][ch] + 2 * e[1][ch] + 1) / 3);
+        else
+            out[ch] = (uint8_t)(2 == index ? (e[0][ch] + e[1][ch] + 1) / 2 : 0);
+    }
+}
+// Signed results round half away from zero, as the D3D11 rules ask.
+static int
+ref_divide (int v, int d) {
+    return v >= 0 ? (2 * v + d) / (2 * d) : -((-2 * v + d) / (2 * d));
+}
+static int
+ref_value (uint8_t const * block, bool is_signed, int t) {
+    int a0 = is_signed ? (int8_t)block[0] : block[0];
+    int a1 = is_signed ? (int8_t)block[1] : block[1];
+    if (is_signed) {
+        a0 = a0 < -127 ? -127 : a0;
+        a1 = a1 < -127 ? -127 : a1;
+    }
+    int index = 0;
+    for (int k = 0; k < 3; ++k) {
+        int bit = 16 + 3 * t + k;
+        index |= ((block[bit / 8] >> (bit % 8)) & 1) << k;
+    }
+    if (index < 2)
+        return index ? a1 : a0;
+    if (a0 > a1)
+        return ref_divide((8 - index) * a0 + (index - 1) * a1, 7);
+    if (index < 6)
+        return ref_divide((6 - index) * a0 + (index - 1) * a1, 5);
+    return 6 == index ? (is_signed ? -127 : 0) : (is_signed ? 127 : 255);
+}
+static void
+ref_texel (BcFormat format, uint8_t const * block, int t, uint8_t out [4]) {
+    bool is_signed = BC_FORMAT_BC4_SNORM == format || BC_FORMAT_BC5_SNORM == format;
+    switch (format) {
+    case BC_FORMAT_BC1:
+        ref_color(block, false, t, out);
+        break;
+    case BC_FORMAT_BC2:
+        ref_color(block + 8, true, t, out);
+        out[3] = (uint8_t)(((block[t / 2] >> (4 * (t % 2))) & 15) * 17);
+        break;
+    case BC_FORMAT_BC3:
+        ref_color(block + 8, true, t, out);
+        out[3] = (uint8_t)ref_value(block, false, t);
+        break;
+    default:
+        out[0] = (uint8_t)ref_value(block, is_signed, t);
+        out[1] = BC_FORMAT_BC5_UNORM == format || BC_FORMAT_BC5_SNORM == format ? (uint8_t)ref_value(block + 8, is_signed, t) : 0;
+        out[2] = 0;
+        out[3] = is_signed ? 127 : 255;
+        break;
+    }
+}
+
+// FNV-1a of the reference decoder's RGBA16F (RGB only, BC6H) or RGBA8
+// (BC7) output for random_blocks(format, 4096, 1) as a 256x256 image.
+// Taken from Mesa's software rasterizer reading the blocks back through
+// glGetTexImage.
+#define _REF_BC6H_UF16  0x739c090b1cd29b54ull
+#define _REF_BC6H_SF16  0xd8fa69a7ecd2df84ull
+#define _REF_BC7        0x83a7e9805c9d6cb5ull
+
+static uint64_t
+output_hash (BcFormat format, uint8_t const * texels, int count) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    if (8 != bc_texel_bytes(format))
+        return fnv1a(h, texels, (size_t)count * 4);
+    for (int i = 0; i < count; ++i)
+        h = fnv1a(h, texels + (size_t)i * 8, 6);
+    return h;
+}
+
+void
+bench_bc_decode (BenchContext * ctx) {
+    // -- Hand-computed blocks
+    {
+        // BC1, red and blue endpoints in four colour mode; the rows index
+        // 0, 1, 2, 3.
+        uint8_t const bc1 [8] = {0x00, 0xf8, 0x1f, 0x00, 0xe4, 0xe4, 0xe4, 0xe4};
+        uint8_t const bc1_row [16] = {255, 0, 0, 255, 0, 0, 255, 255, 170, 0, 85, 255, 85, 0, 170, 255};
+        // Endpoints swapped: three colours and transparent black.
+        uint8_t const bc1_3 [8] = {0x1f, 0x00, 0x00, 0xf8, 0xe4, 0xe4, 0xe4, 0xe4};
+        uint8_t const bc1_3_row [16] = {0, 0, 255, 255, 255, 0, 0, 255, 128, 0, 128, 255, 0, 0, 0, 0};
+        // BC4, 255 to 0, indices 0-7 along the first two rows.
+        uint8_t const bc4 [8] = {255, 0, 0x88, 0xc6, 0xfa, 0x88, 0xc6, 0xfa};
+        uint8_t const bc4_values [8] = {255, 0, 219, 182, 146, 109, 73, 36};
+        uint8_t out [4 * 4 * 4];
+        bc_decode_block(BC_FORMAT_BC1, bc1, out, 16);
+        BENCH_CHECK(ctx, 0 == memcmp(out, bc1_row, 16) && 0 == memcmp(out + 48, bc1_row, 16));
+        bc_decode_block(BC_FORMAT_BC1, bc1_3, out, 16);
+        BENCH_CHECK(ctx, 0 == memcmp(out, bc1_3_row, 16));
+        bc_decode_block(BC_FORMAT_BC4_UNORM, bc4, out, 16);
+        bool bc4_ok = true;
+        for (int t = 0; t < 16; ++t)
+            bc4_ok = bc4_ok && out[t * 4] == bc4_values[t % 8] && 255 == out[t * 4 + 3];
+        BENCH_CHECK(ctx, bc4_ok);
+
+        // Reserved modes decode to zero.
+        uint8_t const bc6h_reserved [16] = {0x13, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+        uint8_t const bc7_reserved [16] = {0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+        uint8_t zero [4 * 4 * 8] = {};
+        uint8_t out16 [4 * 4 * 8];
+        memset(out16, 0xcd, sizeof(out16));
+        bc_decode_block(BC_FORMAT_BC6H_UF16, bc6h_reserved, out16, 32);
+        bool bc6h_zero = true;
+        for (int t = 0; t < 16; ++t)
+            bc6h_zero = bc6h_zero && 0 == memcmp(out16 + t * 8, zero, 6);
+        BENCH_CHECK(ctx, bc6h_zero);
+        memset(out, 0xcd, sizeof(out));
+        bc_decode_block(BC_FORMAT_BC7, bc7_reserved, out, 16);
+        BENCH_CHECK(ctx, 0 == memcmp(out, zero, sizeof(out)));
+    }
+
+    struct { BcFormat format; char const * name; } const formats [] = {
+        {BC_FORMAT_BC1, "bc1"}, {BC_FORMAT_BC2, "bc2"}, {BC_FORMAT_BC3, "bc3"},
+        {BC_FORMAT_BC4_UNORM, "bc4"}, {BC_FORMAT_BC4_SNORM, "bc4 snorm"},
+        {BC_FORMAT_BC5_UNORM, "bc5"}, {BC_FORMAT_BC5_SNORM, "bc5 snorm"},
+        {BC_FORMAT_BC6H_UF16, "bc6h uf16"}, {BC_FORMAT_BC6H_SF16, "bc6h sf16"},
+        {BC_FORMAT_BC7, "bc7"},
+    };
+
+    // -- Reference outputs, on an image with clipped edge blocks for the
+    // texel for texel comparison.
+    for (auto const & f : formats) {
+        int block_bytes = bc_block_bytes(f.format);
+        int texel_bytes = bc_texel_bytes(f.format);
+        bool hashed = 8 == texel_bytes || BC_FORMAT_BC7 == f.format;
+        int width = hashed ? 256 : 254;
+        int height = hashed ? 256 : 129;
+        int blocks_x = (width + 3) / 4;
+        int blocks_y = (height + 3) / 4;
+        std::vector<uint8_t> blocks((size_t)blocks_x * blocks_y * block_bytes);
+        random_blocks(f.format, blocks_x * blocks_y, 1, blocks.data());
+        std::vector<uint8_t> out((size_t)width * height * texel_bytes);
+        std::vector<uint8_t> scalar(out.size());
+        bc_decode_image(f.format, blocks.data(), 0, width, height, out.data(), (size_t)width * texel_bytes);
+        bc_decode_image_scalar(f.format, blocks.data(), 0, width, height, scalar.data(), (size_t)width * texel_bytes);
+        BENCH_CHECK(ctx, out == scalar);
+
+        int mismatched = 0;
+        if (hashed) {
+            uint64_t want = BC_FORMAT_BC7 == f.format ? _REF_BC7 : (BC_FORMAT_BC6H_UF16 == f.format ? _REF_BC6H_UF16 : _REF_BC6H_SF16);
+            mismatched = output_hash(f.format, out.data(), width * height) != want;
+        } else {
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    uint8_t want [4];
+                    ref_texel(f.format, &blocks[((size_t)(y / 4) * blocks_x + x / 4) * block_bytes], (y % 4) * 4 + x % 4, want);
+                    mismatched += 0 != memcmp(want, &out[((size_t)y * width + x) * 4], 4);
+                }
+            }
+        }
+        printf(
+            "%-9s %dx%d %s: %d mismatched%s\n", f.name, width, height,
+            hashed ? "vs reference hash" : "vs D3D11 rules", mismatched, hashed ? " images" : " texels"
+        );
+        BENCH_CHECK(ctx, 0 == mismatched);
+    }
+
+    // -- Throughput
+    int side = ctx->quick ? 512 : 4096;
+    int rounds = ctx->quick ? 1 : 3;
+    for (auto const & f : formats) {
+        int block_bytes = bc_block_bytes(f.format);
+        int texel_bytes = bc_texel_bytes(f.format);
+        int block_count = (side / 4) * (side / 4);
+        std::vector<uint8_t> blocks((size_t)block_count * block_bytes);
+        random_blocks(f.format, block_count, 7, blocks.data());
+        std::vector<uint8_t> out((size_t)side * side * texel_bytes);
+        double best = 1e30;
+        double best_scalar = 1e30;
+        for (int r = 0; r < rounds; ++r) {
+            double t0 = bench_now_ms();
+            bc_decode_image(f.format, blocks.data(), 0, side, side, out.data(), (size_t)side * texel_bytes);
+            double t1 = bench_now_ms();
+            bc_decode_image_scalar(f.format, blocks.data(), 0, side, side, out.data(), (size_t)side * texel_bytes);
+            double t2 = bench_now_ms();
+            best = t1 - t0 < best ? t1 - t0 : best;
+            best_scalar = t2 - t1 < best_scalar ? t2 - t1 : best_scalar;
+        }
+        double mpix = (double)side * side / 1e6;
+        printf(
+            "%-9s %dx%d: %7.1f Mpix/s (%.1f ms), scalar build %7.1f Mpix/s\n",
+            f.name, side, side, mpix / best * 1e3, best, mpix / best_scalar * 1e3
+        );
+    }
+}
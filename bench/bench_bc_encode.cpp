@@ -0,0 +1,125 @@
+// CPU BC encoding on a synthetic photo-like RGBA image (gradients, noise,
+// a hard-edged disk, an alpha ramp): PSNR and throughput of every format
+// at every quality tier, checked against quality floors, the SSE2 against
+// the scalar paths, and a DDS written with bc_save_dds.
+
+#include "bench.h"
+#include "bc_encode.h"
+#include "bc_scalar.h"
+
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+#define _ENCODE_DDS_PATH    "bench_bc_encode.dds"
+
+static void
+synthetic_image (int width, int height, uint8_t * out) {
+    uint32_t state = 7;
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            uint8_t * p = out + ((size_t)y * width + x) * 4;
+            int noise = (int)(bench_rand(&state) >> 24) % 12;
+            float fx = (float)x / width;
+            float fy = (float)y / height;
+            float dx = x - 0.4f * width;
+            float dy = y - 0.45f * height;
+            bool disk = dx * dx + dy * dy < 0.03f * width * height;
+            float r = 255.0f * fx * 0.8f + noise + (disk ? 60.0f : 0.0f);
+            float g = 255.0f * fy * 0.7f + noise + 40.0f * sinf(x * 0.05f) + 40.0f;
+            p[0] = (uint8_t)(r < 255.0f ? r : 255.0f);
+            p[1] = (uint8_t)(g < 255.0f ? g : 255.0f);
+            p[2] = (uint8_t)(disk ? 200.0f : 128.0f + 100.0f * sinf((x + y) * 0.02f));
+            p[3] = (uint8_t)(x < width / 2 || disk ? 255 : (int)(255.0f * fy));
+        }
+    }
+}
+
+void
+bench_bc_encode (BenchContext * ctx) {
+    int width = ctx->quick ? 256 : 512;
+    int height = ctx->quick ? 192 : 384;
+    std::vector<uint8_t> image((size_t)width * height * 4);
+    synthetic_image(width, height, image.data());
+    size_t pitch = (size_t)width * 4;
+    // BC1 keeps one bit of alpha and blacks out the texels it drops, so it
+    // is measured on an opaque copy.
+    std::vector<uint8_t> opaque = image;
+    for (size_t i = 3; i < opaque.size(); i += 4)
+        opaque[i] = 255;
+
+    // Floors sit a little under what each tier reaches on this image, so
+    // a change that costs quality shows up here.
+    struct { BcFormat format; char const * name; double floor [3]; } const formats [] = {
+        {BC_FORMAT_BC1,       "bc1", {37.5, 40.0, 40.0}},
+        {BC_FORMAT_BC3,       "bc3", {38.5, 41.0, 41.0}},
+        {BC_FORMAT_BC4_UNORM, "bc4", {50.5, 50.5, 52.0}},
+        {BC_FORMAT_BC5_UNORM, "bc5", {50.5, 50.5, 52.0}},
+        {BC_FORMAT_BC7,       "bc7", {40.0, 44.5, 45.5}},
+    };
+    char const * tiers [3] = {"realtime", "normal", "high"};
+
+    for (auto const & f : formats) {
+        size_t bytes = bc_encoded_size(f.format, width, height);
+        std::vector<uint8_t> blocks(bytes);
+        std::vector<uint8_t> scalar(bytes);
+        uint8_t const * source = BC_FORMAT_BC1 == f.format ? opaque.data() : image.data();
+        double last_psnr = 0.0;
+        for (int q = 0; q < 3; ++q) {
+            BcQuality quality = (BcQuality)q;
+            double t0 = bench_now_ms();
+            bool encoded = bc_encode_image(f.format, quality, source, pitch, width, height, blocks.data(), 0);
+            double t1 = bench_now_ms();
+            bc_encode_image_scalar(f.format, quality, source, pitch, width, height, scalar.data(), 0);
+            double t2 = bench_now_ms();
+            double psnr = bc_psnr(f.format, source, pitch, width, height, blocks.data());
+            double mpix = (double)width * height / 1e6;
+            printf(
+                "%s %-8s %dx%d: %5.2f dB, %7.2f Mpix/s, scalar build %7.2f Mpix/s\n",
+                f.name, tiers[q], width, height, psnr, mpix / (t1 - t0) * 1e3, mpix / (t2 - t1) * 1e3
+            );
+            BENCH_CHECK(ctx, encoded);
+            BENCH_CHECK(ctx, blocks == scalar);
+            BENCH_CHECK(ctx, psnr >= f.floor[q]);
+            // A slower tier never loses more than rounding noise.
+            BENCH_CHECK(ctx, psnr >= last_psnr - 0.05);
+            last_psnr = psnr;
+        }
+    }
+
+    // -- Partial edge blocks repeat the last column and row.
+    {
+        std::vector<uint8_t> odd(bc_encoded_size(BC_FORMAT_BC7, 13, 7));
+        BENCH_CHECK(ctx, bc_encode_image(BC_FORMAT_BC7, BC_QUALITY_NORMAL, image.data(), pitch, 13, 7, odd.data(), 0));
+        BENCH_CHECK(ctx, bc_psnr(BC_FORMAT_BC7, image.data(), pitch, 13, 7, odd.data()) >= 40.0);
+        BENCH_CHECK(ctx, !bc_encode_image(BC_FORMAT_BC6H_UF16, BC_QUALITY_NORMAL, image.data(), pitch, 13, 7, odd.data(), 0));
+    }
+
+    // -- A DDS with a full mip chain: a 148-byte DX10 header, then the
+    // levels back to back.
+    {
+        int levels = 1;
+        size_t total = bc_encoded_size(BC_FORMAT_BC1, width, height);
+        for (int w = width, h = height; w > 1 || h > 1; ++levels) {
+            w = w > 1 ? w / 2 : 1;
+            h = h > 1 ? h / 2 : 1;
+            total += bc_encoded_size(BC_FORMAT_BC1, w, h);
+        }
+        std::vector<uint8_t> chain(total);
+        for (size_t i = 0; i < total; ++i)
+            chain[i] = (uint8_t)(i * 31);
+        BENCH_CHECK(ctx, bc_save_dds(_ENCODE_DDS_PATH, BC_FORMAT_BC1, true, width, height, levels, chain.data()));
+        std::vector<uint8_t> file(148 + total + 1);
+        FILE * fp = fopen(_ENCODE_DDS_PATH, "rb");
+        size_t read = nullptr != fp ? fread(file.data(), 1, file.size(), fp) : 0;
+        if (nullptr != fp)
+            fclose(fp);
+        uint32_t words [37];
+        memcpy(words, file.data(), sizeof(words));
+        BENCH_CHECK(ctx, read == 148 + total);
+        BENCH_CHECK(ctx, 0x20534444u == words[0] && (uint32_t)height == words[3] && (uint32_t)width == words[4]);
+        BENCH_CHECK(ctx, (uint32_t)levels == words[7] && 72 == words[32]);
+        BENCH_CHECK(ctx, 0 == memcmp(file.data() + 148, chain.data(), total));
+        remove(_ENCODE_DDS_PATH);
+    }
+}
@@ -0,0 +1,119 @@
+// transform_bounds: the four-wide SoA loop against one item at a time, on
+// rotated, non-uniformly scaled and translated bounds, with counts that
+// leave a tail and with the output aliasing the input; then throughput.
+
+#include "bench.h"
+#include "bounds.h"
+
+#include <math.h>
+#include <vector>
+
+static float
+bench_randf (uint32_t * state, float lo, float hi) {
+    return lo + (hi - lo) * (float)(bench_rand(state) >> 8) / 16777216.0f;
+}
+
+static void
+random_bounds (int count, uint32_t seed, std::vector<MeshBounds> * bounds, std::vector<XMFLOAT4X4> * worlds) {
+    uint32_t state = seed;
+    bounds->resize(count);
+    worlds->resize(count);
+    for (int i = 0; i < count; ++i) {
+        MeshBounds & b = (*bounds)[i];
+        b.aabb_center = XMFLOAT3(bench_randf(&state, -5, 5), bench_randf(&state, -5, 5), bench_randf(&state, -5, 5));
+        b.aabb_extents = XMFLOAT3(bench_randf(&state, 0, 3), bench_randf(&state, 0, 3), bench_randf(&state, 0, 3));
+        b.sphere_center = XMFLOAT3(bench_randf(&state, -1, 1), bench_randf(&state, -1, 1), bench_randf(&state, -1, 1));
+        b.sphere_radius = bench_randf(&state, 0.1f, 4);
+        XMVECTOR axis = XMVector3Normalize(XMVectorSet(bench_randf(&state, -1, 1), bench_randf(&state, -1, 1), bench_randf(&state, -1, 1) + 2.0f, 0.0f));
+        float half = bench_randf(&state, 0, XM_PI);
+        XMVECTOR q = XMVectorSetW(XMVectorScale(axis, sinf(half)), cosf(half));
+        XMMATRIX m = XMMatrixAffineTransformation(
+            XMVectorSet(bench_randf(&state, 0.2f, 3), bench_randf(&state, 0.2f, 3), bench_randf(&state, 0.2f, 3), 1.0f),
+            XMVectorZero(), q,
+            XMVectorSet(bench_randf(&state, -50, 50), bench_randf(&state, -50, 50), bench_randf(&state, -50, 50), 1.0f)
+        );
+        XMStoreFloat4x4(&(*worlds)[i], m);
+    }
+}
+
+static float
+bounds_error (MeshBounds const & a, MeshBounds const & b) {
+    float e = fabsf(a.sphere_radius - b.sphere_radius);
+    XMFLOAT3 const * pa [3] = {&a.aabb_center, &a.aabb_extents, &a.sphere_center};
+    XMFLOAT3 const * pb [3] = {&b.aabb_center, &b.aabb_extents, &b.sphere_center};
+    for (int k = 0; k < 3; ++k)
+        e = fmaxf(e, fmaxf(fabsf(pa[k]->x - pb[k]->x), fmaxf(fabsf(pa[k]->y - pb[k]->y), fabsf(pa[k]->z - pb[k]->z))));
+    return e;
+}
+
+void
+bench_bounds (BenchContext * ctx) {
+    // -- Batch against single items, every tail length
+    for (int count = 0; count <= 9; ++count) {
+        std::vector<MeshBounds> in;
+        std::vector<XMFLOAT4X4> worlds;
+        random_bounds(count, 17 + count, &in, &worlds);
+        std::vector<MeshBounds> batch(count);
+        transform_bounds(in.data(), worlds.data(), count, batch.data());
+        std::vector<MeshBounds> aliased = in;
+        transform_bounds(aliased.data(), worlds.data(), count, aliased.data());
+        float worst = 0.0f;
+        for (int i = 0; i < count; ++i) {
+            MeshBounds one;
+            transform_bounds_one(in[i], worlds[i], &one);
+            worst = fmaxf(worst, fmaxf(bounds_error(one, batch[i]), bounds_error(one, aliased[i])));
+        }
+        BENCH_CHECK(ctx, worst < 1e-4f);
+    }
+
+    // -- The box still holds all eight transformed corners
+    {
+        std::vector<MeshBounds> in;
+        std::vector<XMFLOAT4X4> worlds;
+        random_bounds(64, 5, &in, &worlds);
+        std::vector<MeshBounds> out(64);
+        transform_bounds(in.data(), worlds.data(), 64, out.data());
+        int outside = 0;
+        for (int i = 0; i < 64; ++i) {
+            XMMATRIX m = XMLoadFloat4x4(&worlds[i]);
+            XMVECTOR c = XMLoadFloat3(&in[i].aabb_center);
+            XMVECTOR e = XMLoadFloat3(&in[i].aabb_extents);
+            XMVECTOR lo = XMVectorSubtract(XMLoadFloat3(&out[i].aabb_center), XMLoadFloat3(&out[i].aabb_extents));
+            XMVECTOR hi = XMVectorAdd(XMLoadFloat3(&out[i].aabb_center), XMLoadFloat3(&out[i].aabb_extents));
+            for (int k = 0; k < 8; ++k) {
+                XMVECTOR sign = XMVectorSet(k & 1 ? 1.0f : -1.0f, k & 2 ? 1.0f : -1.0f, k & 4 ? 1.0f : -1.0f, 0.0f);
+                XMVECTOR p = XMVector3Transform(XMVectorMultiplyAdd(sign, e, c), m);
+                XMFLOAT3 below;
+                XMFLOAT3 above;
+                XMStoreFloat3(&below, XMVectorSubtract(lo, p));
+                XMStoreFloat3(&above, XMVectorSubtract(p, hi));
+                outside += fmaxf(fmaxf(below.x, below.y), below.z) > 1e-3f || fmaxf(fmaxf(above.x, above.y), above.z) > 1e-3f;
+            }
+        }
+        BENCH_CHECK(ctx, 0 == outside);
+    }
+
+    // -- Throughput
+    int count = ctx->quick ? 10000 : 1000000;
+    int rounds = ctx->quick ? 3 : 10;
+    std::vector<MeshBounds> in;
+    std::vector<XMFLOAT4X4> worlds;
+    random_bounds(count, 99, &in, &worlds);
+    std::vector<MeshBounds> out(count);
+    double batch_ms = 1e30;
+    double one_ms = 1e30;
+    for (int r = 0; r < rounds; ++r) {
+        double t0 = bench_now_ms();
+        transform_bounds(in.data(), worlds.data(), count, out.data());
+        double t1 = bench_now_ms();
+        for (int i = 0; i < count; ++i)
+            transform_bounds_one(in[i], worlds[i], &out[i]);
+        double t2 = bench_now_ms();
+        batch_ms = fmin(batch_ms, t1 - t0);
+        one_ms = fmin(one_ms, t2 - t1);
+    }
+    printf(
+        "%d bounds: four-wide %.2f ms (%.0f M/s), one at a time %.2f ms (%.0f M/s)\n",
+        count, batch_ms, count / batch_ms / 1e3, one_ms, count / one_ms / 1e3
+    );
+}
@@ -0,0 +1,218 @@
+// The batch DDS loader's pipeline, headless: a stand-in upload sink copies
+// each file's subresources to a staging buffer the way a driver would.
+// Every file must reach the sink once, laid out as stored. Broken files
+// must fail alone. maxsize must drop top levels. A legacy 24bpp file must
+// reach the sink expanded to B8G8R8A8. The device path must create the same
+// textures. Then throughput is timed over worker counts
+// and I/O queue depths.
+
+#include "bench.h"
+#include "dds_files.h"
+#include "DDSTextureLoader11.h"
+
+#include <string.h>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+struct BatchFile {
+    uint32_t    format;
+    int         block_bytes;
+    int         bits_per_pixel;
+    int         size;
+    int         mips;
+    int         array_size;
+};
+
+// Bytes of every subresource, in the order the sink is handed them
+static size_t
+subresource_bytes (DDSBatchTexture const & t) {
+    size_t bytes = 0;
+    for (size_t i = 0; i < t.mipCount * t.arraySize; ++i)
+        bytes += t.initData[i].SysMemSlicePitch;
+    return bytes;
+}
+
+void
+bench_dds_batch (BenchContext * ctx) {
+    BatchFile const kinds [4] = {
+        {71, 8, 0, 1024, 11, 1},    // bc1 with mips
+        {98, 16, 0, 512, 10, 1},    // bc7 with mips
+        {28, 0, 32, 256, 1, 1},     // rgba8, no mips
+        {77, 16, 0, 256, 9, 6},     // bc3 array
+    };
+    int count = ctx->quick ? 32 : 256;
+    std::vector<std::string> paths(count);
+    std::vector<std::wstring> wpaths(count);
+    std::vector<wchar_t const *> names(count);
+    std::vector<std::vector<uint8_t>> files(count);
+    size_t total_bytes = 0;
+    for (int i = 0; i < count; ++i) {
+        BatchFile const & k = kinds[i % 4];
+        paths[i] = "bench_dds_batch_" + std::to_string(i) + ".dds";
+        wpaths[i].assign(paths[i].begin(), paths[i].end());
+        names[i] = wpaths[i].c_str();
+        files[i] = dds_make_dx10(k.format, k.block_bytes, k.bits_per_pixel, k.size, k.size, k.mips, k.array_size, 200 + i);
+        BENCH_CHECK(ctx, dds_save(paths[i].c_str(), files[i]));
+        total_bytes += files[i].size();
+    }
+
+    // -- Every file reaches the sink once, with the subresources as stored
+    {
+        DDSBatchOptions options;
+        std::vector<int> delivered(count);
+        int mislaid = 0;
+        DDSBatchSink sink = [&] (DDSBatchTexture const & t) -> HRESULT {
+            ++delivered[t.index];
+            std::vector<uint8_t> const & file = files[t.index];
+            BatchFile const & k = kinds[t.index % 4];
+            size_t offset = 148;
+            bool ok = t.ddsDataSize == file.size() && (int)t.mipCount == k.mips && (int)t.arraySize == k.array_size
+                && (size_t)k.size == t.width && 148 + subresource_bytes(t) == file.size();
+            for (size_t i = 0; ok && i < t.mipCount * t.arraySize; ++i) {
+                ok = 0 == memcmp(t.initData[i].pSysMem, &file[offset], t.initData[i].SysMemSlicePitch);
+                offset += t.initData[i].SysMemSlicePitch;
+            }
+            mislaid += !ok;
+            return S_OK;
+        };
+        std::vector<HRESULT> results(count);
+        BENCH_CHECK(ctx, S_OK == LoadDDSTexturesFromFiles(names.data(), count, options, sink, results.data()));
+        int once = 0;
+        int succeeded = 0;
+        for (int i = 0; i < count; ++i) {
+            once += 1 == delivered[i];
+            succeeded += S_OK == results[i];
+        }
+        BENCH_CHECK(ctx, count == once && count == succeeded && 0 == mislaid);
+
+        // A missing and a truncated file fail on their own; a failure from
+        // the sink becomes that file's result
+        std::string cut = "bench_dds_batch_cut.dds";
+        BENCH_CHECK(ctx, dds_save(cut.c_str(), std::vector<uint8_t>(files[0].begin(), files[0].begin() + files[0].size() / 2)));
+        wchar_t const * mixed [4] = {names[1], L"bench_dds_batch_missing.dds", L"bench_dds_batch_cut.dds", names[2]};
+        HRESULT mixed_results [4] = {};
+        HRESULT hr = LoadDDSTexturesFromFiles(mixed, 4, options, [] (DDSBatchTexture const & t) {
+            return 3 == t.index ? E_FAIL : S_OK;
+        }, mixed_results);
+        BENCH_CHECK(ctx, FAILED(hr));
+        BENCH_CHECK(ctx, S_OK == mixed_results[0] && FAILED(mixed_results[1]) && FAILED(mixed_results[2]) && E_FAIL == mixed_results[3]);
+        remove(cut.c_str());
+
+        // maxsize drops the top levels before the sink sees them
+        options.maxsize = 256;
+        int clamped = 0;
+        LoadDDSTexturesFromFiles(names.data(), 4, options, [&] (DDSBatchTexture const & t) {
+            BatchFile const & k = kinds[t.index % 4];
+            int dropped = 0;
+            for (int s = k.size; s > 256; s /= 2)
+                ++dropped;
+            clamped += t.width <= 256 && (int)t.mipCount == k.mips - dropped;
+            return S_OK;
+        });
+        BENCH_CHECK(ctx, 4 == clamped);
+    }
+
+    // -- A legacy R8G8B8 file reaches the sink, and the device, expanded
+    {
+        int const size = 64;
+        int const mips = 7;
+        std::vector<uint8_t> file = dds_make_legacy(0x40, 24, 0x00ff0000, 0x0000ff00, 0x000000ff, 0, size, size / 2, mips, 77);
+        std::string path = "bench_dds_batch_legacy.dds";
+        BENCH_CHECK(ctx, dds_save(path.c_str(), file));
+        std::wstring wpath(path.begin(), path.end());
+        wchar_t const * legacy_names [1] = {wpath.c_str()};
+
+        // Each texel's three bytes, then an opaque alpha
+        std::vector<uint8_t> expanded;
+        for (size_t i = 128; i + 3 <= file.size(); i += 3) {
+            expanded.insert(expanded.end(), &file[i], &file[i] + 3);
+            expanded.push_back(0xff);
+        }
+        bool sunk = false;
+        DDSBatchOptions options;
+        HRESULT hr = LoadDDSTexturesFromFiles(legacy_names, 1, options, [&] (DDSBatchTexture const & t) {
+            std::vector<uint8_t> joined;
+            for (size_t i = 0; i < t.mipCount * t.arraySize; ++i) {
+                uint8_t const * p = (uint8_t const *)t.initData[i].pSysMem;
+                joined.insert(joined.end(), p, p + t.initData[i].SysMemSlicePitch);
+            }
+            sunk = DXGI_FORMAT_B8G8R8A8_UNORM == t.format && mips == (int)t.mipCount && (size_t)size == t.width &&
+                joined == expanded;
+            return S_OK;
+        });
+        BENCH_CHECK(ctx, S_OK == hr && sunk);
+
+        ID3D11Device device;
+        ID3D11Resource * texture = nullptr;
+        hr = CreateDDSTexturesFromFiles(&device, legacy_names, 1, options, &texture, nullptr);
+        BENCH_CHECK(ctx, S_OK == hr && nullptr != texture);
+        if (texture) {
+            std::vector<uint8_t> joined;
+            for (std::vector<uint8_t> const & sub : texture->subresources)
+                joined.insert(joined.end(), sub.begin(), sub.end());
+            BENCH_CHECK(ctx, DXGI_FORMAT_B8G8R8A8_UNORM == texture->format && joined == expanded);
+            texture->Release();
+        }
+        remove(path.c_str());
+    }
+
+    // -- The device path creates the same textures
+    {
+        ID3D11Device device;
+        DDSBatchOptions options;
+        std::vector<ID3D11Resource *> textures(count);
+        std::vector<DDS_ALPHA_MODE> alpha_modes(count);
+        BENCH_CHECK(ctx, S_OK == CreateDDSTexturesFromFiles(&device, names.data(), count, options, textures.data(), nullptr, nullptr, alpha_modes.data()));
+        int same = 0;
+        for (int i = 0; i < count; ++i) {
+            if (nullptr == textures[i])
+                continue;
+            std::vector<uint8_t> joined;
+            for (std::vector<uint8_t> const & sub : textures[i]->subresources)
+                joined.insert(joined.end(), sub.begin(), sub.end());
+            same += joined.size() + 148 == files[i].size() && 0 == memcmp(joined.data(), &files[i][148], joined.size());
+            textures[i]->Release();
+        }
+        BENCH_CHECK(ctx, count == same);
+    }
+
+    // -- Throughput, the sink copying everything to a staging buffer
+    {
+        std::vector<uint8_t> staging(4 << 20);
+        size_t copied = 0;
+        DDSBatchSink sink = [&] (DDSBatchTexture const & t) -> HRESULT {
+            for (size_t i = 0; i < t.mipCount * t.arraySize; ++i) {
+                size_t bytes = t.initData[i].SysMemSlicePitch;
+                if (bytes > staging.size())
+                    staging.resize(bytes);
+                memcpy(staging.data(), t.initData[i].pSysMem, bytes);
+                copied += bytes;
+            }
+            return S_OK;
+        };
+        size_t const workers [3] = {1, 2, 4};
+        size_t const depths [3] = {1, 4, 16};
+        double mb = total_bytes / 1048576.0;
+        for (size_t w : workers) {
+            for (size_t d : depths) {
+                DDSBatchOptions options;
+                options.workerThreads = w;
+                options.ioQueueDepth = d;
+                copied = 0;
+                double t0 = bench_now_ms();
+                HRESULT hr = LoadDDSTexturesFromFiles(names.data(), count, options, sink);
+                double ms = bench_now_ms() - t0;
+                BENCH_CHECK(ctx, S_OK == hr && copied + 148 * (size_t)count == total_bytes);
+                printf(
+                    "%d files, %.1f MB, %zu worker(s), queue depth %2zu: %7.1f ms, %7.0f files/s, %6.2f GB/s\n",
+                    count, mb, w, d, ms, count / ms * 1e3, mb / 1024.0 / ms * 1e3
+                );
+            }
+        }
+    }
+
+    for (int i = 0; i < count; ++i)
+        remove(paths[i].c_str());
+}
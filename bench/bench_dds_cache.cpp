@@ -0,0 +1,253 @@
+// The DDS texture cache, headless against the stand-in device. Threads
+// asking for the same file while its load is held in flight must all wait
+// for that one load. Going over budget must release the least recently
+// used texture, or with DDS_CACHE_EVICT_DROP_MIPS reload it smaller first,
+// with the stats counting exactly what happened. The content hash must
+// match XXH64 on known answers, and the copy of a file under another path
+// must share its texture while a file differing in its last byte must not;
+// the files span several of the pieces the cache hashes as it reads. Then
+// loading a set of files through the cache is timed with content hashing on
+// and off.
+
+#include "bench.h"
+#include "dds_files.h"
+#include "DDSTextureLoader11.h"
+
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace DirectX;
+
+static bool
+load_all (DDSTextureCache * cache, std::vector<std::wstring> const & names) {
+    DDSLoadOptions options;
+    bool ok = true;
+    for (std::wstring const & name : names) {
+        ID3D11Resource * texture = nullptr;
+        ok = ok && SUCCEEDED(cache->GetTexture(name.c_str(), options, &texture, nullptr));
+        if (texture)
+            texture->Release();
+    }
+    return ok;
+}
+
+// Width of the texture the cache holds for 'name'; counts as a hit
+static UINT
+cached_width (DDSTextureCache * cache, wchar_t const * name) {
+    DDSLoadOptions options;
+    ID3D11Resource * texture = nullptr;
+    if (FAILED(cache->GetTexture(name, options, &texture, nullptr)))
+        return 0;
+    UINT width = texture->width;
+    texture->Release();
+    return width;
+}
+
+// 256x256 RGBA8 with a full chain: every file holds kFull bytes resident,
+// kTop of them in the top level.
+static size_t const kTop = 256 * 256 * 4;
+static size_t const kFull = kTop + kTop / 4 + kTop / 16 + kTop / 64 + kTop / 256 + kTop / 1024 + kTop / 4096 + 16 + 4;
+
+static bool
+stats_are (DDSTextureCacheStats const & s, uint64_t hits, uint64_t misses, uint64_t shared, uint64_t evictions,
+           uint64_t mip_drops, size_t resident, size_t textures) {
+    return s.hits == hits && s.misses == misses && s.sharedLoads == shared && s.evictions == evictions &&
+        s.mipDrops == mip_drops && s.residentBytes == resident && s.textureCount == textures;
+}
+
+void
+bench_dds_cache (BenchContext * ctx) {
+    ID3D11Device device;
+
+    int const file_count = 6;
+    std::string paths [file_count];
+    std::wstring names [file_count];
+    for (int i = 0; i < file_count; ++i) {
+        paths[i] = "bench_dds_cache_t" + std::to_string(i) + ".dds";
+        names[i].assign(paths[i].begin(), paths[i].end());
+        BENCH_CHECK(ctx, dds_save(paths[i].c_str(), dds_make_dx10(28, 0, 32, 256, 256, 9, 1, 40 + i)));
+    }
+
+    // -- Eight threads ask for one file; the load is held until the other
+    // seven are waiting on it, so they all share that one load
+    {
+        int const thread_count = 8;
+        DDSTextureCache cache(&device, kFull * 4);
+        std::atomic<int> creations(0);
+        device.on_created = [&] () {
+            if (0 != creations++)
+                return;
+            auto give_up = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+            while (cache.GetStats().hits < (uint64_t)thread_count - 1 && std::chrono::steady_clock::now() < give_up)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        };
+        ID3D11Resource * textures [thread_count] = {};
+        HRESULT results [thread_count] = {};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < thread_count; ++t) {
+            threads.emplace_back([&, t] () {
+                DDSLoadOptions options;
+                results[t] = cache.GetTexture(names[0].c_str(), options, &textures[t], nullptr);
+            });
+        }
+        for (std::thread & t : threads)
+            t.join();
+        device.on_created = nullptr;
+        int same = 0;
+        for (int t = 0; t < thread_count; ++t) {
+            same += S_OK == results[t] && textures[t] == textures[0];
+            if (textures[t])
+                textures[t]->Release();
+        }
+        BENCH_CHECK(ctx, thread_count == same && 1 == creations);
+        BENCH_CHECK(ctx, stats_are(cache.GetStats(), thread_count - 1, 1, thread_count - 1, 0, 0, kFull, 1));
+    }
+
+    // -- Releasing, budget for three: the fourth file evicts the least
+    // recently used one, which a hit on file 0 keeps from being file 0
+    {
+        DDSTextureCache cache(&device, kFull * 3, DDS_CACHE_EVICT_RELEASE);
+        std::vector<std::wstring> first(names, names + 3);
+        BENCH_CHECK(ctx, load_all(&cache, first));
+        BENCH_CHECK(ctx, 256 == cached_width(&cache, names[0].c_str()));
+        BENCH_CHECK(ctx, load_all(&cache, std::vector<std::wstring>(1, names[3])));
+        BENCH_CHECK(ctx, stats_are(cache.GetStats(), 1, 4, 0, 1, 0, kFull * 3, 3));
+
+        // File 1 went; loading it again evicts file 2, and file 0 stays
+        BENCH_CHECK(ctx, 256 == cached_width(&cache, names[1].c_str()));
+        BENCH_CHECK(ctx, 256 == cached_width(&cache, names[0].c_str()));
+        BENCH_CHECK(ctx, stats_are(cache.GetStats(), 2, 5, 0, 2, 0, kFull * 3, 3));
+    }
+
+    // -- Dropping mips, budget for three and a half: going half a texture
+    // over drops the top level of the least recently used one, going a
+    // whole texture over evicts a texture already dropped (nothing short of
+    // its last level would do) and drops the next
+    {
+        size_t budget = kFull * 3 + kFull / 2;
+        size_t small = kFull - kTop;
+        DDSTextureCache cache(&device, budget, DDS_CACHE_EVICT_DROP_MIPS);
+        std::vector<std::wstring> first(names, names + 4);
+        BENCH_CHECK(ctx, load_all(&cache, first));
+        BENCH_CHECK(ctx, stats_are(cache.GetStats(), 0, 4, 0, 0, 1, kFull * 3 + small, 4));
+        BENCH_CHECK(ctx, 128 == cached_width(&cache, names[0].c_str()));
+
+        // File 0 is now the most recent, so file 1 drops its top level
+        BENCH_CHECK(ctx, load_all(&cache, std::vector<std::wstring>(1, names[4])));
+        BENCH_CHECK(ctx, stats_are(cache.GetStats(), 1, 5, 0, 0, 2, kFull * 3 + small * 2, 5));
+
+        // File 1 at 128 is least recent again and can't give up enough
+        BENCH_CHECK(ctx, load_all(&cache, std::vector<std::wstring>(1, names[5])));
+        DDSTextureCacheStats stats = cache.GetStats();
+        BENCH_CHECK(ctx, stats_are(stats, 1, 6, 0, 1, 3, kFull * 3 + small * 2, 5));
+        BENCH_CHECK(ctx, stats.residentBytes <= budget && stats.peakBytes > budget);
+        BENCH_CHECK(ctx, 128 == cached_width(&cache, names[2].c_str()) && 256 == cached_width(&cache, names[5].c_str()));
+        printf(
+            "drop mips: %llu misses, %llu evictions, %llu mip drops, %zu of %zu bytes resident (peak %zu)\n",
+            (unsigned long long)stats.misses, (unsigned long long)stats.evictions, (unsigned long long)stats.mipDrops,
+            stats.residentBytes, budget, stats.peakBytes
+        );
+    }
+    for (int i = 0; i < file_count; ++i)
+        remove(paths[i].c_str());
+
+    // -- XXH64 known answers, seed 0, across the stripe and tail lengths
+    {
+        struct Answer {
+            size_t      size;
+            uint64_t    hash;
+        };
+        Answer const answers [] = {
+            {0, 0xef46db3751d8e999ull}, {1, 0xa96c7f0ce858bbb7ull}, {3, 0x56e6957632a487f9ull},
+            {4, 0xc60d15b1e3ff8f04ull}, {7, 0xafbefc3d6c6f9a8eull}, {8, 0x3da5c7aa269683e0ull},
+            {31, 0x4a74f3a1a39ad4a1ull}, {32, 0x8d57d6a4671cc43dull}, {33, 0x62c9fd21ed857664ull},
+            {63, 0x5c320a0d2707057full}, {64, 0x7bbabbc45729d17eull}, {100, 0xefa0ad2d3e70c151ull},
+            {1000, 0x99594f4828043d35ull},
+        };
+        uint8_t data [1000];
+        for (int i = 0; i < 1000; ++i)
+            data[i] = (uint8_t)(i * 31 + 7);
+        int wrong = 0;
+        for (Answer const & a : answers)
+            wrong += a.hash != DDSContentHash(data, a.size);
+        char const text [] = "Nobody inspects the spammish repetition";
+        wrong += 0xfbcea83c8a378bf1ull != DDSContentHash((uint8_t const *)text, sizeof(text) - 1);
+        BENCH_CHECK(ctx, 0 == wrong);
+    }
+
+    // -- Identical content under two paths shares one texture, a file that
+    // differs only in its last byte does not, and nothing is shared with
+    // hashing off
+    {
+        std::vector<uint8_t> file = dds_make_dx10(98, 16, 0, 1024, 1024, 11, 1, 11);
+        std::vector<uint8_t> changed = file;
+        changed.back() ^= 1;
+        BENCH_CHECK(ctx, file.size() > 5 * 256 * 1024 && 0 != file.size() % 32);
+        BENCH_CHECK(ctx, dds_save("bench_dds_cache_a.dds", file));
+        BENCH_CHECK(ctx, dds_save("bench_dds_cache_b.dds", file));
+        BENCH_CHECK(ctx, dds_save("bench_dds_cache_c.dds", changed));
+        wchar_t const * names [3] = {L"bench_dds_cache_a.dds", L"bench_dds_cache_b.dds", L"bench_dds_cache_c.dds"};
+        for (int share = 1; share >= 0; --share) {
+            DDSTextureCache cache(&device, 1 << 30, DDS_CACHE_EVICT_RELEASE, 0 != share);
+            DDSLoadOptions options;
+            ID3D11Resource * textures [3] = {};
+            bool loaded = true;
+            for (int i = 0; i < 3; ++i)
+                loaded = loaded && S_OK == cache.GetTexture(names[i], options, &textures[i], nullptr);
+            DDSTextureCacheStats stats = cache.GetStats();
+            BENCH_CHECK(ctx, loaded && textures[0] != textures[2] && textures[1] != textures[2]);
+            if (share)
+                BENCH_CHECK(ctx, textures[0] == textures[1] && 1 == stats.duplicates && 2 == stats.textureCount);
+            else
+                BENCH_CHECK(ctx, textures[0] != textures[1] && 0 == stats.duplicates && 3 == stats.textureCount);
+            for (ID3D11Resource * t : textures) {
+                if (t)
+                    t->Release();
+            }
+        }
+        remove("bench_dds_cache_a.dds");
+        remove("bench_dds_cache_b.dds");
+        remove("bench_dds_cache_c.dds");
+    }
+
+    // -- Load time with and without content hashing, files already in the
+    // OS file cache; best of a few rounds each
+    {
+        int count = ctx->quick ? 8 : 48;
+        int size = ctx->quick ? 512 : 2048;
+        std::vector<std::string> paths(count);
+        std::vector<std::wstring> names(count);
+        size_t total_bytes = 0;
+        for (int i = 0; i < count; ++i) {
+            paths[i] = "bench_dds_cache_" + std::to_string(i) + ".dds";
+            names[i].assign(paths[i].begin(), paths[i].end());
+            std::vector<uint8_t> file = dds_make_dx10(98, 16, 0, size, size, 1, 1, 300 + i);
+            BENCH_CHECK(ctx, dds_save(paths[i].c_str(), file));
+            total_bytes += file.size();
+        }
+        int rounds = ctx->quick ? 2 : 5;
+        double best_ms [2] = {1e30, 1e30};
+        for (int r = 0; r < rounds; ++r) {
+            for (int share = 0; share < 2; ++share) {
+                DDSTextureCache cache(&device, (size_t)1 << 40, DDS_CACHE_EVICT_RELEASE, 0 != share);
+                double t0 = bench_now_ms();
+                bool ok = load_all(&cache, names);
+                double ms = bench_now_ms() - t0;
+                BENCH_CHECK(ctx, ok && (size_t)count == cache.GetStats().textureCount);
+                best_ms[share] = ms < best_ms[share] ? ms : best_ms[share];
+            }
+        }
+        double mb = total_bytes / 1048576.0;
+        printf(
+            "%d files, %.1f MB: hashing off (mapped) %.1f ms (%.2f GB/s), on (read and hashed) %.1f ms (%.2f GB/s), %+.0f%%\n",
+            count, mb, best_ms[0], mb / 1024.0 / best_ms[0] * 1e3, best_ms[1], mb / 1024.0 / best_ms[1] * 1e3,
+            100.0 * (best_ms[1] - best_ms[0]) / best_ms[0]
+        );
+        for (int i = 0; i < count; ++i)
+            remove(paths[i].c_str());
+    }
+}
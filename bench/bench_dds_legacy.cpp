@@ -0,0 +1,146 @@
+// Legacy DDS pixel formats the loader expands on load (24bpp RGB in both
+// byte orders, X8B8G8R8, X1R5G5B5, X4R4G4B4, R3G3B2, A8R3G3B2, A4L4): every
+// level handed to the stand-in device must match a per-pixel expansion of
+// the file, in the DXGI format the expansion maps to, and each format's
+// load is timed against a native B8G8R8A8 file of the same size.
+
+#include "bench.h"
+#include "dds_files.h"
+#include "DDSTextureLoader11.h"
+
+#include <string.h>
+#include <vector>
+
+using namespace DirectX;
+
+struct LegacyCase {
+    char const *    name;
+    uint32_t        flags;
+    int             bits_per_pixel;
+    uint32_t        masks [4];      // r, g, b, a
+    DXGI_FORMAT     format;         // what the loader creates
+    int             out_bytes;
+    int             order [4];      // channel of each output byte, 0-3 r g b a
+    uint32_t        set_bits;       // 16-bit targets keep the texel and set these
+};
+
+// A channel widened to 8 bits by repeating its bits, as the D3D9 formats
+// are meant to be read.
+static uint32_t
+widen (uint32_t texel, uint32_t mask) {
+    if (0 == mask)
+        return 0xff;
+    int shift = 0;
+    int bits = 0;
+    while (0 == (mask >> shift & 1))
+        ++shift;
+    while (shift + bits < 32 && (mask >> (shift + bits) & 1))
+        ++bits;
+    uint32_t v = (texel & mask) >> shift;
+    uint32_t out = 0;
+    for (int s = 8 - bits; s > -bits; s -= bits)
+        out |= s >= 0 ? v << s : v >> -s;
+    return out & 0xff;
+}
+
+static void
+reference_level (LegacyCase const & c, uint8_t const * src, size_t texels, uint8_t * dst) {
+    int in_bytes = c.bits_per_pixel / 8;
+    for (size_t i = 0; i < texels; ++i) {
+        uint32_t texel = 0;
+        memcpy(&texel, src + i * in_bytes, in_bytes);
+        uint8_t * out = dst + i * c.out_bytes;
+        if (c.set_bits) {
+            uint16_t v = (uint16_t)(texel | c.set_bits);
+            memcpy(out, &v, 2);
+            continue;
+        }
+        for (int k = 0; k < c.out_bytes; ++k)
+            out[k] = (uint8_t)widen(texel, c.masks[c.order[k]]);
+    }
+}
+
+void
+bench_dds_legacy (BenchContext * ctx) {
+    LegacyCase const cases [] = {
+        {"r8g8b8",   0x40,    24, {0x00ff0000, 0x0000ff00, 0x000000ff, 0}, DXGI_FORMAT_B8G8R8A8_UNORM, 4, {2, 1, 0, 3}, 0},
+        {"b8g8r8",   0x40,    24, {0x000000ff, 0x0000ff00, 0x00ff0000, 0}, DXGI_FORMAT_R8G8B8A8_UNORM, 4, {0, 1, 2, 3}, 0},
+        {"x8b8g8r8", 0x40,    32, {0x000000ff, 0x0000ff00, 0x00ff0000, 0}, DXGI_FORMAT_R8G8B8A8_UNORM, 4, {0, 1, 2, 3}, 0},
+        {"x1r5g5b5", 0x40,    16, {0x7c00, 0x03e0, 0x001f, 0},             DXGI_FORMAT_B5G5R5A1_UNORM, 2, {}, 0x8000},
+        {"x4r4g4b4", 0x40,    16, {0x0f00, 0x00f0, 0x000f, 0},             DXGI_FORMAT_B4G4R4A4_UNORM, 2, {}, 0xf000},
+        {"r3g3b2",   0x40,    8,  {0xe0, 0x1c, 0x03, 0},                   DXGI_FORMAT_B8G8R8A8_UNORM, 4, {2, 1, 0, 3}, 0},
+        {"a8r3g3b2", 0x41,    16, {0x00e0, 0x001c, 0x0003, 0xff00},        DXGI_FORMAT_B8G8R8A8_UNORM, 4, {2, 1, 0, 3}, 0},
+        {"a4l4",     0x20001, 8,  {0x0f, 0, 0, 0xf0},                      DXGI_FORMAT_R8G8_UNORM,     2, {0, 3}, 0},
+    };
+
+    // Odd sizes, so every kernel also runs its scalar tail
+    int width = ctx->quick ? 1027 : 4099;
+    int height = ctx->quick ? 515 : 2049;
+    int mips = 1;
+    for (int w = width, h = height; w > 1 || h > 1; ++mips) {
+        w = w > 1 ? w / 2 : 1;
+        h = h > 1 ? h / 2 : 1;
+    }
+    double mpix = 0.0;
+    for (int w = width, h = height, m = 0; m < mips; ++m) {
+        mpix += (double)w * h / 1e6;
+        w = w > 1 ? w / 2 : 1;
+        h = h > 1 ? h / 2 : 1;
+    }
+
+    ID3D11Device device;
+    int rounds = ctx->quick ? 2 : 5;
+    auto best_load_ms = [&] (std::vector<uint8_t> const & file) {
+        double best = 1e30;
+        for (int r = 0; r < rounds; ++r) {
+            ID3D11Resource * tex = nullptr;
+            double t0 = bench_now_ms();
+            HRESULT hr = CreateDDSTextureFromMemory(&device, file.data(), file.size(), &tex, nullptr);
+            double t1 = bench_now_ms();
+            BENCH_CHECK(ctx, SUCCEEDED(hr));
+            if (tex)
+                tex->Release();
+            best = t1 - t0 < best ? t1 - t0 : best;
+        }
+        return best;
+    };
+
+    // -- The baseline: B8G8R8A8 maps straight to a DXGI format and is only copied
+    std::vector<uint8_t> native = dds_make_legacy(0x41, 32, 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000, width, height, mips, 5);
+    double native_ms = best_load_ms(native);
+    printf("%-8s %dx%d, %2d mips: %7.2f ms, %7.1f Mpix/s\n", "bgra8", width, height, mips, native_ms, mpix / native_ms * 1e3);
+
+    for (LegacyCase const & c : cases) {
+        std::vector<uint8_t> file = dds_make_legacy(
+            c.flags, c.bits_per_pixel, c.masks[0], c.masks[1], c.masks[2], c.masks[3], width, height, mips, 5
+        );
+
+        // -- Every level, as the device receives it
+        ID3D11Resource * tex = nullptr;
+        BENCH_CHECK(ctx, SUCCEEDED(CreateDDSTextureFromMemory(&device, file.data(), file.size(), &tex, nullptr)));
+        int mismatched = -1;
+        if (nullptr != tex && c.format == tex->format && mips == (int)tex->mip_levels) {
+            mismatched = 0;
+            size_t offset = 128;
+            std::vector<uint8_t> expected;
+            for (int w = width, h = height, m = 0; m < mips; ++m) {
+                size_t texels = (size_t)w * h;
+                expected.resize(texels * c.out_bytes);
+                reference_level(c, &file[offset], texels, expected.data());
+                mismatched += tex->subresources[m] != expected || tex->row_pitches[m] != (size_t)w * c.out_bytes;
+                offset += texels * (c.bits_per_pixel / 8);
+                w = w > 1 ? w / 2 : 1;
+                h = h > 1 ? h / 2 : 1;
+            }
+        }
+        if (tex)
+            tex->Release();
+
+        double ms = best_load_ms(file);
+        printf(
+            "%-8s %dx%d, %2d mips: %7.2f ms, %7.1f Mpix/s (%.2fx the native load), %d level(s) off\n",
+            c.name, width, height, mips, ms, mpix / ms * 1e3, native_ms / ms, mismatched
+        );
+        BENCH_CHECK(ctx, 0 == mismatched);
+    }
+}
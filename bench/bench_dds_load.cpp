@@ -0,0 +1,161 @@
+// DDS loading through a mapped view against the stand-in device: every
+// subresource handed over must be the file's bytes at the offset the DDS
+// layout puts them, the same as a load from a heap copy of the file, and
+// broken files must fail. Then whole loads (mapped, and read into the heap
+// first) and the header parse plus FillInitData layout alone are timed.
+
+#include "bench.h"
+#include "dds_files.h"
+#include "DDSTextureLoader11.h"
+
+#include <string.h>
+#include <vector>
+
+using namespace DirectX;
+
+#define _DDS_LOAD_PATH      "bench_dds_load.dds"
+#define _DDS_LOAD_WPATH     L"bench_dds_load.dds"
+
+struct LoadCase {
+    char const *    name;
+    uint32_t        format;
+    int             block_bytes;
+    int             bits_per_pixel;
+    int             width;
+    int             height;
+    int             mips;
+    int             array_size;
+};
+
+static std::vector<uint8_t>
+read_file (char const * path) {
+    std::vector<uint8_t> bytes;
+    FILE * f = fopen(path, "rb");
+    if (nullptr == f)
+        return bytes;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    bytes.resize(size > 0 ? (size_t)size : 0);
+    if (fread(bytes.data(), 1, bytes.size(), f) != bytes.size())
+        bytes.clear();
+    fclose(f);
+    return bytes;
+}
+
+// Checks the subresources against the file: slice-major, level after level,
+// tight rows.
+static bool
+layout_matches (ID3D11Resource * tex, LoadCase const & c, std::vector<uint8_t> const & file) {
+    if (nullptr == tex || (int)tex->mip_levels != c.mips || (int)tex->array_size != c.array_size)
+        return false;
+    size_t offset = 148;
+    for (int slice = 0; slice < c.array_size; ++slice) {
+        int w = c.width;
+        int h = c.height;
+        for (int mip = 0; mip < c.mips; ++mip) {
+            size_t bytes = dds_level_bytes(c.block_bytes, c.bits_per_pixel, w, h);
+            size_t row = c.block_bytes ? (size_t)((w + 3) / 4) * c.block_bytes : ((size_t)w * c.bits_per_pixel + 7) / 8;
+            std::vector<uint8_t> const & sub = tex->subresources[slice * c.mips + mip];
+            if (sub.size() != bytes || tex->row_pitches[slice * c.mips + mip] != row || 0 != memcmp(sub.data(), &file[offset], bytes))
+                return false;
+            offset += bytes;
+            w = w > 1 ? w / 2 : 1;
+            h = h > 1 ? h / 2 : 1;
+        }
+    }
+    return offset == file.size();
+}
+
+void
+bench_dds_load (BenchContext * ctx) {
+    int big = ctx->quick ? 1024 : 4096;
+    LoadCase const cases [] = {
+        {"bc1",       71, 8, 0, big, big, 1 + (ctx->quick ? 10 : 12), 1},
+        {"bc7",       98, 16, 0, big, big, 1 + (ctx->quick ? 10 : 12), 1},
+        {"rgba8",     28, 0, 32, big / 2, big / 2, 1, 1},
+        {"bc3 array", 77, 16, 0, 512, 256, 10, 6},
+        {"bc1 odd",   71, 8, 0, 300, 123, 9, 1},
+    };
+
+    ID3D11Device device;
+    int rounds = ctx->quick ? 2 : 5;
+    for (LoadCase const & c : cases) {
+        std::vector<uint8_t> file = dds_make_dx10(c.format, c.block_bytes, c.bits_per_pixel, c.width, c.height, c.mips, c.array_size, 11);
+        BENCH_CHECK(ctx, dds_save(_DDS_LOAD_PATH, file));
+
+        // -- What the device receives, mapped and from memory
+        ID3D11Resource * mapped = nullptr;
+        ID3D11Resource * copied = nullptr;
+        ID3D11ShaderResourceView * view = nullptr;
+        BENCH_CHECK(ctx, SUCCEEDED(CreateDDSTextureFromFile(&device, _DDS_LOAD_WPATH, &mapped, &view)));
+        BENCH_CHECK(ctx, SUCCEEDED(CreateDDSTextureFromMemory(&device, file.data(), file.size(), &copied, nullptr)));
+        BENCH_CHECK(ctx, layout_matches(mapped, c, file));
+        BENCH_CHECK(ctx, layout_matches(copied, c, file));
+        BENCH_CHECK(ctx, nullptr != view && view->resource == mapped);
+        if (view)
+            view->Release();
+        if (mapped)
+            mapped->Release();
+        if (copied)
+            copied->Release();
+
+        // -- Timings, best of a few runs with the file in the page cache
+        double best_mapped = 1e30;
+        double best_heap = 1e30;
+        double best_layout = 1e30;
+        for (int r = 0; r < rounds; ++r) {
+            ID3D11Resource * tex = nullptr;
+            double t0 = bench_now_ms();
+            CreateDDSTextureFromFile(&device, _DDS_LOAD_WPATH, &tex, nullptr);
+            double t1 = bench_now_ms();
+            if (tex)
+                tex->Release();
+
+            t1 = bench_now_ms();
+            std::vector<uint8_t> heap = read_file(_DDS_LOAD_PATH);
+            tex = nullptr;
+            CreateDDSTextureFromMemory(&device, heap.data(), heap.size(), &tex, nullptr);
+            double t2 = bench_now_ms();
+            if (tex)
+                tex->Release();
+
+            device.copy_data = false;
+            tex = nullptr;
+            double t3 = bench_now_ms();
+            CreateDDSTextureFromMemory(&device, file.data(), file.size(), &tex, nullptr);
+            double t4 = bench_now_ms();
+            device.copy_data = true;
+            if (tex)
+                tex->Release();
+
+            best_mapped = t1 - t0 < best_mapped ? t1 - t0 : best_mapped;
+            best_heap = t2 - t1 < best_heap ? t2 - t1 : best_heap;
+            best_layout = t4 - t3 < best_layout ? t4 - t3 : best_layout;
+        }
+        double mb = file.size() / 1048576.0;
+        printf(
+            "%-9s %5dx%-5d %2d mips x%d, %6.1f MB: mapped %7.2f ms (%5.2f GB/s), read+copy %7.2f ms, layout only %.3f ms (%d subresources)\n",
+            c.name, c.width, c.height, c.mips, c.array_size, mb,
+            best_mapped, mb / 1024.0 / best_mapped * 1e3, best_heap, best_layout, c.mips * c.array_size
+        );
+    }
+
+    // -- Broken files fail instead of handing over bad pointers.
+    {
+        std::vector<uint8_t> file = dds_make_dx10(71, 8, 0, 256, 256, 9, 1, 3);
+        struct { char const * name; size_t size; } const broken [] = {
+            {"empty", 0}, {"header cut short", 100}, {"texels cut short", file.size() - 1000},
+        };
+        for (auto const & b : broken) {
+            BENCH_CHECK(ctx, dds_save(_DDS_LOAD_PATH, std::vector<uint8_t>(file.begin(), file.begin() + b.size)));
+            ID3D11Resource * tex = nullptr;
+            HRESULT hr = CreateDDSTextureFromFile(&device, _DDS_LOAD_WPATH, &tex, nullptr);
+            printf("%s: hr 0x%08x\n", b.name, (unsigned)hr);
+            BENCH_CHECK(ctx, FAILED(hr) && nullptr == tex);
+        }
+        remove(_DDS_LOAD_PATH);
+        ID3D11Resource * tex = nullptr;
+        BENCH_CHECK(ctx, HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND) == CreateDDSTextureFromFile(&device, _DDS_LOAD_WPATH, &tex, nullptr));
+    }
+}
@@ -0,0 +1,159 @@
+// CPU mip generation for DDS files that ship only their top level: the box
+// filter must match a 2x2 integer average, the sRGB box an average in
+// linear light, the Kaiser filter must keep a flat colour flat in every
+// column (the SSE2 and scalar encoders round alike), and the thread count
+// must not change the result. Then whole chains are timed from 4K and 8K
+// sources with every filter.
+
+#include "bench.h"
+#include "dds_files.h"
+#include "DDSTextureLoader11.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+using namespace DirectX;
+
+#define _MIPS_RGBA8     28      // DXGI_FORMAT_R8G8B8A8_UNORM
+
+static float
+srgb_to_linear (float c) {
+    return c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static float
+linear_to_srgb (float c) {
+    return c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+}
+
+// One level from the one above: 2x2 per texel, the last row or column
+// repeated where the level above is odd. Returns the largest difference
+// from 'level'.
+static int
+box_level_error (uint8_t const * src, int src_w, int src_h, uint8_t const * level, bool srgb) {
+    int w = src_w > 1 ? src_w / 2 : 1;
+    int h = src_h > 1 ? src_h / 2 : 1;
+    int worst = 0;
+    for (int y = 0; y < h; ++y) {
+        int y0 = 2 * y < src_h ? 2 * y : src_h - 1;
+        int y1 = 2 * y + 1 < src_h ? 2 * y + 1 : src_h - 1;
+        for (int x = 0; x < w; ++x) {
+            int x0 = 2 * x < src_w ? 2 * x : src_w - 1;
+            int x1 = 2 * x + 1 < src_w ? 2 * x + 1 : src_w - 1;
+            uint8_t const * p [4] = {
+                src + ((size_t)y0 * src_w + x0) * 4, src + ((size_t)y0 * src_w + x1) * 4,
+                src + ((size_t)y1 * src_w + x0) * 4, src + ((size_t)y1 * src_w + x1) * 4,
+            };
+            for (int c = 0; c < 4; ++c) {
+                int expected;
+                if (srgb && c < 3) {
+                    float sum = 0.0f;
+                    for (int k = 0; k < 4; ++k)
+                        sum += srgb_to_linear(p[k][c] / 255.0f);
+                    expected = (int)(linear_to_srgb(sum * 0.25f) * 255.0f + 0.5f);
+                } else {
+                    expected = (p[0][c] + p[1][c] + p[2][c] + p[3][c] + 2) >> 2;
+                }
+                int diff = abs(expected - (int)level[((size_t)y * w + x) * 4 + c]);
+                worst = diff > worst ? diff : worst;
+            }
+        }
+    }
+    return worst;
+}
+
+static ID3D11Resource *
+load_with_mips (ID3D11Device * device, std::vector<uint8_t> const & file, DDS_MIP_FILTER filter, bool srgb, size_t threads) {
+    DDSMipOptions options;
+    options.filter = filter;
+    options.srgbFilter = srgb;
+    options.threads = threads;
+    ID3D11Resource * tex = nullptr;
+    if (FAILED(CreateDDSTextureFromMemoryWithMips(device, file.data(), file.size(), options, &tex, nullptr)))
+        return nullptr;
+    return tex;
+}
+
+void
+bench_dds_mips (BenchContext * ctx) {
+    ID3D11Device device;
+
+    // -- Box and sRGB box against the reference, at an odd size
+    {
+        int width = 301;
+        int height = 77;
+        std::vector<uint8_t> file = dds_make_dx10(_MIPS_RGBA8, 0, 32, width, height, 1, 1, 21);
+        for (int srgb = 0; srgb < 2; ++srgb) {
+            ID3D11Resource * tex = load_with_mips(&device, file, DDS_MIP_FILTER_BOX, 0 != srgb, 0);
+            BENCH_CHECK(ctx, nullptr != tex && 9 == tex->mip_levels);
+            if (nullptr == tex)
+                continue;
+            BENCH_CHECK(ctx, 0 == memcmp(tex->subresources[0].data(), &file[148], (size_t)width * height * 4));
+            int worst = 0;
+            for (int m = 1, w = width, h = height; m < (int)tex->mip_levels; ++m) {
+                int e = box_level_error(tex->subresources[m - 1].data(), w, h, tex->subresources[m].data(), 0 != srgb);
+                worst = e > worst ? e : worst;
+                w = w > 1 ? w / 2 : 1;
+                h = h > 1 ? h / 2 : 1;
+            }
+            printf("%s box %dx%d: %u levels, off by at most %d\n", srgb ? "srgb  " : "linear", width, height, tex->mip_levels, worst);
+            // The sRGB encoder goes through a 16-bit table, which can land one step away
+            BENCH_CHECK(ctx, worst <= (srgb ? 1 : 0));
+            tex->Release();
+        }
+
+        // -- A flat colour stays flat through the Kaiser filter in every column
+        uint8_t const flat [4] = {37, 128, 200, 255};
+        std::vector<uint8_t> flat_file = file;
+        for (size_t i = 148; i < flat_file.size(); ++i)
+            flat_file[i] = flat[(i - 148) & 3];
+        ID3D11Resource * tex = load_with_mips(&device, flat_file, DDS_MIP_FILTER_KAISER, false, 0);
+        int off = -1;
+        if (nullptr != tex) {
+            off = 0;
+            for (UINT m = 0; m < tex->mip_levels; ++m) {
+                std::vector<uint8_t> const & level = tex->subresources[m];
+                for (size_t i = 0; i < level.size(); ++i)
+                    off += level[i] != flat[i & 3];
+            }
+            tex->Release();
+        }
+        printf("kaiser flat %dx%d: %d bytes off\n", width, height, off);
+        BENCH_CHECK(ctx, 0 == off);
+
+        // -- Bands and slices split across threads give the same chain
+        ID3D11Resource * one = load_with_mips(&device, file, DDS_MIP_FILTER_KAISER, false, 1);
+        ID3D11Resource * many = load_with_mips(&device, file, DDS_MIP_FILTER_KAISER, false, 4);
+        BENCH_CHECK(ctx, nullptr != one && nullptr != many && one->subresources == many->subresources);
+        if (one)
+            one->Release();
+        if (many)
+            many->Release();
+    }
+
+    // -- Whole chains from large sources; creation copies nothing, so
+    // this is the generator and the layout
+    struct { char const * name; DDS_MIP_FILTER filter; bool srgb; } const filters [] = {
+        {"box",      DDS_MIP_FILTER_BOX,    false},
+        {"srgb box", DDS_MIP_FILTER_BOX,    true},
+        {"kaiser",   DDS_MIP_FILTER_KAISER, false},
+    };
+    int const sizes [2] = {ctx->quick ? 512 : 4096, ctx->quick ? 1024 : 8192};
+    device.copy_data = false;
+    for (int size : sizes) {
+        std::vector<uint8_t> file = dds_make_dx10(_MIPS_RGBA8, 0, 32, size, size, 1, 1, 9);
+        double mpix = (double)size * size / 1e6;
+        for (auto const & f : filters) {
+            double t0 = bench_now_ms();
+            ID3D11Resource * tex = load_with_mips(&device, file, f.filter, f.srgb, 0);
+            double ms = bench_now_ms() - t0;
+            BENCH_CHECK(ctx, nullptr != tex && (UINT)(log2(size) + 1) == tex->mip_levels);
+            if (tex)
+                tex->Release();
+            printf("%-8s %5dx%-5d: %8.1f ms, %6.1f Mpix/s of source\n", f.name, size, size, ms, mpix / ms * 1e3);
+        }
+    }
+    device.copy_data = true;
+}
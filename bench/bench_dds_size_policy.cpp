@@ -0,0 +1,263 @@
+// Budget-driven load sizes, headless: every read the loader makes goes
+// through the pread below, which logs it. For a 2D array and a cube, at
+// several budgets, priorities and size limits, the policy must skip the
+// expected top levels, read the header and then exactly the kept levels of
+// each slice, report those bytes as read and the rest as skipped, and
+// create the texture at the reduced size from the file's bytes. A policy
+// that loads several textures must count what earlier ones hold. Then a
+// set of files is timed with the whole budget and with a tight one.
+
+#include "bench.h"
+#include "dds_files.h"
+#include "DDSTextureLoader11.h"
+
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+struct FileRead {
+    size_t      offset;
+    size_t      size;
+};
+
+static bool                     s_log_reads = false;
+static std::vector<FileRead>    s_reads;
+
+// The loader's FileReader reads with pread; this one, linked into the
+// bench, takes its place, so what it logs is all the loader read. The
+// checks are single threaded.
+extern "C" ssize_t
+pread (int fd, void * buf, size_t count, off_t offset) {
+    ssize_t n = syscall(SYS_pread64, fd, buf, count, offset);
+    if (s_log_reads && n > 0)
+        s_reads.push_back(FileRead{(size_t)offset, (size_t)n});
+    return n;
+}
+
+struct PolicyFile {
+    char            path [40];
+    wchar_t         wpath [40];
+    int             block_bytes;
+    int             bits_per_pixel;
+    int             width;
+    int             height;
+    int             mips;
+    int             slices;
+    std::vector<uint8_t> bytes;
+};
+
+static bool
+save_policy_file (PolicyFile * f, char const * name) {
+    snprintf(f->path, sizeof(f->path), "bench_dds_size_policy_%s.dds", name);
+    for (int i = 0; i < 40; ++i)
+        f->wpath[i] = (wchar_t)f->path[i];
+    return dds_save(f->path, f->bytes);
+}
+
+static size_t
+level_bytes (PolicyFile const & f, int mip) {
+    int w = f.width >> mip;
+    int h = f.height >> mip;
+    return dds_level_bytes(f.block_bytes, f.bits_per_pixel, w ? w : 1, h ? h : 1);
+}
+
+// Loads 'f' through 'policy' and checks it skipped 'skip' levels: the
+// reads, the result, and the texture's size and bytes. Returns the
+// texture's resident bytes.
+static size_t
+check_load (BenchContext * ctx, DDSSizePolicy * policy, PolicyFile const & f, char const * what,
+            DDSSizeClass const & size_class, int skip) {
+    size_t chain = dds_chain_bytes(f.block_bytes, f.bits_per_pixel, f.width, f.height, f.mips);
+    size_t skipped = 0;
+    for (int m = 0; m < skip; ++m)
+        skipped += level_bytes(f, m);
+    size_t kept = chain - skipped;
+
+    ID3D11Resource * texture = nullptr;
+    DDSSizeResult result;
+    s_reads.clear();
+    s_log_reads = true;
+    HRESULT hr = policy->CreateTexture(
+        f.wpath, size_class, D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0, false, &texture, nullptr, &result
+    );
+    s_log_reads = false;
+    BENCH_CHECK(ctx, S_OK == hr && nullptr != texture);
+    if (FAILED(hr) || nullptr == texture)
+        return 0;
+
+    // The header, then one read per slice starting past its skipped levels
+    size_t read = 0;
+    bool reads_ok = s_reads.size() == (size_t)f.slices + 1 && 0 == s_reads[0].offset && 148 == s_reads[0].size;
+    for (int s = 0; reads_ok && s < f.slices; ++s) {
+        FileRead const & r = s_reads[s + 1];
+        reads_ok = 148 + s * chain + skipped == r.offset && kept == r.size;
+    }
+    for (FileRead const & r : s_reads)
+        read += r.size;
+    BENCH_CHECK(ctx, reads_ok);
+    BENCH_CHECK(ctx, read == result.bytesRead && 148 + kept * f.slices == read);
+    BENCH_CHECK(ctx, skipped * f.slices == result.bytesSkipped && kept * f.slices == result.residentBytes);
+    BENCH_CHECK(ctx, (uint32_t)skip == result.skippedMips);
+    BENCH_CHECK(ctx, (skip ? (size_t)((f.width > f.height ? f.width : f.height) >> skip) : 0) == result.maxsize);
+
+    int w = f.width >> skip ? f.width >> skip : 1;
+    int h = f.height >> skip ? f.height >> skip : 1;
+    BENCH_CHECK(ctx, (UINT)w == texture->width && (UINT)h == texture->height);
+    BENCH_CHECK(ctx, (UINT)(f.mips - skip) == texture->mip_levels && (UINT)f.slices == texture->array_size);
+
+    // Each slice's top level is the file's level 'skip' of that slice
+    bool bytes_ok = true;
+    for (int s = 0; bytes_ok && s < f.slices; ++s) {
+        std::vector<uint8_t> const & top = texture->subresources[(size_t)s * (f.mips - skip)];
+        size_t bytes = level_bytes(f, skip);
+        bytes_ok = top.size() == bytes && 0 == memcmp(top.data(), &f.bytes[148 + s * chain + skipped], bytes);
+    }
+    BENCH_CHECK(ctx, bytes_ok);
+    texture->Release();
+
+    printf(
+        "%-30s %4dx%-4d x%d, skipped %d: %8zu bytes read, %8zu skipped\n",
+        what, w, h, f.slices, skip, result.bytesRead, result.bytesSkipped
+    );
+    return result.residentBytes;
+}
+
+static DDSSizeClass
+size_class (float priority, size_t min_size, size_t max_size) {
+    DDSSizeClass c;
+    c.priority = priority;
+    c.minSize = min_size;
+    c.maxSize = max_size;
+    return c;
+}
+
+void
+bench_dds_size_policy (BenchContext * ctx) {
+    ID3D11Device device;
+
+    // RGBA8 256x128, three slices of 174764 bytes: the top level is 393216
+    // of the 524292, the next 98304
+    PolicyFile array;
+    array.block_bytes = 0;
+    array.bits_per_pixel = 32;
+    array.width = 256;
+    array.height = 128;
+    array.mips = 9;
+    array.slices = 3;
+    array.bytes = dds_make_dx10(28, 0, 32, array.width, array.height, array.mips, array.slices, 61);
+    BENCH_CHECK(ctx, save_policy_file(&array, "array"));
+
+    // BC1 128x128, six faces of 10936 bytes: the top level is 49152 of the
+    // 65616, the next 12288
+    PolicyFile cube;
+    cube.block_bytes = 8;
+    cube.bits_per_pixel = 0;
+    cube.width = cube.height = 128;
+    cube.mips = 8;
+    cube.slices = 6;
+    cube.bytes = dds_make_cube(71, 8, 0, cube.width, cube.mips, 62);
+    BENCH_CHECK(ctx, save_policy_file(&cube, "cube"));
+
+    // -- One texture per policy, so only its own budget share counts
+    struct Case {
+        PolicyFile const *  file;
+        char const *        what;
+        size_t              budget;
+        DDSSizeClass        size_class;
+        int                 skip;
+    } const cases [] = {
+        { &array, "array, whole budget",         1 << 20, size_class(1.0f,   0,  0), 0 },
+        { &array, "array, 200000",                200000, size_class(1.0f,   0,  0), 1 },
+        { &array, "array, 200000 at 0.25",        200000, size_class(0.25f,  0,  0), 2 },
+        { &array, "array, 200000 at 0.25, >=128", 200000, size_class(0.25f, 128, 0), 1 },
+        { &array, "array, whole budget, <=64",   1 << 20, size_class(1.0f,   0, 64), 2 },
+        { &array, "array, no budget",                  0, size_class(1.0f,   0,  0), 8 },
+        { &cube,  "cube, whole budget",          1 << 20, size_class(1.0f,   0,  0), 0 },
+        { &cube,  "cube, 20000",                   20000, size_class(1.0f,   0,  0), 1 },
+        { &cube,  "cube, 20000 at 0.5",            20000, size_class(0.5f,   0,  0), 2 },
+        { &cube,  "cube, 20000 at 0",              20000, size_class(0.0f,   0,  0), 7 },
+    };
+    for (Case const & c : cases) {
+        DDSSizePolicy policy(&device, c.budget);
+        size_t resident = check_load(ctx, &policy, *c.file, c.what, c.size_class, c.skip);
+        DDSSizePolicyStats stats = policy.GetStats();
+        BENCH_CHECK(ctx, 1 == stats.textures && resident == stats.committedBytes);
+    }
+
+    // -- One policy, 600000: the array and the cube fit whole, a second
+    // array gets the 10092 left and keeps 8196 bytes from level 3; with the
+    // first array released, half the budget less the 73812 held leaves
+    // room down from level 1
+    {
+        DDSSizePolicy policy(&device, 600000);
+        DDSSizeClass all = size_class(1.0f, 0, 0);
+        size_t first = check_load(ctx, &policy, array, "shared, array", all, 0);
+        size_t held = check_load(ctx, &policy, cube, "shared, cube", all, 0);
+        held += check_load(ctx, &policy, array, "shared, array again", all, 3);
+        BENCH_CHECK(ctx, 73812 == held && first + held == policy.GetStats().committedBytes);
+        policy.Release(first);
+        held += check_load(ctx, &policy, array, "shared, array at 0.5", size_class(0.5f, 0, 0), 1);
+
+        DDSSizePolicyStats stats = policy.GetStats();
+        size_t array_file = array.bytes.size() - 148;
+        size_t cube_file = cube.bytes.size() - 148;
+        BENCH_CHECK(ctx, 4 == stats.textures && 4 == stats.skippedMips && held == stats.committedBytes);
+        BENCH_CHECK(ctx, stats.bytesRead + stats.bytesSkipped == 4 * 148 + 3 * array_file + cube_file);
+        BENCH_CHECK(ctx, 600000 == stats.budgetBytes);
+    }
+    remove(array.path);
+    remove(cube.path);
+
+    // -- Timing: BC7 files with full chains, loaded whole and then with a
+    // budget for about a quarter of them, which skips their top levels
+    int const file_count = ctx->quick ? 8 : 32;
+    int const size = ctx->quick ? 512 : 2048;
+    int mips = 1;
+    while (size >> mips)
+        ++mips;
+    std::vector<std::string> paths(file_count);
+    std::vector<std::wstring> names(file_count);
+    size_t file_bytes = 0;
+    for (int i = 0; i < file_count; ++i) {
+        paths[i] = "bench_dds_size_policy_t" + std::to_string(i) + ".dds";
+        names[i].assign(paths[i].begin(), paths[i].end());
+        std::vector<uint8_t> bytes = dds_make_dx10(98, 16, 0, size, size, mips, 1, 70 + i);
+        file_bytes += bytes.size();
+        BENCH_CHECK(ctx, dds_save(paths[i].c_str(), bytes));
+    }
+    device.copy_data = false;
+    double ms [2];
+    DDSSizePolicyStats stats [2];
+    for (int pass = 0; pass < 2; ++pass) {
+        DDSSizePolicy policy(&device, pass ? file_bytes / 4 : file_bytes);
+        DDSSizeClass all = size_class(1.0f, 0, 0);
+        double t0 = bench_now_ms();
+        for (int i = 0; i < file_count; ++i) {
+            ID3D11Resource * texture = nullptr;
+            HRESULT hr = policy.CreateTexture(
+                names[i].c_str(), all, D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0, false, &texture, nullptr
+            );
+            BENCH_CHECK(ctx, S_OK == hr);
+            if (texture)
+                texture->Release();
+        }
+        ms[pass] = bench_now_ms() - t0;
+        stats[pass] = policy.GetStats();
+    }
+    device.copy_data = true;
+    BENCH_CHECK(ctx, 0 == stats[0].skippedMips && file_bytes == stats[0].bytesRead);
+    // Once the budget is spent the rest keep only their last level
+    BENCH_CHECK(ctx, stats[1].skippedMips > 0 && stats[1].bytesRead + stats[1].bytesSkipped == file_bytes);
+    BENCH_CHECK(ctx, stats[1].committedBytes <= file_bytes / 4 + file_count * 16);
+    printf(
+        "%d files, %.1f MB: whole %.1f ms, quarter budget %.1f ms (%.1f MB read, %llu levels skipped)\n",
+        file_count, file_bytes / 1048576.0, ms[0], ms[1], stats[1].bytesRead / 1048576.0,
+        (unsigned long long)stats[1].skippedMips
+    );
+    for (int i = 0; i < file_count; ++i)
+        remove(paths[i].c_str());
+}
@@ -0,0 +1,266 @@
+// The DDS streamer's scheduling, headless: a read callback stands in for
+// the disk with a fixed latency per level. Every level must be read once,
+// coarsest first, and only down to the renderer's clamp. When several
+// streams want a level the higher priority goes first. The MinLOD clamp
+// must follow the resident level, and what lands in the texture must be
+// the file's bytes. Then the time to stream a set of textures is measured
+// with one and with several I/O threads.
+
+#include "bench.h"
+#include "dds_files.h"
+#include "DDSTextureLoader11.h"
+
+#include <string.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace DirectX;
+
+#define _STREAM_TAIL        64
+
+struct StreamFile {
+    char            path [32];
+    wchar_t         wpath [32];
+    uint32_t        format;
+    int             block_bytes;
+    int             bits_per_pixel;
+    int             size;
+    int             mips;
+    int             array_size;
+    std::vector<uint8_t> bytes;
+};
+
+// Stands in for the disk: waits 'latency_ms' per level, once 'open' is
+// set, and logs what was read. Reads are checked against the files.
+struct SlowDisk {
+    std::mutex                      mutex;
+    std::condition_variable         gate;
+    bool                            open = false;
+    double                          latency_ms = 2.0;
+    std::vector<StreamFile *>       files;      // by stream id - 1
+    std::vector<DDSStreamRead>      log;
+    int                             bad_reads = 0;
+
+    void read (DDSStreamRead const & r) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            gate.wait(lock, [&] () { return open; });
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds((int64_t)(latency_ms * 1000.0)));
+
+        std::lock_guard<std::mutex> lock(mutex);
+        log.push_back(r);
+        StreamFile const * f = r.streamId && r.streamId <= files.size() ? files[r.streamId - 1] : nullptr;
+        if (nullptr == f || (int)r.sliceCount != f->array_size) {
+            ++bad_reads;
+            return;
+        }
+        size_t chain = dds_chain_bytes(f->block_bytes, f->bits_per_pixel, f->size, f->size, f->mips);
+        size_t offset = 148 + dds_chain_bytes(f->block_bytes, f->bits_per_pixel, f->size, f->size, r.mip);
+        size_t level = dds_level_bytes(f->block_bytes, f->bits_per_pixel, f->size >> r.mip, f->size >> r.mip);
+        bool ok = r.sliceSize == level && (r.sliceCount < 2 || r.sliceStride == chain);
+        for (size_t s = 0; ok && s < r.sliceCount; ++s)
+            ok = 0 == memcmp(r.data + s * r.sliceStride, &f->bytes[offset + s * chain], level);
+        bad_reads += !ok;
+    }
+    void release () {
+        std::lock_guard<std::mutex> lock(mutex);
+        open = true;
+        gate.notify_all();
+    }
+};
+
+static void
+make_stream_file (StreamFile * f, int index, uint32_t format, int block_bytes, int bits_per_pixel, int size, int array_size) {
+    snprintf(f->path, sizeof(f->path), "bench_dds_stream_%d.dds", index);
+    for (int i = 0; i < 32; ++i)
+        f->wpath[i] = (wchar_t)f->path[i];
+    f->format = format;
+    f->block_bytes = block_bytes;
+    f->bits_per_pixel = bits_per_pixel;
+    f->size = size;
+    f->mips = 1;
+    for (int s = size; s > 1; s /= 2)
+        ++f->mips;
+    f->array_size = array_size;
+    f->bytes = dds_make_dx10(format, block_bytes, bits_per_pixel, size, size, f->mips, array_size, 100 + index);
+    dds_save(f->path, f->bytes);
+}
+
+// Streams whatever is wanted to completion, uploading as levels come in
+static void
+run_until_idle (DDSTextureStreamer * streamer, ID3D11DeviceContext * context) {
+    while (!streamer->IsIdle()) {
+        streamer->Update(context, SIZE_MAX);
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    streamer->Update(context, SIZE_MAX);
+}
+
+static bool
+levels_match (ID3D11Resource * tex, StreamFile const & f, int from_mip) {
+    size_t chain = dds_chain_bytes(f.block_bytes, f.bits_per_pixel, f.size, f.size, f.mips);
+    for (int s = 0; s < f.array_size; ++s) {
+        for (int m = from_mip; m < f.mips; ++m) {
+            size_t offset = 148 + s * chain + dds_chain_bytes(f.block_bytes, f.bits_per_pixel, f.size, f.size, m);
+            std::vector<uint8_t> const & sub = tex->subresources[s * f.mips + m];
+            if (sub.size() != dds_level_bytes(f.block_bytes, f.bits_per_pixel, f.size >> m, f.size >> m)
+                || 0 != memcmp(sub.data(), &f.bytes[offset], sub.size()))
+                return false;
+        }
+    }
+    return true;
+}
+
+void
+bench_dds_stream (BenchContext * ctx) {
+    ID3D11Device device;
+    ID3D11DeviceContext context;
+
+    // -- Scheduling: three streams, one I/O thread
+    {
+        StreamFile files [3];
+        make_stream_file(&files[0], 0, 71, 8, 0, 1024, 1);     // bc1, low priority
+        make_stream_file(&files[1], 1, 28, 0, 32, 512, 1);     // rgba8, high
+        make_stream_file(&files[2], 2, 77, 16, 0, 512, 4);     // bc3 array, middle, clamped at mip 1
+        float const priorities [3] = {1.0f, 3.0f, 2.0f};
+        uint32_t const min_mips [3] = {0, 0, 1};
+
+        SlowDisk disk;
+        disk.files.assign(3, nullptr);
+        DDSTextureStreamer streamer(&device, 1, [&disk] (DDSStreamRead const & r) { disk.read(r); });
+        ID3D11Resource * textures [3] = {};
+        uint32_t ids [3] = {};
+        int tail_mips [3] = {};
+        for (int i = 0; i < 3; ++i) {
+            BENCH_CHECK(ctx, SUCCEEDED(streamer.CreateTexture(&context, files[i].wpath, _STREAM_TAIL, false, &textures[i], nullptr, &ids[i])));
+            BENCH_CHECK(ctx, 0 != ids[i] && nullptr != textures[i]);
+            if (0 == ids[i] || nullptr == textures[i])
+                return;
+            {
+                std::lock_guard<std::mutex> lock(disk.mutex);
+                disk.files[ids[i] - 1] = &files[i];
+            }
+            streamer.SetPriority(ids[i], priorities[i], min_mips[i]);
+            tail_mips[i] = (int)streamer.GetResidentMip(ids[i]);
+            // Usable straight away: the tail is in, and sampling clamped to it
+            BENCH_CHECK(ctx, levels_match(textures[i], files[i], tail_mips[i]));
+            BENCH_CHECK(ctx, (float)tail_mips[i] == textures[i]->min_lod);
+        }
+        BENCH_CHECK(ctx, 4 == tail_mips[0] && 3 == tail_mips[1] && 3 == tail_mips[2]);
+
+        disk.release();
+        double t0 = bench_now_ms();
+        run_until_idle(&streamer, &context);
+        double ms = bench_now_ms() - t0;
+
+        // Each stream read every level from just above its tail down to its
+        // clamp, once, coarsest first
+        int reads [3] = {};
+        bool ordered = true;
+        std::vector<int> order;
+        for (DDSStreamRead const & r : disk.log) {
+            int i = 0;
+            while (i < 3 && ids[i] != r.streamId)
+                ++i;
+            if (3 == i) {
+                ordered = false;
+                continue;
+            }
+            ordered = ordered && (int)r.mip == tail_mips[i] - 1 - reads[i];
+            ++reads[i];
+            order.push_back(i);
+        }
+        for (int i = 0; i < 3; ++i) {
+            uint32_t resident = streamer.GetResidentMip(ids[i]);
+            BENCH_CHECK(ctx, reads[i] == tail_mips[i] - (int)min_mips[i]);
+            BENCH_CHECK(ctx, resident == min_mips[i]);
+            BENCH_CHECK(ctx, (float)resident == textures[i]->min_lod);
+            BENCH_CHECK(ctx, levels_match(textures[i], files[i], (int)resident));
+        }
+        BENCH_CHECK(ctx, ordered && 0 == disk.bad_reads);
+
+        // Levels are uploaded as fast as they come in here, so whenever the
+        // high and middle priority streams both want a level the high one
+        // reads first, and the low one only reads once neither wants any:
+        // HMHMHLLLL. The I/O thread may pick the low one's first level
+        // before the others exist.
+        int seen [3] = {};
+        bool by_priority = true;
+        for (size_t k = 0; k < order.size(); ++k) {
+            int i = order[k];
+            if (0 == k && 0 == i)
+                continue;
+            ++seen[i];
+            by_priority = by_priority && seen[1] >= seen[2] && (0 == i || 0 == seen[0]);
+        }
+        std::string sequence;
+        for (int i : order)
+            sequence += "LHM"[i];
+        printf("3 streams, 1 I/O thread, %.1f ms per level: %s in %.1f ms\n", disk.latency_ms, sequence.c_str(), ms);
+        BENCH_CHECK(ctx, by_priority);
+
+        // Lowering the clamp streams the rest; releasing a stream drops it
+        streamer.SetPriority(ids[2], priorities[2], 0);
+        run_until_idle(&streamer, &context);
+        BENCH_CHECK(ctx, 0 == streamer.GetResidentMip(ids[2]) && levels_match(textures[2], files[2], 0));
+        streamer.Release(ids[0]);
+        BENCH_CHECK(ctx, 0 == streamer.GetResidentMip(ids[0]) && streamer.IsIdle());
+
+        for (int i = 0; i < 3; ++i) {
+            textures[i]->Release();
+            remove(files[i].path);
+        }
+    }
+
+    // -- Latency hidden by more I/O threads: 8 textures, one level per read
+    {
+        int const count = 8;
+        StreamFile files [count];
+        for (int i = 0; i < count; ++i)
+            make_stream_file(&files[i], i, 71, 8, 0, ctx->quick ? 512 : 2048, 1);
+        size_t const thread_counts [2] = {1, 4};
+        double elapsed [2] = {};
+        for (int t = 0; t < 2; ++t) {
+            SlowDisk disk;
+            disk.files.assign(count, nullptr);
+            disk.latency_ms = ctx->quick ? 2.0 : 5.0;
+            disk.open = true;
+            DDSTextureStreamer streamer(&device, thread_counts[t], [&disk] (DDSStreamRead const & r) { disk.read(r); });
+            ID3D11Resource * textures [count] = {};
+            uint32_t ids [count] = {};
+            double t0 = bench_now_ms();
+            for (int i = 0; i < count; ++i) {
+                {
+                    // Ids are handed out in order; the reads check against them
+                    std::lock_guard<std::mutex> lock(disk.mutex);
+                    disk.files[i] = &files[i];
+                }
+                BENCH_CHECK(ctx, SUCCEEDED(streamer.CreateTexture(&context, files[i].wpath, _STREAM_TAIL, false, &textures[i], nullptr, &ids[i])));
+                BENCH_CHECK(ctx, (uint32_t)i + 1 == ids[i]);
+                streamer.SetPriority(ids[i], (float)i);
+            }
+            run_until_idle(&streamer, &context);
+            elapsed[t] = bench_now_ms() - t0;
+            int resident = 0;
+            for (int i = 0; i < count; ++i) {
+                resident += 0 == streamer.GetResidentMip(ids[i]) && levels_match(textures[i], files[i], 0);
+                if (textures[i])
+                    textures[i]->Release();
+            }
+            printf(
+                "%d textures, %zu I/O thread(s), %.1f ms per level: %zu reads in %.1f ms\n",
+                count, thread_counts[t], disk.latency_ms, disk.log.size(), elapsed[t]
+            );
+            BENCH_CHECK(ctx, count == resident && 0 == disk.bad_reads);
+        }
+        // The reads only sleep, so four threads overlap them even on one core
+        BENCH_CHECK(ctx, elapsed[1] * 2.0 < elapsed[0]);
+        for (int i = 0; i < count; ++i)
+            remove(files[i].path);
+    }
+}
@@ -0,0 +1,179 @@
+// Degenerate triangle stripping on the demo's generators: the sphere and
+// the grid lose nothing, a cone (a cylinder with top radius 0) loses the
+// side triangles and cap fan meeting at its apex. A synthetic list counts
+// each kind of degenerate, with a tail that doesn't fill four lanes, and
+// the survivors must keep their order. The SSE2 area test must agree with
+// the scalar one lane for lane, near the threshold too. Then throughput.
+
+#include "bench.h"
+#include "geometry.h"
+#include "degenerate.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+// The survivors are the input's triangles in their order, none skipped
+// that the stats don't account for.
+static bool
+kept_in_order (std::vector<int> const & before, int const after [], int after_count, DegenerateStats const & stats) {
+    int k = 0;
+    for (size_t t = 0; t < before.size() && k < after_count; t += 3) {
+        if (0 == memcmp(&before[t], &after[k], sizeof(int) * 3))
+            k += 3;
+    }
+    return k == after_count && after_count / 3 + degenerate_removed(&stats) == stats.triangles;
+}
+
+static void
+check_shape (BenchContext * ctx, char const * name, std::vector<Vertex> const & vertices,
+             std::vector<int> const & indices, int expected_zero_area) {
+    std::vector<int> stripped = indices;
+    DegenerateStats st;
+    int n = strip_degenerate_triangles(
+        &vertices[0].position.x, sizeof(Vertex), stripped.data(), (int)stripped.size(), DEGENERATE_MIN_RATIO, &st
+    );
+    printf(
+        "%-8s %5d triangles: removed %d (%d collapsed, %d zero area, %d slivers)\n",
+        name, st.triangles, degenerate_removed(&st), st.collapsed, st.zero_area, st.slivers
+    );
+    BENCH_CHECK(ctx, (int)indices.size() / 3 == st.triangles);
+    BENCH_CHECK(ctx, 0 == st.collapsed && expected_zero_area == st.zero_area && 0 == st.slivers);
+    BENCH_CHECK(ctx, kept_in_order(indices, stripped.data(), n, st));
+}
+
+static float
+bench_randf (uint32_t * state, float lo, float hi) {
+    return lo + (hi - lo) * (float)(bench_rand(state) >> 8) / 16777216.0f;
+}
+
+// Lanes where the SSE2 and scalar area tests disagree, over the triangles
+// of 'indices' four at a time.
+static int
+mask_mismatches (float const * positions, size_t stride, int const indices [], int index_count) {
+    int mismatches = 0;
+#if defined(DEGENERATE_SSE2)
+    float min_ratio_sq = DEGENERATE_MIN_RATIO * DEGENERATE_MIN_RATIO;
+    for (int t = 0; t + 4 <= index_count / 3; t += 4) {
+        float p [3][3][4];
+        for (int k = 0; k < 4; ++k) {
+            for (int c = 0; c < 3; ++c) {
+                float const * v = (float const *)((uint8_t const *)positions + (size_t)indices[(t + k) * 3 + c] * stride);
+                p[c][0][k] = v[0];
+                p[c][1][k] = v[1];
+                p[c][2][k] = v[2];
+            }
+        }
+        int keep [2], zero [2];
+        degenerate_masks_sse2(p, min_ratio_sq, &keep[0], &zero[0]);
+        degenerate_masks_scalar(p, min_ratio_sq, &keep[1], &zero[1]);
+        for (int k = 0; k < 4; ++k)
+            mismatches += ((keep[0] ^ keep[1]) >> k & 1) | ((zero[0] ^ zero[1]) >> k & 1);
+    }
+#else
+    (void)positions;
+    (void)stride;
+    (void)indices;
+    (void)index_count;
+#endif
+    return mismatches;
+}
+
+void
+bench_degenerate (BenchContext * ctx) {
+    // -- The generators
+    std::vector<Vertex> vertices(401);
+    std::vector<int> indices(2280);
+    create_sphere(0.5f, vertices.data(), indices.data(), nullptr);
+    check_shape(ctx, "sphere", vertices, indices, 0);
+    int mismatches = mask_mismatches(&vertices[0].position.x, sizeof(Vertex), indices.data(), (int)indices.size());
+
+    // Every slice has one side triangle with two corners on the apex ring
+    // and one cap triangle with all three on the apex.
+    int const slices = 20;
+    vertices.resize(485);
+    indices.resize(2520);
+    create_cylinder(0.5f, 0.0f, 3.0f, vertices.data(), indices.data(), nullptr);
+    check_shape(ctx, "cone", vertices, indices, 2 * slices);
+    mismatches += mask_mismatches(&vertices[0].position.x, sizeof(Vertex), indices.data(), (int)indices.size());
+
+    vertices.resize(60 * 40);
+    indices.resize(59 * 39 * 6);
+    create_grid(20.0f, 30.0f, 60, 40, vertices.data(), indices.data(), nullptr);
+    check_shape(ctx, "grid", vertices, indices, 0);
+    mismatches += mask_mismatches(&vertices[0].position.x, sizeof(Vertex), indices.data(), (int)indices.size());
+
+    // -- Every kind, 37 triangles so the last group fills one lane of four:
+    // triangle t is collapsed when t % 5 == 0, three distinct collinear
+    // points when 1, a sliver of height 1e-7 over a unit edge when 2, and a
+    // proper triangle otherwise
+    {
+        int const tri_count = 7 * 5 + 2;
+        std::vector<XMFLOAT3> positions;
+        std::vector<int> tris;
+        for (int t = 0; t < tri_count; ++t) {
+            float x = (float)t;
+            float h = t % 5 == 1 ? 0.0f : (t % 5 == 2 ? 1e-7f : 0.5f);
+            int base = (int)positions.size();
+            positions.push_back(XMFLOAT3(x, 0.0f, 0.0f));
+            positions.push_back(XMFLOAT3(x + 1.0f, 0.0f, 0.0f));
+            positions.push_back(XMFLOAT3(x + 0.5f, h, 0.0f));
+            tris.push_back(base);
+            tris.push_back(base + 1);
+            tris.push_back(t % 5 == 0 ? base : base + 2);
+        }
+        std::vector<int> stripped = tris;
+        DegenerateStats st;
+        int n = strip_degenerate_triangles(
+            &positions[0].x, sizeof(XMFLOAT3), stripped.data(), (int)stripped.size(), DEGENERATE_MIN_RATIO, &st
+        );
+        BENCH_CHECK(ctx, 8 == st.collapsed && 8 == st.zero_area && 7 == st.slivers && 14 * 3 == n);
+        BENCH_CHECK(ctx, kept_in_order(tris, stripped.data(), n, st));
+    }
+
+    // -- SSE2 against scalar on random triangles around the threshold: the
+    // apex sits at 0.5 to 1.5 times the smallest kept height
+    {
+        int const tri_count = 40000;
+        std::vector<XMFLOAT3> positions(tri_count * 3);
+        std::vector<int> tris(tri_count * 3);
+        uint32_t state = 23;
+        for (int t = 0; t < tri_count; ++t) {
+            XMFLOAT3 o(bench_randf(&state, -100, 100), bench_randf(&state, -100, 100), bench_randf(&state, -100, 100));
+            XMFLOAT3 d(bench_randf(&state, -1, 1), bench_randf(&state, -1, 1), bench_randf(&state, -1, 1));
+            float len = sqrtf(d.x * d.x + d.y * d.y + d.z * d.z) + 1e-3f;
+            float h = len * DEGENERATE_MIN_RATIO * bench_randf(&state, 0.5f, 1.5f);
+            positions[t * 3 + 0] = o;
+            positions[t * 3 + 1] = XMFLOAT3(o.x + d.x, o.y + d.y, o.z + d.z);
+            positions[t * 3 + 2] = XMFLOAT3(o.x + 0.5f * d.x - d.y / len * h, o.y + 0.5f * d.y + d.x / len * h, o.z + 0.5f * d.z);
+            for (int c = 0; c < 3; ++c)
+                tris[t * 3 + c] = t * 3 + c;
+        }
+        mismatches += mask_mismatches(&positions[0].x, sizeof(XMFLOAT3), tris.data(), (int)tris.size());
+    }
+    BENCH_CHECK(ctx, 0 == mismatches);
+
+    // -- Throughput on a large grid, which keeps every triangle
+    int m = ctx->quick ? 400 : 2000;
+    int n = ctx->quick ? 300 : 1000;
+    vertices.resize((size_t)m * n);
+    indices.resize((size_t)(m - 1) * (n - 1) * 6);
+    create_grid(200.0f, 100.0f, m, n, vertices.data(), indices.data(), nullptr);
+    DegenerateStats st;
+    double t0 = bench_now_ms();
+    int kept = strip_degenerate_triangles(
+        &vertices[0].position.x, sizeof(Vertex), indices.data(), (int)indices.size(), DEGENERATE_MIN_RATIO, &st
+    );
+    double ms = bench_now_ms() - t0;
+    BENCH_CHECK(ctx, (int)indices.size() == kept);
+    printf(
+        "%d triangles: stripped in %.1f ms (%.1f M triangles/s), %d SSE2/scalar mismatches%s\n",
+        st.triangles, ms, st.triangles / ms / 1e3, mismatches,
+#if defined(DEGENERATE_SSE2)
+        ""
+#else
+        " (no SSE2)"
+#endif
+    );
+}
@@ -0,0 +1,289 @@
+// The glTF loader on a generated GLB with many meshes, accessors, buffer
+// views and nodes. Even meshes interleave float positions and colours in
+// one view and index with uint32; odd ones keep separate views, normalized
+// byte colours and uint16 indices. Every mesh node sits under a group node.
+// Every stream, bound and instance must come back as written, json_int
+// must not cast numbers outside the int range, and primitive names must fit
+// however long the mesh name. Then load_gltf is timed as the scene grows.
+
+#include "bench.h"
+#include "gltf_loader.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define _GLTF_PATH          "bench_gltf.glb"
+#define _GLTF_GRID          3                           // vertices per side
+#define _GLTF_VERTICES      (_GLTF_GRID * _GLTF_GRID)
+#define _GLTF_INDICES       ((_GLTF_GRID - 1) * (_GLTF_GRID - 1) * 6)
+#define _GLTF_GROUP         16                          // mesh nodes per group node
+
+struct GltfTestMesh {
+    float       positions [_GLTF_VERTICES][3];
+    uint8_t     colors [_GLTF_VERTICES][4];
+    uint32_t    indices [_GLTF_INDICES];
+};
+
+static void
+json_append (std::string * s, char const * fmt, ...) {
+    char buf [512];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    *s += buf;
+}
+
+static void
+make_test_mesh (GltfTestMesh * m, uint32_t seed) {
+    uint32_t state = seed * 2654435761u + 1;
+    for (int y = 0; y < _GLTF_GRID; ++y) {
+        for (int x = 0; x < _GLTF_GRID; ++x) {
+            int v = y * _GLTF_GRID + x;
+            m->positions[v][0] = x * 0.5f;
+            m->positions[v][1] = (bench_rand(&state) & 1023) / 1024.0f;
+            m->positions[v][2] = y * 0.5f;
+            uint32_t c = bench_rand(&state);
+            memcpy(m->colors[v], &c, 4);
+        }
+    }
+    int i = 0;
+    for (int y = 0; y + 1 < _GLTF_GRID; ++y) {
+        for (int x = 0; x + 1 < _GLTF_GRID; ++x) {
+            uint32_t v = y * _GLTF_GRID + x;
+            uint32_t const quad [6] = {v, v + _GLTF_GRID, v + 1, v + 1, v + _GLTF_GRID, v + _GLTF_GRID + 1};
+            memcpy(&m->indices[i], quad, sizeof(quad));
+            i += 6;
+        }
+    }
+}
+
+static void
+bin_append (std::vector<uint8_t> * bin, void const * data, size_t size) {
+    bin->insert(bin->end(), (uint8_t const *)data, (uint8_t const *)data + size);
+    while (bin->size() % 4)
+        bin->push_back(0);
+}
+
+// Writes 'mesh_count' meshes of the pattern above into one GLB
+static bool
+write_test_glb (char const * path, int mesh_count) {
+    std::vector<uint8_t> bin;
+    std::string views;
+    std::string accessors;
+    std::string meshes;
+    std::string nodes;
+    int view_count = 0;
+    int accessor_count = 0;
+    GltfTestMesh m;
+    for (int k = 0; k < mesh_count; ++k) {
+        make_test_mesh(&m, k);
+        float lo [3] = {1e9f, 1e9f, 1e9f};
+        float hi [3] = {-1e9f, -1e9f, -1e9f};
+        for (int v = 0; v < _GLTF_VERTICES; ++v) {
+            for (int c = 0; c < 3; ++c) {
+                lo[c] = fminf(lo[c], m.positions[v][c]);
+                hi[c] = fmaxf(hi[c], m.positions[v][c]);
+            }
+        }
+        int position = accessor_count;
+        int color = accessor_count + 1;
+        int index = accessor_count + 2;
+        accessor_count += 3;
+        if (0 == k % 2) {
+            float interleaved [_GLTF_VERTICES][7];
+            for (int v = 0; v < _GLTF_VERTICES; ++v) {
+                memcpy(interleaved[v], m.positions[v], 12);
+                for (int c = 0; c < 4; ++c)
+                    interleaved[v][3 + c] = m.colors[v][c] / 255.0f;
+            }
+            json_append(&views, "%s{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu,\"byteStride\":28}", view_count ? "," : "", bin.size(), sizeof(interleaved));
+            bin_append(&bin, interleaved, sizeof(interleaved));
+            json_append(&views, ",{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu}", bin.size(), sizeof(m.indices));
+            bin_append(&bin, m.indices, sizeof(m.indices));
+            json_append(
+                &accessors, "%s{\"bufferView\":%d,\"componentType\":5126,\"count\":%d,\"type\":\"VEC3\",\"min\":[%g,%g,%g],\"max\":[%g,%g,%g]}",
+                accessor_count > 3 ? "," : "", view_count, _GLTF_VERTICES, lo[0], lo[1], lo[2], hi[0], hi[1], hi[2]
+            );
+            json_append(&accessors, ",{\"bufferView\":%d,\"byteOffset\":12,\"componentType\":5126,\"count\":%d,\"type\":\"VEC4\"}", view_count, _GLTF_VERTICES);
+            json_append(&accessors, ",{\"bufferView\":%d,\"componentType\":5125,\"count\":%d,\"type\":\"SCALAR\"}", view_count + 1, _GLTF_INDICES);
+            view_count += 2;
+        } else {
+            uint16_t short_indices [_GLTF_INDICES];
+            for (int i = 0; i < _GLTF_INDICES; ++i)
+                short_indices[i] = (uint16_t)m.indices[i];
+            json_append(&views, "%s{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu}", view_count ? "," : "", bin.size(), sizeof(m.positions));
+            bin_append(&bin, m.positions, sizeof(m.positions));
+            json_append(&views, ",{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu}", bin.size(), sizeof(m.colors));
+            bin_append(&bin, m.colors, sizeof(m.colors));
+            json_append(&views, ",{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu}", bin.size(), sizeof(short_indices));
+            bin_append(&bin, short_indices, sizeof(short_indices));
+            json_append(
+                &accessors, "%s{\"bufferView\":%d,\"componentType\":5126,\"count\":%d,\"type\":\"VEC3\",\"min\":[%g,%g,%g],\"max\":[%g,%g,%g]}",
+                accessor_count > 3 ? "," : "", view_count, _GLTF_VERTICES, lo[0], lo[1], lo[2], hi[0], hi[1], hi[2]
+            );
+            json_append(&accessors, ",{\"bufferView\":%d,\"componentType\":5121,\"normalized\":true,\"count\":%d,\"type\":\"VEC4\"}", view_count + 1, _GLTF_VERTICES);
+            json_append(&accessors, ",{\"bufferView\":%d,\"componentType\":5123,\"count\":%d,\"type\":\"SCALAR\"}", view_count + 2, _GLTF_INDICES);
+            view_count += 3;
+        }
+        json_append(
+            &meshes, "%s{\"name\":\"mesh_%d\",\"primitives\":[{\"attributes\":{\"POSITION\":%d,\"COLOR_0\":%d},\"indices\":%d}]}",
+            k ? "," : "", k, position, color, index
+        );
+        json_append(&nodes, "%s{\"mesh\":%d,\"translation\":[%d,0,0]}", k ? "," : "", k, k);
+    }
+
+    // Group nodes after the mesh nodes, each lifting _GLTF_GROUP of them
+    std::string roots;
+    for (int g = 0; g * _GLTF_GROUP < mesh_count; ++g) {
+        json_append(&nodes, ",{\"translation\":[0,2,0],\"children\":[");
+        for (int k = g * _GLTF_GROUP; k < mesh_count && k < (g + 1) * _GLTF_GROUP; ++k)
+            json_append(&nodes, "%s%d", k > g * _GLTF_GROUP ? "," : "", k);
+        nodes += "]}";
+        json_append(&roots, "%s%d", g ? "," : "", mesh_count + g);
+    }
+
+    std::string js = "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[" + roots + "]}],";
+    js += "\"nodes\":[" + nodes + "],\"meshes\":[" + meshes + "],";
+    json_append(&js, "\"buffers\":[{\"byteLength\":%zu}],", bin.size());
+    js += "\"bufferViews\":[" + views + "],\"accessors\":[" + accessors + "]}";
+    while (js.size() % 4)
+        js += ' ';
+
+    FILE * f = fopen(path, "wb");
+    if (nullptr == f)
+        return false;
+    uint32_t header [3] = {GLTF_GLB_MAGIC, 2, (uint32_t)(12 + 8 + js.size() + 8 + bin.size())};
+    uint32_t json_chunk [2] = {(uint32_t)js.size(), GLTF_CHUNK_JSON};
+    uint32_t bin_chunk [2] = {(uint32_t)bin.size(), GLTF_CHUNK_BIN};
+    fwrite(header, 4, 3, f);
+    fwrite(json_chunk, 4, 2, f);
+    fwrite(js.data(), 1, js.size(), f);
+    fwrite(bin_chunk, 4, 2, f);
+    fwrite(bin.data(), 1, bin.size(), f);
+    fclose(f);
+    return true;
+}
+
+// Mismatches between a loaded scene and what write_test_glb wrote
+static int
+check_test_scene (GltfScene const * scene, int mesh_count) {
+    if (scene->mesh_count != mesh_count || scene->primitive_count != mesh_count || scene->instance_count != mesh_count)
+        return 1;
+    GltfVertexElement const layout [] = {
+        {GLTF_POSITION, 0,  3},
+        {GLTF_COLOR_0,  12, 4},
+    };
+    int bad = 0;
+    GltfTestMesh m;
+    for (int k = 0; k < mesh_count; ++k) {
+        make_test_mesh(&m, k);
+        GltfMesh const & mesh = scene->meshes[k];
+        GltfPrimitive const * prim = &scene->primitives[mesh.first_primitive];
+        char name [32];
+        snprintf(name, sizeof(name), "mesh_%d", k);
+        if (1 != mesh.primitive_count || 0 != strcmp(mesh.name, name) ||
+            _GLTF_VERTICES != gltf_vertex_count(prim) || _GLTF_INDICES != gltf_index_count(prim)) {
+            ++bad;
+            continue;
+        }
+        bool even = 0 == k % 2;
+        bad += even != (nullptr != gltf_match_interleaved(prim, layout, 2, 28));
+        bad += even != (nullptr != gltf_index_source(prim));
+
+        float positions [_GLTF_VERTICES][3];
+        float colors [_GLTF_VERTICES][4];
+        int indices [_GLTF_INDICES];
+        gltf_read_floats(prim->attributes[GLTF_POSITION], 3, positions, 12);
+        gltf_read_floats(prim->attributes[GLTF_COLOR_0], 4, colors, 16);
+        gltf_read_indices(prim, indices);
+        bad += 0 != memcmp(positions, m.positions, sizeof(positions));
+        for (int v = 0; v < _GLTF_VERTICES; ++v)
+            for (int c = 0; c < 4; ++c)
+                bad += fabsf(colors[v][c] - m.colors[v][c] / 255.0f) > 1e-6f;
+        for (int i = 0; i < _GLTF_INDICES; ++i)
+            bad += indices[i] != (int)m.indices[i];
+        bad += fabsf(prim->bounds.aabb_center.x - 0.5f) > 1e-6f || fabsf(prim->bounds.aabb_extents.z - 0.5f) > 1e-6f;
+    }
+
+    // Every mesh node once, lifted by its group and mirrored on z
+    std::vector<int> seen(mesh_count);
+    for (int i = 0; i < scene->instance_count; ++i) {
+        GltfInstance const & inst = scene->instances[i];
+        ++seen[inst.mesh];
+        bad += (float)inst.mesh != inst.world._41 || 2.0f != inst.world._42 || 0.0f != inst.world._43 || -1.0f != inst.world._33;
+    }
+    for (int k = 0; k < mesh_count; ++k)
+        bad += 1 != seen[k];
+    return bad;
+}
+
+void
+bench_gltf (BenchContext * ctx) {
+    // -- json_int: values an int can't hold are absent, not cast
+    {
+        char const text [] = "[2147483647, -2147483648, 2147483648, -2147483649, 1e20, -1e300, 12.9, -12.9, NaN, \"7\"]";
+        int const expected [] = {INT_MAX, INT_MIN, -5, -5, -5, -5, 12, -12, -5, -5};
+        JsonDoc doc;
+        bool ok = json_parse(text, (int)strlen(text), &doc);
+        for (int i = 0; ok && i < (int)(sizeof(expected) / sizeof(expected[0])); ++i)
+            ok = expected[i] == json_int(&doc, json_at(&doc, 0, i), -5);
+        BENCH_CHECK(ctx, ok);
+        json_free(&doc);
+    }
+
+    // -- Primitive names fit the mesh table's 32 chars whatever the mesh name;
+    // GltfMesh::name holds up to 31
+    {
+        char const * longest = "a_mesh_name_of_exactly_31_chars";
+        char first [32];
+        char last [32];
+        char short_name [32];
+        gltf_primitive_name(first, sizeof(first), longest, 0);
+        gltf_primitive_name(last, sizeof(last), longest, 123456);
+        gltf_primitive_name(short_name, sizeof(short_name), "box", 2);
+        BENCH_CHECK(ctx, 31 == strlen(first) && 0 == strcmp(first + 29, "/0") && 0 == strncmp(first, longest, 29));
+        BENCH_CHECK(ctx, 31 == strlen(last) && 0 == strcmp(last + 24, "/123456") && 0 == strncmp(last, longest, 24));
+        BENCH_CHECK(ctx, 0 == strcmp(short_name, "box/2"));
+    }
+
+    // -- One scene, checked stream by stream
+    {
+        int mesh_count = 300;
+        GltfScene scene;
+        bool ok = write_test_glb(_GLTF_PATH, mesh_count) && load_gltf(_GLTF_PATH, &scene);
+        BENCH_CHECK(ctx, ok);
+        if (ok) {
+            int bad = check_test_scene(&scene, mesh_count);
+            printf("%d meshes: %d mismatches\n", mesh_count, bad);
+            BENCH_CHECK(ctx, 0 == bad);
+            free_gltf(&scene);
+        }
+    }
+
+    // -- Load time as the scene grows; per mesh it should stay flat
+    int const sizes [3] = {1000, ctx->quick ? 2000 : 10000, ctx->quick ? 4000 : 50000};
+    for (int mesh_count : sizes) {
+        BENCH_CHECK(ctx, write_test_glb(_GLTF_PATH, mesh_count));
+        GltfScene scene;
+        double t0 = bench_now_ms();
+        bool ok = load_gltf(_GLTF_PATH, &scene);
+        double ms = bench_now_ms() - t0;
+        BENCH_CHECK(ctx, ok);
+        if (!ok)
+            continue;
+        int node_count = mesh_count + (mesh_count + _GLTF_GROUP - 1) / _GLTF_GROUP;
+        double json_mb = scene.json.tokens[0].end / 1048576.0;
+        printf(
+            "%6d meshes, %6d accessors, %6d nodes, %5.1f MB of JSON: %8.1f ms, %6.2f us per mesh\n",
+            mesh_count, mesh_count * 3, node_count, json_mb, ms, ms * 1e3 / mesh_count
+        );
+        free_gltf(&scene);
+    }
+    remove(_GLTF_PATH);
+}
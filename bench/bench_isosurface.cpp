@@ -0,0 +1,115 @@
+// Isosurface extraction on the demo's two fields, the torus-box SDF and the
+// metaballs, sampled at 256^3 so the surface crosses many ISO_BLOCK
+// borders. The welded output must hold no two vertices at the same spot
+// (a cell stitched twice across a border would) and must be closed: every
+// half-edge has a twin. Sampling and extraction are timed against loading
+// the same mesh back from a mesh cache, which is what the demo does after
+// its first launch.
+
+#include "bench.h"
+#include "isosurface.h"
+#include "adjacency.h"
+#include "mesh_cache.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define _ISO_CACHE_PATH     "bench_isosurface.meshcache"
+
+struct IsoCase {
+    char const *    name;
+    float           extent;         // the volume spans [-extent, extent]^3
+    int             field;          // 0 SDF, 1 metaballs
+};
+
+static IsoMetaball const g_iso_balls [] = {
+    {XMFLOAT3(-0.7f, 0.0f, 0.0f), 0.8f},
+    {XMFLOAT3(+0.7f, 0.3f, 0.0f), 0.7f},
+    {XMFLOAT3(0.0f, 0.9f, 0.4f), 0.6f},
+    {XMFLOAT3(0.1f, -0.8f, -0.4f), 0.6f},
+};
+
+void
+bench_isosurface (BenchContext * ctx) {
+    IsoCase const cases [2] = {
+        {"sdf",         2.5f,   0},
+        {"metaballs",   2.0f,   1},
+    };
+    int res = ctx->quick ? 100 : 256;
+    for (IsoCase const & c : cases) {
+        IsoVolume volume;
+        iso_volume_create(&volume, res, res, res, XMFLOAT3(-c.extent, -c.extent, -c.extent), 2.0f * c.extent / (res - 1));
+
+        double t0 = bench_now_ms();
+        if (0 == c.field) {
+            iso_sample_field(&volume, [](float x, float y, float z) {
+                float torus = iso_sdf_torus(x, y, z, 1.6f, 0.45f);
+                float box = iso_sdf_box(x, y, z, 0.8f, 0.8f, 0.8f) - 0.1f;
+                return iso_smooth_union(torus, box, 0.6f);
+            });
+        } else {
+            iso_sample_field(&volume, [](float x, float y, float z) {
+                return iso_metaballs(g_iso_balls, (int)(sizeof(g_iso_balls) / sizeof(g_iso_balls[0])), x, y, z);
+            });
+        }
+        double sample_ms = bench_now_ms() - t0;
+
+        IsoMesh iso;
+        t0 = bench_now_ms();
+        bool ok = extract_isosurface(&volume, 0.0f, &iso) && iso.index_count > 0;
+        double extract_ms = bench_now_ms() - t0;
+        iso_volume_destroy(&volume);
+        BENCH_CHECK(ctx, ok);
+        if (!ok)
+            continue;
+
+        // -- Welded: no two vertices share a position
+        int * remap = (int *)::malloc(sizeof(int) * (iso.vertex_count + 1));
+        int distinct = weld_positions(&iso.vertices[0].position.x, sizeof(Vertex), iso.vertex_count, remap);
+        ::free(remap);
+        BENCH_CHECK(ctx, distinct == iso.vertex_count);
+
+        // -- Closed: every half-edge is paired, on the output's own indices
+        HalfEdgeMesh he;
+        half_edge_build(iso.indices, iso.index_count, iso.vertex_count, nullptr, 0, &he);
+        BENCH_CHECK(ctx, 0 == he.boundary_edges);
+
+        // -- Cached: the mesh comes back from the cache with the same vertices
+        MeshCacheEntry entry = {};
+        snprintf(entry.name, sizeof(entry.name), "%s", c.name);
+        entry.vertex_count = iso.vertex_count;
+        entry.index_count = iso.index_count;
+        entry.bounds = iso.bounds;
+        uint64_t key = mesh_cache_key_add(mesh_cache_key_begin(), c.name, strlen(c.name));
+        bool written = mesh_cache_write(
+            _ISO_CACHE_PATH, key, &entry, 1, iso.vertices, sizeof(Vertex), iso.vertex_count, iso.indices, iso.index_count
+        );
+        Vertex * cached_vertices = (Vertex *)::malloc(sizeof(Vertex) * iso.vertex_count);
+        int * cached_indices = (int *)::malloc(sizeof(int) * iso.index_count);
+        t0 = bench_now_ms();
+        MeshCache cache;
+        bool loaded = written && mesh_cache_open(_ISO_CACHE_PATH, key, sizeof(Vertex), &cache);
+        if (loaded) {
+            loaded = 1 == cache.header->mesh_count && (int)cache.header->index_count == iso.index_count &&
+                mesh_cache_decode(&cache, cached_vertices, cached_indices);
+            mesh_cache_close(&cache);
+        }
+        double cache_ms = bench_now_ms() - t0;
+        remove(_ISO_CACHE_PATH);
+        BENCH_CHECK(ctx, loaded && 0 == memcmp(cached_vertices, iso.vertices, sizeof(Vertex) * iso.vertex_count));
+        ::free(cached_indices);
+        ::free(cached_vertices);
+
+        double cells = (double)(res - 1) * (res - 1) * (res - 1);
+        int triangles = iso.index_count / 3;
+        printf(
+            "%-9s %d^3: sample %6.1f ms (%5.1f M samples/s), extract %6.1f ms (%5.1f M cells/s, %5.2f M triangles/s), "
+            "cached %5.1f ms, %d vertices, %d triangles, %d duplicate, %d open edges, %d non-manifold\n",
+            c.name, res, sample_ms, (double)res * res * res / sample_ms / 1e3, extract_ms, cells / extract_ms / 1e3,
+            triangles / extract_ms / 1e3, cache_ms, iso.vertex_count, triangles, iso.vertex_count - distinct, he.boundary_edges,
+            he.nonmanifold_edges
+        );
+        half_edge_destroy(&he);
+        free_iso_mesh(&iso);
+    }
+}
@@ -0,0 +1,321 @@
+// Mesh codec round trips on the output of every generator and loader the
+// demo has (the built-in shapes, fBm terrain, an isosurface, an OBJ and a
+// GLB written here), then the same meshes through a mesh cache file, then
+// decode throughput against raw bytes.
+
+#include "bench.h"
+#include "gltf_loader.h"
+#include "isosurface.h"
+#include "mesh_cache.h"
+#include "obj_loader.h"
+#include "terrain.h"
+
+#include <math.h>
+#include <string>
+#include <vector>
+
+#define _OBJ_PATH       "bench_mesh_codec.obj"
+#define _GLB_PATH       "bench_mesh_codec.glb"
+#define _CACHE_PATH     "bench_mesh_codec.meshcache"
+
+struct CodecMesh {
+    char const *        name;
+    std::vector<Vertex> vertices;
+    std::vector<int>    indices;
+};
+
+// Torus with a UV seam, faces sharing positions and normals across it.
+static bool
+write_obj (char const * path) {
+    FILE * f = fopen(path, "wb");
+    if (nullptr == f)
+        return false;
+    int const rings = 24;
+    int const sides = 12;
+    for (int r = 0; r < rings; ++r) {
+        for (int s = 0; s < sides; ++s) {
+            float a = 2.0f * XM_PI * r / rings;
+            float b = 2.0f * XM_PI * s / sides;
+            fprintf(f, "v %f %f %f\n", (1.0f + 0.3f * cosf(b)) * cosf(a), 0.3f * sinf(b), (1.0f + 0.3f * cosf(b)) * sinf(a));
+            fprintf(f, "vn %f %f %f\n", cosf(b) * cosf(a), sinf(b), cosf(b) * sinf(a));
+        }
+    }
+    for (int r = 0; r <= rings; ++r)
+        for (int s = 0; s <= sides; ++s)
+            fprintf(f, "vt %f %f\n", (float)r / rings, (float)s / sides);
+    for (int r = 0; r < rings; ++r) {
+        for (int s = 0; s < sides; ++s) {
+            int p [4] = {r * sides + s, ((r + 1) % rings) * sides + s, ((r + 1) % rings) * sides + (s + 1) % sides, r * sides + (s + 1) % sides};
+            int t [4] = {r * (sides + 1) + s, (r + 1) * (sides + 1) + s, (r + 1) * (sides + 1) + s + 1, r * (sides + 1) + s + 1};
+            fprintf(f, "f");
+            for (int k = 0; k < 4; ++k)
+                fprintf(f, " %d/%d/%d", p[k] + 1, t[k] + 1, p[k] + 1);
+            fprintf(f, "\n");
+        }
+    }
+    fclose(f);
+    return true;
+}
+// The sphere as one GLB primitive: POSITION, NORMAL and TEXCOORD_0 in
+// separate views, uint16 indices.
+static bool
+write_glb (char const * path, CodecMesh const & sphere) {
+    uint32_t n = (uint32_t)sphere.vertices.size();
+    uint32_t index_count = (uint32_t)sphere.indices.size();
+    std::vector<uint8_t> bin(n * 32 + ((index_count * 2 + 3) & ~3u));
+    float * positions = (float *)bin.data();
+    float * normals = positions + n * 3;
+    float * uvs = normals + n * 3;
+    uint16_t * indices = (uint16_t *)(uvs + n * 2);
+    XMFLOAT3 lo(1e9f, 1e9f, 1e9f);
+    XMFLOAT3 hi(-1e9f, -1e9f, -1e9f);
+    for (uint32_t i = 0; i < n; ++i) {
+        Vertex const & v = sphere.vertices[i];
+        memcpy(positions + i * 3, &v.position, 12);
+        memcpy(normals + i * 3, &v.normal, 12);
+        memcpy(uvs + i * 2, &v.texc, 8);
+        lo = XMFLOAT3(fminf(lo.x, v.position.x), fminf(lo.y, v.position.y), fminf(lo.z, v.position.z));
+        hi = XMFLOAT3(fmaxf(hi.x, v.position.x), fmaxf(hi.y, v.position.y), fmaxf(hi.z, v.position.z));
+    }
+    for (uint32_t i = 0; i < index_count; ++i)
+        indices[i] = (uint16_t)sphere.indices[i];
+
+    char json [2048];
+    snprintf(
+        json, sizeof(json),
+        "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],\"nodes\":[{\"mesh\":0}],"
+        "\"meshes\":[{\"name\":\"sphere\",\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1,\"TEXCOORD_0\":2},\"indices\":3}]}],"
+        "\"buffers\":[{\"byteLength\":%u}],"
+        "\"bufferViews\":[{\"buffer\":0,\"byteOffset\":0,\"byteLength\":%u},{\"buffer\":0,\"byteOffset\":%u,\"byteLength\":%u},"
+        "{\"buffer\":0,\"byteOffset\":%u,\"byteLength\":%u},{\"buffer\":0,\"byteOffset\":%u,\"byteLength\":%u}],"
+        "\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":%u,\"type\":\"VEC3\",\"min\":[%f,%f,%f],\"max\":[%f,%f,%f]},"
+        "{\"bufferView\":1,\"componentType\":5126,\"count\":%u,\"type\":\"VEC3\"},"
+        "{\"bufferView\":2,\"componentType\":5126,\"count\":%u,\"type\":\"VEC2\"},"
+        "{\"bufferView\":3,\"componentType\":5123,\"count\":%u,\"type\":\"SCALAR\"}]}",
+        (uint32_t)bin.size(), n * 12, n * 12, n * 12, n * 24, n * 8, n * 32, index_count * 2,
+        n, lo.x, lo.y, lo.z, hi.x, hi.y, hi.z, n, n, index_count
+    );
+    std::string js = json;
+    while (js.size() % 4)
+        js += ' ';
+
+    FILE * f = fopen(path, "wb");
+    if (nullptr == f)
+        return false;
+    uint32_t header [3] = {0x46546c67u, 2, (uint32_t)(12 + 8 + js.size() + 8 + bin.size())};
+    uint32_t json_chunk [2] = {(uint32_t)js.size(), 0x4e4f534au};
+    uint32_t bin_chunk [2] = {(uint32_t)bin.size(), 0x004e4942u};
+    fwrite(header, 4, 3, f);
+    fwrite(json_chunk, 4, 2, f);
+    fwrite(js.data(), 1, js.size(), f);
+    fwrite(bin_chunk, 4, 2, f);
+    fwrite(bin.data(), 1, bin.size(), f);
+    fclose(f);
+    return true;
+}
+
+static void
+add_generated (std::vector<CodecMesh> * meshes) {
+    MeshBounds bounds;
+    CodecMesh m;
+
+    m.name = "box";
+    m.vertices.resize(24);
+    m.indices.resize(36);
+    create_box(1.0f, 2.0f, 3.0f, m.vertices.data(), m.indices.data(), &bounds);
+    meshes->push_back(m);
+
+    m.name = "grid";
+    m.vertices.resize(60 * 40);
+    m.indices.resize(59 * 39 * 6);
+    create_grid(20.0f, 30.0f, 60, 40, m.vertices.data(), m.indices.data(), &bounds);
+    meshes->push_back(m);
+
+    m.name = "sphere";
+    m.vertices.resize(401);
+    m.indices.resize(2280);
+    create_sphere(0.5f, m.vertices.data(), m.indices.data(), &bounds);
+    meshes->push_back(m);
+
+    m.name = "cylinder";
+    m.vertices.resize(485);
+    m.indices.resize(2520);
+    create_cylinder(0.5f, 0.3f, 3.0f, m.vertices.data(), m.indices.data(), &bounds);
+    meshes->push_back(m);
+
+    TerrainParams p = {};
+    p.width = p.depth = 128.0f;
+    p.m = p.n = 129;
+    p.octaves = 6;
+    p.frequency = 0.02f;
+    p.amplitude = 4.0f;
+    p.lacunarity = 2.0f;
+    p.gain = 0.5f;
+    p.seed = 1337;
+    m.name = "terrain";
+    m.vertices.resize(p.m * p.n);
+    m.indices.resize((p.m - 1) * (p.n - 1) * 6);
+    create_terrain(&p, m.vertices.data(), m.indices.data(), &bounds);
+    meshes->push_back(m);
+
+    IsoVolume volume;
+    iso_volume_create(&volume, 48, 48, 48, XMFLOAT3(-2.0f, -2.0f, -2.0f), 4.0f / 47);
+    iso_sample_field(&volume, [](float x, float y, float z) {
+        return iso_smooth_union(iso_sdf_torus(x, y, z, 1.2f, 0.4f), iso_sdf_sphere(x, y - 0.5f, z, 0.7f), 0.3f);
+    });
+    IsoMesh iso;
+    if (extract_isosurface(&volume, 0.0f, &iso)) {
+        m.name = "isosurface";
+        m.vertices.assign(iso.vertices, iso.vertices + iso.vertex_count);
+        m.indices.assign(iso.indices, iso.indices + iso.index_count);
+        meshes->push_back(m);
+    }
+    free_iso_mesh(&iso);
+    iso_volume_destroy(&volume);
+}
+static bool
+add_obj (std::vector<CodecMesh> * meshes) {
+    ObjMesh obj;
+    bool ok = write_obj(_OBJ_PATH) && load_obj(_OBJ_PATH, &obj);
+    if (ok) {
+        CodecMesh m;
+        m.name = "obj";
+        m.vertices.assign(obj.vertices, obj.vertices + obj.vertex_count);
+        m.indices.assign(obj.indices, obj.indices + obj.index_count);
+        meshes->push_back(m);
+        free_obj(&obj);
+    }
+    remove(_OBJ_PATH);
+    return ok;
+}
+static bool
+add_gltf (std::vector<CodecMesh> * meshes, CodecMesh const & sphere) {
+    GltfScene scene;
+    bool ok = write_glb(_GLB_PATH, sphere) && load_gltf(_GLB_PATH, &scene);
+    if (ok) {
+        GltfPrimitive const * prim = &scene.primitives[0];
+        CodecMesh m;
+        m.name = "gltf";
+        m.vertices.assign(gltf_vertex_count(prim), Vertex{});
+        m.indices.resize(gltf_index_count(prim));
+        gltf_read_floats(prim->attributes[GLTF_POSITION], 3, &m.vertices[0].position, sizeof(Vertex));
+        gltf_read_floats(prim->attributes[GLTF_NORMAL], 3, &m.vertices[0].normal, sizeof(Vertex));
+        gltf_read_floats(prim->attributes[GLTF_TEXCOORD_0], 2, &m.vertices[0].texc, sizeof(Vertex));
+        gltf_read_indices(prim, m.indices.data());
+        ok = 0 == memcmp(m.indices.data(), sphere.indices.data(), sizeof(int) * m.indices.size());
+        meshes->push_back(m);
+        free_gltf(&scene);
+    }
+    remove(_GLB_PATH);
+    return ok;
+}
+static bool
+same_triangles (int const a [], int const b [], size_t index_count) {
+    for (size_t t = 0; t + 2 < index_count; t += 3) {
+        bool same = false;
+        for (int r = 0; r < 3; ++r)
+            same = same || (a[t] == b[t + r] && a[t + 1] == b[t + (r + 1) % 3] && a[t + 2] == b[t + (r + 2) % 3]);
+        if (!same)
+            return false;
+    }
+    return true;
+}
+
+void
+bench_mesh_codec (BenchContext * ctx) {
+    std::vector<CodecMesh> meshes;
+    add_generated(&meshes);
+    BENCH_CHECK(ctx, add_obj(&meshes));
+    BENCH_CHECK(ctx, add_gltf(&meshes, meshes[2]));
+
+    // -- Each mesh on its own.
+    for (CodecMesh const & m : meshes) {
+        uint32_t vertex_count = (uint32_t)m.vertices.size();
+        uint32_t index_count = (uint32_t)m.indices.size();
+        std::vector<uint8_t> vertex_data(encode_vertex_buffer_bound(vertex_count, sizeof(Vertex)));
+        std::vector<uint8_t> index_data(encode_index_buffer_bound(index_count));
+        size_t vertex_size = encode_vertex_buffer(vertex_data.data(), vertex_data.size(), m.vertices.data(), vertex_count, sizeof(Vertex));
+        size_t index_size = encode_index_buffer(index_data.data(), index_data.size(), m.indices.data(), index_count);
+        bool ok = vertex_size > 0 && index_size > 0 && mesh_codec_round_trip(
+            m.vertices.data(), vertex_count, sizeof(Vertex), m.indices.data(), index_count,
+            vertex_data.data(), vertex_size, index_data.data(), index_size
+        );
+        printf(
+            "%-10s %6u vertices %7u indices: vertices %5.1f%%, indices %5.1f%% (%.2f B/triangle), %s\n",
+            m.name, vertex_count, index_count, 100.0 * vertex_size / (vertex_count * sizeof(Vertex)),
+            100.0 * index_size / (index_count * sizeof(int)), index_size / (index_count / 3.0), ok ? "ok" : "MISMATCH"
+        );
+        BENCH_CHECK(ctx, ok);
+    }
+
+    // -- All of them packed in one cache file, written, mapped and decoded.
+    {
+        std::vector<MeshCacheEntry> entries(meshes.size());
+        std::vector<Vertex> vertices;
+        std::vector<int> indices;
+        for (size_t i = 0; i < meshes.size(); ++i) {
+            MeshCacheEntry & e = entries[i];
+            memset(&e, 0, sizeof(e));
+            snprintf(e.name, sizeof(e.name), "%s", meshes[i].name);
+            e.base_vertex = (int)vertices.size();
+            e.vertex_count = (uint32_t)meshes[i].vertices.size();
+            e.first_index = (uint32_t)indices.size();
+            e.index_count = (uint32_t)meshes[i].indices.size();
+            vertices.insert(vertices.end(), meshes[i].vertices.begin(), meshes[i].vertices.end());
+            indices.insert(indices.end(), meshes[i].indices.begin(), meshes[i].indices.end());
+        }
+        uint64_t key = mesh_cache_key_add(mesh_cache_key_begin(), "bench", 5);
+        bool written = mesh_cache_write(
+            _CACHE_PATH, key, entries.data(), (uint32_t)entries.size(),
+            vertices.data(), sizeof(Vertex), (uint32_t)vertices.size(), indices.data(), (uint32_t)indices.size()
+        );
+        MeshCache cache;
+        bool opened = written && mesh_cache_open(_CACHE_PATH, key, sizeof(Vertex), &cache);
+        bool same = false;
+        if (opened) {
+            std::vector<Vertex> decoded_vertices(vertices.size());
+            std::vector<int> decoded_indices(indices.size());
+            same =
+                mesh_cache_decode(&cache, decoded_vertices.data(), decoded_indices.data()) &&
+                0 == memcmp(decoded_vertices.data(), vertices.data(), sizeof(Vertex) * vertices.size()) &&
+                same_triangles(indices.data(), decoded_indices.data(), indices.size());
+            printf("cache file: %u meshes, %llu bytes, %s\n", cache.header->mesh_count, (unsigned long long)cache.file.size, same ? "ok" : "MISMATCH");
+            mesh_cache_close(&cache);
+        }
+        remove(_CACHE_PATH);
+        BENCH_CHECK(ctx, written);
+        BENCH_CHECK(ctx, opened);
+        BENCH_CHECK(ctx, same);
+    }
+
+    // -- Decode throughput, in bytes of decoded output per second.
+    {
+        int m = ctx->quick ? 300 : 1000;
+        int reps = ctx->quick ? 2 : 10;
+        MeshBounds bounds;
+        std::vector<Vertex> vertices(m * m);
+        std::vector<int> indices((size_t)(m - 1) * (m - 1) * 6);
+        create_grid(10.0f, 10.0f, m, m, vertices.data(), indices.data(), &bounds);
+        std::vector<uint8_t> vertex_data(encode_vertex_buffer_bound(vertices.size(), sizeof(Vertex)));
+        std::vector<uint8_t> index_data(encode_index_buffer_bound(indices.size()));
+        size_t vertex_size = encode_vertex_buffer(vertex_data.data(), vertex_data.size(), vertices.data(), vertices.size(), sizeof(Vertex));
+        size_t index_size = encode_index_buffer(index_data.data(), index_data.size(), indices.data(), indices.size());
+
+        std::vector<Vertex> out_vertices(vertices.size());
+        std::vector<int> out_indices(indices.size());
+        double t0 = bench_now_ms();
+        for (int r = 0; r < reps; ++r)
+            decode_vertex_buffer(out_vertices.data(), out_vertices.size(), sizeof(Vertex), vertex_data.data(), vertex_size);
+        double t1 = bench_now_ms();
+        for (int r = 0; r < reps; ++r)
+            decode_index_buffer(out_indices.data(), out_indices.size(), (uint32_t)vertices.size(), index_data.data(), index_size);
+        double t2 = bench_now_ms();
+        double vertex_bytes = (double)vertices.size() * sizeof(Vertex);
+        double index_bytes = (double)indices.size() * sizeof(int);
+        printf(
+            "decode %d^2 grid: vertices %.2f GB/s (%.1f%% of raw), indices %.2f GB/s (%.1f%% of raw)\n",
+            m, vertex_bytes * reps / (t1 - t0) / 1e6, 100.0 * vertex_size / vertex_bytes,
+            index_bytes * reps / (t2 - t1) / 1e6, 100.0 * index_size / index_bytes
+        );
+    }
+}
@@ -0,0 +1,82 @@
+// The mesh table and render item sort: removed rows must be handed out
+// again instead of growing the table, names must resolve only to live rows,
+// and the counting sort must order items by mesh and drop items without a
+// row. Then the sort is timed on a large item list.
+
+#include "bench.h"
+#include "mesh_table.h"
+
+#include <stdio.h>
+
+void
+bench_mesh_table (BenchContext * ctx) {
+    MeshBounds bounds = {};
+
+    // -- Reload the same mesh many times: two rows are enough
+    {
+        MeshTable table;
+        mesh_table_init(&table, 4);
+        MeshHandle box = mesh_table_add(&table, "box", 0, 0, 36, bounds);
+        MeshHandle current = mesh_table_add(&table, "obj", 0, 36, 300, bounds);
+        int reloads = 1000;
+        bool predicted = true;
+        for (int i = 0; i < reloads; ++i) {
+            MeshHandle next = mesh_table_next_handle(&table);
+            MeshHandle added = mesh_table_add(&table, "obj", 0, 336, 300, bounds);
+            predicted = predicted && next == added && added != current;
+            mesh_table_remove(&table, current);
+            current = added;
+        }
+        BENCH_CHECK(ctx, predicted && 3 == table.count);
+        BENCH_CHECK(ctx, box == mesh_table_find(&table, "box") && current == mesh_table_find(&table, "obj"));
+
+        // A removed row is not found by name, draws nothing, and removing
+        // it twice does not put it on the list twice
+        mesh_table_remove(&table, current);
+        mesh_table_remove(&table, current);
+        BENCH_CHECK(ctx, INVALID_MESH_HANDLE == mesh_table_find(&table, "obj") && 0 == table.index_count[current]);
+        MeshHandle a = mesh_table_add(&table, "a", 0, 0, 3, bounds);
+        MeshHandle b = mesh_table_add(&table, "b", 0, 0, 3, bounds);
+        MeshHandle c = mesh_table_add(&table, "c", 0, 0, 3, bounds);
+        BENCH_CHECK(ctx, a != b && b != c && a != c && 4 == table.count);
+        mesh_table_free(&table);
+    }
+
+    // -- The sort keeps items with a row, in mesh order, and drops the rest
+    {
+        RenderItems items;
+        render_items_init(&items, 4);
+        MeshHandle const handles [8] = {2, INVALID_MESH_HANDLE, 0, 2, 5, 1, INVALID_MESH_HANDLE, 0};
+        for (int i = 0; i < 8; ++i)
+            render_items_add(&items, handles[i], XMMatrixTranslation((float)i, 0.0f, 0.0f));
+        render_items_sort_by_mesh(&items, 3);
+        // Stable within a mesh, so the translations tell the items apart
+        MeshHandle const mesh_order [5] = {0, 0, 1, 2, 2};
+        float const x_order [5] = {2, 7, 5, 0, 3};
+        bool ordered = 5 == items.count;
+        for (int i = 0; ordered && i < 5; ++i)
+            ordered = mesh_order[i] == items.mesh[i] && x_order[i] == items.world[i]._41;
+        BENCH_CHECK(ctx, ordered);
+        render_items_sort_by_mesh(&items, 0);
+        BENCH_CHECK(ctx, 0 == items.count);
+        render_items_free(&items);
+    }
+
+    // -- Sort throughput
+    int mesh_count = 4096;
+    int item_count = ctx->quick ? 100000 : 2000000;
+    RenderItems items;
+    render_items_init(&items, item_count);
+    uint32_t state = 7;
+    for (int i = 0; i < item_count; ++i)
+        render_items_add(&items, (MeshHandle)(bench_rand(&state) % mesh_count), XMMatrixIdentity());
+    double t0 = bench_now_ms();
+    render_items_sort_by_mesh(&items, mesh_count);
+    double ms = bench_now_ms() - t0;
+    bool sorted = item_count == items.count;
+    for (int i = 1; sorted && i < items.count; ++i)
+        sorted = items.mesh[i - 1] <= items.mesh[i];
+    BENCH_CHECK(ctx, sorted);
+    printf("%d items over %d meshes: sorted in %.2f ms (%.1f M items/s)\n", item_count, mesh_count, ms, item_count / ms / 1e3);
+    render_items_free(&items);
+}
@@ -0,0 +1,185 @@
+// The OBJ importer on a large generated file: a grid written row by row,
+// with odd rows indexing their faces relative to the end (negative indices)
+// and even rows absolutely, quads, hexagons and triangles mixed, and a
+// usemtl switch every few rows. The chunked parallel parse must produce the
+// vertex count and submesh ranges the grid predicts, and the very same mesh
+// as a parse of the whole file as one chunk. Both are timed.
+
+#include "bench.h"
+#include "obj_loader.h"
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define _OBJ_PATH           "bench_obj.obj"
+#define _OBJ_MATERIALS      4
+
+// Buffered text writer; snprintf into a block, fwrite when it fills up
+struct ObjWriter {
+    FILE *      file;
+    char        buffer [1 << 16];
+    size_t      used;
+    size_t      total;
+};
+
+static void
+obj_write (ObjWriter * w, char const * fmt, ...) {
+    if (w->used + 256 > sizeof(w->buffer)) {
+        fwrite(w->buffer, 1, w->used, w->file);
+        w->used = 0;
+    }
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(w->buffer + w->used, sizeof(w->buffer) - w->used, fmt, args);
+    va_end(args);
+    w->used += n;
+    w->total += n;
+}
+
+// Corner (x, y) of the grid: i/i/i, absolute or relative to 'written'
+static void
+obj_write_corner (ObjWriter * w, int width, int x, int y, int written, bool relative) {
+    int i = y * width + x;
+    int raw = relative ? i - written : i + 1;
+    obj_write(w, " %d/%d/%d", raw, raw, raw);
+}
+
+// Writes a width x height grid; 'band_rows' rows of faces share a material.
+// Returns the file size.
+static size_t
+write_grid_obj (char const * path, int width, int height, int band_rows) {
+    ObjWriter * w = (ObjWriter *)::malloc(sizeof(ObjWriter));
+    w->file = fopen(path, "wb");
+    w->used = 0;
+    w->total = 0;
+    if (nullptr == w->file) {
+        ::free(w);
+        return 0;
+    }
+    obj_write(w, "# generated by bench_obj\no grid\n");
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            obj_write(w, "v %.4f %.4f %.4f\n", x * 0.01f, 0.001f * ((x * 7 + y * 13) % 97), y * 0.01f);
+            obj_write(w, "vt %.5f %.5f\n", (float)x / width, (float)y / height);
+            obj_write(w, "vn 0 1 0\n");
+        }
+        if (0 == y)
+            continue;
+        if (0 == (y - 1) % band_rows)
+            obj_write(w, "usemtl m%d\n", (y - 1) / band_rows % _OBJ_MATERIALS);
+        int written = (y + 1) * width;
+        bool relative = 1 == y % 2;
+        for (int x = 0; x + 1 < width; ++x) {
+            if (0 == x % 5 && x + 2 < width) {
+                // Two cells as one hexagon: four triangles
+                obj_write(w, "f");
+                obj_write_corner(w, width, x, y - 1, written, relative);
+                obj_write_corner(w, width, x + 1, y - 1, written, relative);
+                obj_write_corner(w, width, x + 2, y - 1, written, relative);
+                obj_write_corner(w, width, x + 2, y, written, relative);
+                obj_write_corner(w, width, x + 1, y, written, relative);
+                obj_write_corner(w, width, x, y, written, relative);
+                obj_write(w, "\n");
+                ++x;
+            } else if (0 == y % 7) {
+                obj_write(w, "f");
+                obj_write_corner(w, width, x, y - 1, written, relative);
+                obj_write_corner(w, width, x + 1, y - 1, written, relative);
+                obj_write_corner(w, width, x + 1, y, written, relative);
+                obj_write(w, "\nf");
+                obj_write_corner(w, width, x, y - 1, written, relative);
+                obj_write_corner(w, width, x + 1, y, written, relative);
+                obj_write_corner(w, width, x, y, written, relative);
+                obj_write(w, "\n");
+            } else {
+                obj_write(w, "f");
+                obj_write_corner(w, width, x, y - 1, written, relative);
+                obj_write_corner(w, width, x + 1, y - 1, written, relative);
+                obj_write_corner(w, width, x + 1, y, written, relative);
+                obj_write_corner(w, width, x, y, written, relative);
+                obj_write(w, "\n");
+            }
+        }
+    }
+    fwrite(w->buffer, 1, w->used, w->file);
+    fclose(w->file);
+    size_t total = w->total;
+    ::free(w);
+    return total;
+}
+
+static bool
+same_obj (ObjMesh const & a, ObjMesh const & b) {
+    if (a.vertex_count != b.vertex_count || a.index_count != b.index_count ||
+        a.submesh_count != b.submesh_count || a.material_count != b.material_count)
+        return false;
+    for (int i = 0; i < a.vertex_count; ++i) {
+        Vertex const & va = a.vertices[i];
+        Vertex const & vb = b.vertices[i];
+        if (0 != memcmp(&va.position, &vb.position, sizeof(va.position)) ||
+            0 != memcmp(&va.normal, &vb.normal, sizeof(va.normal)) ||
+            0 != memcmp(&va.texc, &vb.texc, sizeof(va.texc)))
+            return false;
+    }
+    for (int i = 0; i < a.material_count; ++i)
+        if (0 != strcmp(a.materials[i].name, b.materials[i].name))
+            return false;
+    return 0 == memcmp(a.indices, b.indices, sizeof(int) * a.index_count) &&
+        0 == memcmp(a.submeshes, b.submeshes, sizeof(ObjSubmesh) * a.submesh_count);
+}
+
+void
+bench_obj (BenchContext * ctx) {
+    int width = ctx->quick ? 500 : 2500;
+    int height = ctx->quick ? 100 : 1200;
+    int band_rows = ctx->quick ? 9 : 97;
+    size_t bytes = write_grid_obj(_OBJ_PATH, width, height, band_rows);
+    BENCH_CHECK(ctx, bytes > 0);
+    if (0 == bytes)
+        return;
+    double mb = bytes / 1048576.0;
+
+    ObjMesh chunked;
+    double t0 = bench_now_ms();
+    bool chunked_ok = load_obj(_OBJ_PATH, &chunked);
+    double chunked_ms = bench_now_ms() - t0;
+    ObjMesh whole;
+    t0 = bench_now_ms();
+    bool whole_ok = load_obj(_OBJ_PATH, &whole, SIZE_MAX);
+    double whole_ms = bench_now_ms() - t0;
+    remove(_OBJ_PATH);
+    BENCH_CHECK(ctx, chunked_ok && whole_ok);
+
+    // -- What the grid predicts: one vertex per grid point (every corner is
+    // i/i/i), two triangles per cell, one submesh per band of rows
+    int cells_per_row = width - 1;
+    int face_rows = height - 1;
+    int bands = (face_rows + band_rows - 1) / band_rows;
+    bool ranges = bands == chunked.submesh_count;
+    for (int b = 0; ranges && b < bands; ++b) {
+        int rows = b + 1 < bands ? band_rows : face_rows - b * band_rows;
+        ObjSubmesh const & sm = chunked.submeshes[b];
+        char name [8];
+        snprintf(name, sizeof(name), "m%d", b % _OBJ_MATERIALS);
+        ranges = sm.first_index == (uint32_t)(b * band_rows * cells_per_row * 6) &&
+            sm.index_count == (uint32_t)(rows * cells_per_row * 6) &&
+            sm.material >= 0 && sm.material < chunked.material_count &&
+            0 == strcmp(chunked.materials[sm.material].name, name);
+    }
+    BENCH_CHECK(ctx, width * height == chunked.vertex_count);
+    BENCH_CHECK(ctx, face_rows * cells_per_row * 6 == chunked.index_count);
+    BENCH_CHECK(ctx, ranges && (bands < _OBJ_MATERIALS ? bands : _OBJ_MATERIALS) == chunked.material_count);
+
+    // -- The chunks stitched together are the whole file parsed at once
+    BENCH_CHECK(ctx, same_obj(chunked, whole));
+
+    printf(
+        "%.1f MB, %d vertices, %d triangles, %d submeshes: chunked %.0f ms (%.1f MB/s), one chunk %.0f ms (%.1f MB/s)\n",
+        mb, chunked.vertex_count, chunked.index_count / 3, chunked.submesh_count,
+        chunked_ms, mb / chunked_ms * 1e3, whole_ms, mb / whole_ms * 1e3
+    );
+    free_obj(&chunked);
+    free_obj(&whole);
+}
@@ -0,0 +1,194 @@
+// Fragmentation stress of the TLSF range allocator behind the geometry pool:
+// meshes of very different sizes are streamed in and out of a mostly full
+// pool, once without compaction and once with a per-frame defrag budget.
+// A mirror of the pool tagged with each block's owner checks that the moves
+// defrag reports really preserve every block's contents.
+
+#include "bench.h"
+#include "range_allocator.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define _POOL_UNITS         (1u << 22)
+#define _MAX_BLOCKS         4096
+#define _TARGET_FILL        0.8f
+#define _DEFRAG_BUDGET      (1u << 16)  // units moved per frame, as in the demo
+
+// Address-ordered walk: blocks tile the pool, free neighbours are merged and
+// the free total matches.
+static bool
+range_alloc_consistent (RangeAllocator const * ra) {
+    uint32_t offset = 0;
+    uint32_t free_size = 0;
+    uint32_t prev = RANGE_ALLOC_INVALID;
+    for (uint32_t n = ra->phys_head; n != RANGE_ALLOC_INVALID; n = ra->nodes[n].phys_next) {
+        RangeNode const & node = ra->nodes[n];
+        if (node.offset != offset || node.phys_prev != prev)
+            return false;
+        if (!node.used) {
+            if (prev != RANGE_ALLOC_INVALID && !ra->nodes[prev].used)
+                return false;
+            free_size += node.size;
+        }
+        offset += node.size;
+        prev = n;
+    }
+    return offset == ra->total_size && free_size == ra->free_size;
+}
+// Mesh sizes spread log-uniformly over 64..64K units.
+static uint32_t
+random_mesh_size (uint32_t * rng) {
+    uint32_t shift = 6 + bench_rand(rng) % 10;
+    return (1u << shift) + bench_rand(rng) % (1u << shift);
+}
+
+struct StressResult {
+    int     frames;
+    int     allocs;
+    int     failed;         // no block large enough although free space was
+    double  frag_sum;
+    float   frag_max;
+    int     moves;
+    double  moved_units;
+    bool    intact;
+};
+
+static StressResult
+stress (int frames, bool defrag, uint32_t seed) {
+    StressResult r = {};
+    r.frames = frames;
+    r.intact = true;
+
+    RangeAllocator ra;
+    range_allocator_init(&ra, _POOL_UNITS, _MAX_BLOCKS);
+    uint32_t * mirror = (uint32_t *)::calloc(_POOL_UNITS, sizeof(uint32_t));
+    std::vector<uint32_t> live;
+    std::vector<uint32_t> node_tag(ra.max_nodes, 0);
+    RangeMove moves[256];
+    uint32_t rng = seed;
+    uint32_t next_tag = 1;
+
+    for (int f = 0; f < frames; ++f) {
+        // -- Stream a few meshes out, then refill up to the target.
+        int evict = 1 + (int)(bench_rand(&rng) % 4);
+        for (int e = 0; e < evict && !live.empty(); ++e) {
+            size_t k = bench_rand(&rng) % live.size();
+            range_allocator_free(&ra, live[k]);
+            live[k] = live.back();
+            live.pop_back();
+        }
+        while (ra.free_size > (uint32_t)(_POOL_UNITS * (1.0f - _TARGET_FILL)) && live.size() < _MAX_BLOCKS) {
+            uint32_t size = random_mesh_size(&rng);
+            uint32_t tag = next_tag++;
+            uint32_t n = range_allocator_alloc(&ra, size, tag);
+            ++r.allocs;
+            if (RANGE_ALLOC_INVALID == n) {
+                if (size <= ra.free_size)
+                    ++r.failed;
+                break;
+            }
+            node_tag[n] = tag;
+            uint32_t offset = range_allocator_offset(&ra, n);
+            for (uint32_t i = 0; i < size; ++i)
+                mirror[offset + i] = tag;
+            live.push_back(n);
+        }
+
+        if (defrag) {
+            int move_count = range_allocator_defrag(&ra, _DEFRAG_BUDGET, moves, 256);
+            for (int m = 0; m < move_count; ++m) {
+                memmove(mirror + moves[m].dst_offset, mirror + moves[m].src_offset, sizeof(uint32_t) * moves[m].size);
+                r.moved_units += moves[m].size;
+                r.intact = r.intact && moves[m].user == node_tag[moves[m].node];
+            }
+            r.moves += move_count;
+        }
+
+        float frag = range_allocator_fragmentation(&ra);
+        r.frag_sum += frag;
+        if (frag > r.frag_max)
+            r.frag_max = frag;
+    }
+
+    // -- Every live block still holds its own tag.
+    for (uint32_t n : live) {
+        RangeNode const & node = ra.nodes[n];
+        for (uint32_t i = 0; i < node.size && r.intact; ++i)
+            r.intact = mirror[node.offset + i] == node_tag[n];
+    }
+    r.intact = r.intact && range_alloc_consistent(&ra);
+
+    ::free(mirror);
+    range_allocator_destroy(&ra);
+    return r;
+}
+
+void
+bench_range_alloc (BenchContext * ctx) {
+    // -- A freed block is reused by an allocation of the same size, also
+    // when that size falls inside a bin (as the demo's terrain tiles do).
+    {
+        uint32_t const size = 65 * 65;
+        RangeAllocator ra;
+        range_allocator_init(&ra, size * 8 + 100, 16);
+        uint32_t blocks [8];
+        for (int i = 0; i < 8; ++i)
+            blocks[i] = range_allocator_alloc(&ra, size, 0);
+        range_allocator_free(&ra, blocks[3]);
+        range_allocator_free(&ra, blocks[6]);
+        uint32_t again = range_allocator_alloc(&ra, size, 0);
+        uint32_t twice = range_allocator_alloc(&ra, size, 0);
+        printf("same-size reuse: %s\n", again != RANGE_ALLOC_INVALID && twice != RANGE_ALLOC_INVALID ? "ok" : "FAILED");
+        BENCH_CHECK(ctx, RANGE_ALLOC_INVALID != blocks[7]);
+        BENCH_CHECK(ctx, RANGE_ALLOC_INVALID != again && RANGE_ALLOC_INVALID != twice);
+        BENCH_CHECK(ctx, RANGE_ALLOC_INVALID == range_allocator_alloc(&ra, size, 0));
+        BENCH_CHECK(ctx, range_alloc_consistent(&ra));
+        range_allocator_destroy(&ra);
+    }
+
+    // -- Raw alloc/free throughput, random sizes, ~half full.
+    {
+        int ops = ctx->quick ? 200000 : 5000000;
+        RangeAllocator ra;
+        range_allocator_init(&ra, 1u << 28, _MAX_BLOCKS);
+        std::vector<uint32_t> live;
+        live.reserve(_MAX_BLOCKS);
+        uint32_t rng = 1;
+        double t0 = bench_now_ms();
+        for (int i = 0; i < ops; ++i) {
+            if (live.size() < _MAX_BLOCKS / 2 || (live.size() < _MAX_BLOCKS && (bench_rand(&rng) & 1))) {
+                uint32_t n = range_allocator_alloc(&ra, random_mesh_size(&rng), 0);
+                if (n != RANGE_ALLOC_INVALID)
+                    live.push_back(n);
+            } else {
+                size_t k = bench_rand(&rng) % live.size();
+                range_allocator_free(&ra, live[k]);
+                live[k] = live.back();
+                live.pop_back();
+            }
+        }
+        double ms = bench_now_ms() - t0;
+        printf("alloc/free: %d ops in %.1f ms, %.1f M ops/s\n", ops, ms, ops / ms / 1000.0);
+        BENCH_CHECK(ctx, range_alloc_consistent(&ra));
+        range_allocator_destroy(&ra);
+    }
+
+    // -- Streaming at 80% fill, with and without compaction.
+    int frames = ctx->quick ? 2000 : 20000;
+    for (int pass = 0; pass < 2; ++pass) {
+        bool defrag = 1 == pass;
+        double t0 = bench_now_ms();
+        StressResult r = stress(frames, defrag, 12345);
+        double ms = bench_now_ms() - t0;
+        printf(
+            "%-10s %d frames, %d allocs, %d failed with space free, fragmentation avg %.3f max %.3f",
+            defrag ? "defrag:" : "no defrag:", r.frames, r.allocs, r.failed, r.frag_sum / r.frames, r.frag_max
+        );
+        if (defrag)
+            printf(", %d moves (%.0f units/frame)", r.moves, r.moved_units / r.frames);
+        printf(", %.1f ms\n", ms);
+        BENCH_CHECK(ctx, r.intact);
+    }
+}
@@ -0,0 +1,160 @@
+// Stencil shadow volumes of the demo's casters (box, sphere, cylinder):
+// every volume must be closed (each directed edge matched by its reverse)
+// for directional and point lights, a worker pool must produce the same
+// volumes as a single thread, and 100 lights over 1000 casters are timed
+// single-threaded, with fork/join threads and on a pool.
+
+#include "bench.h"
+#include "geometry.h"
+#include "shadow_volume.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#define _SHADOW_EXTRUSION   40.0f
+
+// Sum of +1/-1 per undirected edge over the volume's triangles; a closed,
+// consistently wound volume leaves every edge at zero.
+static int
+unmatched_edges (int const indices [], int index_count) {
+    std::vector<uint64_t> keys;
+    keys.reserve(index_count);
+    for (int t = 0; t < index_count; t += 3) {
+        for (int k = 0; k < 3; ++k) {
+            uint32_t a = (uint32_t)indices[t + k];
+            uint32_t b = (uint32_t)indices[t + (k + 1) % 3];
+            keys.push_back(a < b ? ((uint64_t)a << 32 | b) << 1 : ((uint64_t)b << 32 | a) << 1 | 1);
+        }
+    }
+    std::sort(keys.begin(), keys.end());
+    int unmatched = 0;
+    for (size_t i = 0; i < keys.size();) {
+        size_t j = i;
+        int balance = 0;
+        for (; j < keys.size() && keys[j] >> 1 == keys[i] >> 1; ++j)
+            balance += (keys[j] & 1) ? -1 : 1;
+        unmatched += 0 != balance;
+        i = j;
+    }
+    return unmatched;
+}
+
+// A null pool forks and joins threads on every call.
+static double
+build_ms (WorkerPool * pool, ShadowJob jobs [], int job_count, int lights,
+          XMFLOAT3 * vertices, int * scratch, int * indices, ShadowDraw * draws, int64_t * index_total) {
+    *index_total = 0;
+    double t0 = bench_now_ms();
+    for (int l = 0; l < lights; ++l) {
+        for (int j = 0; j < job_count; ++j) {
+            float a = l * 0.3f + j * 0.001f;
+            jobs[j].light = XMFLOAT4(cosf(a), 1.0f, sinf(a), 0.0f);
+        }
+        *index_total += shadow_volumes_build(pool, jobs, job_count, _SHADOW_EXTRUSION, vertices, sizeof(XMFLOAT3), scratch, indices, draws);
+    }
+    return bench_now_ms() - t0;
+}
+
+void
+bench_shadow_volumes (BenchContext * ctx) {
+    char const * names [3] = {"box", "sphere", "cylinder"};
+    std::vector<Vertex> vertices [3];
+    std::vector<int> indices [3];
+    vertices[0].resize(24);
+    indices[0].resize(36);
+    create_box(1.0f, 1.0f, 1.0f, vertices[0].data(), indices[0].data(), nullptr);
+    vertices[1].resize(401);
+    indices[1].resize(2280);
+    create_sphere(0.5f, vertices[1].data(), indices[1].data(), nullptr);
+    vertices[2].resize(485);
+    indices[2].resize(2520);
+    create_cylinder(0.5f, 0.3f, 3.0f, vertices[2].data(), indices[2].data(), nullptr);
+
+    ShadowCaster casters [3];
+    for (int c = 0; c < 3; ++c) {
+        shadow_caster_create(
+            &casters[c], &vertices[c][0].position.x, sizeof(Vertex), (int)vertices[c].size(),
+            indices[c].data(), (int)indices[c].size()
+        );
+    }
+
+    // -- Closed volumes, lit from above, from the side and from close by
+    XMFLOAT4 const lights [] = {
+        XMFLOAT4(0.3f, 1.0f, 0.2f, 0.0f), XMFLOAT4(-1.0f, 0.1f, 0.4f, 0.0f),
+        XMFLOAT4(3.0f, 4.0f, -2.0f, 1.0f), XMFLOAT4(0.0f, 0.0f, 2.5f, 1.0f),
+    };
+    for (int c = 0; c < 3; ++c) {
+        std::vector<XMFLOAT3> v(shadow_caster_vertex_bound(&casters[c]));
+        std::vector<int> idx(shadow_caster_index_bound(&casters[c]));
+        int open = 0;
+        int max_indices = 0;
+        for (XMFLOAT4 const & light : lights) {
+            shadow_extrude_vertices(&casters[c], light, _SHADOW_EXTRUSION, v.data(), sizeof(XMFLOAT3));
+            int n = shadow_volume_indices(&casters[c], light, idx.data());
+            open += unmatched_edges(idx.data(), n);
+            max_indices = n > max_indices ? n : max_indices;
+            BENCH_CHECK(ctx, n > 0);
+        }
+        printf(
+            "%-8s %4d vertices %5d edges: up to %5d volume indices, %d unmatched edges\n",
+            names[c], casters[c].vertex_count, casters[c].edge_count, max_indices, open
+        );
+        BENCH_CHECK(ctx, 0 == open);
+    }
+
+    // -- 1000 casters per light, as many as a busy scene would cast
+    int job_count = 1000;
+    int light_count = ctx->quick ? 10 : 100;
+    std::vector<ShadowJob> jobs(job_count);
+    size_t vertex_bound = 0;
+    size_t index_bound = 0;
+    int64_t edges = 0;
+    for (int j = 0; j < job_count; ++j) {
+        jobs[j].caster = &casters[j % 3];
+        jobs[j].light = XMFLOAT4(0.3f, 1.0f, 0.2f, 0.0f);
+        vertex_bound += shadow_caster_vertex_bound(jobs[j].caster);
+        index_bound += shadow_caster_index_bound(jobs[j].caster);
+        edges += jobs[j].caster->edge_count;
+    }
+    std::vector<XMFLOAT3> out_vertices(vertex_bound);
+    std::vector<int> scratch(index_bound);
+    std::vector<int> out_indices(index_bound);
+    std::vector<int> pooled_indices(index_bound);
+    std::vector<ShadowDraw> draws(job_count);
+    std::vector<ShadowDraw> pooled_draws(job_count);
+
+    // A pool of one thread runs every task on the caller.
+    WorkerPool * single = worker_pool_create(1);
+    WorkerPool * pool = worker_pool_create(0);
+
+    // The pool splits the jobs across threads; the result must not change.
+    int serial = shadow_volumes_build(single, jobs.data(), job_count, _SHADOW_EXTRUSION, out_vertices.data(), sizeof(XMFLOAT3), scratch.data(), out_indices.data(), draws.data());
+    int pooled = shadow_volumes_build(pool, jobs.data(), job_count, _SHADOW_EXTRUSION, out_vertices.data(), sizeof(XMFLOAT3), scratch.data(), pooled_indices.data(), pooled_draws.data());
+    BENCH_CHECK(ctx, serial == pooled);
+    BENCH_CHECK(ctx, 0 == memcmp(draws.data(), pooled_draws.data(), sizeof(ShadowDraw) * job_count));
+    BENCH_CHECK(ctx, 0 == memcmp(out_indices.data(), pooled_indices.data(), sizeof(int) * (serial < pooled ? serial : pooled)));
+
+    struct { char const * name; WorkerPool * pool; } const modes [] = {
+        {"single thread", single},
+        {"fork/join", nullptr},
+        {"worker pool", pool},
+    };
+    for (auto const & mode : modes) {
+        int64_t index_total = 0;
+        double ms = build_ms(
+            mode.pool, jobs.data(), job_count, light_count,
+            out_vertices.data(), scratch.data(), out_indices.data(), draws.data(), &index_total
+        );
+        printf(
+            "%d lights x %d casters, %-13s: %7.1f ms (%.2f ms/light), %.1f M indices, %.0f M edges/s\n",
+            light_count, job_count, mode.name, ms, ms / light_count, index_total / 1e6, edges * light_count / ms / 1e3
+        );
+    }
+
+    worker_pool_destroy(pool);
+    worker_pool_destroy(single);
+    for (int c = 0; c < 3; ++c)
+        shadow_caster_destroy(&casters[c]);
+}
@@ -0,0 +1,107 @@
+// generate_tangents against the analytic tangents of the generators, on
+// mirrored UVs and on a bumpy surface, then its throughput on grids of
+// millions of triangles.
+
+#include "bench.h"
+#include "tangents.h"
+
+#include <math.h>
+#include <vector>
+
+static float
+tangent_dot (XMFLOAT3 const & a, XMFLOAT3 const & b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+// Largest 1 - cos between generated and analytic tangents.
+static float
+analytic_error (std::vector<Vertex> & vertices, std::vector<int> const & indices) {
+    std::vector<Vertex> analytic = vertices;
+    generate_tangents(vertices.data(), (int)vertices.size(), indices.data(), (int)indices.size());
+    float worst = 0.0f;
+    for (size_t i = 0; i < vertices.size(); ++i)
+        worst = fmaxf(worst, 1.0f - tangent_dot(vertices[i].tangent_u, analytic[i].tangent_u));
+    return worst;
+}
+
+void
+bench_tangents (BenchContext * ctx) {
+    MeshBounds bounds;
+
+    // -- Generators that fill tangent_u analytically.
+    {
+        int m = 200;
+        std::vector<Vertex> vertices(m * m);
+        std::vector<int> indices((m - 1) * (m - 1) * 6);
+        create_grid(10.0f, 10.0f, m, m, vertices.data(), indices.data(), &bounds);
+        float grid_error = analytic_error(vertices, indices);
+
+        vertices.resize(24);
+        indices.resize(36);
+        create_box(1.0f, 2.0f, 3.0f, vertices.data(), indices.data(), &bounds);
+        float box_error = analytic_error(vertices, indices);
+
+        printf("analytic: grid 1-cos %.2g, box 1-cos %.2g\n", grid_error, box_error);
+        BENCH_CHECK(ctx, grid_error < 1e-5f);
+        BENCH_CHECK(ctx, box_error < 1e-5f);
+    }
+
+    // -- Right half of the UVs mirrored: tangents flip there, and the two
+    // halves don't bleed into each other away from the seam.
+    {
+        int m = 9;
+        std::vector<Vertex> vertices(m * m);
+        std::vector<int> indices((m - 1) * (m - 1) * 6);
+        create_grid(2.0f, 2.0f, m, m, vertices.data(), indices.data(), &bounds);
+        for (Vertex & v : vertices)
+            if (v.position.x > 0.0f)
+                v.texc.x = 1.0f - v.texc.x;
+        generate_tangents(vertices.data(), m * m, indices.data(), (int)indices.size());
+        float worst = 1.0f;
+        for (Vertex const & v : vertices) {
+            float step = 2.0f / (m - 1);
+            if (fabsf(v.position.x) < 1.5f * step)
+                continue;   // seam column and its neighbours average both sides
+            float expected = v.position.x < 0.0f ? 1.0f : -1.0f;
+            worst = fminf(worst, v.tangent_u.x * expected);
+        }
+        printf("mirrored: worst cos vs expected %.4f\n", worst);
+        BENCH_CHECK(ctx, worst > 0.999f);
+    }
+
+    // -- Bumpy surface: tangents stay unit length and orthogonal to the
+    // (generated) normals.
+    {
+        int m = 128;
+        std::vector<Vertex> vertices(m * m);
+        std::vector<int> indices((m - 1) * (m - 1) * 6);
+        create_grid(10.0f, 10.0f, m, m, vertices.data(), indices.data(), &bounds);
+        for (Vertex & v : vertices)
+            v.position.y = 0.5f * sinf(2.0f * v.position.x) * cosf(3.0f * v.position.z);
+        generate_normals(vertices.data(), m * m, indices.data(), (int)indices.size());
+        generate_tangents(vertices.data(), m * m, indices.data(), (int)indices.size());
+        float worst_dot = 0.0f;
+        float worst_len = 0.0f;
+        for (Vertex const & v : vertices) {
+            worst_dot = fmaxf(worst_dot, fabsf(tangent_dot(v.tangent_u, v.normal)));
+            worst_len = fmaxf(worst_len, fabsf(sqrtf(tangent_dot(v.tangent_u, v.tangent_u)) - 1.0f));
+        }
+        printf("bumpy: worst |t.n| %.2g, worst | |t| - 1 | %.2g\n", worst_dot, worst_len);
+        BENCH_CHECK(ctx, worst_dot < 1e-4f);
+        BENCH_CHECK(ctx, worst_len < 1e-4f);
+    }
+
+    // -- Throughput.
+    int const sizes [] = {300, 1000, 1415};
+    int size_count = ctx->quick ? 1 : 3;
+    for (int s = 0; s < size_count; ++s) {
+        int m = sizes[s];
+        std::vector<Vertex> vertices(m * m);
+        std::vector<int> indices((size_t)(m - 1) * (m - 1) * 6);
+        create_grid(10.0f, 10.0f, m, m, vertices.data(), indices.data(), &bounds);
+        double t0 = bench_now_ms();
+        generate_tangents(vertices.data(), m * m, indices.data(), (int)indices.size());
+        double ms = bench_now_ms() - t0;
+        double tris = indices.size() / 3.0;
+        printf("%7.2f M triangles: %7.1f ms, %.1f M triangles/s\n", tris / 1e6, ms, tris / ms / 1000.0);
+    }
+}
@@ -0,0 +1,93 @@
+// create_terrain: the SIMD fBm rows against the scalar terrain_fbm, normals
+// of a heightmap with a known slope, and build throughput in vertices per
+// second.
+
+#include "bench.h"
+#include "terrain.h"
+
+#include <math.h>
+#include <vector>
+
+void
+bench_terrain (BenchContext * ctx) {
+    MeshBounds bounds;
+
+    TerrainParams fbm = {};
+    fbm.width = 160.0f;
+    fbm.depth = 160.0f;
+    fbm.m = 129;
+    fbm.n = 129;
+    fbm.octaves = 6;
+    fbm.frequency = 0.02f;
+    fbm.amplitude = 4.0f;
+    fbm.lacunarity = 2.0f;
+    fbm.gain = 0.5f;
+    fbm.seed = 1337;
+
+    // -- Vectorized heights match the scalar reference.
+    {
+        std::vector<Vertex> vertices(fbm.m * fbm.n);
+        std::vector<int> indices((fbm.m - 1) * (fbm.n - 1) * 6);
+        create_terrain(&fbm, vertices.data(), indices.data(), &bounds);
+        float worst = 0.0f;
+        for (Vertex const & v : vertices)
+            worst = fmaxf(worst, fabsf(terrain_fbm(&fbm, v.position.x, v.position.z) - v.position.y));
+        printf("fBm: SIMD vs scalar max |dh| %.2g\n", worst);
+        BENCH_CHECK(ctx, worst < 1e-4f);
+    }
+
+    // -- Heightmap h = scale * u^2 along x: normals follow dh/dx exactly,
+    // tangents stay orthogonal to them.
+    {
+        int side = 257;
+        std::vector<float> samples(side * side);
+        for (int y = 0; y < side; ++y)
+            for (int x = 0; x < side; ++x) {
+                float u = x / (float)(side - 1);
+                samples[y * side + x] = u * u;
+            }
+        TerrainParams hm = {};
+        hm.width = 10.0f;
+        hm.depth = 10.0f;
+        hm.m = side;
+        hm.n = side;
+        hm.heightmap.samples = samples.data();
+        hm.heightmap.width = side;
+        hm.heightmap.height = side;
+        hm.height_scale = 2.0f;
+        std::vector<Vertex> vertices(side * side);
+        std::vector<int> indices((side - 1) * (side - 1) * 6);
+        create_terrain(&hm, vertices.data(), indices.data(), &bounds);
+
+        float worst_normal = 0.0f;
+        float worst_dot = 0.0f;
+        for (int i = 1; i < side - 1; ++i) {
+            for (int j = 1; j < side - 1; ++j) {
+                Vertex const & v = vertices[i * side + j];
+                float dhdx = 2.0f * hm.height_scale * v.texc.x / hm.width;
+                float len = sqrtf(dhdx * dhdx + 1.0f);
+                worst_normal = fmaxf(worst_normal, fabsf(-dhdx / len - v.normal.x) + fabsf(1.0f / len - v.normal.y) + fabsf(v.normal.z));
+                worst_dot = fmaxf(worst_dot, fabsf(v.tangent_u.x * v.normal.x + v.tangent_u.y * v.normal.y + v.tangent_u.z * v.normal.z));
+            }
+        }
+        printf("heightmap: normal error %.2g, worst |t.n| %.2g\n", worst_normal, worst_dot);
+        BENCH_CHECK(ctx, worst_normal < 1e-3f);
+        BENCH_CHECK(ctx, worst_dot < 1e-5f);
+    }
+
+    // -- Throughput, heights + normals + tangents + indices.
+    int const sides [] = {257, 1025, 2049};
+    int side_count = ctx->quick ? 1 : 3;
+    for (int s = 0; s < side_count; ++s) {
+        TerrainParams p = fbm;
+        p.m = p.n = sides[s];
+        p.width = p.depth = (float)(sides[s] - 1);
+        size_t vertex_count = (size_t)p.m * p.n;
+        std::vector<Vertex> vertices(vertex_count);
+        std::vector<int> indices((size_t)(p.m - 1) * (p.n - 1) * 6);
+        double t0 = bench_now_ms();
+        create_terrain(&p, vertices.data(), indices.data(), &bounds);
+        double ms = bench_now_ms() - t0;
+        printf("%4d^2: %7.1f ms, %.1f M vertices/s\n", sides[s], ms, vertex_count / ms / 1000.0);
+    }
+}
@@ -0,0 +1,115 @@
+// CDLOD selection on the demo's 1025^2 terrain: cached slots must match a
+// fresh fill, the selection must draw a small fraction of the full grid's
+// triangles, and per-frame update cost is timed for an orbit and a straight
+// fly-over, with fork/join threads and on a worker pool.
+
+#include "bench.h"
+#include "terrain_lod.h"
+
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+// Parameters of the demo's quadtree terrain.
+#define _TERRAIN_PATCH      32
+#define _TERRAIN_LEVELS     6
+#define _TERRAIN_LOD0_RANGE 96.0f
+#define _TERRAIN_SLOTS      256
+
+static XMFLOAT3
+orbit_eye (int frame) {
+    float a = frame * 0.01f;
+    return XMFLOAT3(30.0f * cosf(a), 15.0f, 30.0f * sinf(a));
+}
+static XMFLOAT3
+fly_eye (int frame, int frames) {
+    float z = -480.0f + 960.0f * frame / frames;
+    return XMFLOAT3(0.25f * z, 25.0f, z);
+}
+
+void
+bench_terrain_lod (BenchContext * ctx) {
+    TerrainParams params = {};
+    params.width = 1024.0f;
+    params.octaves = 6;
+    params.frequency = 0.005f;
+    params.amplitude = 20.0f;
+    params.lacunarity = 2.0f;
+    params.gain = 0.5f;
+    params.seed = 1337;
+
+    TerrainLod t;
+    double t0 = bench_now_ms();
+    bool created = terrain_lod_create(&t, &params, _TERRAIN_PATCH, _TERRAIN_LEVELS, _TERRAIN_LOD0_RANGE, _TERRAIN_SLOTS);
+    double create_ms = bench_now_ms() - t0;
+    BENCH_CHECK(ctx, created);
+    if (!created)
+        return;
+    printf("create: %d^2 samples, %d nodes, %.1f ms\n", t.params.m, t.node_count, create_ms);
+
+    // -- Slots kept across updates hold what a fresh fill would write.
+    int frames = ctx->quick ? 200 : 2000;
+    int stale = 0;
+    int dropped = 0;
+    std::vector<XMFLOAT3> kept(t.patch_vertex_count);
+    for (int f = 0; f < frames; f += 10) {
+        XMFLOAT3 eye = (f & 16) ? orbit_eye(f) : fly_eye(f, frames);
+        terrain_lod_update(&t, eye, nullptr);
+        dropped += t.dropped;
+        for (int d = 0; d < t.draw_count; ++d) {
+            int slot = t.draws[d].slot;
+            XMFLOAT3 * positions = t.slot_positions + slot * t.patch_vertex_count;
+            memcpy(kept.data(), positions, sizeof(XMFLOAT3) * t.patch_vertex_count);
+            terrain_lod_fill_slot(&t, slot, t.slot_node[slot], eye);
+            stale += 0 != memcmp(kept.data(), positions, sizeof(XMFLOAT3) * t.patch_vertex_count);
+        }
+    }
+    printf("cache: %d stale slots, %d nodes dropped for lack of slots\n", stale, dropped);
+    BENCH_CHECK(ctx, 0 == stale);
+    BENCH_CHECK(ctx, 0 == dropped);
+
+    // -- Triangles drawn against the full-resolution grid.
+    t.selected = false;
+    terrain_lod_update(&t, XMFLOAT3(0.0f, 15.0f, -15.0f), nullptr);
+    TerrainLodStats st;
+    terrain_lod_stats(&t, &st);
+    printf(
+        "selection: %d nodes, %d draws, %d of %d triangles (%.2f%%)\n",
+        st.nodes, st.draws, st.triangles, st.full_triangles, 100.0 * st.triangles / st.full_triangles
+    );
+    BENCH_CHECK(ctx, st.triangles < st.full_triangles / 4);
+
+    // -- Per-frame cost: selection alone, then full updates.
+    XMFLOAT3 eye = orbit_eye(0);
+    t0 = bench_now_ms();
+    for (int f = 0; f < frames; ++f) {
+        t.draw_count = 0;
+        terrain_lod_select_node(&t, eye, 0, 0, 0);
+    }
+    printf("select only: %.4f ms/frame\n", (bench_now_ms() - t0) / frames);
+
+    WorkerPool * pool = worker_pool_create(0);
+    for (int pass = 0; pass < 2; ++pass) {
+        WorkerPool * p = pass ? pool : nullptr;
+        for (int path = 0; path < 2; ++path) {
+            t.selected = false;
+            int rebuilt = 0;
+            double worst = 0.0;
+            t0 = bench_now_ms();
+            for (int f = 0; f < frames; ++f) {
+                double f0 = bench_now_ms();
+                terrain_lod_update(&t, path ? fly_eye(f, frames) : orbit_eye(f), p);
+                double f1 = bench_now_ms();
+                worst = f1 - f0 > worst ? f1 - f0 : worst;
+                rebuilt += t.dirty_count;
+            }
+            double ms = bench_now_ms() - t0;
+            printf(
+                "update %-5s %-9s: %.3f ms/frame avg, %.3f ms worst, %.1f slots refilled/frame\n",
+                path ? "fly" : "orbit", p ? "pool" : "fork/join", ms / frames, worst, (double)rebuilt / frames
+            );
+        }
+    }
+    worker_pool_destroy(pool);
+    terrain_lod_destroy(&t);
+}
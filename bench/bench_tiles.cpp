@@ -0,0 +1,180 @@
+// Headless fly-through over a streamed tiled heightfield. Each frame does
+// the demo's main-thread streaming work (update, release evicted tiles,
+// upload finished ones until the per-frame upload time is used up), with a
+// range allocator and a CPU array standing in for the vertex buffer, then
+// sleeps out the rest of the frame so the I/O threads run alongside as
+// they would behind rendering. Streaming time over _TILE_SPIKE_MS counts
+// as a spike; wanted tiles that aren't resident yet count as holes.
+
+#include "bench.h"
+#include "range_allocator.h"
+#include "tile_streamer.h"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+// The demo's streaming parameters.
+#define _TILE_SIZE              64
+#define _TILE_COUNT             64
+#define _TILE_SPACING           2.0f
+#define _TILE_VIEW_RADIUS       600.0f
+#define _TILE_PREFETCH_RADIUS   800.0f
+#define _TILE_THREADS           2
+#define _TILE_QUEUE             32
+#define _TILE_BUDGET            (16u << 20)
+#define _TILE_UPLOAD_MS         2.0
+#define _TILE_SPIKE_MS          4.0
+#define _TILE_FLY_SPEED         60.0f
+
+#define _TILE_PATH              "bench_tiles.thf"
+#define _FRAME_MS               (1000.0 / 60.0)
+
+struct DemoVertex {
+    XMFLOAT3 position;
+    XMFLOAT4 color;
+};
+
+struct FlyResult {
+    std::vector<double> stream_ms;
+    int     uploaded;
+    int     upload_failed;
+    double  holes;          // wanted but not resident, summed over frames
+    int     hole_frames;
+};
+
+// Wanted tiles (within 'radius' of x, z) that aren't resident.
+static int
+count_holes (TileStreamer const * s, float x, float z, float radius) {
+    TiledHeightfieldHeader const * h = s->header;
+    float tile_width = h->tile_size * h->spacing;
+    float x0 = -(h->tiles_x / 2) * tile_width;
+    float z0 = -(h->tiles_z / 2) * tile_width;
+    int holes = 0;
+    for (int tz = 0; tz < h->tiles_z; ++tz) {
+        for (int tx = 0; tx < h->tiles_x; ++tx) {
+            float bx = x0 + tx * tile_width;
+            float bz = z0 + tz * tile_width;
+            float dx = x < bx ? bx - x : (x > bx + tile_width ? x - bx - tile_width : 0.0f);
+            float dz = z < bz ? bz - z : (z > bz + tile_width ? z - bz - tile_width : 0.0f);
+            if (dx * dx + dz * dz <= radius * radius && TILE_RESIDENT != s->state[tz * h->tiles_x + tx])
+                ++holes;
+        }
+    }
+    return holes;
+}
+
+static FlyResult
+fly (TileStreamer * tiles, int frames, float speed) {
+    FlyResult r = {};
+    uint32_t pool_vertices = (uint32_t)(_TILE_BUDGET / sizeof(DemoVertex)) + 4 * tiles->vertex_count;
+    RangeAllocator pool;
+    range_allocator_init(&pool, pool_vertices, tiles->tile_count);
+    std::vector<DemoVertex> buffer(pool_vertices);
+    std::vector<DemoVertex> vertices(tiles->vertex_count);
+
+    float extent = 0.5f * tiles->header->tiles_x * tiles->header->tile_size * tiles->header->spacing - _TILE_PREFETCH_RADIUS;
+    float x = -extent;
+    float z = -0.5f * extent;
+    float dt = (float)(_FRAME_MS / 1000.0);
+    for (int f = 0; f < frames; ++f) {
+        double t0 = bench_now_ms();
+        x += speed * 0.94f * dt;
+        z += speed * 0.34f * dt;
+        if (x > extent || z > extent) {
+            x = -extent;
+            z = -0.5f * extent;
+        }
+
+        tile_streamer_update(tiles, x, z, _TILE_VIEW_RADIUS, _TILE_PREFETCH_RADIUS, (uint32_t)f + 1);
+        for (int i = 0; i < tiles->evicted_count; ++i)
+            range_allocator_free(&pool, tiles->block[tiles->evicted[i]]);
+
+        TileMesh tile;
+        while (bench_now_ms() - t0 <= _TILE_UPLOAD_MS && tile_streamer_pop(tiles, &tile)) {
+            for (int i = 0; i < tiles->vertex_count; ++i) {
+                vertices[i].position = tile.vertices[i].position;
+                vertices[i].color = XMFLOAT4(tile.vertices[i].normal.x, tile.vertices[i].normal.y, tile.vertices[i].normal.z, 1.0f);
+            }
+            uint32_t block = range_allocator_alloc(&pool, tiles->vertex_count, (uint32_t)tile.tile);
+            if (RANGE_ALLOC_INVALID == block) {
+                ++r.upload_failed;
+                tile_streamer_discard(tiles, &tile);
+                continue;
+            }
+            int base_vertex = (int)range_allocator_offset(&pool, block);
+            memcpy(&buffer[base_vertex], vertices.data(), sizeof(DemoVertex) * tiles->vertex_count);
+            tile_streamer_resident(tiles, &tile, block, base_vertex);
+            ++r.uploaded;
+        }
+        double ms = bench_now_ms() - t0;
+        r.stream_ms.push_back(ms);
+
+        int holes = count_holes(tiles, x, z, _TILE_VIEW_RADIUS);
+        r.holes += holes;
+        r.hole_frames += holes > 0;
+
+        double left = _FRAME_MS - (bench_now_ms() - t0);
+        if (left > 0.0)
+            std::this_thread::sleep_for(std::chrono::microseconds((int64_t)(left * 1000.0)));
+    }
+    range_allocator_destroy(&pool);
+    return r;
+}
+
+void
+bench_tiles (BenchContext * ctx) {
+    int tile_count = ctx->quick ? 24 : _TILE_COUNT;
+    TerrainParams noise = {};
+    noise.octaves = 6;
+    noise.frequency = 0.005f;
+    noise.amplitude = 20.0f;
+    noise.lacunarity = 2.0f;
+    noise.gain = 0.5f;
+    noise.seed = 1337;
+    double t0 = bench_now_ms();
+    bool written = write_tiled_heightfield(_TILE_PATH, &noise, _TILE_SIZE, tile_count, tile_count, _TILE_SPACING);
+    double write_ms = bench_now_ms() - t0;
+    BENCH_CHECK(ctx, written);
+    if (!written)
+        return;
+    printf("write: %dx%d tiles of %d^2 quads in %.0f ms\n", tile_count, tile_count, _TILE_SIZE, write_ms);
+
+    // -- The demo's speed, then four times as fast.
+    int frames = ctx->quick ? 90 : 900;
+    for (int pass = 0; pass < 2; ++pass) {
+        float speed = pass ? 4.0f * _TILE_FLY_SPEED : _TILE_FLY_SPEED;
+        TileStreamer * tiles = tile_streamer_open(_TILE_PATH, _TILE_THREADS, _TILE_QUEUE, sizeof(DemoVertex), _TILE_BUDGET);
+        BENCH_CHECK(ctx, nullptr != tiles);
+        if (nullptr == tiles)
+            break;
+        FlyResult r = fly(tiles, frames, speed);
+        TileStreamerStats st;
+        tile_streamer_stats(tiles, &st);
+        tile_streamer_close(tiles);
+
+        std::vector<double> sorted = r.stream_ms;
+        std::sort(sorted.begin(), sorted.end());
+        double sum = 0.0;
+        int spikes = 0;
+        for (double ms : sorted) {
+            sum += ms;
+            spikes += ms > _TILE_SPIKE_MS;
+        }
+        printf(
+            "fly %3.0f u/s, %d frames: streaming %.3f ms avg, %.3f p99, %.3f max, %d spikes over %.0f ms\n",
+            speed, frames, sum / frames, sorted[(size_t)(0.99 * (frames - 1))], sorted.back(), spikes, _TILE_SPIKE_MS
+        );
+        printf(
+            "    %d uploaded, %d evicted, %d resident (%.1f MB); holes in %d frames, %.2f tiles/frame avg\n",
+            r.uploaded, st.evicted, st.resident, st.resident_bytes / 1048576.0, r.hole_frames, r.holes / frames
+        );
+        BENCH_CHECK(ctx, 0 == r.upload_failed);
+        BENCH_CHECK(ctx, st.resident_bytes <= _TILE_BUDGET);
+        // One stray frame can be the scheduler's doing; more is the streamer's.
+        // The quick run is too short to hold a rate to, so it only reports.
+        if (!ctx->quick)
+            BENCH_CHECK(ctx, spikes <= 1 + frames / 100);
+    }
+    remove(_TILE_PATH);
+}
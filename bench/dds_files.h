@@ -0,0 +1,125 @@
+#pragma once
+
+// DDS files for the loader benches: a DX10 header or a legacy pixel format
+// header, then seeded random texels, level after level for each array
+// slice. Sizes follow the packing the loader expects, tight rows of whole
+// blocks for BC formats.
+
+#include "bench.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+// Bytes of one level: 'block_bytes' per 4x4 block if nonzero, else
+// 'bits_per_pixel' per texel.
+static size_t
+dds_level_bytes (int block_bytes, int bits_per_pixel, int width, int height) {
+    if (block_bytes)
+        return (size_t)((width + 3) / 4) * ((height + 3) / 4) * block_bytes;
+    return ((size_t)width * bits_per_pixel + 7) / 8 * height;
+}
+static size_t
+dds_chain_bytes (int block_bytes, int bits_per_pixel, int width, int height, int mips) {
+    size_t bytes = 0;
+    for (int m = 0; m < mips; ++m) {
+        bytes += dds_level_bytes(block_bytes, bits_per_pixel, width, height);
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    return bytes;
+}
+
+// The 4-byte magic and 124-byte DDS_HEADER, as 32-bit words.
+static void
+dds_header (uint32_t words [32], int width, int height, int mips) {
+    memset(words, 0, sizeof(uint32_t) * 32);
+    words[0] = 0x20534444u;                     // "DDS "
+    uint32_t * h = words + 1;
+    h[0] = 124;
+    h[1] = 0x1 | 0x2 | 0x4 | 0x1000;            // CAPS, HEIGHT, WIDTH, PIXELFORMAT
+    if (mips > 1)
+        h[1] |= 0x20000;                        // MIPMAPCOUNT
+    h[2] = (uint32_t)height;
+    h[3] = (uint32_t)width;
+    h[6] = (uint32_t)mips;
+    h[18] = 32;                                 // ddspf.dwSize
+    h[26] = 0x1000;                             // DDSCAPS_TEXTURE
+}
+
+static void
+dds_random_payload (std::vector<uint8_t> * file, size_t bytes, uint32_t seed) {
+    size_t start = file->size();
+    file->resize(start + bytes);
+    uint32_t state = seed;
+    uint8_t * p = file->data() + start;
+    for (size_t i = 0; i + 4 <= bytes; i += 4) {
+        uint32_t r = bench_rand(&state);
+        memcpy(p + i, &r, 4);
+    }
+    for (size_t i = bytes & ~(size_t)3; i < bytes; ++i)
+        p[i] = (uint8_t)bench_rand(&state);
+}
+
+// A 2D texture (array) with the DX10 extension header.
+static std::vector<uint8_t>
+dds_make_dx10 (
+    uint32_t dxgi_format, int block_bytes, int bits_per_pixel,
+    int width, int height, int mips, int array_size, uint32_t seed
+) {
+    uint32_t words [32 + 5];
+    dds_header(words, width, height, mips);
+    words[1 + 19] = 0x4;                        // DDPF_FOURCC
+    words[1 + 20] = 0x30315844u;                // "DX10"
+    uint32_t * dx10 = words + 32;
+    dx10[0] = dxgi_format;
+    dx10[1] = 3;                                // D3D11_RESOURCE_DIMENSION_TEXTURE2D
+    dx10[2] = 0;
+    dx10[3] = (uint32_t)array_size;
+    dx10[4] = 0;
+    std::vector<uint8_t> file((uint8_t const *)words, (uint8_t const *)words + sizeof(words));
+    dds_random_payload(&file, dds_chain_bytes(block_bytes, bits_per_pixel, width, height, mips) * array_size, seed);
+    return file;
+}
+
+// A 2D texture with a legacy DDS_PIXELFORMAT: 'flags' as in ddspf.dwFlags
+// (DDPF_RGB 0x40, DDPF_ALPHAPIXELS 0x1, DDPF_LUMINANCE 0x20000, ...).
+static std::vector<uint8_t>
+dds_make_legacy (
+    uint32_t flags, int bits_per_pixel, uint32_t r_mask, uint32_t g_mask, uint32_t b_mask, uint32_t a_mask,
+    int width, int height, int mips, uint32_t seed
+) {
+    uint32_t words [32];
+    dds_header(words, width, height, mips);
+    uint32_t * pf = words + 1 + 18;
+    pf[1] = flags;
+    pf[3] = (uint32_t)bits_per_pixel;
+    pf[4] = r_mask;
+    pf[5] = g_mask;
+    pf[6] = b_mask;
+    pf[7] = a_mask;
+    std::vector<uint8_t> file((uint8_t const *)words, (uint8_t const *)words + sizeof(words));
+    dds_random_payload(&file, dds_chain_bytes(0, bits_per_pixel, width, height, mips), seed);
+    return file;
+}
+
+// A cube map with the DX10 extension header: six faces of 'size' square,
+// each storing its whole chain before the next.
+static std::vector<uint8_t>
+dds_make_cube (uint32_t dxgi_format, int block_bytes, int bits_per_pixel, int size, int mips, uint32_t seed) {
+    std::vector<uint8_t> file = dds_make_dx10(dxgi_format, block_bytes, bits_per_pixel, size, size, mips, 6, seed);
+    uint32_t cube [2] = { 0x4, 1 };             // D3D11_RESOURCE_MISC_TEXTURECUBE, one cube
+    memcpy(file.data() + 128 + 8, cube, sizeof(cube));
+    return file;
+}
+
+static bool
+dds_save (char const * path, std::vector<uint8_t> const & file) {
+    FILE * f = fopen(path, "wb");
+    if (nullptr == f)
+        return false;
+    bool ok = fwrite(file.data(), 1, file.size(), f) == file.size();
+    fclose(f);
+    return ok;
+}
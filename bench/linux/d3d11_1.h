@@ -0,0 +1,578 @@
+#pragma once
+
+// Just enough of d3d11_1.h for DDSTextureLoader11.cpp to build on Linux,
+// with a stand-in device behind it. Textures created on the stand-in copy
+// their initial data, as a driver uploading it would, and keep the copy so
+// the benches can check what the loader handed over. UpdateSubresource
+// replaces a subresource the same way. Only the calls the loader makes
+// exist, and only with the arguments it passes.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+// -- Source annotations, as no-ops. Not a sal.h of its own, which would
+// shadow the one DirectXMath takes from the include path.
+
+#define _In_
+#define _In_z_
+#define _In_opt_
+#define _Inout_
+#define _Inout_opt_
+#define _Out_
+#define _Out_opt_
+#define _Outptr_opt_
+#define _Use_decl_annotations_
+#define _In_reads_(size)
+#define _In_reads_opt_(size)
+#define _In_reads_bytes_(size)
+#define _In_reads_bytes_opt_(size)
+#define _Out_writes_(size)
+#define _Out_writes_opt_(size)
+#define _Out_writes_bytes_(size)
+#define _Analysis_assume_(expr)
+
+// -- Win32
+
+typedef int32_t     HRESULT;
+typedef uint32_t    UINT;
+typedef uint32_t    DWORD;
+typedef char        CHAR;
+typedef void *      HANDLE;
+
+#define S_OK            ((HRESULT)0)
+#define S_FALSE         ((HRESULT)1)
+#define E_NOTIMPL       ((HRESULT)0x80004001)
+#define E_POINTER       ((HRESULT)0x80004003)
+#define E_ABORT         ((HRESULT)0x80004004)
+#define E_FAIL          ((HRESULT)0x80004005)
+#define E_UNEXPECTED    ((HRESULT)0x8000FFFF)
+#define E_OUTOFMEMORY   ((HRESULT)0x8007000E)
+#define E_INVALIDARG    ((HRESULT)0x80070057)
+#define SUCCEEDED(hr)   (((HRESULT)(hr)) >= 0)
+#define FAILED(hr)      (((HRESULT)(hr)) < 0)
+
+#define HRESULT_FROM_WIN32(x)       ((HRESULT)(((x) & 0x0000FFFF) | 0x80070000))
+#define ERROR_FILE_NOT_FOUND        2
+#define ERROR_INVALID_DATA          13
+#define ERROR_HANDLE_EOF            38
+#define ERROR_NOT_SUPPORTED         50
+#define ERROR_ARITHMETIC_OVERFLOW   534
+#define ERROR_OPERATION_ABORTED     995
+#define ERROR_IO_PENDING            997
+#define ERROR_CANCELLED             1223
+#define ERROR_INVALID_STATE         5023
+
+#define UNREFERENCED_PARAMETER(x)   (void)(x)
+#define INVALID_HANDLE_VALUE        ((HANDLE)(intptr_t)-1)
+
+// The loader's handle wrapper is declared on every platform but only holds
+// handles on Windows.
+inline int
+CloseHandle (HANDLE) {
+    return 1;
+}
+
+inline size_t
+strnlen_s (char const * s, size_t count) {
+    return s ? strnlen(s, count) : 0;
+}
+
+// -- DXGI and Direct3D types
+
+enum DXGI_FORMAT
+{
+    DXGI_FORMAT_UNKNOWN                      = 0,
+    DXGI_FORMAT_R32G32B32A32_TYPELESS        = 1,
+    DXGI_FORMAT_R32G32B32A32_FLOAT           = 2,
+    DXGI_FORMAT_R32G32B32A32_UINT            = 3,
+    DXGI_FORMAT_R32G32B32A32_SINT            = 4,
+    DXGI_FORMAT_R32G32B32_TYPELESS           = 5,
+    DXGI_FORMAT_R32G32B32_FLOAT              = 6,
+    DXGI_FORMAT_R32G32B32_UINT               = 7,
+    DXGI_FORMAT_R32G32B32_SINT               = 8,
+    DXGI_FORMAT_R16G16B16A16_TYPELESS        = 9,
+    DXGI_FORMAT_R16G16B16A16_FLOAT           = 10,
+    DXGI_FORMAT_R16G16B16A16_UNORM           = 11,
+    DXGI_FORMAT_R16G16B16A16_UINT            = 12,
+    DXGI_FORMAT_R16G16B16A16_SNORM           = 13,
+    DXGI_FORMAT_R16G16B16A16_SINT            = 14,
+    DXGI_FORMAT_R32G32_TYPELESS              = 15,
+    DXGI_FORMAT_R32G32_FLOAT                 = 16,
+    DXGI_FORMAT_R32G32_UINT                  = 17,
+    DXGI_FORMAT_R32G32_SINT                  = 18,
+    DXGI_FORMAT_R32G8X24_TYPELESS            = 19,
+    DXGI_FORMAT_D32_FLOAT_S8X24_UINT         = 20,
+    DXGI_FORMAT_R32_FLOAT_X8X24_TYPELESS     = 21,
+    DXGI_FORMAT_X32_TYPELESS_G8X24_UINT      = 22,
+    DXGI_FORMAT_R10G10B10A2_TYPELESS         = 23,
+    DXGI_FORMAT_R10G10B10A2_UNORM            = 24,
+    DXGI_FORMAT_R10G10B10A2_UINT             = 25,
+    DXGI_FORMAT_R11G11B10_FLOAT              = 26,
+    DXGI_FORMAT_R8G8B8A8_TYPELESS            = 27,
+    DXGI_FORMAT_R8G8B8A8_UNORM               = 28,
+    DXGI_FORMAT_R8G8B8A8_UNORM_SRGB          = 29,
+    DXGI_FORMAT_R8G8B8A8_UINT                = 30,
+    DXGI_FORMAT_R8G8B8A8_SNORM               = 31,
+    DXGI_FORMAT_R8G8B8A8_SINT                = 32,
+    DXGI_FORMAT_R16G16_TYPELESS              = 33,
+    DXGI_FORMAT_R16G16_FLOAT                 = 34,
+    DXGI_FORMAT_R16G16_UNORM                 = 35,
+    DXGI_FORMAT_R16G16_UINT                  = 36,
+    DXGI_FORMAT_R16G16_SNORM                 = 37,
+    DXGI_FORMAT_R16G16_SINT                  = 38,
+    DXGI_FORMAT_R32_TYPELESS                 = 39,
+    DXGI_FORMAT_D32_FLOAT                    = 40,
+    DXGI_FORMAT_R32_FLOAT                    = 41,
+    DXGI_FORMAT_R32_UINT                     = 42,
+    DXGI_FORMAT_R32_SINT                     = 43,
+    DXGI_FORMAT_R24G8_TYPELESS               = 44,
+    DXGI_FORMAT_D24_UNORM_S8_UINT            = 45,
+    DXGI_FORMAT_R24_UNORM_X8_TYPELESS        = 46,
+    DXGI_FORMAT_X24_TYPELESS_G8_UINT         = 47,
+    DXGI_FORMAT_R8G8_TYPELESS                = 48,
+    DXGI_FORMAT_R8G8_UNORM                   = 49,
+    DXGI_FORMAT_R8G8_UINT                    = 50,
+    DXGI_FORMAT_R8G8_SNORM                   = 51,
+    DXGI_FORMAT_R8G8_SINT                    = 52,
+    DXGI_FORMAT_R16_TYPELESS                 = 53,
+    DXGI_FORMAT_R16_FLOAT                    = 54,
+    DXGI_FORMAT_D16_UNORM                    = 55,
+    DXGI_FORMAT_R16_UNORM                    = 56,
+    DXGI_FORMAT_R16_UINT                     = 57,
+    DXGI_FORMAT_R16_SNORM                    = 58,
+    DXGI_FORMAT_R16_SINT                     = 59,
+    DXGI_FORMAT_R8_TYPELESS                  = 60,
+    DXGI_FORMAT_R8_UNORM                     = 61,
+    DXGI_FORMAT_R8_UINT                      = 62,
+    DXGI_FORMAT_R8_SNORM                     = 63,
+    DXGI_FORMAT_R8_SINT                      = 64,
+    DXGI_FORMAT_A8_UNORM                     = 65,
+    DXGI_FORMAT_R1_UNORM                     = 66,
+    DXGI_FORMAT_R9G9B9E5_SHAREDEXP           = 67,
+    DXGI_FORMAT_R8G8_B8G8_UNORM              = 68,
+    DXGI_FORMAT_G8R8_G8B8_UNORM              = 69,
+    DXGI_FORMAT_BC1_TYPELESS                 = 70,
+    DXGI_FORMAT_BC1_UNORM                    = 71,
+    DXGI_FORMAT_BC1_UNORM_SRGB               = 72,
+    DXGI_FORMAT_BC2_TYPELESS                 = 73,
+    DXGI_FORMAT_BC2_UNORM                    = 74,
+    DXGI_FORMAT_BC2_UNORM_SRGB               = 75,
+    DXGI_FORMAT_BC3_TYPELESS                 = 76,
+    DXGI_FORMAT_BC3_UNORM                    = 77,
+    DXGI_FORMAT_BC3_UNORM_SRGB               = 78,
+    DXGI_FORMAT_BC4_TYPELESS                 = 79,
+    DXGI_FORMAT_BC4_UNORM                    = 80,
+    DXGI_FORMAT_BC4_SNORM                    = 81,
+    DXGI_FORMAT_BC5_TYPELESS                 = 82,
+    DXGI_FORMAT_BC5_UNORM                    = 83,
+    DXGI_FORMAT_BC5_SNORM                    = 84,
+    DXGI_FORMAT_B5G6R5_UNORM                 = 85,
+    DXGI_FORMAT_B5G5R5A1_UNORM               = 86,
+    DXGI_FORMAT_B8G8R8A8_UNORM               = 87,
+    DXGI_FORMAT_B8G8R8X8_UNORM               = 88,
+    DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM   = 89,
+    DXGI_FORMAT_B8G8R8A8_TYPELESS            = 90,
+    DXGI_FORMAT_B8G8R8A8_UNORM_SRGB          = 91,
+    DXGI_FORMAT_B8G8R8X8_TYPELESS            = 92,
+    DXGI_FORMAT_B8G8R8X8_UNORM_SRGB          = 93,
+    DXGI_FORMAT_BC6H_TYPELESS                = 94,
+    DXGI_FORMAT_BC6H_UF16                    = 95,
+    DXGI_FORMAT_BC6H_SF16                    = 96,
+    DXGI_FORMAT_BC7_TYPELESS                 = 97,
+    DXGI_FORMAT_BC7_UNORM                    = 98,
+    DXGI_FORMAT_BC7_UNORM_SRGB               = 99,
+    DXGI_FORMAT_AYUV                         = 100,
+    DXGI_FORMAT_Y410                         = 101,
+    DXGI_FORMAT_Y416                         = 102,
+    DXGI_FORMAT_NV12                         = 103,
+    DXGI_FORMAT_P010                         = 104,
+    DXGI_FORMAT_P016                         = 105,
+    DXGI_FORMAT_420_OPAQUE                   = 106,
+    DXGI_FORMAT_YUY2                         = 107,
+    DXGI_FORMAT_Y210                         = 108,
+    DXGI_FORMAT_Y216                         = 109,
+    DXGI_FORMAT_NV11                         = 110,
+    DXGI_FORMAT_AI44                         = 111,
+    DXGI_FORMAT_IA44                         = 112,
+    DXGI_FORMAT_P8                           = 113,
+    DXGI_FORMAT_A8P8                         = 114,
+    DXGI_FORMAT_B4G4R4A4_UNORM               = 115,
+    DXGI_FORMAT_FORCE_UINT                   = 0xffffffff,
+};
+
+enum D3D11_USAGE
+{
+    D3D11_USAGE_DEFAULT     = 0,
+    D3D11_USAGE_IMMUTABLE   = 1,
+    D3D11_USAGE_DYNAMIC     = 2,
+    D3D11_USAGE_STAGING     = 3,
+};
+
+enum D3D11_BIND_FLAG
+{
+    D3D11_BIND_SHADER_RESOURCE  = 0x8,
+    D3D11_BIND_RENDER_TARGET    = 0x20,
+};
+
+enum D3D11_RESOURCE_MISC_FLAG
+{
+    D3D11_RESOURCE_MISC_GENERATE_MIPS   = 0x1,
+    D3D11_RESOURCE_MISC_TEXTURECUBE     = 0x4,
+    D3D11_RESOURCE_MISC_RESOURCE_CLAMP  = 0x20,
+};
+
+enum D3D11_FORMAT_SUPPORT
+{
+    D3D11_FORMAT_SUPPORT_MIP_AUTOGEN    = 0x20000,
+};
+
+enum D3D11_RESOURCE_DIMENSION
+{
+    D3D11_RESOURCE_DIMENSION_UNKNOWN    = 0,
+    D3D11_RESOURCE_DIMENSION_BUFFER     = 1,
+    D3D11_RESOURCE_DIMENSION_TEXTURE1D  = 2,
+    D3D11_RESOURCE_DIMENSION_TEXTURE2D  = 3,
+    D3D11_RESOURCE_DIMENSION_TEXTURE3D  = 4,
+};
+
+enum D3D_FEATURE_LEVEL
+{
+    D3D_FEATURE_LEVEL_9_1   = 0x9100,
+    D3D_FEATURE_LEVEL_9_2   = 0x9200,
+    D3D_FEATURE_LEVEL_9_3   = 0x9300,
+    D3D_FEATURE_LEVEL_10_0  = 0xa000,
+    D3D_FEATURE_LEVEL_10_1  = 0xa100,
+    D3D_FEATURE_LEVEL_11_0  = 0xb000,
+};
+
+enum D3D_SRV_DIMENSION
+{
+    D3D_SRV_DIMENSION_UNKNOWN           = 0,
+    D3D_SRV_DIMENSION_BUFFER            = 1,
+    D3D_SRV_DIMENSION_TEXTURE1D         = 2,
+    D3D_SRV_DIMENSION_TEXTURE1DARRAY    = 3,
+    D3D_SRV_DIMENSION_TEXTURE2D         = 4,
+    D3D_SRV_DIMENSION_TEXTURE2DARRAY    = 5,
+    D3D_SRV_DIMENSION_TEXTURE2DMS       = 6,
+    D3D_SRV_DIMENSION_TEXTURE2DMSARRAY  = 7,
+    D3D_SRV_DIMENSION_TEXTURE3D         = 8,
+    D3D_SRV_DIMENSION_TEXTURECUBE       = 9,
+    D3D_SRV_DIMENSION_TEXTURECUBEARRAY  = 10,
+};
+typedef D3D_SRV_DIMENSION D3D11_SRV_DIMENSION;
+
+#define D3D11_SRV_DIMENSION_TEXTURE1D           D3D_SRV_DIMENSION_TEXTURE1D
+#define D3D11_SRV_DIMENSION_TEXTURE1DARRAY      D3D_SRV_DIMENSION_TEXTURE1DARRAY
+#define D3D11_SRV_DIMENSION_TEXTURE2D           D3D_SRV_DIMENSION_TEXTURE2D
+#define D3D11_SRV_DIMENSION_TEXTURE2DARRAY      D3D_SRV_DIMENSION_TEXTURE2DARRAY
+#define D3D11_SRV_DIMENSION_TEXTURE3D           D3D_SRV_DIMENSION_TEXTURE3D
+#define D3D11_SRV_DIMENSION_TEXTURECUBE         D3D_SRV_DIMENSION_TEXTURECUBE
+#define D3D11_SRV_DIMENSION_TEXTURECUBEARRAY    D3D_SRV_DIMENSION_TEXTURECUBEARRAY
+
+#define D3D11_REQ_MIP_LEVELS                        15
+#define D3D11_REQ_TEXTURE1D_ARRAY_AXIS_DIMENSION    2048
+#define D3D11_REQ_TEXTURE1D_U_DIMENSION             16384
+#define D3D11_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION    2048
+#define D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION        16384
+#define D3D11_REQ_TEXTURECUBE_DIMENSION             16384
+#define D3D11_REQ_TEXTURE3D_U_V_OR_W_DIMENSION      2048
+
+struct GUID { uint32_t data [4]; };
+static const GUID WKPDID_D3DDebugObjectName = {};
+
+struct D3D11_SUBRESOURCE_DATA
+{
+    const void *    pSysMem;
+    UINT            SysMemPitch;
+    UINT            SysMemSlicePitch;
+};
+
+struct DXGI_SAMPLE_DESC
+{
+    UINT    Count;
+    UINT    Quality;
+};
+
+struct D3D11_TEXTURE1D_DESC
+{
+    UINT            Width;
+    UINT            MipLevels;
+    UINT            ArraySize;
+    DXGI_FORMAT     Format;
+    D3D11_USAGE     Usage;
+    UINT            BindFlags;
+    UINT            CPUAccessFlags;
+    UINT            MiscFlags;
+};
+
+struct D3D11_TEXTURE2D_DESC
+{
+    UINT                Width;
+    UINT                Height;
+    UINT                MipLevels;
+    UINT                ArraySize;
+    DXGI_FORMAT         Format;
+    DXGI_SAMPLE_DESC    SampleDesc;
+    D3D11_USAGE         Usage;
+    UINT                BindFlags;
+    UINT                CPUAccessFlags;
+    UINT                MiscFlags;
+};
+
+struct D3D11_TEXTURE3D_DESC
+{
+    UINT            Width;
+    UINT            Height;
+    UINT            Depth;
+    UINT            MipLevels;
+    DXGI_FORMAT     Format;
+    D3D11_USAGE     Usage;
+    UINT            BindFlags;
+    UINT            CPUAccessFlags;
+    UINT            MiscFlags;
+};
+
+struct D3D11_TEX_SRV        { UINT MostDetailedMip, MipLevels; };
+struct D3D11_TEX_ARRAY_SRV  { UINT MostDetailedMip, MipLevels, FirstArraySlice, ArraySize; };
+struct D3D11_TEXCUBE_ARRAY_SRV { UINT MostDetailedMip, MipLevels, First2DArrayFace, NumCubes; };
+
+struct D3D11_SHADER_RESOURCE_VIEW_DESC
+{
+    DXGI_FORMAT             Format;
+    D3D11_SRV_DIMENSION     ViewDimension;
+    union
+    {
+        D3D11_TEX_SRV           Texture1D;
+        D3D11_TEX_ARRAY_SRV     Texture1DArray;
+        D3D11_TEX_SRV           Texture2D;
+        D3D11_TEX_ARRAY_SRV     Texture2DArray;
+        D3D11_TEX_SRV           Texture3D;
+        D3D11_TEX_SRV           TextureCube;
+        D3D11_TEXCUBE_ARRAY_SRV TextureCubeArray;
+    };
+};
+
+struct D3D11_BOX
+{
+    UINT    left, top, front, right, bottom, back;
+};
+
+inline UINT
+D3D11CalcSubresource (UINT mip, UINT slice, UINT mip_levels) {
+    return mip + slice * mip_levels;
+}
+
+// -- Stand-in objects
+
+struct IUnknown
+{
+    std::atomic<int> refs { 1 };
+
+    virtual ~IUnknown () {}
+    UINT AddRef () { return (UINT)++refs; }
+    UINT Release () {
+        int left = --refs;
+        if (0 == left)
+            delete this;
+        return (UINT)left;
+    }
+};
+
+struct ID3D11DeviceChild : IUnknown
+{
+    HRESULT SetPrivateData (GUID const &, UINT, void const *) { return S_OK; }
+};
+
+// Every resource keeps a copy of each subresource it was given, unless the
+// device was told not to copy; the sizes and pitches are kept either way.
+// 'depth' is the 3D depth of the top level (1 otherwise), 'min_lod' what
+// SetResourceMinLOD last set.
+struct ID3D11Resource : ID3D11DeviceChild
+{
+    D3D11_RESOURCE_DIMENSION                dimension = D3D11_RESOURCE_DIMENSION_UNKNOWN;
+    DXGI_FORMAT                             format = DXGI_FORMAT_UNKNOWN;
+    UINT                                    width = 0;
+    UINT                                    height = 0;
+    UINT                                    depth = 0;
+    UINT                                    mip_levels = 0;
+    UINT                                    array_size = 0;
+    std::vector<std::vector<uint8_t>>       subresources;
+    std::vector<size_t>                     sizes;
+    std::vector<UINT>                       row_pitches;
+    float                                   min_lod = 0.0f;
+
+    void GetType (D3D11_RESOURCE_DIMENSION * out) { *out = dimension; }
+
+    // 'bytes' covers every depth slice of a mip level, back to back.
+    void store (UINT index, void const * data, UINT row_pitch, size_t bytes, bool copy) {
+        if (copy)
+            subresources[index].assign((uint8_t const *)data, (uint8_t const *)data + bytes);
+        sizes[index] = bytes;
+        row_pitches[index] = row_pitch;
+    }
+    UINT level_depth (UINT mip) const {
+        UINT d = depth >> mip;
+        return d ? d : 1;
+    }
+    size_t init (UINT mips, UINT slices, D3D11_SUBRESOURCE_DATA const * data, bool copy) {
+        mip_levels = mips;
+        array_size = slices;
+        subresources.assign((size_t)mips * slices, std::vector<uint8_t>());
+        sizes.assign((size_t)mips * slices, 0);
+        row_pitches.assign((size_t)mips * slices, 0);
+        if (nullptr == data)
+            return 0;
+        size_t total = 0;
+        for (UINT i = 0; i < mips * slices; ++i) {
+            size_t bytes = D3D11_RESOURCE_DIMENSION_TEXTURE1D == dimension
+                ? data[i].SysMemPitch
+                : (size_t)data[i].SysMemSlicePitch * level_depth(i % mips);
+            store(i, data[i].pSysMem, data[i].SysMemPitch, bytes, copy);
+            total += bytes;
+        }
+        return total;
+    }
+};
+
+struct ID3D11Texture1D : ID3D11Resource
+{
+    D3D11_TEXTURE1D_DESC desc;
+    void GetDesc (D3D11_TEXTURE1D_DESC * out) { *out = desc; }
+};
+struct ID3D11Texture2D : ID3D11Resource
+{
+    D3D11_TEXTURE2D_DESC desc;
+    void GetDesc (D3D11_TEXTURE2D_DESC * out) { *out = desc; }
+};
+struct ID3D11Texture3D : ID3D11Resource
+{
+    D3D11_TEXTURE3D_DESC desc;
+    void GetDesc (D3D11_TEXTURE3D_DESC * out) { *out = desc; }
+};
+
+struct ID3D11ShaderResourceView : ID3D11DeviceChild
+{
+    D3D11_SHADER_RESOURCE_VIEW_DESC     desc;
+    ID3D11Resource *                    resource = nullptr;
+
+    ~ID3D11ShaderResourceView () {
+        if (resource)
+            resource->Release();
+    }
+    void GetDesc (D3D11_SHADER_RESOURCE_VIEW_DESC * out) { *out = desc; }
+    void GetResource (ID3D11Resource ** out) {
+        resource->AddRef();
+        *out = resource;
+    }
+};
+
+// A full chain when 'mips' is 0, as Direct3D reads MipLevels.
+inline UINT
+stand_in_mip_levels (UINT mips, UINT width, UINT height, UINT depth) {
+    if (mips)
+        return mips;
+    UINT size = width > height ? width : height;
+    size = size > depth ? size : depth;
+    UINT levels = 1;
+    while (size > 1) {
+        size >>= 1;
+        ++levels;
+    }
+    return levels;
+}
+
+// Not reference counted: it lives on the bench's stack. Creation is safe
+// from any thread, as on a free-threaded Direct3D 11 device. With
+// 'copy_data' off, creation reads none of the initial data, which leaves
+// only the loader's own work to time. 'on_created' runs on the creating
+// thread after each texture, so a bench can hold a load in flight.
+struct ID3D11Device
+{
+    D3D_FEATURE_LEVEL       feature_level = D3D_FEATURE_LEVEL_11_0;
+    bool                    copy_data = true;
+    std::atomic<uint64_t>   textures_created { 0 };
+    std::atomic<uint64_t>   bytes_uploaded { 0 };
+    std::function<void ()>  on_created;
+
+    UINT AddRef () { return 1; }
+    UINT Release () { return 1; }
+
+    HRESULT CreateTexture1D (D3D11_TEXTURE1D_DESC const * desc, D3D11_SUBRESOURCE_DATA const * data, ID3D11Texture1D ** out) {
+        ID3D11Texture1D * tex = new ID3D11Texture1D();
+        tex->desc = *desc;
+        tex->dimension = D3D11_RESOURCE_DIMENSION_TEXTURE1D;
+        tex->format = desc->Format;
+        tex->width = desc->Width;
+        tex->height = tex->depth = 1;
+        created(tex->init(stand_in_mip_levels(desc->MipLevels, desc->Width, 1, 1), desc->ArraySize, data, copy_data));
+        *out = tex;
+        return S_OK;
+    }
+    HRESULT CreateTexture2D (D3D11_TEXTURE2D_DESC const * desc, D3D11_SUBRESOURCE_DATA const * data, ID3D11Texture2D ** out) {
+        ID3D11Texture2D * tex = new ID3D11Texture2D();
+        tex->desc = *desc;
+        tex->dimension = D3D11_RESOURCE_DIMENSION_TEXTURE2D;
+        tex->format = desc->Format;
+        tex->width = desc->Width;
+        tex->height = desc->Height;
+        tex->depth = 1;
+        created(tex->init(stand_in_mip_levels(desc->MipLevels, desc->Width, desc->Height, 1), desc->ArraySize, data, copy_data));
+        *out = tex;
+        return S_OK;
+    }
+    HRESULT CreateTexture3D (D3D11_TEXTURE3D_DESC const * desc, D3D11_SUBRESOURCE_DATA const * data, ID3D11Texture3D ** out) {
+        ID3D11Texture3D * tex = new ID3D11Texture3D();
+        tex->desc = *desc;
+        tex->dimension = D3D11_RESOURCE_DIMENSION_TEXTURE3D;
+        tex->format = desc->Format;
+        tex->width = desc->Width;
+        tex->height = desc->Height;
+        tex->depth = desc->Depth;
+        created(tex->init(stand_in_mip_levels(desc->MipLevels, desc->Width, desc->Height, desc->Depth), 1, data, copy_data));
+        *out = tex;
+        return S_OK;
+    }
+    HRESULT CreateShaderResourceView (ID3D11Resource * resource, D3D11_SHADER_RESOURCE_VIEW_DESC const * desc, ID3D11ShaderResourceView ** out) {
+        ID3D11ShaderResourceView * view = new ID3D11ShaderResourceView();
+        view->desc = *desc;
+        resource->AddRef();
+        view->resource = resource;
+        *out = view;
+        return S_OK;
+    }
+    // No format supports auto-gen mips, so the loader never asks for them.
+    HRESULT CheckFormatSupport (DXGI_FORMAT, UINT * support) {
+        *support = 0;
+        return S_OK;
+    }
+    D3D_FEATURE_LEVEL GetFeatureLevel () { return feature_level; }
+
+    void created (size_t bytes) {
+        ++textures_created;
+        bytes_uploaded += bytes;
+        if (on_created)
+            on_created();
+    }
+};
+
+// Single-threaded, like an immediate context.
+struct ID3D11DeviceContext
+{
+    uint64_t    updates = 0;
+    uint64_t    bytes_updated = 0;
+
+    void UpdateSubresource (ID3D11Resource * resource, UINT index, D3D11_BOX const *, void const * data, UINT row_pitch, UINT depth_pitch) {
+        size_t bytes = D3D11_RESOURCE_DIMENSION_TEXTURE1D == resource->dimension
+            ? row_pitch
+            : (size_t)depth_pitch * resource->level_depth(index % resource->mip_levels);
+        resource->store(index, data, row_pitch, bytes, true);
+        ++updates;
+        bytes_updated += bytes;
+    }
+    void GenerateMips (ID3D11ShaderResourceView *) {}
+    void SetResourceMinLOD (ID3D11Resource * resource, float min_lod) { resource->min_lod = min_lod; }
+};
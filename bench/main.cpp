@@ -0,0 +1,79 @@
+// Runs the benches named on the command line, or all of them:
+//   bench [--quick] [name...]
+
+#include "bench.h"
+
+#include <string.h>
+
+struct BenchEntry {
+    char const *    name;
+    void            (*run) (BenchContext * ctx);
+};
+
+static BenchEntry const g_benches [] = {
+    {"range_alloc",     bench_range_alloc},
+    {"tangents",        bench_tangents},
+    {"terrain",         bench_terrain},
+    {"terrain_lod",     bench_terrain_lod},
+    {"mesh_codec",      bench_mesh_codec},
+    {"tiles",           bench_tiles},
+    {"shadow_volumes",  bench_shadow_volumes},
+    {"bc_decode",       bench_bc_decode},
+    {"bc_encode",       bench_bc_encode},
+#ifndef _WIN32
+    {"dds_load",        bench_dds_load},
+    {"dds_legacy",      bench_dds_legacy},
+    {"dds_mips",        bench_dds_mips},
+    {"dds_stream",      bench_dds_stream},
+    {"dds_batch",       bench_dds_batch},
+    {"dds_cache",       bench_dds_cache},
+    {"dds_size_policy", bench_dds_size_policy},
+#endif
+    {"bounds",          bench_bounds},
+    {"mesh_table",      bench_mesh_table},
+    {"obj",             bench_obj},
+    {"gltf",            bench_gltf},
+    {"isosurface",      bench_isosurface},
+    {"adjacency",       bench_adjacency},
+    {"degenerate",      bench_degenerate},
+};
+
+int
+main (int argc, char ** argv) {
+    BenchContext ctx = {};
+    int first_name = 1;
+    if (argc > 1 && 0 == strcmp(argv[1], "--quick")) {
+        ctx.quick = true;
+        first_name = 2;
+    }
+
+    int bench_count = (int)(sizeof(g_benches) / sizeof(g_benches[0]));
+    for (int i = first_name; i < argc; ++i) {
+        bool known = false;
+        for (int b = 0; b < bench_count; ++b)
+            known = known || 0 == strcmp(argv[i], g_benches[b].name);
+        if (!known) {
+            fprintf(stderr, "unknown bench '%s'; available:", argv[i]);
+            for (int b = 0; b < bench_count; ++b)
+                fprintf(stderr, " %s", g_benches[b].name);
+            fprintf(stderr, "\n");
+            return 2;
+        }
+    }
+
+    for (int b = 0; b < bench_count; ++b) {
+        bool selected = first_name == argc;
+        for (int i = first_name; i < argc; ++i)
+            selected = selected || 0 == strcmp(argv[i], g_benches[b].name);
+        if (!selected)
+            continue;
+        printf("-- %s\n", g_benches[b].name);
+        g_benches[b].run(&ctx);
+    }
+
+    if (ctx.failures) {
+        printf("%d check(s) failed\n", ctx.failures);
+        return 1;
+    }
+    return 0;
+}
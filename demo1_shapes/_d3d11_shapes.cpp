@@ -23,6 +23,16 @@
 using namespace DirectX;
 
 #include "geometry.h"
+#include "mesh_table.h"
+#include "geometry_pool.h"
+#include "mesh_cache.h"
+#include "obj_loader.h"
+#include "gltf_loader.h"
+#include "terrain_lod.h"
+#include "tile_streamer.h"
+#include "isosurface.h"
+#include "shadow_volume.h"
+#include "degenerate.h"
 
 #include <stdio.h>
 #include <tchar.h>
@@ -49,35 +59,61 @@ struct D3D11RenderContext {
 
     ID3D11InputLayout* input_layout;
     ID3D11RasterizerState* wireframe_rs;
-
-    // Define transformations from local spaces to world space.
-    XMFLOAT4X4 sphere_world[10];
-    XMFLOAT4X4 cylinder_world[10];
-    XMFLOAT4X4 box_world;
-    XMFLOAT4X4 grid_world;
-    XMFLOAT4X4 center_sphere;
+    ID3D11RasterizerState* wireframe_mirrored_rs;   // for worlds with a negative determinant
 
     XMFLOAT4X4 view;
     XMFLOAT4X4 proj;
 
-    ID3D11Buffer * vb;
-    ID3D11Buffer * ib;
-
-    // vertex buffer and index buffer data
-    int     box_vertex_offset;
-    int     grid_vertex_offset;
-    int     sphere_vertex_offset;
-    int     cylinder_vertex_offset;
-
-    UINT    box_index_offset;
-    UINT    grid_index_offset;
-    UINT    sphere_index_offset;
-    UINT    cylinder_index_offset;
-
-    UINT    box_index_count;
-    UINT    grid_index_count;
-    UINT    sphere_index_count;
-    UINT    cylinder_index_count;
+    // shared vertex/index buffers, the meshes living in them, and the
+    // instances drawn from those meshes
+    GeometryPool    geometry;
+    MeshTable   meshes;
+    RenderItems items;
+
+    // OBJ file from the command line, reloaded into the pool with 'R'
+    char        obj_path [MAX_PATH];
+    MeshHandle  obj_mesh;
+
+    // quadtree terrain, drawn from the slots of the terrain patch mesh
+    TerrainLod      terrain;
+    MeshHandle      terrain_patch;
+    XMFLOAT3        terrain_offset;
+    TerrainLodStats terrain_stats;
+    double          terrain_update_ms;
+
+    // streamed terrain tiles, all drawing the indices of the tile mesh
+    TileStreamer *  tiles;
+    MeshHandle      tile_mesh;
+    uint32_t        tile_frame;
+    LONGLONG        tile_last_tick;
+    double          tile_stream_ms;     // main thread streaming work, last frame
+    double          tile_stream_max_ms;
+    int             tile_spikes;        // frames over _TILE_SPIKE_MS
+
+    // persistent threads for the kernels that run every frame
+    WorkerPool *    workers;
+
+    // shadow volumes of every caster item for the orbiting lights, rebuilt
+    // on the CPU each frame into dynamic buffers
+    ShadowCaster *  shadow_casters;     // per mesh row, empty if it casts nothing
+    int             shadow_caster_count;
+    ID3D11Buffer *  shadow_vb;
+    ID3D11Buffer *  shadow_ib;
+    int             shadow_vb_capacity;
+    int             shadow_ib_capacity;
+    ShadowJob *     shadow_jobs;
+    ShadowDraw *    shadow_draws;
+    int *           shadow_items;       // render item of every job
+    int *           shadow_scratch;
+    int             shadow_job_capacity;
+    int             shadow_job_count;
+    int             shadow_triangles;
+    double          shadow_ms;
+    bool            shadows_visible;
+
+    // degenerate triangles stripped from the meshes generated this launch;
+    // meshes loaded from a cache add nothing
+    DegenerateStats degenerate;
 
     // camera, window, etc
     HWND    wnd;
@@ -85,6 +121,8 @@ struct D3D11RenderContext {
     float   theta;
     float   phi;
     float   radius;
+    XMFLOAT3    eye;
+    XMFLOAT3    target;     // orbited point, moved by the tile fly-through
 
     int     width;
     int     height;
@@ -180,12 +218,13 @@ update_scene (D3D11RenderContext * render_ctx) {
     float y = render_ctx->radius * cosf(render_ctx->phi);
 
     // Build the view matrix.
-    XMVECTOR pos    = XMVectorSet(x, y, z, 1.0f);
-    XMVECTOR target = XMVectorZero();
+    XMVECTOR target = XMLoadFloat3(&render_ctx->target);
+    XMVECTOR pos    = XMVectorAdd(target, XMVectorSet(x, y, z, 0.0f));
     XMVECTOR up     = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
 
     XMMATRIX V = XMMatrixLookAtLH(pos, target, up);
     XMStoreFloat4x4(&render_ctx->view, V);
+    XMStoreFloat3(&render_ctx->eye, pos);
 }
 static void
 draw_scene (D3D11RenderContext * render_ctx) {
@@ -197,11 +236,12 @@ draw_scene (D3D11RenderContext * render_ctx) {
     render_ctx->d3d_immediate_context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
     render_ctx->d3d_immediate_context->RSSetState(render_ctx->wireframe_rs);
+    bool mirrored = false;
 
     UINT stride = sizeof(DemoVertex);
     UINT offset = 0;
-    render_ctx->d3d_immediate_context->IASetVertexBuffers(0, 1, &render_ctx->vb, &stride, &offset);
-    render_ctx->d3d_immediate_context->IASetIndexBuffer(render_ctx->ib, DXGI_FORMAT_R32_UINT, 0);
+    render_ctx->d3d_immediate_context->IASetVertexBuffers(0, 1, &render_ctx->geometry.vb, &stride, &offset);
+    render_ctx->d3d_immediate_context->IASetIndexBuffer(render_ctx->geometry.ib, DXGI_FORMAT_R32_UINT, 0);
 
     // Set constants
 
@@ -209,46 +249,95 @@ draw_scene (D3D11RenderContext * render_ctx) {
     XMMATRIX proj  = XMLoadFloat4x4(&render_ctx->proj);
     XMMATRIX view_proj = view * proj;
 
+    MeshTable const * meshes = &render_ctx->meshes;
+    RenderItems const * items = &render_ctx->items;
+
     D3DX11_TECHNIQUE_DESC techDesc;
     render_ctx->tech->GetDesc(&techDesc);
     for (UINT p = 0; p < techDesc.Passes; ++p) {
-        // Draw the grid.
-        XMMATRIX world = XMLoadFloat4x4(&render_ctx->grid_world);
-        XMMATRIX wvp = world * view_proj;
-        render_ctx->fx_wvp->SetMatrix(reinterpret_cast<float*>(&wvp));
-        render_ctx->tech->GetPassByIndex(p)->Apply(0, render_ctx->d3d_immediate_context);
-        render_ctx->d3d_immediate_context->DrawIndexed(render_ctx->grid_index_count, render_ctx->grid_index_offset, render_ctx->grid_vertex_offset);
-
-        // Draw the box.
-        world = XMLoadFloat4x4(&render_ctx->box_world);
-        wvp = world * view_proj;
-        render_ctx->fx_wvp->SetMatrix(reinterpret_cast<float*>(&wvp));
-        render_ctx->tech->GetPassByIndex(p)->Apply(0, render_ctx->d3d_immediate_context);
-        render_ctx->d3d_immediate_context->DrawIndexed(render_ctx->box_index_count, render_ctx->box_index_offset, render_ctx->box_vertex_offset);
-
-        // Draw center sphere.
-        world = XMLoadFloat4x4(&render_ctx->center_sphere);
-        wvp = world * view_proj;
-        render_ctx->fx_wvp->SetMatrix(reinterpret_cast<float*>(&wvp));
-        render_ctx->tech->GetPassByIndex(p)->Apply(0, render_ctx->d3d_immediate_context);
-        render_ctx->d3d_immediate_context->DrawIndexed(render_ctx->sphere_index_count, render_ctx->sphere_index_offset, render_ctx->sphere_vertex_offset);
-
-        // Draw the cylinders.
-        for (int i = 0; i < 10; ++i) {
-            world = XMLoadFloat4x4(&render_ctx->cylinder_world[i]);
-            wvp = world * view_proj;
+        // Items are sorted by mesh, so this walks the mesh table in order.
+        for (int i = 0; i < items->count; ++i) {
+            MeshHandle mesh = items->mesh[i];
+            XMMATRIX world = XMLoadFloat4x4(&items->world[i]);
+            XMMATRIX wvp = world * view_proj;
+
+            // Mirroring transforms flip the winding seen by the rasterizer.
+            bool item_mirrored = XMVectorGetX(XMMatrixDeterminant(world)) < 0.0f;
+            if (item_mirrored != mirrored) {
+                mirrored = item_mirrored;
+                render_ctx->d3d_immediate_context->RSSetState(mirrored ? render_ctx->wireframe_mirrored_rs : render_ctx->wireframe_rs);
+            }
             render_ctx->fx_wvp->SetMatrix(reinterpret_cast<float*>(&wvp));
             render_ctx->tech->GetPassByIndex(p)->Apply(0, render_ctx->d3d_immediate_context);
-            render_ctx->d3d_immediate_context->DrawIndexed(render_ctx->cylinder_index_count, render_ctx->cylinder_index_offset, render_ctx->cylinder_vertex_offset);
+            render_ctx->d3d_immediate_context->DrawIndexed(meshes->index_count[mesh], meshes->first_index[mesh], meshes->base_vertex[mesh]);
         }
 
-        // Draw the spheres.
-        for (int i = 0; i < 10; ++i) {
-            world = XMLoadFloat4x4(&render_ctx->sphere_world[i]);
-            wvp = world * view_proj;
+        // -- Terrain nodes: the shared patch indices over each node's slot of
+        // vertices, runs of adjacent quadrants in one draw.
+        if (INVALID_MESH_HANDLE != render_ctx->terrain_patch) {
+            TerrainLod const * terrain = &render_ctx->terrain;
+            MeshHandle patch = render_ctx->terrain_patch;
+            UINT quadrant_indices = meshes->index_count[patch] / 4;
+            XMMATRIX world = XMMatrixTranslation(render_ctx->terrain_offset.x, render_ctx->terrain_offset.y, render_ctx->terrain_offset.z);
+            XMMATRIX wvp = world * view_proj;
+            if (mirrored) {
+                mirrored = false;
+                render_ctx->d3d_immediate_context->RSSetState(render_ctx->wireframe_rs);
+            }
             render_ctx->fx_wvp->SetMatrix(reinterpret_cast<float*>(&wvp));
             render_ctx->tech->GetPassByIndex(p)->Apply(0, render_ctx->d3d_immediate_context);
-            render_ctx->d3d_immediate_context->DrawIndexed(render_ctx->sphere_index_count, render_ctx->sphere_index_offset, render_ctx->sphere_vertex_offset);
+            for (int d = 0; d < terrain->draw_count; ++d) {
+                int base_vertex = meshes->base_vertex[patch] + terrain->draws[d].slot * terrain->patch_vertex_count;
+                int q = terrain->draws[d].quadrants;
+                for (int k = 0; k < 4; ++k) {
+                    if (!(q & (1 << k)))
+                        continue;
+                    int run = k;
+                    while (run + 1 < 4 && (q & (1 << (run + 1))))
+                        ++run;
+                    render_ctx->d3d_immediate_context->DrawIndexed(
+                        (run - k + 1) * quadrant_indices, meshes->first_index[patch] + k * quadrant_indices, base_vertex
+                    );
+                    k = run;
+                }
+            }
+        }
+        // -- Streamed tiles, their vertices already in world space.
+        if (render_ctx->tiles) {
+            TileStreamer const * tiles = render_ctx->tiles;
+            MeshHandle tile_mesh = render_ctx->tile_mesh;
+            if (mirrored) {
+                mirrored = false;
+                render_ctx->d3d_immediate_context->RSSetState(render_ctx->wireframe_rs);
+            }
+            render_ctx->fx_wvp->SetMatrix(reinterpret_cast<float*>(&view_proj));
+            render_ctx->tech->GetPassByIndex(p)->Apply(0, render_ctx->d3d_immediate_context);
+            for (int r = 0; r < tiles->resident_count; ++r) {
+                int tile = tiles->resident[r];
+                render_ctx->d3d_immediate_context->DrawIndexed(meshes->index_count[tile_mesh], meshes->first_index[tile_mesh], tiles->base_vertex[tile]);
+            }
+        }
+        // -- Shadow volumes, in their casters' object space.
+        if (render_ctx->shadow_job_count > 0) {
+            render_ctx->d3d_immediate_context->IASetVertexBuffers(0, 1, &render_ctx->shadow_vb, &stride, &offset);
+            render_ctx->d3d_immediate_context->IASetIndexBuffer(render_ctx->shadow_ib, DXGI_FORMAT_R32_UINT, 0);
+            for (int j = 0; j < render_ctx->shadow_job_count; ++j) {
+                ShadowDraw const & draw = render_ctx->shadow_draws[j];
+                if (0 == draw.index_count)
+                    continue;
+                XMMATRIX world = XMLoadFloat4x4(&items->world[render_ctx->shadow_items[j]]);
+                XMMATRIX wvp = world * view_proj;
+                bool item_mirrored = XMVectorGetX(XMMatrixDeterminant(world)) < 0.0f;
+                if (item_mirrored != mirrored) {
+                    mirrored = item_mirrored;
+                    render_ctx->d3d_immediate_context->RSSetState(mirrored ? render_ctx->wireframe_mirrored_rs : render_ctx->wireframe_rs);
+                }
+                render_ctx->fx_wvp->SetMatrix(reinterpret_cast<float*>(&wvp));
+                render_ctx->tech->GetPassByIndex(p)->Apply(0, render_ctx->d3d_immediate_context);
+                render_ctx->d3d_immediate_context->DrawIndexed(draw.index_count, draw.first_index, draw.base_vertex);
+            }
+            render_ctx->d3d_immediate_context->IASetVertexBuffers(0, 1, &render_ctx->geometry.vb, &stride, &offset);
+            render_ctx->d3d_immediate_context->IASetIndexBuffer(render_ctx->geometry.ib, DXGI_FORMAT_R32_UINT, 0);
         }
     }
     render_ctx->swapchain->Present(0, 0);
@@ -306,8 +395,169 @@ handle_mouse_move (D3D11RenderContext * render_ctx, WPARAM btn_state, int x, int
 
 #define _TOTAL_VTX_CNT  (_BOX_VTX_CNT + _GRID_VTX_CNT + _SPHERE_VTX_CNT + _CYLINDER_VTX_CNT)
 #define _TOTAL_IDX_CNT  (_BOX_IDX_CNT + _GRID_IDX_CNT + _SPHERE_IDX_CNT + _CYLINDER_IDX_CNT)
+
+// streamed terrain: a file of 64 x 64 tiles of 64 x 64 quads, 2 units
+// apart, loaded within _TILE_VIEW_RADIUS of the orbit target and paged in
+// out to _TILE_PREFETCH_RADIUS
+#define _TILE_SIZE              64
+#define _TILE_COUNT             64
+#define _TILE_SPACING           2.0f
+#define _TILE_VIEW_RADIUS       600.0f
+#define _TILE_PREFETCH_RADIUS   800.0f
+#define _TILE_THREADS           2
+#define _TILE_QUEUE             32
+#define _TILE_BUDGET            (16u << 20)     // bytes of resident tile vertices
+#define _TILE_UPLOAD_MS         2.0             // upload time allowed per frame
+#define _TILE_SPIKE_MS          4.0             // streaming work counted as a spike
+#define _TILE_FLY_SPEED         60.0f           // units per second
+#define _TILE_TAG               0x80000000u     // pool tag of tile vertex blocks
+
+// quadtree terrain: 1024 x 1024 units, 32 x 32 quad patches, 6 levels (a
+// 1025^2 height field), and vertex slots for that many selected nodes
+#define _TERRAIN_WIDTH      1024.0f
+#define _TERRAIN_PATCH      32
+#define _TERRAIN_LEVELS     6
+#define _TERRAIN_LOD0_RANGE 96.0f
+#define _TERRAIN_SLOTS      256
+
+// shadow volumes: directional lights circling the scene, volumes pushed
+// this far (in object units) away from the lights
+#define _SHADOW_LIGHTS          2
+#define _SHADOW_LIGHT_SPEED     0.3f    // radians per second
+#define _SHADOW_EXTRUSION       40.0f
+
+// Meshes that cast shadow volumes. Casting costs an adjacency build at load
+// and silhouette work per light every frame, so it is opt-in per mesh.
+static char const * const _SHADOW_CASTERS [] = {"box", "sphere", "cylinder"};
+
+static bool
+is_shadow_caster (char const * name) {
+    for (int i = 0; i < (int)_countof(_SHADOW_CASTERS); ++i)
+        if (0 == strcmp(name, _SHADOW_CASTERS[i]))
+            return true;
+    return false;
+}
+
+// samples per axis of the isosurface volumes
+#define _ISO_METABALL_RES   64
+#define _ISO_SDF_RES        128
+
+// size of the shared geometry pool
+#define _POOL_VTX_CAPACITY  (1 << 20)
+#define _POOL_IDX_CAPACITY  (1 << 22)
+#define _POOL_MAX_MESHES    4096
+
+// Bump when a generator in geometry.h or the extraction in isosurface.h
+// changes its output for the same parameters, so stale caches are rebuilt.
+#define _GEOMETRY_VERSION   3
+#define _MESH_CACHE_PATH    "./shapes.meshcache"
+#define _ISO_CACHE_PATH     "./isosurfaces.meshcache"
+
+// Logs what stripping took out of mesh 'name' to the debugger and adds it
+// to the totals on the title bar.
+static void
+note_degenerate_stats (D3D11RenderContext * render_ctx, char const * name, DegenerateStats const & stats) {
+    char buf [160];
+    _snprintf_s(
+        buf, _countof(buf), _TRUNCATE, "%s: removed %d of %d triangles (%d collapsed, %d zero area, %d slivers)\n",
+        name, degenerate_removed(&stats), stats.triangles, stats.collapsed, stats.zero_area, stats.slivers
+    );
+    OutputDebugStringA(buf);
+    DegenerateStats & total = render_ctx->degenerate;
+    total.triangles += stats.triangles;
+    total.collapsed += stats.collapsed;
+    total.zero_area += stats.zero_area;
+    total.slivers += stats.slivers;
+}
+// Uploads the meshes described by 'entries' from packed vertex/index blobs
+// into the geometry pool and registers each region in the mesh table. The
+// handles go to 'out_meshes' when given, INVALID_MESH_HANDLE for any that
+// did not fit.
+static void
+upload_meshes (
+    D3D11RenderContext * render_ctx, MeshCacheEntry const entries [], int mesh_count,
+    DemoVertex const vertices [], int const indices [], MeshHandle out_meshes [] = nullptr
+) {
+    for (int m = 0; out_meshes && m < mesh_count; ++m)
+        out_meshes[m] = INVALID_MESH_HANDLE;
+    for (int m = 0; m < mesh_count; ++m) {
+        MeshCacheEntry const & e = entries[m];
+
+        MeshHandle mesh = mesh_table_next_handle(&render_ctx->meshes);
+        GeometryAlloc alloc;
+        if (!geometry_pool_upload(
+            &render_ctx->geometry, render_ctx->d3d_immediate_context,
+            &vertices[e.base_vertex], e.vertex_count, &indices[e.first_index], e.index_count,
+            mesh, &alloc
+        )) {
+            MessageBox(0, _T("Geometry pool is full"), 0, 0);
+            break;
+        }
+        mesh_table_add(&render_ctx->meshes, e.name, alloc.base_vertex, alloc.first_index, e.index_count, e.bounds);
+        render_ctx->meshes.vtx_block[mesh] = alloc.vtx_block;
+        render_ctx->meshes.idx_block[mesh] = alloc.idx_block;
+        if (out_meshes)
+            out_meshes[m] = mesh;
+
+        // Keep a shadow caster of the props that opt in; everything else
+        // (ground, terrain, loaded models) only receives.
+        int caster_count = render_ctx->meshes.count;
+        render_ctx->shadow_casters = (ShadowCaster *)::realloc(render_ctx->shadow_casters, sizeof(ShadowCaster) * caster_count);
+        for (int c = render_ctx->shadow_caster_count; c < caster_count; ++c)
+            memset(&render_ctx->shadow_casters[c], 0, sizeof(ShadowCaster));
+        render_ctx->shadow_caster_count = caster_count;
+        if (is_shadow_caster(e.name)) {
+            shadow_caster_create(
+                &render_ctx->shadow_casters[mesh], &vertices[e.base_vertex].position.x, sizeof(DemoVertex), e.vertex_count,
+                &indices[e.first_index], e.index_count
+            );
+        }
+    }
+}
 static void
 create_geom_buffers (D3D11RenderContext * render_ctx) {
+    // All the geometry lives in one big vertex/index buffer pair.  Each
+    // submesh is uploaded into a region of the pool and that region is
+    // registered in the mesh table.
+    geometry_pool_create(
+        &render_ctx->geometry, render_ctx->device, sizeof(DemoVertex),
+        _POOL_VTX_CAPACITY, _POOL_IDX_CAPACITY, _POOL_MAX_MESHES
+    );
+
+    float const box_params [] = {1.5f, 0.5f, 1.5f};
+    float const grid_params [] = {20.0f, 30.0f};
+    int const   grid_dims [] = {60, 40};
+    float const sphere_params [] = {0.5f};
+    float const cylinder_params [] = {0.5f, 0.3f, 3.0f};
+
+    // -- Try the binary cache first: if it was built from the same inputs its
+    // meshes are decoded from the mapped file and uploaded.
+    uint64_t key = mesh_cache_key_begin();
+    int const geometry_version = _GEOMETRY_VERSION;
+    int const vertex_stride = sizeof(DemoVertex);
+    key = mesh_cache_key_add(key, &geometry_version, sizeof(geometry_version));
+    key = mesh_cache_key_add(key, &vertex_stride, sizeof(vertex_stride));
+    key = mesh_cache_key_add(key, box_params, sizeof(box_params));
+    key = mesh_cache_key_add(key, grid_params, sizeof(grid_params));
+    key = mesh_cache_key_add(key, grid_dims, sizeof(grid_dims));
+    key = mesh_cache_key_add(key, sphere_params, sizeof(sphere_params));
+    key = mesh_cache_key_add(key, cylinder_params, sizeof(cylinder_params));
+
+    MeshCache cache;
+    if (mesh_cache_open(_MESH_CACHE_PATH, key, sizeof(DemoVertex), &cache)) {
+        DemoVertex *    cached_vertices = (DemoVertex *)::malloc(sizeof(DemoVertex) * (cache.header->vertex_count + 1));
+        int *           cached_indices = (int *)::malloc(sizeof(int) * (cache.header->index_count + 1));
+        bool decoded = mesh_cache_decode(&cache, cached_vertices, cached_indices);
+        if (decoded)
+            upload_meshes(render_ctx, cache.entries, cache.header->mesh_count, cached_vertices, cached_indices);
+        free(cached_indices);
+        free(cached_vertices);
+        mesh_cache_close(&cache);
+        if (decoded)
+            return;
+    }
+
+    // -- Cache miss: generate everything, pack it, and write the cache for next time.
     DemoVertex *    vertices = (DemoVertex *)::malloc(sizeof(DemoVertex) * _TOTAL_VTX_CNT);
     int *           indices = (int *)::malloc(sizeof(int) * _TOTAL_IDX_CNT);
     BYTE *          scratch = (BYTE *)::malloc(sizeof(Vertex) * _TOTAL_VTX_CNT + sizeof(int) * _TOTAL_IDX_CNT);
@@ -334,103 +584,722 @@ create_geom_buffers (D3D11RenderContext * render_ctx) {
     Vertex *    cylinder_vertices = reinterpret_cast<Vertex *>(scratch + ssz_id);
     int *       cylinder_indices = reinterpret_cast<int *>(scratch + csz);
 
-    create_box(1.5f, 0.5f, 1.5f, box_vertices, box_indices);
-    create_grid(20.0f, 30.0f, 60, 40, grid_vertices, grid_indices);
-    create_sphere(0.5f, sphere_vertices, sphere_indices);
-    create_cylinder(0.5f, 0.3f, 3.0f, cylinder_vertices, cylinder_indices);
+    struct {
+        char const *    name;
+        Vertex *        vertices;
+        int *           indices;
+        int             vtx_cnt;
+        int             idx_cnt;
+        MeshBounds      bounds;
+    } shapes [] = {
+        {"box",         box_vertices,       box_indices,        _BOX_VTX_CNT,       _BOX_IDX_CNT},
+        {"grid",        grid_vertices,      grid_indices,       _GRID_VTX_CNT,      _GRID_IDX_CNT},
+        {"sphere",      sphere_vertices,    sphere_indices,     _SPHERE_VTX_CNT,    _SPHERE_IDX_CNT},
+        {"cylinder",    cylinder_vertices,  cylinder_indices,   _CYLINDER_VTX_CNT,  _CYLINDER_IDX_CNT},
+    };
 
-    // We are concatenating all the geometry into one big vertex/index buffer.  So
-    // define the regions in the buffer each submesh covers.
+    create_box(box_params[0], box_params[1], box_params[2], box_vertices, box_indices, &shapes[0].bounds);
+    create_grid(grid_params[0], grid_params[1], grid_dims[0], grid_dims[1], grid_vertices, grid_indices, &shapes[1].bounds);
+    create_sphere(sphere_params[0], sphere_vertices, sphere_indices, &shapes[2].bounds);
+    create_cylinder(cylinder_params[0], cylinder_params[1], cylinder_params[2], cylinder_vertices, cylinder_indices, &shapes[3].bounds);
+
+    // -- Drop the degenerate triangles the generators leave at poles and seams.
+    for (int s = 0; s < (int)_countof(shapes); ++s) {
+        DegenerateStats stats;
+        shapes[s].idx_cnt = strip_degenerate_triangles(
+            &shapes[s].vertices[0].position.x, sizeof(Vertex), shapes[s].indices, shapes[s].idx_cnt, DEGENERATE_MIN_RATIO, &stats
+        );
+        note_degenerate_stats(render_ctx, shapes[s].name, stats);
+    }
 
-    // Cache the vertex offsets to each object in the concatenated vertex buffer.
-    render_ctx->box_vertex_offset = 0;
-    render_ctx->grid_vertex_offset = _BOX_VTX_CNT;
-    render_ctx->sphere_vertex_offset = render_ctx->grid_vertex_offset + _GRID_VTX_CNT;
-    render_ctx->cylinder_vertex_offset = render_ctx->sphere_vertex_offset + _SPHERE_VTX_CNT;
+    // Extract the vertex elements we are interested in and pack the
+    // meshes back to back.
+    MeshCacheEntry entries [_countof(shapes)] = {};
+    XMFLOAT4 black(0.0f, 0.0f, 0.0f, 1.0f);
+    int vtx_offset = 0;
+    int idx_offset = 0;
+    for (int s = 0; s < (int)_countof(shapes); ++s) {
+        strncpy_s(entries[s].name, shapes[s].name, _TRUNCATE);
+        entries[s].base_vertex = vtx_offset;
+        entries[s].vertex_count = shapes[s].vtx_cnt;
+        entries[s].first_index = idx_offset;
+        entries[s].index_count = shapes[s].idx_cnt;
+        entries[s].bounds = shapes[s].bounds;
+
+        for (int i = 0; i < shapes[s].vtx_cnt; ++i) {
+            vertices[vtx_offset + i].position = shapes[s].vertices[i].position;
+            vertices[vtx_offset + i].color = black;
+        }
+        memcpy(&indices[idx_offset], shapes[s].indices, sizeof(int) * shapes[s].idx_cnt);
 
-    // Cache the starting index for each object in the concatenated index buffer.
-    render_ctx->box_index_offset = 0;
-    render_ctx->grid_index_offset = _BOX_IDX_CNT;
-    render_ctx->sphere_index_offset = render_ctx->grid_index_offset + _GRID_IDX_CNT;
-    render_ctx->cylinder_index_offset = render_ctx->sphere_index_offset + _SPHERE_IDX_CNT;
+        vtx_offset += shapes[s].vtx_cnt;
+        idx_offset += shapes[s].idx_cnt;
+    }
 
-    // index count
-    render_ctx->box_index_count =_BOX_IDX_CNT;
-    render_ctx->grid_index_count =_GRID_IDX_CNT;
-    render_ctx->sphere_index_count =_SPHERE_IDX_CNT;
-    render_ctx->cylinder_index_count =_CYLINDER_IDX_CNT;
+    mesh_cache_write(
+        _MESH_CACHE_PATH, key, entries, _countof(entries),
+        vertices, sizeof(DemoVertex), vtx_offset, indices, idx_offset
+    );
+    upload_meshes(render_ctx, entries, _countof(entries), vertices, indices);
 
-    // Extract the vertex elements we are interested in and pack the
-    // vertices of all the meshes into one vertex buffer.
+    // -- cleanup
+    free(scratch);
+    free(indices);
+    free(vertices);
+}
+// Imports an OBJ file as one mesh. Vertices take the diffuse color of the
+// material of the (last) submesh using them.
+static MeshHandle
+load_obj_mesh (D3D11RenderContext * render_ctx, char const * path, char const * name) {
+    ObjMesh obj;
+    if (!load_obj(path, &obj)) {
+        free_obj(&obj);
+        return INVALID_MESH_HANDLE;
+    }
 
-    XMFLOAT4 black(0.0f, 0.0f, 0.0f, 1.0f);
-    UINT k = 0;
-    for (size_t i = 0; i < _BOX_VTX_CNT; ++i, ++k) {
-        vertices[k].position = box_vertices[i].position;
-        vertices[k].color = black;
+    DemoVertex * vertices = (DemoVertex *)::malloc(sizeof(DemoVertex) * obj.vertex_count);
+    for (int i = 0; i < obj.vertex_count; ++i) {
+        vertices[i].position = obj.vertices[i].position;
+        vertices[i].color = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+    for (int s = 0; s < obj.submesh_count; ++s) {
+        ObjMaterial const & mat = obj.materials[obj.submeshes[s].material];
+        XMFLOAT4 color(mat.diffuse.x, mat.diffuse.y, mat.diffuse.z, mat.opacity);
+        for (uint32_t i = 0; i < obj.submeshes[s].index_count; ++i)
+            vertices[obj.indices[obj.submeshes[s].first_index + i]].color = color;
+    }
+
+    MeshCacheEntry entry = {};
+    strncpy_s(entry.name, name, _TRUNCATE);
+    entry.vertex_count = obj.vertex_count;
+    entry.index_count = obj.index_count;
+    entry.bounds = obj.bounds;
+    MeshHandle mesh;
+    upload_meshes(render_ctx, &entry, 1, vertices, obj.indices, &mesh);
+
+    free(vertices);
+    free_obj(&obj);
+    return mesh;
+}
+// Loads a glTF scene: every triangle primitive becomes a mesh named
+// "<mesh>/<primitive>" and every node referencing a mesh becomes render
+// items. Vertices already laid out like DemoVertex and uint32 indices are
+// uploaded straight from the mapped file; everything else is converted.
+static bool
+load_gltf_scene (D3D11RenderContext * render_ctx, char const * path) {
+    GltfScene scene;
+    if (!load_gltf(path, &scene))
+        return false;
+
+    GltfVertexElement const demo_layout [] = {
+        {GLTF_POSITION, offsetof(DemoVertex, position),   3},
+        {GLTF_COLOR_0,  offsetof(DemoVertex, color),      4},
+    };
+
+    MeshHandle * prim_mesh = (MeshHandle *)::malloc(sizeof(MeshHandle) * (scene.primitive_count + 1));
+    for (int m = 0; m < scene.mesh_count; ++m) {
+        GltfMesh const & mesh = scene.meshes[m];
+        for (int p = 0; p < mesh.primitive_count; ++p) {
+            int prim_index = mesh.first_primitive + p;
+            GltfPrimitive const * prim = &scene.primitives[prim_index];
+            uint32_t vtx_cnt = gltf_vertex_count(prim);
+            uint32_t idx_cnt = gltf_index_count(prim);
+
+            DemoVertex * converted_vertices = nullptr;
+            int * converted_indices = nullptr;
+            DemoVertex const * vertices = (DemoVertex const *)gltf_match_interleaved(prim, demo_layout, _countof(demo_layout), sizeof(DemoVertex));
+            if (nullptr == vertices) {
+                converted_vertices = (DemoVertex *)::malloc(sizeof(DemoVertex) * vtx_cnt);
+                gltf_read_floats(prim->attributes[GLTF_POSITION], 3, &converted_vertices[0].position, sizeof(DemoVertex));
+                if (!gltf_read_floats(prim->attributes[GLTF_COLOR_0], 4, &converted_vertices[0].color, sizeof(DemoVertex))) {
+                    XMFLOAT4 color = (prim->material >= 0 && prim->material < scene.material_count) ?
+                        scene.materials[prim->material].base_color : XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+                    for (uint32_t i = 0; i < vtx_cnt; ++i)
+                        converted_vertices[i].color = color;
+                }
+                vertices = converted_vertices;
+            }
+            int const * indices = gltf_index_source(prim);
+            if (nullptr == indices) {
+                converted_indices = (int *)::malloc(sizeof(int) * idx_cnt);
+                gltf_read_indices(prim, converted_indices);
+                indices = converted_indices;
+            }
+
+            MeshCacheEntry entry = {};
+            gltf_primitive_name(entry.name, sizeof(entry.name), mesh.name, p);
+            entry.vertex_count = vtx_cnt;
+            entry.index_count = idx_cnt;
+            entry.bounds = prim->bounds;
+            upload_meshes(render_ctx, &entry, 1, vertices, indices, &prim_mesh[prim_index]);
+
+            free(converted_indices);
+            free(converted_vertices);
+        }
+    }
+    for (int i = 0; i < scene.instance_count; ++i) {
+        GltfMesh const & mesh = scene.meshes[scene.instances[i].mesh];
+        XMMATRIX world = XMLoadFloat4x4(&scene.instances[i].world);
+        for (int p = 0; p < mesh.primitive_count; ++p)
+            if (prim_mesh[mesh.first_primitive + p] != INVALID_MESH_HANDLE)
+                render_items_add(&render_ctx->items, prim_mesh[mesh.first_primitive + p], world);
+    }
+
+    free(prim_mesh);
+    free_gltf(&scene);
+    return true;
+}
+// Builds the quadtree terrain and reserves its vertex slots in the geometry
+// pool, as the vertices of one "terrain_patch" mesh whose indices are the
+// shared patch. Each frame update_terrain_lod rewrites the slots that changed.
+static bool
+create_terrain_lod (D3D11RenderContext * render_ctx, XMFLOAT3 offset) {
+    TerrainParams params = {};
+    params.width = _TERRAIN_WIDTH;
+    params.octaves = 6;
+    params.frequency = 0.005f;
+    params.amplitude = 20.0f;
+    params.lacunarity = 2.0f;
+    params.gain = 0.5f;
+    params.seed = 1337;
+
+    TerrainLod * terrain = &render_ctx->terrain;
+    if (!terrain_lod_create(terrain, &params, _TERRAIN_PATCH, _TERRAIN_LEVELS, _TERRAIN_LOD0_RANGE, _TERRAIN_SLOTS))
+        return false;
+
+    int vtx_cnt = terrain->slot_count * terrain->patch_vertex_count;
+    DemoVertex *    vertices = (DemoVertex *)::calloc(vtx_cnt, sizeof(DemoVertex));
+    int *           indices = (int *)::malloc(sizeof(int) * terrain->patch_index_count);
+    terrain_lod_patch_indices(terrain->patch, indices);
+
+    MeshHandle mesh = mesh_table_next_handle(&render_ctx->meshes);
+    GeometryAlloc alloc;
+    bool uploaded = geometry_pool_upload(
+        &render_ctx->geometry, render_ctx->d3d_immediate_context,
+        vertices, vtx_cnt, indices, terrain->patch_index_count, mesh, &alloc
+    );
+    free(indices);
+    free(vertices);
+    if (!uploaded) {
+        terrain_lod_destroy(terrain);
+        return false;
+    }
+
+    MeshBounds bounds;
+    int root = 0;
+    bounds.aabb_center = XMFLOAT3(0.0f, 0.5f * (terrain->node_min_y[root] + terrain->node_max_y[root]), 0.0f);
+    bounds.aabb_extents = XMFLOAT3(0.5f * _TERRAIN_WIDTH, 0.5f * (terrain->node_max_y[root] - terrain->node_min_y[root]), 0.5f * _TERRAIN_WIDTH);
+    bounds.sphere_center = bounds.aabb_center;
+    bounds.sphere_radius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&bounds.aabb_extents)));
+    mesh_table_add(&render_ctx->meshes, "terrain_patch", alloc.base_vertex, alloc.first_index, terrain->patch_index_count, bounds);
+    render_ctx->meshes.vtx_block[mesh] = alloc.vtx_block;
+    render_ctx->meshes.idx_block[mesh] = alloc.idx_block;
+
+    render_ctx->terrain_patch = mesh;
+    render_ctx->terrain_offset = offset;
+    return true;
+}
+// Reselects terrain nodes for the current eye and uploads the slots whose
+// vertices were refilled, colored by height.
+static void
+update_terrain_lod (D3D11RenderContext * render_ctx) {
+    if (INVALID_MESH_HANDLE == render_ctx->terrain_patch)
+        return;
+    TerrainLod * terrain = &render_ctx->terrain;
+    XMFLOAT3 eye(
+        render_ctx->eye.x - render_ctx->terrain_offset.x,
+        render_ctx->eye.y - render_ctx->terrain_offset.y,
+        render_ctx->eye.z - render_ctx->terrain_offset.z
+    );
+
+    LARGE_INTEGER freq, t0, t1;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&t0);
+    bool changed = terrain_lod_update(terrain, eye, render_ctx->workers);
+    QueryPerformanceCounter(&t1);
+    if (!changed)
+        return;
+    render_ctx->terrain_update_ms = 1000.0 * (t1.QuadPart - t0.QuadPart) / freq.QuadPart;
+    terrain_lod_stats(terrain, &render_ctx->terrain_stats);
+
+    float lo = terrain->node_min_y[0];
+    float scale = 1.0f / (terrain->node_max_y[0] - lo + 1e-6f);
+    XMFLOAT4 const sand(1.0f, 0.96f, 0.62f, 1.0f);
+    XMFLOAT4 const grass(0.48f, 0.77f, 0.46f, 1.0f);
+    XMFLOAT4 const forest(0.1f, 0.48f, 0.19f, 1.0f);
+    XMFLOAT4 const rock(0.45f, 0.39f, 0.34f, 1.0f);
+    XMFLOAT4 const snow(1.0f, 1.0f, 1.0f, 1.0f);
+
+    int vtx_cnt = terrain->patch_vertex_count;
+    DemoVertex * vertices = (DemoVertex *)::malloc(sizeof(DemoVertex) * vtx_cnt);
+    D3D11_BOX box = {};
+    box.bottom = 1;
+    box.back = 1;
+    for (int d = 0; d < terrain->dirty_count; ++d) {
+        int slot = terrain->dirty[d];
+        XMFLOAT3 const * positions = terrain->slot_positions + slot * vtx_cnt;
+        for (int i = 0; i < vtx_cnt; ++i) {
+            float h = (positions[i].y - lo) * scale;
+            vertices[i].position = positions[i];
+            vertices[i].color = h < 0.2f ? sand : (h < 0.45f ? grass : (h < 0.7f ? forest : (h < 0.85f ? rock : snow)));
+        }
+        UINT first = render_ctx->meshes.base_vertex[render_ctx->terrain_patch] + slot * vtx_cnt;
+        box.left = first * sizeof(DemoVertex);
+        box.right = box.left + vtx_cnt * sizeof(DemoVertex);
+        render_ctx->d3d_immediate_context->UpdateSubresource(render_ctx->geometry.vb, 0, &box, vertices, 0, 0);
+    }
+    free(vertices);
+}
+// Opens a tiled heightfield for streaming, writing one from the terrain noise
+// first if there is no file at 'path' or it doesn't open (an older layout).
+// Tiles are added to the geometry pool as vertices only, tagged with
+// _TILE_TAG, and draw the shared indices of the "terrain_tile" mesh.
+static bool
+open_terrain_tiles (D3D11RenderContext * render_ctx, char const * path) {
+    TileStreamer * tiles = nullptr;
+    if (INVALID_FILE_ATTRIBUTES != GetFileAttributesA(path))
+        tiles = tile_streamer_open(path, _TILE_THREADS, _TILE_QUEUE, sizeof(DemoVertex), _TILE_BUDGET);
+    if (nullptr == tiles) {
+        TerrainParams noise = {};
+        noise.octaves = 6;
+        noise.frequency = 0.005f;
+        noise.amplitude = 20.0f;
+        noise.lacunarity = 2.0f;
+        noise.gain = 0.5f;
+        noise.seed = 1337;
+        if (!write_tiled_heightfield(path, &noise, _TILE_SIZE, _TILE_COUNT, _TILE_COUNT, _TILE_SPACING))
+            return false;
+        tiles = tile_streamer_open(path, _TILE_THREADS, _TILE_QUEUE, sizeof(DemoVertex), _TILE_BUDGET);
+        if (nullptr == tiles)
+            return false;
     }
 
-    for (size_t i = 0; i < _GRID_VTX_CNT; ++i, ++k) {
-        vertices[k].position = grid_vertices[i].position;
-        vertices[k].color = black;
+    MeshHandle mesh = mesh_table_next_handle(&render_ctx->meshes);
+    GeometryAlloc alloc;
+    if (!geometry_pool_upload(
+        &render_ctx->geometry, render_ctx->d3d_immediate_context,
+        nullptr, 0, tiles->indices, tiles->index_count, mesh, &alloc
+    )) {
+        tile_streamer_close(tiles);
+        return false;
     }
+    MeshBounds bounds = {};
+    mesh_table_add(&render_ctx->meshes, "terrain_tile", 0, alloc.first_index, tiles->index_count, bounds);
+    render_ctx->meshes.vtx_block[mesh] = alloc.vtx_block;
+    render_ctx->meshes.idx_block[mesh] = alloc.idx_block;
+
+    render_ctx->tiles = tiles;
+    render_ctx->tile_mesh = mesh;
+    return true;
+}
+// Moves the orbit target along a straight fly-through over the tiles, then
+// streams: queues the tiles around the target, releases evicted ones and
+// uploads finished ones until _TILE_UPLOAD_MS is used up. The main thread's
+// share of the work is timed against _TILE_SPIKE_MS.
+static void
+update_terrain_tiles (D3D11RenderContext * render_ctx) {
+    TileStreamer * tiles = render_ctx->tiles;
+    if (nullptr == tiles)
+        return;
 
-    for (size_t i = 0; i < _SPHERE_VTX_CNT; ++i, ++k) {
-        vertices[k].position = sphere_vertices[i].position;
-        vertices[k].color = black;
+    LARGE_INTEGER freq, t0, t1;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&t0);
+    float dt = render_ctx->tile_last_tick ? (float)(t0.QuadPart - render_ctx->tile_last_tick) / freq.QuadPart : 0.0f;
+    render_ctx->tile_last_tick = t0.QuadPart;
+
+    float extent = 0.5f * tiles->header->tiles_x * tiles->header->tile_size * tiles->header->spacing - _TILE_PREFETCH_RADIUS;
+    render_ctx->target.x += _TILE_FLY_SPEED * 0.94f * (dt < 0.1f ? dt : 0.1f);
+    render_ctx->target.z += _TILE_FLY_SPEED * 0.34f * (dt < 0.1f ? dt : 0.1f);
+    if (render_ctx->target.x > extent || render_ctx->target.z > extent) {
+        render_ctx->target.x = -extent;
+        render_ctx->target.z = -0.5f * extent;
     }
 
-    for (size_t i = 0; i < _CYLINDER_VTX_CNT; ++i, ++k) {
-        vertices[k].position = cylinder_vertices[i].position;
-        vertices[k].color = black;
+    tile_streamer_update(tiles, render_ctx->target.x, render_ctx->target.z, _TILE_VIEW_RADIUS, _TILE_PREFETCH_RADIUS, ++render_ctx->tile_frame);
+    for (int i = 0; i < tiles->evicted_count; ++i) {
+        GeometryAlloc alloc = {};
+        alloc.vtx_block = tiles->block[tiles->evicted[i]];
+        alloc.idx_block = RANGE_ALLOC_INVALID;
+        geometry_pool_release(&render_ctx->geometry, alloc);
     }
 
-    // -- pack indices
-    k = 0;
-    for (size_t i = 0; i < _BOX_IDX_CNT; ++i, ++k) {
-        indices[k] = box_indices[i];
+    float lo = tiles->header->height_min;
+    float scale = 1.0f / (65535.0f * tiles->header->height_step);
+    XMFLOAT4 const sand(1.0f, 0.96f, 0.62f, 1.0f);
+    XMFLOAT4 const grass(0.48f, 0.77f, 0.46f, 1.0f);
+    XMFLOAT4 const forest(0.1f, 0.48f, 0.19f, 1.0f);
+    XMFLOAT4 const rock(0.45f, 0.39f, 0.34f, 1.0f);
+    XMFLOAT4 const snow(1.0f, 1.0f, 1.0f, 1.0f);
+
+    DemoVertex * vertices = (DemoVertex *)::malloc(sizeof(DemoVertex) * tiles->vertex_count);
+    TileMesh tile;
+    for (;;) {
+        QueryPerformanceCounter(&t1);
+        if (1000.0 * (t1.QuadPart - t0.QuadPart) / freq.QuadPart > _TILE_UPLOAD_MS || !tile_streamer_pop(tiles, &tile))
+            break;
+        // fBm rarely strays far from zero: stretch the middle of the range.
+        for (int i = 0; i < tiles->vertex_count; ++i) {
+            float h = 0.5f + 2.0f * ((tile.vertices[i].position.y - lo) * scale - 0.5f);
+            vertices[i].position = tile.vertices[i].position;
+            vertices[i].color = h < 0.2f ? sand : (h < 0.45f ? grass : (h < 0.7f ? forest : (h < 0.85f ? rock : snow)));
+        }
+        GeometryAlloc alloc;
+        if (geometry_pool_upload(
+            &render_ctx->geometry, render_ctx->d3d_immediate_context,
+            vertices, tiles->vertex_count, nullptr, 0, _TILE_TAG | (uint32_t)tile.tile, &alloc
+        ))
+            tile_streamer_resident(tiles, &tile, alloc.vtx_block, alloc.base_vertex);
+        else
+            tile_streamer_discard(tiles, &tile);
     }
+    free(vertices);
 
-    for (size_t i = 0; i < _GRID_IDX_CNT; ++i, ++k) {
-        indices[k] = grid_indices[i];
+    QueryPerformanceCounter(&t1);
+    render_ctx->tile_stream_ms = 1000.0 * (t1.QuadPart - t0.QuadPart) / freq.QuadPart;
+    if (render_ctx->tile_stream_ms > render_ctx->tile_stream_max_ms)
+        render_ctx->tile_stream_max_ms = render_ctx->tile_stream_ms;
+    if (render_ctx->tile_stream_ms > _TILE_SPIKE_MS)
+        ++render_ctx->tile_spikes;
+}
+// Dynamic buffer rewritten by the CPU every frame.
+static ID3D11Buffer *
+create_dynamic_buffer (ID3D11Device * device, UINT bytes, UINT bind_flags) {
+    D3D11_BUFFER_DESC desc = {};
+    desc.Usage = D3D11_USAGE_DYNAMIC;
+    desc.ByteWidth = bytes;
+    desc.BindFlags = bind_flags;
+    desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    ID3D11Buffer * buffer = nullptr;
+    if (FAILED(device->CreateBuffer(&desc, nullptr, &buffer)))
+        return nullptr;
+    return buffer;
+}
+// Rebuilds the shadow volumes of every caster item for the lights at their
+// current angle: one job per item and light, with the light brought into
+// the item's object space, built straight into the mapped buffers.
+static void
+update_shadow_volumes (D3D11RenderContext * render_ctx) {
+    render_ctx->shadow_job_count = 0;
+    if (!render_ctx->shadows_visible)
+        return;
+    RenderItems const * items = &render_ctx->items;
+
+    LARGE_INTEGER freq, t0, t1;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&t0);
+    float angle = (float)fmod(_SHADOW_LIGHT_SPEED * (double)t0.QuadPart / freq.QuadPart, XM_2PI);
+
+    // -- Jobs
+    int max_jobs = items->count * _SHADOW_LIGHTS;
+    if (max_jobs > render_ctx->shadow_job_capacity) {
+        render_ctx->shadow_job_capacity = max_jobs;
+        render_ctx->shadow_jobs = (ShadowJob *)::realloc(render_ctx->shadow_jobs, sizeof(ShadowJob) * max_jobs);
+        render_ctx->shadow_draws = (ShadowDraw *)::realloc(render_ctx->shadow_draws, sizeof(ShadowDraw) * max_jobs);
+        render_ctx->shadow_items = (int *)::realloc(render_ctx->shadow_items, sizeof(int) * max_jobs);
+    }
+    int job_count = 0;
+    int vertex_count = 0;
+    int index_bound = 0;
+    for (int l = 0; l < _SHADOW_LIGHTS; ++l) {
+        float a = angle + l * XM_2PI / _SHADOW_LIGHTS;
+        XMVECTOR light = XMVectorSet(cosf(a), 1.2f, sinf(a), 0.0f);
+        for (int i = 0; i < items->count; ++i) {
+            MeshHandle mesh = items->mesh[i];
+            if (mesh >= render_ctx->shadow_caster_count || 0 == render_ctx->shadow_casters[mesh].triangle_count)
+                continue;
+            ShadowJob & job = render_ctx->shadow_jobs[job_count];
+            job.caster = &render_ctx->shadow_casters[mesh];
+            job.light = shadow_light_to_object(light, XMLoadFloat4x4(&items->world[i]));
+            render_ctx->shadow_items[job_count++] = i;
+            vertex_count += shadow_caster_vertex_bound(job.caster);
+            index_bound += shadow_caster_index_bound(job.caster);
+        }
     }
+    if (0 == job_count)
+        return;
 
-    for (size_t i = 0; i < _SPHERE_IDX_CNT; ++i, ++k) {
-        indices[k] = sphere_indices[i];
+    // -- Grow the buffers by half again whenever they run short.
+    if (vertex_count > render_ctx->shadow_vb_capacity) {
+        if (render_ctx->shadow_vb)
+            render_ctx->shadow_vb->Release();
+        render_ctx->shadow_vb_capacity = vertex_count + vertex_count / 2;
+        render_ctx->shadow_vb = create_dynamic_buffer(render_ctx->device, sizeof(DemoVertex) * render_ctx->shadow_vb_capacity, D3D11_BIND_VERTEX_BUFFER);
+    }
+    if (index_bound > render_ctx->shadow_ib_capacity) {
+        if (render_ctx->shadow_ib)
+            render_ctx->shadow_ib->Release();
+        render_ctx->shadow_ib_capacity = index_bound + index_bound / 2;
+        render_ctx->shadow_ib = create_dynamic_buffer(render_ctx->device, sizeof(int) * render_ctx->shadow_ib_capacity, D3D11_BIND_INDEX_BUFFER);
+        render_ctx->shadow_scratch = (int *)::realloc(render_ctx->shadow_scratch, sizeof(int) * render_ctx->shadow_ib_capacity);
+    }
+    if (nullptr == render_ctx->shadow_vb || nullptr == render_ctx->shadow_ib) {
+        render_ctx->shadow_vb_capacity = 0;
+        render_ctx->shadow_ib_capacity = 0;
+        return;
     }
 
-    for (size_t i = 0; i < _CYLINDER_IDX_CNT; ++i, ++k) {
-        indices[k] = cylinder_indices[i];
+    ID3D11DeviceContext * ctx = render_ctx->d3d_immediate_context;
+    D3D11_MAPPED_SUBRESOURCE vb_map, ib_map;
+    if (FAILED(ctx->Map(render_ctx->shadow_vb, 0, D3D11_MAP_WRITE_DISCARD, 0, &vb_map)))
+        return;
+    if (FAILED(ctx->Map(render_ctx->shadow_ib, 0, D3D11_MAP_WRITE_DISCARD, 0, &ib_map))) {
+        ctx->Unmap(render_ctx->shadow_vb, 0);
+        return;
+    }
+    DemoVertex * vertices = (DemoVertex *)vb_map.pData;
+    int index_count = shadow_volumes_build(
+        render_ctx->workers, render_ctx->shadow_jobs, job_count, _SHADOW_EXTRUSION,
+        &vertices[0].position, sizeof(DemoVertex), render_ctx->shadow_scratch, (int *)ib_map.pData,
+        render_ctx->shadow_draws
+    );
+    XMFLOAT4 const shadow(0.35f, 0.1f, 0.45f, 1.0f);
+    for (int i = 0; i < vertex_count; ++i)
+        vertices[i].color = shadow;
+    ctx->Unmap(render_ctx->shadow_ib, 0);
+    ctx->Unmap(render_ctx->shadow_vb, 0);
+
+    QueryPerformanceCounter(&t1);
+    render_ctx->shadow_job_count = job_count;
+    render_ctx->shadow_triangles = index_count / 3;
+    render_ctx->shadow_ms = 1000.0 * (t1.QuadPart - t0.QuadPart) / freq.QuadPart;
+}
+// Samples 'volume' with 'field' and extracts its zero isosurface, without
+// the degenerate triangles (counted in 'stats'). Returns false if there is
+// no surface.
+template <typename Field>
+static bool
+build_isosurface (IsoVolume * volume, Field && field, IsoMesh * iso, DegenerateStats * stats) {
+    memset(stats, 0, sizeof(*stats));
+    iso_sample_field(volume, field);
+    if (!extract_isosurface(volume, 0.0f, iso) || 0 == iso->index_count)
+        return false;
+    iso->index_count = strip_degenerate_triangles(&iso->vertices[0].position.x, sizeof(Vertex), iso->indices, iso->index_count, DEGENERATE_MIN_RATIO, stats);
+    return true;
+}
+// Two isosurfaces: a cluster of metaballs and a torus smoothly blended
+// into a box. Sampling and extraction take a while, so like the analytic
+// shapes they are kept in a mesh cache keyed by everything they are built
+// from.
+static void
+create_isosurfaces (D3D11RenderContext * render_ctx) {
+    IsoMetaball const balls [] = {
+        {XMFLOAT3(-0.7f, 0.0f, 0.0f), 0.8f},
+        {XMFLOAT3(+0.7f, 0.3f, 0.0f), 0.7f},
+        {XMFLOAT3(0.0f, 0.9f, 0.4f), 0.6f},
+        {XMFLOAT3(0.1f, -0.8f, -0.4f), 0.6f},
+    };
+    // torus radii, box half size, box rounding, blend distance
+    float const sdf_params [] = {1.6f, 0.45f, 0.8f, 0.1f, 0.6f};
+    // volumes: first sample on every axis, and the span
+    float const metaball_volume [] = {-2.0f, 4.0f};
+    float const sdf_volume [] = {-2.5f, 5.0f};
+    int const resolutions [] = {_ISO_METABALL_RES, _ISO_SDF_RES};
+
+    uint64_t key = mesh_cache_key_begin();
+    int const geometry_version = _GEOMETRY_VERSION;
+    int const vertex_stride = sizeof(DemoVertex);
+    float const min_ratio = DEGENERATE_MIN_RATIO;
+    key = mesh_cache_key_add(key, &geometry_version, sizeof(geometry_version));
+    key = mesh_cache_key_add(key, &vertex_stride, sizeof(vertex_stride));
+    key = mesh_cache_key_add(key, &min_ratio, sizeof(min_ratio));
+    key = mesh_cache_key_add(key, balls, sizeof(balls));
+    key = mesh_cache_key_add(key, sdf_params, sizeof(sdf_params));
+    key = mesh_cache_key_add(key, metaball_volume, sizeof(metaball_volume));
+    key = mesh_cache_key_add(key, sdf_volume, sizeof(sdf_volume));
+    key = mesh_cache_key_add(key, resolutions, sizeof(resolutions));
+
+    // meshes[0] the metaballs, meshes[1] the SDF, in the cache as well
+    MeshHandle meshes [2] = {INVALID_MESH_HANDLE, INVALID_MESH_HANDLE};
+    bool cached = false;
+    MeshCache cache;
+    if (mesh_cache_open(_ISO_CACHE_PATH, key, sizeof(DemoVertex), &cache)) {
+        if (2 == cache.header->mesh_count) {
+            DemoVertex *    cached_vertices = (DemoVertex *)::malloc(sizeof(DemoVertex) * (cache.header->vertex_count + 1));
+            int *           cached_indices = (int *)::malloc(sizeof(int) * (cache.header->index_count + 1));
+            cached = mesh_cache_decode(&cache, cached_vertices, cached_indices);
+            if (cached)
+                upload_meshes(render_ctx, cache.entries, 2, cached_vertices, cached_indices, meshes);
+            free(cached_indices);
+            free(cached_vertices);
+        }
+        mesh_cache_close(&cache);
     }
 
-    UINT vb_byte_size = _TOTAL_VTX_CNT * sizeof(DemoVertex);
-    UINT ib_byte_size = _TOTAL_IDX_CNT * sizeof(int);
+    if (!cached) {
+        IsoMesh isos [2] = {};
+        DegenerateStats stats [2];
+        IsoVolume volume;
+        float o = metaball_volume[0];
+        iso_volume_create(&volume, resolutions[0], resolutions[0], resolutions[0], XMFLOAT3(o, o, o), metaball_volume[1] / (resolutions[0] - 1));
+        bool ok = build_isosurface(&volume, [&](float x, float y, float z) {
+            return iso_metaballs(balls, (int)_countof(balls), x, y, z);
+        }, &isos[0], &stats[0]);
+        iso_volume_destroy(&volume);
+
+        o = sdf_volume[0];
+        iso_volume_create(&volume, resolutions[1], resolutions[1], resolutions[1], XMFLOAT3(o, o, o), sdf_volume[1] / (resolutions[1] - 1));
+        ok = build_isosurface(&volume, [&](float x, float y, float z) {
+            float torus = iso_sdf_torus(x, y, z, sdf_params[0], sdf_params[1]);
+            float box = iso_sdf_box(x, y, z, sdf_params[2], sdf_params[2], sdf_params[2]) - sdf_params[3];
+            return iso_smooth_union(torus, box, sdf_params[4]);
+        }, &isos[1], &stats[1]) && ok;
+        iso_volume_destroy(&volume);
+
+        if (ok) {
+            // Pack both back to back, write the cache for next time, upload.
+            char const * const names [2] = {"metaballs", "sdf"};
+            MeshCacheEntry entries [2] = {};
+            int vtx_cnt = isos[0].vertex_count + isos[1].vertex_count;
+            int idx_cnt = isos[0].index_count + isos[1].index_count;
+            DemoVertex *    vertices = (DemoVertex *)::malloc(sizeof(DemoVertex) * vtx_cnt);
+            int *           indices = (int *)::malloc(sizeof(int) * idx_cnt);
+            XMFLOAT4 black(0.0f, 0.0f, 0.0f, 1.0f);
+            int vtx_offset = 0;
+            int idx_offset = 0;
+            for (int m = 0; m < 2; ++m) {
+                note_degenerate_stats(render_ctx, names[m], stats[m]);
+                strncpy_s(entries[m].name, names[m], _TRUNCATE);
+                entries[m].base_vertex = vtx_offset;
+                entries[m].vertex_count = isos[m].vertex_count;
+                entries[m].first_index = idx_offset;
+                entries[m].index_count = isos[m].index_count;
+                entries[m].bounds = isos[m].bounds;
+                for (int i = 0; i < isos[m].vertex_count; ++i) {
+                    vertices[vtx_offset + i].position = isos[m].vertices[i].position;
+                    vertices[vtx_offset + i].color = black;
+                }
+                memcpy(&indices[idx_offset], isos[m].indices, sizeof(int) * isos[m].index_count);
+                vtx_offset += isos[m].vertex_count;
+                idx_offset += isos[m].index_count;
+            }
+            mesh_cache_write(
+                _ISO_CACHE_PATH, key, entries, 2,
+                vertices, sizeof(DemoVertex), vtx_offset, indices, idx_offset
+            );
+            upload_meshes(render_ctx, entries, 2, vertices, indices, meshes);
+            free(indices);
+            free(vertices);
+        }
+        free_iso_mesh(&isos[0]);
+        free_iso_mesh(&isos[1]);
+    }
 
-    // create vertex buffer and index buffer
-    D3D11_BUFFER_DESC vb_desc;
-    vb_desc.Usage = D3D11_USAGE_IMMUTABLE;
-    vb_desc.ByteWidth = vb_byte_size;
-    vb_desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-    vb_desc.CPUAccessFlags = 0;
-    vb_desc.MiscFlags = 0;
-    D3D11_SUBRESOURCE_DATA vinit_data;
-    vinit_data.pSysMem = &vertices[0];
-    render_ctx->device->CreateBuffer(&vb_desc, &vinit_data, &render_ctx->vb);
+    if (INVALID_MESH_HANDLE == meshes[0] || INVALID_MESH_HANDLE == meshes[1]) {
+        MessageBox(0, _T("Failed to create the isosurfaces"), 0, 0);
+        return;
+    }
+    render_items_add(&render_ctx->items, meshes[0], XMMatrixTranslation(0.0f, 2.5f, 10.0f));
+    render_items_add(&render_ctx->items, meshes[1], XMMatrixTranslation(0.0f, 2.5f, -10.0f));
+}
+// The built-in scene: the grid over a noise terrain, a box with a sphere on
+// top, two rows of columns with spheres on them, and two isosurfaces at the
+// ends of the rows. The quadtree terrain is left out when tiles are
+// streamed instead.
+static void
+create_default_scene (D3D11RenderContext * render_ctx, char const * obj_path, bool quadtree_terrain) {
+    XMMATRIX I = XMMatrixIdentity();
+    MeshHandle box_mesh = mesh_table_find(&render_ctx->meshes, "box");
+    MeshHandle grid_mesh = mesh_table_find(&render_ctx->meshes, "grid");
+    MeshHandle sphere_mesh = mesh_table_find(&render_ctx->meshes, "sphere");
+    MeshHandle cylinder_mesh = mesh_table_find(&render_ctx->meshes, "cylinder");
 
-    D3D11_BUFFER_DESC ib_desc;
-    ib_desc.Usage = D3D11_USAGE_IMMUTABLE;
-    ib_desc.ByteWidth =ib_byte_size;
-    ib_desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-    ib_desc.CPUAccessFlags = 0;
-    ib_desc.MiscFlags = 0;
-    D3D11_SUBRESOURCE_DATA iinit_data;
-    iinit_data.pSysMem = &indices[0];
-    render_ctx->device->CreateBuffer(&ib_desc, &iinit_data, &render_ctx->ib);
+    render_items_add(&render_ctx->items, grid_mesh, I);
+    if (quadtree_terrain && !create_terrain_lod(render_ctx, XMFLOAT3(0.0f, -12.0f, 0.0f)))
+        MessageBox(0, _T("Failed to create the terrain"), 0, 0);
 
-    // -- cleanup
-    free(scratch);
-    free(indices);
-    free(vertices);
+    XMMATRIX box_scale = XMMatrixScaling(2.0f, 1.0f, 2.0f);
+    XMMATRIX box_offset = XMMatrixTranslation(0.0f, 0.5f, 0.0f);
+    render_items_add(&render_ctx->items, box_mesh, XMMatrixMultiply(box_scale, box_offset));
+
+    XMMATRIX center_sphere_scale = XMMatrixScaling(2.0f, 2.0f, 2.0f);
+    XMMATRIX center_sphere_offset = XMMatrixTranslation(0.0f, 2.0f, 0.0f);
+    render_items_add(&render_ctx->items, sphere_mesh, XMMatrixMultiply(center_sphere_scale, center_sphere_offset));
+
+    for (int i = 0; i < 5; ++i) {
+        render_items_add(&render_ctx->items, cylinder_mesh, XMMatrixTranslation(-5.0f, 1.5f, -10.0f + i * 5.0f));
+        render_items_add(&render_ctx->items, cylinder_mesh, XMMatrixTranslation(+5.0f, 1.5f, -10.0f + i * 5.0f));
+
+        render_items_add(&render_ctx->items, sphere_mesh, XMMatrixTranslation(-5.0f, 3.5f, -10.0f + i * 5.0f));
+        render_items_add(&render_ctx->items, sphere_mesh, XMMatrixTranslation(+5.0f, 3.5f, -10.0f + i * 5.0f));
+    }
+    create_isosurfaces(render_ctx);
+
+    // -- An OBJ file given on the command line is placed on top of the box.
+    if (obj_path && obj_path[0]) {
+        MeshHandle obj_mesh = load_obj_mesh(render_ctx, obj_path, "obj");
+        if (INVALID_MESH_HANDLE == obj_mesh) {
+            MessageBox(0, _T("Failed to load OBJ file"), 0, 0);
+        } else {
+            render_items_add(&render_ctx->items, obj_mesh, XMMatrixTranslation(0.0f, 1.0f, 0.0f));
+            strncpy_s(render_ctx->obj_path, obj_path, _TRUNCATE);
+            render_ctx->obj_mesh = obj_mesh;
+        }
+    }
+}
+// Returns a mesh's regions to the pool and its row to the table's free
+// list, for the next mesh loaded to reuse.
+static void
+unload_mesh (D3D11RenderContext * render_ctx, MeshHandle mesh) {
+    MeshTable * meshes = &render_ctx->meshes;
+    if (meshes->vtx_block[mesh] == RANGE_ALLOC_INVALID)
+        return;
+
+    GeometryAlloc alloc = {};
+    alloc.vtx_block = meshes->vtx_block[mesh];
+    alloc.idx_block = meshes->idx_block[mesh];
+    geometry_pool_release(&render_ctx->geometry, alloc);
+
+    if (mesh < render_ctx->shadow_caster_count)
+        shadow_caster_destroy(&render_ctx->shadow_casters[mesh]);
+    mesh_table_remove(meshes, mesh);
+}
+// Reads the OBJ file again (say, after it was edited) into a new row, moves
+// its items over and unloads the old row. The freed regions are compacted
+// later by defrag_geometry.
+static void
+reload_obj_mesh (D3D11RenderContext * render_ctx) {
+    MeshHandle old_mesh = render_ctx->obj_mesh;
+    if (INVALID_MESH_HANDLE == old_mesh)
+        return;
+    MeshHandle mesh = load_obj_mesh(render_ctx, render_ctx->obj_path, "obj");
+    if (INVALID_MESH_HANDLE == mesh)
+        return;     // keep drawing the old one
+
+    RenderItems * items = &render_ctx->items;
+    for (int i = 0; i < items->count; ++i)
+        if (items->mesh[i] == old_mesh)
+            items->mesh[i] = mesh;
+    render_items_sort_by_mesh(items, render_ctx->meshes.count);
+    unload_mesh(render_ctx, old_mesh);
+    render_ctx->obj_mesh = mesh;
+}
+// Compacts the geometry pool a little at a time once streaming has left it
+// fragmented, and points the affected meshes at their new regions.
+static void
+defrag_geometry (D3D11RenderContext * render_ctx, UINT max_elements) {
+    GeometryPool * pool = &render_ctx->geometry;
+    if (range_allocator_fragmentation(&pool->vtx_alloc) < 0.25f &&
+        range_allocator_fragmentation(&pool->idx_alloc) < 0.25f)
+        return;
+
+    RangeMove vtx_moves[64];
+    RangeMove idx_moves[64];
+    int vtx_move_cnt = 0;
+    int idx_move_cnt = 0;
+    geometry_pool_defrag(
+        pool, render_ctx->d3d_immediate_context, max_elements,
+        vtx_moves, &vtx_move_cnt, idx_moves, &idx_move_cnt, (int)_countof(vtx_moves)
+    );
+
+    for (int i = 0; i < vtx_move_cnt; ++i) {
+        if (vtx_moves[i].user & _TILE_TAG)
+            render_ctx->tiles->base_vertex[vtx_moves[i].user & ~_TILE_TAG] = (int)vtx_moves[i].dst_offset;
+        else
+            render_ctx->meshes.base_vertex[vtx_moves[i].user] = (int)vtx_moves[i].dst_offset;
+    }
+    for (int i = 0; i < idx_move_cnt; ++i)
+        render_ctx->meshes.first_index[idx_moves[i].user] = idx_moves[i].dst_offset;
 }
 static void
 create_fx (D3D11RenderContext * render_ctx) {
@@ -579,6 +1448,13 @@ msg_proc (D3D11RenderContext * render_ctx, UINT msg, WPARAM wparam, LPARAM lpara
     case WM_MOUSEMOVE:
         handle_mouse_move(g_render_ctx, wparam, GET_X_LPARAM(lparam), GET_Y_LPARAM(lparam));
         return 0;
+    // 'V' shows or hides the shadow volumes, 'R' reloads the OBJ file.
+    case WM_KEYDOWN:
+        if ('V' == wparam)
+            render_ctx->shadows_visible = !render_ctx->shadows_visible;
+        else if ('R' == wparam)
+            reload_obj_mesh(render_ctx);
+        return 0;
     }
 
     return DefWindowProc(render_ctx->wnd, msg, wparam, lparam);
@@ -732,6 +1608,7 @@ init_render_ctx (
 
         init_window(render_ctx);
         init_direct3d(render_ctx);
+        render_ctx->workers = worker_pool_create(0);
 
         render_ctx->initialized = true;
     }
@@ -760,30 +1637,34 @@ WinMain (
     g_render_ctx->last_mouse_pos.y = 0;
 
     XMMATRIX I = XMMatrixIdentity();
-    XMStoreFloat4x4(&g_render_ctx->grid_world, I);
     XMStoreFloat4x4(&g_render_ctx->view, I);
     XMStoreFloat4x4(&g_render_ctx->proj, I);
 
-    XMMATRIX box_scale = XMMatrixScaling(2.0f, 1.0f, 2.0f);
-    XMMATRIX box_offset = XMMatrixTranslation(0.0f, 0.5f, 0.0f);
-    XMStoreFloat4x4(&g_render_ctx->box_world, XMMatrixMultiply(box_scale, box_offset));
-
-    XMMATRIX center_sphere_scale = XMMatrixScaling(2.0f, 2.0f, 2.0f);
-    XMMATRIX center_sphere_offset = XMMatrixTranslation(0.0f, 2.0f, 0.0f);
-    XMStoreFloat4x4(&g_render_ctx->center_sphere, XMMatrixMultiply(center_sphere_scale, center_sphere_offset));
-
-    for (int i = 0; i < 5; ++i) {
-        XMStoreFloat4x4(&g_render_ctx->cylinder_world[i * 2 + 0], XMMatrixTranslation(-5.0f, 1.5f, -10.0f + i * 5.0f));
-        XMStoreFloat4x4(&g_render_ctx->cylinder_world[i * 2 + 1], XMMatrixTranslation(+5.0f, 1.5f, -10.0f + i * 5.0f));
-
-        XMStoreFloat4x4(&g_render_ctx->sphere_world[i * 2 + 0], XMMatrixTranslation(-5.0f, 3.5f, -10.0f + i * 5.0f));
-        XMStoreFloat4x4(&g_render_ctx->sphere_world[i * 2 + 1], XMMatrixTranslation(+5.0f, 3.5f, -10.0f + i * 5.0f));
-    }
+    mesh_table_init(&g_render_ctx->meshes, 16);
+    render_items_init(&g_render_ctx->items, 32);
+    g_render_ctx->terrain_patch = INVALID_MESH_HANDLE;
+    g_render_ctx->obj_mesh = INVALID_MESH_HANDLE;
+    g_render_ctx->shadows_visible = true;
 
     create_geom_buffers(g_render_ctx);
     create_fx(g_render_ctx);
     create_vertex_layout(g_render_ctx);
 
+    // -- A glTF scene given on the command line replaces the built-in one;
+    // an OBJ file is placed on top of the box, and a tiled heightfield
+    // (.thf, written first if missing) is streamed in for a fly-through.
+    char const * ext = cmdline ? strrchr(cmdline, '.') : nullptr;
+    bool gltf = ext && (0 == _stricmp(ext, ".glb") || 0 == _stricmp(ext, ".gltf"));
+    bool tiles = ext && 0 == _stricmp(ext, ".thf");
+    bool gltf_loaded = gltf && load_gltf_scene(g_render_ctx, cmdline);
+    if (gltf && !gltf_loaded)
+        MessageBox(0, _T("Failed to load glTF file"), 0, 0);
+    if (!gltf_loaded)
+        create_default_scene(g_render_ctx, (gltf || tiles) ? nullptr : cmdline, !tiles);
+    if (tiles && !open_terrain_tiles(g_render_ctx, cmdline))
+        MessageBox(0, _T("Failed to open tiled heightfield"), 0, 0);
+    render_items_sort_by_mesh(&g_render_ctx->items, g_render_ctx->meshes.count);
+
     D3D11_RASTERIZER_DESC wireframe_desc;
     ZeroMemory(&wireframe_desc, sizeof(D3D11_RASTERIZER_DESC));
     wireframe_desc.FillMode = D3D11_FILL_WIREFRAME;
@@ -792,6 +1673,8 @@ WinMain (
     wireframe_desc.DepthClipEnable = true;
 
     g_render_ctx->device->CreateRasterizerState(&wireframe_desc, &g_render_ctx->wireframe_rs);
+    wireframe_desc.FrontCounterClockwise = true;
+    g_render_ctx->device->CreateRasterizerState(&wireframe_desc, &g_render_ctx->wireframe_mirrored_rs);
 
 #pragma endregion
 #pragma region Main Loop
@@ -806,12 +1689,49 @@ WinMain (
         // Otherwise, do animation/game stuff.
         else {
             if (!g_render_ctx->paused) {
+                defrag_geometry(g_render_ctx, 65536);
                 update_scene(g_render_ctx);
+                update_terrain_lod(g_render_ctx);
+                update_terrain_tiles(g_render_ctx);
+                update_shadow_volumes(g_render_ctx);
                 draw_scene(g_render_ctx);
 
                 // -- display results on window's title bar
-                TCHAR buf[50];
-                _sntprintf_s(buf, 50, 50, _T("D3D11 shapes demo:   %s"), _T(""));
+                TCHAR buf[256];
+                if (g_render_ctx->tiles) {
+                    TileStreamerStats st;
+                    tile_streamer_stats(g_render_ctx->tiles, &st);
+                    _sntprintf_s(
+                        buf, _countof(buf), _TRUNCATE,
+                        _T("D3D11 shapes demo:   tiles %d resident, %d queued, %d evicted, stream %.2f ms (max %.2f, %d spikes)"),
+                        st.resident, st.queued, st.evicted, g_render_ctx->tile_stream_ms, g_render_ctx->tile_stream_max_ms, g_render_ctx->tile_spikes
+                    );
+                } else if (INVALID_MESH_HANDLE != g_render_ctx->terrain_patch) {
+                    TerrainLodStats const & st = g_render_ctx->terrain_stats;
+                    _sntprintf_s(
+                        buf, _countof(buf), _TRUNCATE,
+                        _T("D3D11 shapes demo:   terrain %d nodes, %d tris (%.1f%% of full grid), %d rebuilt, %.3f ms"),
+                        st.nodes, st.triangles, 100.0 * st.triangles / st.full_triangles, st.rebuilt, g_render_ctx->terrain_update_ms
+                    );
+                } else {
+                    _sntprintf_s(buf, 50, 50, _T("D3D11 shapes demo:   %s"), _T(""));
+                }
+                if (g_render_ctx->shadow_job_count > 0) {
+                    size_t len = _tcslen(buf);
+                    _sntprintf_s(
+                        buf + len, _countof(buf) - len, _TRUNCATE,
+                        _T(", shadows %d volumes, %d tris, %.3f ms"),
+                        g_render_ctx->shadow_job_count, g_render_ctx->shadow_triangles, g_render_ctx->shadow_ms
+                    );
+                }
+                if (degenerate_removed(&g_render_ctx->degenerate) > 0) {
+                    size_t len = _tcslen(buf);
+                    _sntprintf_s(
+                        buf + len, _countof(buf) - len, _TRUNCATE,
+                        _T(", %d of %d generated tris degenerate"),
+                        degenerate_removed(&g_render_ctx->degenerate), g_render_ctx->degenerate.triangles
+                    );
+                }
                 ::SetWindowText(g_render_ctx->wnd, buf);
             } else {
                 Sleep(100);
@@ -820,11 +1740,30 @@ WinMain (
     }
 #pragma endregion
 #pragma region Cleanup
-    g_render_ctx->ib->Release();
-    g_render_ctx->vb->Release();
+    if (INVALID_MESH_HANDLE != g_render_ctx->terrain_patch)
+        terrain_lod_destroy(&g_render_ctx->terrain);
+    if (g_render_ctx->tiles)
+        tile_streamer_close(g_render_ctx->tiles);
+    worker_pool_destroy(g_render_ctx->workers);
+    for (int c = 0; c < g_render_ctx->shadow_caster_count; ++c)
+        shadow_caster_destroy(&g_render_ctx->shadow_casters[c]);
+    free(g_render_ctx->shadow_casters);
+    free(g_render_ctx->shadow_jobs);
+    free(g_render_ctx->shadow_draws);
+    free(g_render_ctx->shadow_items);
+    free(g_render_ctx->shadow_scratch);
+    if (g_render_ctx->shadow_vb)
+        g_render_ctx->shadow_vb->Release();
+    if (g_render_ctx->shadow_ib)
+        g_render_ctx->shadow_ib->Release();
+    render_items_free(&g_render_ctx->items);
+    mesh_table_free(&g_render_ctx->meshes);
+
+    geometry_pool_destroy(&g_render_ctx->geometry);
     g_render_ctx->fx->Release();
     g_render_ctx->input_layout->Release();
     g_render_ctx->wireframe_rs->Release();
+    g_render_ctx->wireframe_mirrored_rs->Release();
 
     g_render_ctx->rtv->Release();
     g_render_ctx->dsv->Release();
@@ -0,0 +1,244 @@
+#pragma once
+
+// Triangle adjacency as a compact half-edge structure over an indexed
+// triangle list. Half-edge 3t+k runs from corner k to corner k+1 of
+// triangle t, so next/prev/face are arithmetic and only the twin links
+// (plus one outgoing half-edge per vertex) are stored: 4 bytes per
+// half-edge and 8 per vertex with welding.
+//
+// Twins are found with one open-addressing hash of directed edges, O(n) in
+// the triangle count. Generated meshes split vertices along texture seams
+// and hard edges, so the build can first weld vertices by position; twins
+// are then matched on the welded ids while the triangles keep their own.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct HalfEdgeMesh {
+    int *   twin;               // per half-edge: opposite half-edge, -1 on borders
+    int *   vertex_edge;        // per welded vertex: an outgoing half-edge, -1 if unused
+    int *   remap;              // per vertex: welded id (nullptr without welding)
+    int     triangle_count;
+    int     vertex_count;
+    int     welded_count;       // distinct welded vertices
+
+    int     boundary_edges;     // half-edges without a twin
+    int     nonmanifold_edges;  // directed edges used more than once
+};
+
+static inline int
+half_edge_next (int he) {
+    return (he % 3 == 2) ? he - 2 : he + 1;
+}
+static inline int
+half_edge_prev (int he) {
+    return (he % 3 == 0) ? he + 2 : he - 1;
+}
+static inline int
+half_edge_face (int he) {
+    return he / 3;
+}
+// Welded id of the vertex the half-edge starts from.
+static inline int
+half_edge_origin (HalfEdgeMesh const * mesh, int const indices [], int he) {
+    return mesh->remap ? mesh->remap[indices[he]] : indices[he];
+}
+
+// -- Welding: vertices with bit-identical positions share one id (the
+// lowest vertex index among them); -0.0 is folded into 0.0.
+static inline uint32_t
+half_edge_position_hash (uint32_t const bits [3]) {
+    uint32_t h = bits[0] * 73856093u ^ bits[1] * 19349663u ^ bits[2] * 83492791u;
+    return h ^ (h >> 16);
+}
+static int
+weld_positions (float const * positions, size_t stride, int vertex_count, int out_remap []) {
+    int size = 16;
+    while (size < vertex_count * 2)
+        size *= 2;
+    int mask = size - 1;
+    int * table = (int *)::malloc(sizeof(int) * size);
+    memset(table, 0xff, sizeof(int) * size);
+
+    int welded = 0;
+    for (int v = 0; v < vertex_count; ++v) {
+        float const * p = (float const *)((uint8_t const *)positions + v * stride);
+        uint32_t bits [3];
+        for (int c = 0; c < 3; ++c) {
+            float f = p[c] == 0.0f ? 0.0f : p[c];
+            memcpy(&bits[c], &f, sizeof(f));
+        }
+        int s = (int)(half_edge_position_hash(bits) & (uint32_t)mask);
+        for (;; s = (s + 1) & mask) {
+            int other = table[s];
+            if (other < 0) {
+                table[s] = v;
+                out_remap[v] = v;
+                ++welded;
+                break;
+            }
+            float const * q = (float const *)((uint8_t const *)positions + other * stride);
+            if (p[0] == q[0] && p[1] == q[1] && p[2] == q[2]) {
+                out_remap[v] = other;
+                break;
+            }
+        }
+    }
+    ::free(table);
+    return welded;
+}
+
+// -- Build
+// Edges leaving the same vertex hash into a run of 2^shift slots starting
+// at the vertex's own position in the table, so a mesh with coherent
+// vertex order probes the table almost sequentially instead of at random.
+static inline int
+half_edge_slot (int a, int b, int shift, int mask) {
+    uint32_t spread = ((uint32_t)b * 0x9e3779b1u) >> (32 - shift);
+    return (int)((((uint32_t)a << shift) + spread) & (uint32_t)mask);
+}
+// Builds the adjacency of 'index_count / 3' triangles over 'vertex_count'
+// vertices. With 'positions' (x, y, z floats every 'stride' bytes) the
+// vertices are welded by position first; pass nullptr to use the indices
+// as they are. Release with half_edge_destroy.
+static void
+half_edge_build (
+    int const indices [], int index_count, int vertex_count,
+    float const * positions, size_t stride, HalfEdgeMesh * mesh
+) {
+    memset(mesh, 0, sizeof(*mesh));
+    int he_count = index_count - index_count % 3;
+    mesh->triangle_count = he_count / 3;
+    mesh->vertex_count = vertex_count;
+    mesh->welded_count = vertex_count;
+    mesh->twin = (int *)::malloc(sizeof(int) * (he_count + 1));
+    mesh->vertex_edge = (int *)::malloc(sizeof(int) * (vertex_count + 1));
+    memset(mesh->vertex_edge, 0xff, sizeof(int) * vertex_count);
+    if (positions) {
+        mesh->remap = (int *)::malloc(sizeof(int) * (vertex_count + 1));
+        mesh->welded_count = weld_positions(positions, stride, vertex_count, mesh->remap);
+    }
+
+    // -- Every directed edge goes into the table once, with its endpoints
+    // stored alongside so probing never chases the index buffer. Repeats
+    // of the same directed edge are non-manifold and, like collapsed edges,
+    // are marked -2 so they stay unpaired.
+    struct Slot {
+        int a;
+        int b;
+        int he;
+    };
+    int size = 16;
+    while (size < he_count * 2)
+        size *= 2;
+    int mask = size - 1;
+    int shift = 1;
+    while (shift < 16 && (int64_t)mesh->vertex_count << (shift + 1) <= size)
+        ++shift;
+    Slot * table = (Slot *)::malloc(sizeof(Slot) * size);
+    for (int s = 0; s < size; ++s)
+        table[s].he = -1;
+    for (int he = 0; he < he_count; ++he) {
+        mesh->twin[he] = -1;
+        int a = half_edge_origin(mesh, indices, he);
+        int b = half_edge_origin(mesh, indices, half_edge_next(he));
+        mesh->vertex_edge[a] = he;
+        if (a == b) {
+            mesh->twin[he] = -2;
+            continue;
+        }
+        int s = half_edge_slot(a, b, shift, mask);
+        for (;; s = (s + 1) & mask) {
+            Slot & slot = table[s];
+            if (slot.he < 0) {
+                slot.a = a;
+                slot.b = b;
+                slot.he = he;
+                break;
+            }
+            if (slot.a == a && slot.b == b) {
+                mesh->twin[he] = -2;
+                ++mesh->nonmanifold_edges;
+                break;
+            }
+        }
+    }
+
+    // -- Pair each stored half-edge with the stored reverse edge.
+    for (int he = 0; he < he_count; ++he) {
+        if (mesh->twin[he] != -1)
+            continue;
+        int a = half_edge_origin(mesh, indices, he);
+        int b = half_edge_origin(mesh, indices, half_edge_next(he));
+        int s = half_edge_slot(b, a, shift, mask);
+        for (;; s = (s + 1) & mask) {
+            Slot const & slot = table[s];
+            if (slot.he < 0)
+                break;
+            if (slot.a == b && slot.b == a) {
+                if (mesh->twin[slot.he] == -1) {
+                    mesh->twin[he] = slot.he;
+                    mesh->twin[slot.he] = he;
+                }
+                break;
+            }
+        }
+    }
+    ::free(table);
+
+    for (int he = 0; he < he_count; ++he) {
+        if (mesh->twin[he] < 0) {
+            mesh->twin[he] = -1;
+            ++mesh->boundary_edges;
+        }
+    }
+}
+static void
+half_edge_destroy (HalfEdgeMesh * mesh) {
+    ::free(mesh->twin);
+    ::free(mesh->vertex_edge);
+    ::free(mesh->remap);
+    memset(mesh, 0, sizeof(*mesh));
+}
+static size_t
+half_edge_memory (HalfEdgeMesh const * mesh) {
+    size_t bytes = sizeof(int) * ((size_t)mesh->triangle_count * 3 + mesh->vertex_count);
+    if (mesh->remap)
+        bytes += sizeof(int) * mesh->vertex_count;
+    return bytes;
+}
+
+// -- Outputs
+// Triangle list with adjacency (D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST_ADJ):
+// six indices per triangle, v0 a01 v1 a12 v2 a20, where aij is the vertex
+// of the neighbour across edge ij opposite that edge. Border edges repeat
+// the triangle's own opposite vertex, which makes the neighbour degenerate.
+// The triangle and neighbour vertices keep their original (unwelded) ids.
+static void
+half_edge_emit_adjacency (HalfEdgeMesh const * mesh, int const indices [], int out_indices []) {
+    for (int t = 0; t < mesh->triangle_count; ++t) {
+        for (int k = 0; k < 3; ++k) {
+            int he = t * 3 + k;
+            int twin = mesh->twin[he];
+            out_indices[t * 6 + k * 2 + 0] = indices[he];
+            out_indices[t * 6 + k * 2 + 1] = indices[twin >= 0 ? half_edge_prev(twin) : half_edge_prev(he)];
+        }
+    }
+}
+// Every undirected edge once, as vertex pairs (original ids), for line-list
+// wireframes. Returns the number of edges; 'out_pairs' needs room for
+// 2 * 3 * triangle_count indices.
+static int
+half_edge_unique_edges (HalfEdgeMesh const * mesh, int const indices [], int out_pairs []) {
+    int count = 0;
+    for (int he = 0; he < mesh->triangle_count * 3; ++he) {
+        int twin = mesh->twin[he];
+        if (twin >= 0 && twin < he)
+            continue;
+        out_pairs[count * 2 + 0] = indices[he];
+        out_pairs[count * 2 + 1] = indices[half_edge_next(he)];
+        ++count;
+    }
+    return count;
+}
@@ -0,0 +1,654 @@
+#pragma once
+
+// CPU decoders for the block-compressed texture formats BC1 to BC7, for
+// software fallbacks, thumbnails and checking compressed assets without a
+// GPU.
+//
+// Every block decodes to 4x4 texels. BC1-BC5 and BC7 write RGBA8 (the
+// signed BC4/BC5 variants write signed bytes, alpha 127); BC6H writes RGBA
+// half floats with alpha 1.0. Missing channels are 0, as when the GPU
+// samples an R or RG format. Interpolation follows the D3D11 rules in
+// integer form: BC1-BC3 colour and BC3-BC5 alpha palettes use the 8-bit
+// expanded endpoints with rounded divisions, BC6H/BC7 the 6-bit weight
+// tables. Reserved BC6H and BC7 modes decode to zero.
+//
+// bc_decode_image splits the image into runs of block rows decoded in
+// parallel. The BC1-BC3 colour blocks are decoded four texels at a time
+// with SSE2; the other formats are mostly bit unpacking and table lookups,
+// and stay scalar. Defining BC_NO_SSE2 before the include builds the scalar
+// paths everywhere, for parity checks.
+
+#include "parallel.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if !defined(BC_NO_SSE2) && (defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__))
+#include <emmintrin.h>
+#define BC_DECODE_SSE2 1
+#endif
+
+enum BcFormat {
+    BC_FORMAT_BC1,
+    BC_FORMAT_BC2,
+    BC_FORMAT_BC3,
+    BC_FORMAT_BC4_UNORM,
+    BC_FORMAT_BC4_SNORM,
+    BC_FORMAT_BC5_UNORM,
+    BC_FORMAT_BC5_SNORM,
+    BC_FORMAT_BC6H_UF16,
+    BC_FORMAT_BC6H_SF16,
+    BC_FORMAT_BC7,
+};
+
+static inline int
+bc_block_bytes (BcFormat format) {
+    return (BC_FORMAT_BC1 == format || BC_FORMAT_BC4_UNORM == format || BC_FORMAT_BC4_SNORM == format) ? 8 : 16;
+}
+// Bytes per decoded texel: 8 for BC6H (RGBA16F), 4 for everything else.
+static inline int
+bc_texel_bytes (BcFormat format) {
+    return (BC_FORMAT_BC6H_UF16 == format || BC_FORMAT_BC6H_SF16 == format) ? 8 : 4;
+}
+
+// ------------------------------------------------------------- BC1 - BC3 --
+
+static inline uint32_t
+bc_rgb565_to_rgba8 (uint32_t c) {
+    uint32_t r = (c >> 11) & 31;
+    uint32_t g = (c >> 5) & 63;
+    uint32_t b = c & 31;
+    r = (r << 3) | (r >> 2);
+    g = (g << 2) | (g >> 4);
+    b = (b << 3) | (b >> 2);
+    return r | (g << 8) | (b << 16) | 0xff000000u;
+}
+// Palette of a colour block; 'four_colors' forces the opaque four colour
+// mode, which BC2 and BC3 always use.
+static inline void
+bc_color_palette (uint8_t const * block, bool four_colors, uint32_t palette [4]) {
+    uint32_t c0 = block[0] | (uint32_t)block[1] << 8;
+    uint32_t c1 = block[2] | (uint32_t)block[3] << 8;
+    palette[0] = bc_rgb565_to_rgba8(c0);
+    palette[1] = bc_rgb565_to_rgba8(c1);
+    uint32_t p2 = 0xff000000u;
+    uint32_t p3 = 0xff000000u;
+    bool interpolate3 = four_colors || c0 > c1;
+    for (int shift = 0; shift < 24; shift += 8) {
+        uint32_t a = (palette[0] >> shift) & 0xff;
+        uint32_t b = (palette[1] >> shift) & 0xff;
+        if (interpolate3) {
+            p2 |= ((2 * a + b + 1) / 3) << shift;
+            p3 |= ((a + 2 * b + 1) / 3) << shift;
+        } else {
+            p2 |= ((a + b + 1) / 2) << shift;
+        }
+    }
+    palette[2] = p2;
+    palette[3] = interpolate3 ? p3 : 0;
+}
+// Writes the 16 texels of a colour block; alpha is overwritten later for
+// BC2 and BC3.
+static inline void
+bc_decode_color (uint8_t const * block, bool four_colors, uint8_t * out, size_t pitch) {
+    uint32_t palette [4];
+    bc_color_palette(block, four_colors, palette);
+    uint32_t bits = block[4] | (uint32_t)block[5] << 8 | (uint32_t)block[6] << 16 | (uint32_t)block[7] << 24;
+#if defined(BC_DECODE_SSE2)
+    // Each row selects between the palette entries with lane compares of
+    // the index bits held in place, so no variable shifts are needed.
+    __m128i const lane_mask = _mm_setr_epi32(3, 3 << 2, 3 << 4, 3 << 6);
+    __m128i const lane_one = _mm_setr_epi32(1, 1 << 2, 1 << 4, 1 << 6);
+    __m128i const lane_two = _mm_slli_epi32(lane_one, 1);
+    __m128i const lane_three = _mm_or_si128(lane_one, lane_two);
+    __m128i const p0 = _mm_set1_epi32((int)palette[0]);
+    __m128i const p1 = _mm_set1_epi32((int)palette[1]);
+    __m128i const p2 = _mm_set1_epi32((int)palette[2]);
+    __m128i const p3 = _mm_set1_epi32((int)palette[3]);
+    for (int y = 0; y < 4; ++y) {
+        __m128i idx = _mm_and_si128(_mm_set1_epi32((int)((bits >> (8 * y)) & 0xff)), lane_mask);
+        __m128i m1 = _mm_cmpeq_epi32(idx, lane_one);
+        __m128i m2 = _mm_cmpeq_epi32(idx, lane_two);
+        __m128i m3 = _mm_cmpeq_epi32(idx, lane_three);
+        __m128i m0 = _mm_cmpeq_epi32(idx, _mm_setzero_si128());
+        __m128i texels = _mm_or_si128(
+            _mm_or_si128(_mm_and_si128(m0, p0), _mm_and_si128(m1, p1)),
+            _mm_or_si128(_mm_and_si128(m2, p2), _mm_and_si128(m3, p3))
+        );
+        _mm_storeu_si128((__m128i *)(out + y * pitch), texels);
+    }
+#else
+    for (int y = 0; y < 4; ++y) {
+        uint8_t * row = out + y * pitch;
+        for (int x = 0; x < 4; ++x) {
+            uint32_t c = palette[(bits >> (2 * (y * 4 + x))) & 3];
+            memcpy(row + x * 4, &c, 4);
+        }
+    }
+#endif
+}
+
+// Eight entry alpha palette shared by BC3, BC4 and BC5; signed endpoints
+// round away from zero.
+static inline void
+bc_alpha_palette (int a0, int a1, bool is_signed, int out [8]) {
+    out[0] = a0;
+    out[1] = a1;
+    if (a0 > a1) {
+        for (int i = 1; i < 7; ++i) {
+            int v = (7 - i) * a0 + i * a1;
+            out[i + 1] = (v >= 0 ? v + 3 : v - 3) / 7;
+        }
+    } else {
+        for (int i = 1; i < 5; ++i) {
+            int v = (5 - i) * a0 + i * a1;
+            out[i + 1] = (v >= 0 ? v + 2 : v - 2) / 5;
+        }
+        out[6] = is_signed ? -127 : 0;
+        out[7] = is_signed ? 127 : 255;
+    }
+}
+// Decodes an 8-byte alpha block into one byte channel of 16 texels.
+static inline void
+bc_decode_alpha (uint8_t const * block, bool is_signed, uint8_t * out, size_t pitch, int channel) {
+    int a0 = block[0];
+    int a1 = block[1];
+    if (is_signed) {
+        a0 = (int8_t)block[0] < -127 ? -127 : (int8_t)block[0];
+        a1 = (int8_t)block[1] < -127 ? -127 : (int8_t)block[1];
+    }
+    int palette [8];
+    bc_alpha_palette(a0, a1, is_signed, palette);
+    uint64_t bits = 0;
+    for (int i = 0; i < 6; ++i)
+        bits |= (uint64_t)block[2 + i] << (8 * i);
+    for (int i = 0; i < 16; ++i)
+        out[(i >> 2) * pitch + (i & 3) * 4 + channel] = (uint8_t)palette[(bits >> (3 * i)) & 7];
+}
+
+static inline void
+bc1_decode_block (uint8_t const * block, uint8_t * out, size_t pitch) {
+    bc_decode_color(block, false, out, pitch);
+}
+static inline void
+bc2_decode_block (uint8_t const * block, uint8_t * out, size_t pitch) {
+    bc_decode_color(block + 8, true, out, pitch);
+    for (int i = 0; i < 16; ++i) {
+        uint32_t a = (block[i >> 1] >> (4 * (i & 1))) & 15;
+        out[(i >> 2) * pitch + (i & 3) * 4 + 3] = (uint8_t)(a * 17);
+    }
+}
+static inline void
+bc3_decode_block (uint8_t const * block, uint8_t * out, size_t pitch) {
+    bc_decode_color(block + 8, true, out, pitch);
+    bc_decode_alpha(block, false, out, pitch, 3);
+}
+static inline void
+bc4_decode_block (uint8_t const * block, bool is_signed, uint8_t * out, size_t pitch) {
+    uint32_t fill = is_signed ? 0x7f000000u : 0xff000000u;
+    for (int y = 0; y < 4; ++y)
+        for (int x = 0; x < 4; ++x)
+            memcpy(out + y * pitch + x * 4, &fill, 4);
+    bc_decode_alpha(block, is_signed, out, pitch, 0);
+}
+static inline void
+bc5_decode_block (uint8_t const * block, bool is_signed, uint8_t * out, size_t pitch) {
+    bc4_decode_block(block, is_signed, out, pitch);
+    bc_decode_alpha(block + 8, is_signed, out, pitch, 1);
+}
+
+// ---------------------------------------------------------- BC6H / BC7 --
+
+struct BcBits {
+    uint64_t    lo;
+    uint64_t    hi;
+};
+static inline BcBits
+bc_bits (uint8_t const * block) {
+    BcBits b;
+    memcpy(&b.lo, block, 8);
+    memcpy(&b.hi, block + 8, 8);
+    return b;
+}
+// Takes the next 'count' (<= 32) bits, least significant first.
+static inline uint32_t
+bc_read (BcBits * b, int count) {
+    uint32_t v = (uint32_t)(b->lo & ((1ull << count) - 1));
+    b->lo = (b->lo >> count) | (count ? b->hi << (64 - count) : 0);
+    b->hi >>= count;
+    return v;
+}
+
+// Partition tables shared by BC6H (first 32) and BC7: one bit per texel
+// for two subsets, two bits per texel for three.
+static uint16_t const bc_partitions2 [64] = {
+    0xcccc, 0x8888, 0xeeee, 0xecc8, 0xc880, 0xfeec, 0xfec8, 0xec80,
+    0xc800, 0xffec, 0xfe80, 0xe800, 0xffe8, 0xff00, 0xfff0, 0xf000,
+    0xf710, 0x008e, 0x7100, 0x08ce, 0x008c, 0x7310, 0x3100, 0x8cce,
+    0x088c, 0x3110, 0x6666, 0x366c, 0x17e8, 0x0ff0, 0x718e, 0x399c,
+    0xaaaa, 0xf0f0, 0x5a5a, 0x33cc, 0x3c3c, 0x55aa, 0x9696, 0xa55a,
+    0x73ce, 0x13c8, 0x324c, 0x3bdc, 0x6996, 0xc33c, 0x9966, 0x0660,
+    0x0272, 0x04e4, 0x4e40, 0x2720, 0xc936, 0x936c, 0x39c6, 0x639c,
+    0x9336, 0x9cc6, 0x817e, 0xe718, 0xccf0, 0x0fcc, 0x7744, 0xee22,
+};
+static uint32_t const bc_partitions3 [64] = {
+    0xaa685050, 0x6a5a5040, 0x5a5a4200, 0x5450a0a8, 0xa5a50000, 0xa0a05050, 0x5555a0a0, 0x5a5a5050,
+    0xaa550000, 0xaa555500, 0xaaaa5500, 0x90909090, 0x94949494, 0xa4a4a4a4, 0xa9a59450, 0x2a0a4250,
+    0xa5945040, 0x0a425054, 0xa5a5a500, 0x55a0a0a0, 0xa8a85454, 0x6a6a4040, 0xa4a45000, 0x1a1a0500,
+    0x0050a4a4, 0xaaa59090, 0x14696914, 0x69691400, 0xa08585a0, 0xaa821414, 0x50a4a450, 0x6a5a0200,
+    0xa9a58000, 0x5090a0a8, 0xa8a09050, 0x24242424, 0x00aa5500, 0x24924924, 0x24499224, 0x50a50a50,
+    0x500aa550, 0xaaaa4444, 0x66660000, 0xa5a0a5a0, 0x50a050a0, 0x69286928, 0x44aaaa44, 0x66666600,
+    0xaa444444, 0x54a854a8, 0x95809580, 0x96969600, 0xa85454a8, 0x80959580, 0xaa141414, 0x96960000,
+    0xaaaa1414, 0xa05050a0, 0xa0a5a5a0, 0x96000000, 0x40804080, 0xa9a8a9a8, 0xaaaaaa44, 0x2a4a5254,
+};
+static uint8_t const bc_anchor2 [64] = {
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15,  2,  8,  2,  2,  8,  8, 15,  2,  8,  2,  2,  8,  8,  2,  2,
+    15, 15,  6,  8,  2,  8, 15, 15,  2,  8,  2,  2,  2, 15, 15,  6,
+     6,  2,  6,  8, 15, 15,  2,  2, 15, 15, 15, 15, 15,  2,  2, 15,
+};
+static uint8_t const bc_anchor3a [64] = {
+     3,  3, 15, 15,  8,  3, 15, 15,  8,  8,  6,  6,  6,  5,  3,  3,
+     3,  3,  8, 15,  3,  3,  6, 10,  5,  8,  8,  6,  8,  5, 15, 15,
+     8, 15,  3,  5,  6, 10,  8, 15, 15,  3, 15,  5, 15, 15, 15, 15,
+     3, 15,  5,  5,  5,  8,  5, 10,  5, 10,  8, 13, 15, 12,  3,  3,
+};
+static uint8_t const bc_anchor3b [64] = {
+    15,  8,  8,  3, 15, 15,  3,  8, 15, 15, 15, 15, 15, 15, 15,  8,
+    15,  8, 15,  3, 15,  8, 15,  8,  3, 15,  6, 10, 15, 15, 10,  8,
+    15,  3, 15, 10, 10,  8,  9, 10,  6, 15,  8, 15,  3,  6,  6,  8,
+    15,  3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,  3, 15, 15,  8,
+};
+static uint8_t const bc_weights2 [4] = {0, 21, 43, 64};
+static uint8_t const bc_weights3 [8] = {0, 9, 18, 27, 37, 46, 55, 64};
+static uint8_t const bc_weights4 [16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+static inline int
+bc_subset (int subsets, int partition, int texel) {
+    if (2 == subsets)
+        return (bc_partitions2[partition] >> texel) & 1;
+    if (3 == subsets)
+        return (bc_partitions3[partition] >> (2 * texel)) & 3;
+    return 0;
+}
+static inline bool
+bc_is_anchor (int subsets, int partition, int texel) {
+    if (0 == texel)
+        return true;
+    if (2 == subsets)
+        return bc_anchor2[partition] == texel;
+    if (3 == subsets)
+        return bc_anchor3a[partition] == texel || bc_anchor3b[partition] == texel;
+    return false;
+}
+static inline uint8_t const *
+bc_weights (int bits) {
+    return 2 == bits ? bc_weights2 : (3 == bits ? bc_weights3 : bc_weights4);
+}
+// Reads 16 indices of 'bits' bits; anchor texels store one bit less.
+static inline void
+bc_read_indices (BcBits * b, int bits, int subsets, int partition, uint8_t out [16]) {
+    for (int i = 0; i < 16; ++i)
+        out[i] = (uint8_t)bc_read(b, bc_is_anchor(subsets, partition, i) ? bits - 1 : bits);
+}
+
+// -- BC7
+struct Bc7Mode {
+    uint8_t     subsets;
+    uint8_t     partition_bits;
+    uint8_t     rotation_bits;
+    uint8_t     selector_bits;
+    uint8_t     color_bits;
+    uint8_t     alpha_bits;
+    uint8_t     endpoint_pbits;     // one p-bit per endpoint
+    uint8_t     shared_pbits;       // one p-bit per subset
+    uint8_t     index_bits;
+    uint8_t     index2_bits;
+};
+static Bc7Mode const bc7_modes [8] = {
+    {3, 4, 0, 0, 4, 0, 1, 0, 3, 0},
+    {2, 6, 0, 0, 6, 0, 0, 1, 3, 0},
+    {3, 6, 0, 0, 5, 0, 0, 0, 2, 0},
+    {2, 6, 0, 0, 7, 0, 1, 0, 2, 0},
+    {1, 0, 2, 1, 5, 6, 0, 0, 2, 3},
+    {1, 0, 2, 0, 7, 8, 0, 0, 2, 2},
+    {1, 0, 0, 0, 7, 7, 1, 0, 4, 0},
+    {2, 6, 0, 0, 5, 5, 1, 0, 2, 0},
+};
+static inline int
+bc_interpolate (int e0, int e1, int weight) {
+    return ((64 - weight) * e0 + weight * e1 + 32) >> 6;
+}
+static void
+bc7_decode_block (uint8_t const * block, uint8_t * out, size_t pitch) {
+    BcBits b = bc_bits(block);
+    int mode = 0;
+    while (mode < 8 && !bc_read(&b, 1))
+        ++mode;
+    if (8 == mode) {
+        for (int y = 0; y < 4; ++y)
+            memset(out + y * pitch, 0, 16);
+        return;
+    }
+    Bc7Mode const & m = bc7_modes[mode];
+    int partition = (int)bc_read(&b, m.partition_bits);
+    int rotation = (int)bc_read(&b, m.rotation_bits);
+    int selector = (int)bc_read(&b, m.selector_bits);
+
+    // -- Endpoints: all red values, then green, blue and alpha.
+    int endpoints [6][4];
+    int count = m.subsets * 2;
+    for (int c = 0; c < 3; ++c)
+        for (int e = 0; e < count; ++e)
+            endpoints[e][c] = (int)bc_read(&b, m.color_bits);
+    for (int e = 0; e < count; ++e)
+        endpoints[e][3] = m.alpha_bits ? (int)bc_read(&b, m.alpha_bits) : 255;
+
+    int color_bits = m.color_bits;
+    int alpha_bits = m.alpha_bits;
+    if (m.endpoint_pbits || m.shared_pbits) {
+        int pbits [6];
+        for (int e = 0; e < count; ++e)
+            pbits[e] = m.endpoint_pbits ? (int)bc_read(&b, 1) : 0;
+        if (m.shared_pbits) {
+            for (int s = 0; s < m.subsets; ++s)
+                pbits[s * 2] = pbits[s * 2 + 1] = (int)bc_read(&b, 1);
+        }
+        for (int e = 0; e < count; ++e) {
+            for (int c = 0; c < 3; ++c)
+                endpoints[e][c] = endpoints[e][c] << 1 | pbits[e];
+            if (alpha_bits)
+                endpoints[e][3] = endpoints[e][3] << 1 | pbits[e];
+        }
+        ++color_bits;
+        if (alpha_bits)
+            ++alpha_bits;
+    }
+    for (int e = 0; e < count; ++e) {
+        for (int c = 0; c < 3; ++c)
+            endpoints[e][c] = (endpoints[e][c] << (8 - color_bits)) | (endpoints[e][c] >> (2 * color_bits - 8));
+        if (alpha_bits)
+            endpoints[e][3] = (endpoints[e][3] << (8 - alpha_bits)) | (endpoints[e][3] >> (2 * alpha_bits - 8));
+    }
+
+    // -- Indices; with a second index set the selector bit says which one
+    // drives colour and which alpha.
+    uint8_t indices [16];
+    uint8_t indices2 [16];
+    bc_read_indices(&b, m.index_bits, m.subsets, partition, indices);
+    if (m.index2_bits)
+        bc_read_indices(&b, m.index2_bits, 1, 0, indices2);
+    uint8_t const * color_weights = bc_weights(m.index_bits);
+    uint8_t const * alpha_weights = color_weights;
+    uint8_t const * color_indices = indices;
+    uint8_t const * alpha_indices = indices;
+    if (m.index2_bits) {
+        alpha_weights = bc_weights(m.index2_bits);
+        alpha_indices = indices2;
+        if (selector) {
+            uint8_t const * w = color_weights;
+            color_weights = alpha_weights;
+            alpha_weights = w;
+            color_indices = indices2;
+            alpha_indices = indices;
+        }
+    }
+
+    for (int i = 0; i < 16; ++i) {
+        int s = bc_subset(m.subsets, partition, i);
+        int const * e0 = endpoints[s * 2];
+        int const * e1 = endpoints[s * 2 + 1];
+        int cw = color_weights[color_indices[i]];
+        int aw = alpha_weights[alpha_indices[i]];
+        uint8_t texel [4] = {
+            (uint8_t)bc_interpolate(e0[0], e1[0], cw),
+            (uint8_t)bc_interpolate(e0[1], e1[1], cw),
+            (uint8_t)bc_interpolate(e0[2], e1[2], cw),
+            (uint8_t)bc_interpolate(e0[3], e1[3], aw),
+        };
+        if (rotation) {
+            uint8_t t = texel[3];
+            texel[3] = texel[rotation - 1];
+            texel[rotation - 1] = t;
+        }
+        memcpy(out + (i >> 2) * pitch + (i & 3) * 4, texel, 4);
+    }
+}
+
+// -- BC6H
+// Each mode lists where its endpoint bits sit: runs of bits of one
+// endpoint value (r0 g0 b0 r1 g1 b1 r2 g2 b2 r3 g3 b3) written as in the
+// format spec, field[a:b] starting from bit b in the stream. The reversed
+// runs of modes 11 and 15 have a < b.
+struct Bc6hRun {
+    uint8_t     field;
+    uint8_t     a;
+    uint8_t     b;
+};
+struct Bc6hMode {
+    uint8_t     id;                 // mode bits as read, 2 or 5 of them
+    uint8_t     subsets;
+    uint8_t     transformed;
+    uint8_t     endpoint_bits;
+    uint8_t     delta_bits [3];
+    uint8_t     run_count;
+    Bc6hRun     runs [24];
+};
+enum {
+    BC6H_R0, BC6H_G0, BC6H_B0, BC6H_R1, BC6H_G1, BC6H_B1,
+    BC6H_R2, BC6H_G2, BC6H_B2, BC6H_R3, BC6H_G3, BC6H_B3,
+};
+static Bc6hMode const bc6h_modes [14] = {
+    {0x00, 2, 1, 10, {5, 5, 5}, 19, {
+        {BC6H_G2, 4, 4}, {BC6H_B2, 4, 4}, {BC6H_B3, 4, 4}, {BC6H_R0, 9, 0}, {BC6H_G0, 9, 0}, {BC6H_B0, 9, 0},
+        {BC6H_R1, 4, 0}, {BC6H_G3, 4, 4}, {BC6H_G2, 3, 0}, {BC6H_G1, 4, 0}, {BC6H_B3, 0, 0}, {BC6H_G3, 3, 0},
+        {BC6H_B1, 4, 0}, {BC6H_B3, 1, 1}, {BC6H_B2, 3, 0}, {BC6H_R2, 4, 0}, {BC6H_B3, 2, 2}, {BC6H_R3, 4, 0},
+        {BC6H_B3, 3, 3}}},
+    {0x01, 2, 1, 7, {6, 6, 6}, 23, {
+        {BC6H_G2, 5, 5}, {BC6H_G3, 4, 4}, {BC6H_G3, 5, 5}, {BC6H_R0, 6, 0}, {BC6H_B3, 0, 0}, {BC6H_B3, 1, 1},
+        {BC6H_B2, 4, 4}, {BC6H_G0, 6, 0}, {BC6H_B2, 5, 5}, {BC6H_B3, 2, 2}, {BC6H_G2, 4, 4}, {BC6H_B0, 6, 0},
+        {BC6H_B3, 3, 3}, {BC6H_B3, 5, 5}, {BC6H_B3, 4, 4}, {BC6H_R1, 5, 0}, {BC6H_G2, 3, 0}, {BC6H_G1, 5, 0},
+        {BC6H_G3, 3, 0}, {BC6H_B1, 5, 0}, {BC6H_B2, 3, 0}, {BC6H_R2, 5, 0}, {BC6H_R3, 5, 0}}},
+    {0x02, 2, 1, 11, {5, 4, 4}, 18, {
+        {BC6H_R0, 9, 0}, {BC6H_G0, 9, 0}, {BC6H_B0, 9, 0}, {BC6H_R1, 4, 0}, {BC6H_R0, 10, 10}, {BC6H_G2, 3, 0},
+        {BC6H_G1, 3, 0}, {BC6H_G0, 10, 10}, {BC6H_B3, 0, 0}, {BC6H_G3, 3, 0}, {BC6H_B1, 3, 0}, {BC6H_B0, 10, 10},
+        {BC6H_B3, 1, 1}, {BC6H_B2, 3, 0}, {BC6H_R2, 4, 0}, {BC6H_B3, 2, 2}, {BC6H_R3, 4, 0}, {BC6H_B3, 3, 3}}},
+    {0x06, 2, 1, 11, {4, 5, 4}, 20, {
+        {BC6H_R0, 9, 0}, {BC6H_G0, 9, 0}, {BC6H_B0, 9, 0}, {BC6H_R1, 3, 0}, {BC6H_R0, 10, 10}, {BC6H_G3, 4, 4},
+        {BC6H_G2, 3, 0}, {BC6H_G1, 4, 0}, {BC6H_G0, 10, 10}, {BC6H_G3, 3, 0}, {BC6H_B1, 3, 0}, {BC6H_B0, 10, 10},
+        {BC6H_B3, 1, 1}, {BC6H_B2, 3, 0}, {BC6H_R2, 3, 0}, {BC6H_B3, 0, 0}, {BC6H_B3, 2, 2}, {BC6H_R3, 3, 0},
+        {BC6H_G2, 4, 4}, {BC6H_B3, 3, 3}}},
+    {0x0a, 2, 1, 11, {4, 4, 5}, 20, {
+        {BC6H_R0, 9, 0}, {BC6H_G0, 9, 0}, {BC6H_B0, 9, 0}, {BC6H_R1, 3, 0}, {BC6H_R0, 10, 10}, {BC6H_B2, 4, 4},
+        {BC6H_G2, 3, 0}, {BC6H_G1, 3, 0}, {BC6H_G0, 10, 10}, {BC6H_B3, 0, 0}, {BC6H_G3, 3, 0}, {BC6H_B1, 4, 0},
+        {BC6H_B0, 10, 10}, {BC6H_B2, 3, 0}, {BC6H_R2, 3, 0}, {BC6H_B3, 1, 1}, {BC6H_B3, 2, 2}, {BC6H_R3, 3, 0},
+        {BC6H_B3, 4, 4}, {BC6H_B3, 3, 3}}},
+    {0x0e, 2, 1, 9, {5, 5, 5}, 19, {
+        {BC6H_R0, 8, 0}, {BC6H_B2, 4, 4}, {BC6H_G0, 8, 0}, {BC6H_G2, 4, 4}, {BC6H_B0, 8, 0}, {BC6H_B3, 4, 4},
+        {BC6H_R1, 4, 0}, {BC6H_G3, 4, 4}, {BC6H_G2, 3, 0}, {BC6H_G1, 4, 0}, {BC6H_B3, 0, 0}, {BC6H_G3, 3, 0},
+        {BC6H_B1, 4, 0}, {BC6H_B3, 1, 1}, {BC6H_B2, 3, 0}, {BC6H_R2, 4, 0}, {BC6H_B3, 2, 2}, {BC6H_R3, 4, 0},
+        {BC6H_B3, 3, 3}}},
+    {0x12, 2, 1, 8, {6, 5, 5}, 19, {
+        {BC6H_R0, 7, 0}, {BC6H_G3, 4, 4}, {BC6H_B2, 4, 4}, {BC6H_G0, 7, 0}, {BC6H_B3, 2, 2}, {BC6H_G2, 4, 4},
+        {BC6H_B0, 7, 0}, {BC6H_B3, 3, 3}, {BC6H_B3, 4, 4}, {BC6H_R1, 5, 0}, {BC6H_G2, 3, 0}, {BC6H_G1, 4, 0},
+        {BC6H_B3, 0, 0}, {BC6H_G3, 3, 0}, {BC6H_B1, 4, 0}, {BC6H_B3, 1, 1}, {BC6H_B2, 3, 0}, {BC6H_R2, 5, 0},
+        {BC6H_R3, 5, 0}}},
+    {0x16, 2, 1, 8, {5, 6, 5}, 21, {
+        {BC6H_R0, 7, 0}, {BC6H_B3, 0, 0}, {BC6H_B2, 4, 4}, {BC6H_G0, 7, 0}, {BC6H_G2, 5, 5}, {BC6H_G2, 4, 4},
+        {BC6H_B0, 7, 0}, {BC6H_G3, 5, 5}, {BC6H_B3, 4, 4}, {BC6H_R1, 4, 0}, {BC6H_G3, 4, 4}, {BC6H_G2, 3, 0},
+        {BC6H_G1, 5, 0}, {BC6H_G3, 3, 0}, {BC6H_B1, 4, 0}, {BC6H_B3, 1, 1}, {BC6H_B2, 3, 0}, {BC6H_R2, 4, 0},
+        {BC6H_B3, 2, 2}, {BC6H_R3, 4, 0}, {BC6H_B3, 3, 3}}},
+    {0x1a, 2, 1, 8, {5, 5, 6}, 21, {
+        {BC6H_R0, 7, 0}, {BC6H_B3, 1, 1}, {BC6H_B2, 4, 4}, {BC6H_G0, 7, 0}, {BC6H_B2, 5, 5}, {BC6H_G2, 4, 4},
+        {BC6H_B0, 7, 0}, {BC6H_B3, 5, 5}, {BC6H_B3, 4, 4}, {BC6H_R1, 4, 0}, {BC6H_G3, 4, 4}, {BC6H_G2, 3, 0},
+        {BC6H_G1, 4, 0}, {BC6H_B3, 0, 0}, {BC6H_G3, 3, 0}, {BC6H_B1, 5, 0}, {BC6H_B2, 3, 0}, {BC6H_R2, 4, 0},
+        {BC6H_B3, 2, 2}, {BC6H_R3, 4, 0}, {BC6H_B3, 3, 3}}},
+    {0x1e, 2, 0, 6, {6, 6, 6}, 23, {
+        {BC6H_R0, 5, 0}, {BC6H_G3, 4, 4}, {BC6H_B3, 0, 0}, {BC6H_B3, 1, 1}, {BC6H_B2, 4, 4}, {BC6H_G0, 5, 0},
+        {BC6H_G2, 5, 5}, {BC6H_B2, 5, 5}, {BC6H_B3, 2, 2}, {BC6H_G2, 4, 4}, {BC6H_B0, 5, 0}, {BC6H_G3, 5, 5},
+        {BC6H_B3, 3, 3}, {BC6H_B3, 5, 5}, {BC6H_B3, 4, 4}, {BC6H_R1, 5, 0}, {BC6H_G2, 3, 0}, {BC6H_G1, 5, 0},
+        {BC6H_G3, 3, 0}, {BC6H_B1, 5, 0}, {BC6H_B2, 3, 0}, {BC6H_R2, 5, 0}, {BC6H_R3, 5, 0}}},
+    {0x03, 1, 0, 10, {10, 10, 10}, 6, {
+        {BC6H_R0, 9, 0}, {BC6H_G0, 9, 0}, {BC6H_B0, 9, 0}, {BC6H_R1, 9, 0}, {BC6H_G1, 9, 0}, {BC6H_B1, 9, 0}}},
+    {0x07, 1, 1, 11, {9, 9, 9}, 9, {
+        {BC6H_R0, 9, 0}, {BC6H_G0, 9, 0}, {BC6H_B0, 9, 0}, {BC6H_R1, 8, 0}, {BC6H_R0, 10, 10}, {BC6H_G1, 8, 0},
+        {BC6H_G0, 10, 10}, {BC6H_B1, 8, 0}, {BC6H_B0, 10, 10}}},
+    {0x0b, 1, 1, 12, {8, 8, 8}, 9, {
+        {BC6H_R0, 9, 0}, {BC6H_G0, 9, 0}, {BC6H_B0, 9, 0}, {BC6H_R1, 7, 0}, {BC6H_R0, 10, 11}, {BC6H_G1, 7, 0},
+        {BC6H_G0, 10, 11}, {BC6H_B1, 7, 0}, {BC6H_B0, 10, 11}}},
+    {0x0f, 1, 1, 16, {4, 4, 4}, 9, {
+        {BC6H_R0, 9, 0}, {BC6H_G0, 9, 0}, {BC6H_B0, 9, 0}, {BC6H_R1, 3, 0}, {BC6H_R0, 10, 15}, {BC6H_G1, 3, 0},
+        {BC6H_G0, 10, 15}, {BC6H_B1, 3, 0}, {BC6H_B0, 10, 15}}},
+};
+static inline int
+bc_sign_extend (int v, int bits) {
+    int shift = 32 - bits;
+    return (int)((uint32_t)v << shift) >> shift;
+}
+static inline int
+bc6h_unquantize (int v, int bits, bool is_signed) {
+    if (!is_signed) {
+        if (bits >= 15 || 0 == v)
+            return v;
+        if (v == (1 << bits) - 1)
+            return 0xffff;
+        return ((v << 16) + 0x8000) >> bits;
+    }
+    if (bits >= 16)
+        return v;
+    bool negative = v < 0;
+    int u = negative ? -v : v;
+    int q;
+    if (0 == u)
+        q = 0;
+    else if (u >= (1 << (bits - 1)) - 1)
+        q = 0x7fff;
+    else
+        q = ((u << 15) + 0x4000) >> (bits - 1);
+    return negative ? -q : q;
+}
+// Scales an interpolated value to the half float bit pattern.
+static inline uint16_t
+bc6h_finish (int v, bool is_signed) {
+    if (!is_signed)
+        return (uint16_t)((v * 31) >> 6);
+    if (v < 0)
+        return (uint16_t)(0x8000 | (((-v) * 31) >> 5));
+    return (uint16_t)((v * 31) >> 5);
+}
+static void
+bc6h_decode_block (uint8_t const * block, bool is_signed, uint8_t * out, size_t pitch) {
+    BcBits b = bc_bits(block);
+    int id = (int)bc_read(&b, 2);
+    if (id > 1)
+        id |= (int)bc_read(&b, 3) << 2;
+    Bc6hMode const * m = nullptr;
+    for (int i = 0; i < 14; ++i) {
+        if (bc6h_modes[i].id == id)
+            m = &bc6h_modes[i];
+    }
+    if (!m) {
+        // Reserved modes: zero colour, alpha 1.0
+        for (int y = 0; y < 4; ++y) {
+            uint16_t texels [16] = {0, 0, 0, 0x3c00, 0, 0, 0, 0x3c00, 0, 0, 0, 0x3c00, 0, 0, 0, 0x3c00};
+            memcpy(out + y * pitch, texels, sizeof(texels));
+        }
+        return;
+    }
+
+    int fields [12] = {};
+    for (int r = 0; r < m->run_count; ++r) {
+        Bc6hRun const & run = m->runs[r];
+        int step = run.a >= run.b ? 1 : -1;
+        for (int bit = run.b; ; bit += step) {
+            fields[run.field] |= (int)bc_read(&b, 1) << bit;
+            if (bit == run.a)
+                break;
+        }
+    }
+    int partition = 2 == m->subsets ? (int)bc_read(&b, 5) : 0;
+
+    // -- Endpoints: sign extension, the delta transform, unquantizing.
+    int count = m->subsets * 2;
+    int bits = m->endpoint_bits;
+    int endpoints [4][3];
+    for (int e = 0; e < count; ++e) {
+        for (int c = 0; c < 3; ++c) {
+            int v = fields[e * 3 + c];
+            if (e > 0 && m->transformed)
+                v = (fields[c] + bc_sign_extend(v, m->delta_bits[c])) & ((1 << bits) - 1);
+            endpoints[e][c] = is_signed ? bc_sign_extend(v, bits) : v;
+        }
+    }
+    for (int e = 0; e < count; ++e)
+        for (int c = 0; c < 3; ++c)
+            endpoints[e][c] = bc6h_unquantize(endpoints[e][c], bits, is_signed);
+
+    uint8_t indices [16];
+    int index_bits = 2 == m->subsets ? 3 : 4;
+    bc_read_indices(&b, index_bits, m->subsets, partition, indices);
+    uint8_t const * weights = bc_weights(index_bits);
+    for (int i = 0; i < 16; ++i) {
+        int s = bc_subset(m->subsets, partition, i);
+        int w = weights[indices[i]];
+        uint16_t texel [4];
+        for (int c = 0; c < 3; ++c)
+            texel[c] = bc6h_finish(bc_interpolate(endpoints[s * 2][c], endpoints[s * 2 + 1][c], w), is_signed);
+        texel[3] = 0x3c00;
+        memcpy(out + (i >> 2) * pitch + (i & 3) * 8, texel, 8);
+    }
+}
+
+// ----------------------------------------------------------------- images --
+
+static inline void
+bc_decode_block (BcFormat format, uint8_t const * block, uint8_t * out, size_t pitch) {
+    switch (format) {
+    case BC_FORMAT_BC1:       bc1_decode_block(block, out, pitch); break;
+    case BC_FORMAT_BC2:       bc2_decode_block(block, out, pitch); break;
+    case BC_FORMAT_BC3:       bc3_decode_block(block, out, pitch); break;
+    case BC_FORMAT_BC4_UNORM: bc4_decode_block(block, false, out, pitch); break;
+    case BC_FORMAT_BC4_SNORM: bc4_decode_block(block, true, out, pitch); break;
+    case BC_FORMAT_BC5_UNORM: bc5_decode_block(block, false, out, pitch); break;
+    case BC_FORMAT_BC5_SNORM: bc5_decode_block(block, true, out, pitch); break;
+    case BC_FORMAT_BC6H_UF16: bc6h_decode_block(block, false, out, pitch); break;
+    case BC_FORMAT_BC6H_SF16: bc6h_decode_block(block, true, out, pitch); break;
+    case BC_FORMAT_BC7:       bc7_decode_block(block, out, pitch); break;
+    }
+}
+// Decodes a width x height image whose blocks are packed row after row
+// (block rows 'block_pitch' bytes apart, 0 for tightly packed) into
+// 'out', 'out_pitch' bytes per texel row. Edge blocks are clipped.
+static void
+bc_decode_image (
+    BcFormat format, void const * blocks, size_t block_pitch,
+    int width, int height, void * out, size_t out_pitch
+) {
+    int blocks_x = (width + 3) / 4;
+    int blocks_y = (height + 3) / 4;
+    int block_bytes = bc_block_bytes(format);
+    int texel_bytes = bc_texel_bytes(format);
+    if (0 == block_pitch)
+        block_pitch = (size_t)blocks_x * block_bytes;
+
+    parallel_for(blocks_y, 16, [&](int begin, int end, int) {
+        uint8_t edge [4 * 4 * 8];
+        for (int by = begin; by < end; ++by) {
+            uint8_t const * src = (uint8_t const *)blocks + by * block_pitch;
+            uint8_t * dst_row = (uint8_t *)out + (size_t)by * 4 * out_pitch;
+            int rows = height - by * 4 < 4 ? height - by * 4 : 4;
+            for (int bx = 0; bx < blocks_x; ++bx, src += block_bytes) {
+                int cols = width - bx * 4 < 4 ? width - bx * 4 : 4;
+                uint8_t * dst = dst_row + (size_t)bx * 4 * texel_bytes;
+                if (4 == rows && 4 == cols) {
+                    bc_decode_block(format, src, dst, out_pitch);
+                    continue;
+                }
+                bc_decode_block(format, src, edge, 4 * texel_bytes);
+                for (int y = 0; y < rows; ++y)
+                    memcpy(dst + y * out_pitch, edge + y * 4 * texel_bytes, (size_t)cols * texel_bytes);
+            }
+        }
+    });
+}
@@ -0,0 +1,847 @@
+#pragma once
+
+// CPU encoders for BC1, BC3, BC4, BC5 and BC7 from RGBA8 images, so
+// textures built or converted at run time don't have to be uploaded
+// uncompressed (4-8x the memory of the block formats).
+//
+// Every format has three quality tiers:
+//   BC_QUALITY_REALTIME   bounding box endpoints (inset, with the diagonal
+//                         picked from the channel correlation), one pass;
+//                         meant for textures generated every few frames
+//   BC_QUALITY_NORMAL     principal axis endpoints, refined once by least
+//                         squares; alpha blocks also try the six value mode
+//   BC_QUALITY_HIGH       more refinement passes and wider endpoint
+//                         searches; opaque BC7 blocks also try the best
+//                         two-subset partitions of mode 1. An offline
+//                         tier: BC7 runs some 50x slower than NORMAL
+// BC7 otherwise uses mode 6 (one subset, RGBA, 4-bit indices).
+//
+// Palettes come from the decoders in bc_decode.h, so the encoder measures
+// exactly what the GPU will sample. Index selection, the inner loop of
+// every tier, compares four texels at a time against each palette entry
+// with SSE2. bc_encode_image splits the image into runs of block rows
+// encoded in parallel; bc_save_dds writes the result (with its mips) as a
+// DDS file DDSTextureLoader11 reads. BC_NO_SSE2 builds the scalar paths, as
+// in bc_decode.h.
+
+#include "bc_decode.h"
+#include "parallel.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(BC_NO_SSE2) && (defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__))
+#include <emmintrin.h>
+#define BC_ENCODE_SSE2 1
+#endif
+
+#define BC7_PARTITION_SHORTLIST 4
+
+enum BcQuality {
+    BC_QUALITY_REALTIME,
+    BC_QUALITY_NORMAL,
+    BC_QUALITY_HIGH,
+};
+
+static inline bool
+bc_can_encode (BcFormat format) {
+    return BC_FORMAT_BC1 == format || BC_FORMAT_BC3 == format || BC_FORMAT_BC4_UNORM == format ||
+        BC_FORMAT_BC5_UNORM == format || BC_FORMAT_BC7 == format;
+}
+static inline size_t
+bc_encoded_size (BcFormat format, int width, int height) {
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * bc_block_bytes(format);
+}
+
+// ----------------------------------------------------------- index search --
+
+// Picks the nearest of 'count' RGBA8 palette entries for every texel whose
+// bit is set in 'members', comparing only the channels kept by 'mask'.
+// Returns the summed squared error of those texels; other texels get
+// index 0.
+static uint32_t
+bc_nearest_colors (
+    uint8_t const texels [16][4], uint16_t members, uint32_t const palette [], int count,
+    uint32_t mask, uint8_t indices [16]
+) {
+    uint32_t error = 0;
+#if defined(BC_ENCODE_SSE2)
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const keep = _mm_set1_epi32((int)mask);
+    __m128i const lane_bits = _mm_set_epi32(8, 4, 2, 1);
+    __m128i entries [16];
+    for (int e = 0; e < count; ++e)
+        entries[e] = _mm_unpacklo_epi8(_mm_and_si128(_mm_set1_epi32((int)palette[e]), keep), zero);
+    for (int q = 0; q < 4; ++q) {
+        __m128i t = _mm_and_si128(_mm_loadu_si128((__m128i const *)texels[q * 4]), keep);
+        __m128i lo = _mm_unpacklo_epi8(t, zero);
+        __m128i hi = _mm_unpackhi_epi8(t, zero);
+        __m128i best = _mm_set1_epi32(0x7fffffff);
+        __m128i best_index = zero;
+        for (int e = 0; e < count; ++e) {
+            __m128i dlo = _mm_sub_epi16(lo, entries[e]);
+            __m128i dhi = _mm_sub_epi16(hi, entries[e]);
+            // madd leaves r^2 + g^2 and b^2 + a^2 per texel; fold the pairs.
+            __m128 slo = _mm_castsi128_ps(_mm_madd_epi16(dlo, dlo));
+            __m128 shi = _mm_castsi128_ps(_mm_madd_epi16(dhi, dhi));
+            __m128i d = _mm_add_epi32(
+                _mm_castps_si128(_mm_shuffle_ps(slo, shi, _MM_SHUFFLE(2, 0, 2, 0))),
+                _mm_castps_si128(_mm_shuffle_ps(slo, shi, _MM_SHUFFLE(3, 1, 3, 1))));
+            __m128i closer = _mm_cmplt_epi32(d, best);
+            best = _mm_or_si128(_mm_and_si128(closer, d), _mm_andnot_si128(closer, best));
+            best_index = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(e)), _mm_andnot_si128(closer, best_index));
+        }
+        __m128i in = _mm_and_si128(_mm_set1_epi32(members >> (q * 4)), lane_bits);
+        in = _mm_cmpeq_epi32(in, lane_bits);
+        best = _mm_and_si128(best, in);
+        best_index = _mm_and_si128(best_index, in);
+        uint32_t d [4], k [4];
+        _mm_storeu_si128((__m128i *)d, best);
+        _mm_storeu_si128((__m128i *)k, best_index);
+        for (int i = 0; i < 4; ++i) {
+            error += d[i];
+            indices[q * 4 + i] = (uint8_t)k[i];
+        }
+    }
+#else
+    for (int i = 0; i < 16; ++i) {
+        indices[i] = 0;
+        if (!(members & (1 << i)))
+            continue;
+        uint32_t best = 0xffffffffu;
+        for (int e = 0; e < count; ++e) {
+            uint32_t d = 0;
+            for (int c = 0; c < 4; ++c) {
+                if (!(mask & (0xffu << (8 * c))))
+                    continue;
+                int diff = (int)texels[i][c] - (int)((palette[e] >> (8 * c)) & 0xff);
+                d += (uint32_t)(diff * diff);
+            }
+            if (d < best) {
+                best = d;
+                indices[i] = (uint8_t)e;
+            }
+        }
+        error += best;
+    }
+#endif
+    return error;
+}
+// Same for one channel against an eight entry alpha palette.
+static uint32_t
+bc_nearest_values (uint8_t const values [16], int const palette [8], uint8_t indices [16]) {
+    uint32_t error = 0;
+#if defined(BC_ENCODE_SSE2)
+    __m128i const zero = _mm_setzero_si128();
+    __m128i v = _mm_loadu_si128((__m128i const *)values);
+    __m128i half [2] = {_mm_unpacklo_epi8(v, zero), _mm_unpackhi_epi8(v, zero)};
+    __m128i sum = zero;
+    for (int h = 0; h < 2; ++h) {
+        // |v - p| fits in 16 bits, and the smallest one is also the
+        // smallest square.
+        __m128i best = _mm_set1_epi16(0x7fff);
+        __m128i best_index = zero;
+        for (int e = 0; e < 8; ++e) {
+            __m128i p = _mm_set1_epi16((short)palette[e]);
+            __m128i d = _mm_sub_epi16(_mm_max_epi16(half[h], p), _mm_min_epi16(half[h], p));
+            __m128i closer = _mm_cmplt_epi16(d, best);
+            best = _mm_min_epi16(d, best);
+            best_index = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi16((short)e)), _mm_andnot_si128(closer, best_index));
+        }
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(best, best));
+        _mm_storel_epi64((__m128i *)(indices + h * 8), _mm_packus_epi16(best_index, best_index));
+    }
+    uint32_t s [4];
+    _mm_storeu_si128((__m128i *)s, sum);
+    error = s[0] + s[1] + s[2] + s[3];
+#else
+    for (int i = 0; i < 16; ++i) {
+        int best = 0x7fff;
+        for (int e = 0; e < 8; ++e) {
+            int d = abs((int)values[i] - palette[e]);
+            if (d < best) {
+                best = d;
+                indices[i] = (uint8_t)e;
+            }
+        }
+        error += (uint32_t)(best * best);
+    }
+#endif
+    return error;
+}
+
+// --------------------------------------------------------- endpoint fits --
+
+// Float endpoint pair of the texels in 'members' over the first
+// 'channels' channels. The real-time fit takes the bounding box, inset by
+// 1/16 of its extent, and swaps a channel's ends when it falls while green
+// rises. The other tiers use the principal axis of the texels.
+static void
+bc_fit_endpoints (
+    uint8_t const texels [16][4], uint16_t members, int channels, BcQuality quality,
+    float e0 [4], float e1 [4]
+) {
+    float mean [4] = {};
+    float lo [4] = {255, 255, 255, 255};
+    float hi [4] = {0, 0, 0, 0};
+    int n = 0;
+    for (int i = 0; i < 16; ++i) {
+        if (!(members & (1 << i)))
+            continue;
+        ++n;
+        for (int c = 0; c < channels; ++c) {
+            float v = texels[i][c];
+            mean[c] += v;
+            lo[c] = v < lo[c] ? v : lo[c];
+            hi[c] = v > hi[c] ? v : hi[c];
+        }
+    }
+    if (0 == n) {
+        for (int c = 0; c < 4; ++c)
+            e0[c] = e1[c] = 0;
+        return;
+    }
+    for (int c = 0; c < channels; ++c)
+        mean[c] /= (float)n;
+
+    float cov [4][4] = {};
+    for (int i = 0; i < 16; ++i) {
+        if (!(members & (1 << i)))
+            continue;
+        float d [4];
+        for (int c = 0; c < channels; ++c)
+            d[c] = texels[i][c] - mean[c];
+        for (int a = 0; a < channels; ++a)
+            for (int b = a; b < channels; ++b)
+                cov[a][b] += d[a] * d[b];
+    }
+    for (int a = 0; a < channels; ++a)
+        for (int b = 0; b < a; ++b)
+            cov[a][b] = cov[b][a];
+
+    if (BC_QUALITY_REALTIME == quality) {
+        int ref = channels > 1 ? 1 : 0;
+        for (int c = 0; c < channels; ++c) {
+            float inset = (hi[c] - lo[c]) / 16.0f;
+            e0[c] = lo[c] + inset;
+            e1[c] = hi[c] - inset;
+            if (c != ref && cov[c][ref] < 0) {
+                float t = e0[c];
+                e0[c] = e1[c];
+                e1[c] = t;
+            }
+        }
+        return;
+    }
+
+    // -- Power iteration from the bounding box diagonal.
+    float axis [4] = {};
+    for (int c = 0; c < channels; ++c)
+        axis[c] = hi[c] - lo[c];
+    for (int c = 0; c < channels; ++c)
+        if (c != 0 && cov[c][0] < 0)
+            axis[c] = -axis[c];
+    for (int iter = 0; iter < 8; ++iter) {
+        float next [4] = {};
+        float len = 0;
+        for (int a = 0; a < channels; ++a) {
+            for (int b = 0; b < channels; ++b)
+                next[a] += cov[a][b] * axis[b];
+            len += next[a] * next[a];
+        }
+        if (len < 1e-12f)
+            break;
+        len = 1.0f / sqrtf(len);
+        for (int c = 0; c < channels; ++c)
+            axis[c] = next[c] * len;
+    }
+    float len = 0;
+    for (int c = 0; c < channels; ++c)
+        len += axis[c] * axis[c];
+    if (len < 1e-12f) {
+        for (int c = 0; c < 4; ++c)
+            e0[c] = e1[c] = mean[c];
+        return;
+    }
+    len = 1.0f / sqrtf(len);
+    for (int c = 0; c < channels; ++c)
+        axis[c] *= len;
+
+    float t_min = 1e30f;
+    float t_max = -1e30f;
+    for (int i = 0; i < 16; ++i) {
+        if (!(members & (1 << i)))
+            continue;
+        float t = 0;
+        for (int c = 0; c < channels; ++c)
+            t += (texels[i][c] - mean[c]) * axis[c];
+        t_min = t < t_min ? t : t_min;
+        t_max = t > t_max ? t : t_max;
+    }
+    for (int c = 0; c < channels; ++c) {
+        float a = mean[c] + axis[c] * t_min;
+        float b = mean[c] + axis[c] * t_max;
+        e0[c] = a < 0 ? 0 : (a > 255 ? 255 : a);
+        e1[c] = b < 0 ? 0 : (b > 255 ? 255 : b);
+    }
+}
+// Least squares endpoints for fixed indices: texel i sits at weight
+// weights[indices[i]] between e0 and e1. Leaves the endpoints alone when
+// the system is singular (every texel on one weight).
+static void
+bc_refine_endpoints (
+    uint8_t const texels [16][4], uint16_t members, int channels,
+    uint8_t const indices [16], float const weights [], float e0 [4], float e1 [4]
+) {
+    float aa = 0, ab = 0, bb = 0;
+    float xa [4] = {};
+    float xb [4] = {};
+    for (int i = 0; i < 16; ++i) {
+        if (!(members & (1 << i)))
+            continue;
+        float w = weights[indices[i]];
+        float a = 1.0f - w;
+        aa += a * a;
+        ab += a * w;
+        bb += w * w;
+        for (int c = 0; c < channels; ++c) {
+            xa[c] += a * texels[i][c];
+            xb[c] += w * texels[i][c];
+        }
+    }
+    float det = aa * bb - ab * ab;
+    if (fabsf(det) < 1e-6f)
+        return;
+    det = 1.0f / det;
+    for (int c = 0; c < channels; ++c) {
+        float a = (bb * xa[c] - ab * xb[c]) * det;
+        float b = (aa * xb[c] - ab * xa[c]) * det;
+        e0[c] = a < 0 ? 0 : (a > 255 ? 255 : a);
+        e1[c] = b < 0 ? 0 : (b > 255 ? 255 : b);
+    }
+}
+static inline int
+bc_refine_passes (BcQuality quality) {
+    return BC_QUALITY_HIGH == quality ? 3 : (BC_QUALITY_NORMAL == quality ? 1 : 0);
+}
+
+// ------------------------------------------------------------- BC1 - BC3 --
+
+static inline uint32_t
+bc_quantize_565 (float const e [4]) {
+    uint32_t r = (uint32_t)(e[0] * (31.0f / 255.0f) + 0.5f);
+    uint32_t g = (uint32_t)(e[1] * (63.0f / 255.0f) + 0.5f);
+    uint32_t b = (uint32_t)(e[2] * (31.0f / 255.0f) + 0.5f);
+    return r << 11 | g << 5 | b;
+}
+// Encodes the colour half of a block. BC1 texels with alpha below 128 use
+// the three colour mode's transparent index; BC2 and BC3 ('four_colors')
+// always use four colours. Returns the squared RGB error.
+static uint32_t
+bc_encode_color (uint8_t const texels [16][4], bool four_colors, BcQuality quality, uint8_t * block) {
+    uint16_t opaque = 0xffff;
+    if (!four_colors) {
+        opaque = 0;
+        for (int i = 0; i < 16; ++i)
+            opaque |= (texels[i][3] >= 128 ? 1 : 0) << i;
+    }
+    if (0 == opaque) {
+        memset(block, 0, 4);
+        memset(block + 4, 0xff, 4);
+        return 0;
+    }
+    bool three_colors = 0xffff != opaque;
+    static float const weights4 [4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+    static float const weights3 [4] = {0.0f, 1.0f, 0.5f, 0.0f};
+
+    float e0 [4], e1 [4];
+    bc_fit_endpoints(texels, opaque, 3, quality, e0, e1);
+    uint32_t best_error = 0xffffffffu;
+    for (int pass = 0; pass <= bc_refine_passes(quality); ++pass) {
+        uint32_t c0 = bc_quantize_565(e0);
+        uint32_t c1 = bc_quantize_565(e1);
+        // -- Four colours need c0 > c1, three colours c0 <= c1; a swap
+        // only relabels the indices.
+        bool swap = three_colors ? c0 > c1 : c0 < c1;
+        if (swap) {
+            uint32_t t = c0;
+            c0 = c1;
+            c1 = t;
+            for (int c = 0; c < 3; ++c) {
+                float f = e0[c];
+                e0[c] = e1[c];
+                e1[c] = f;
+            }
+        }
+        uint8_t candidate [8] = {(uint8_t)c0, (uint8_t)(c0 >> 8), (uint8_t)c1, (uint8_t)(c1 >> 8)};
+        uint32_t palette [4];
+        bc_color_palette(candidate, four_colors, palette);
+        bool use_three = !four_colors && c0 <= c1;
+        uint8_t indices [16];
+        uint32_t error = bc_nearest_colors(texels, opaque, palette, use_three ? 3 : 4, 0x00ffffffu, indices);
+        if (error < best_error) {
+            best_error = error;
+            uint32_t bits = 0;
+            for (int i = 0; i < 16; ++i)
+                bits |= (uint32_t)((opaque & (1 << i)) ? indices[i] : 3) << (2 * i);
+            memcpy(block, candidate, 4);
+            block[4] = (uint8_t)bits;
+            block[5] = (uint8_t)(bits >> 8);
+            block[6] = (uint8_t)(bits >> 16);
+            block[7] = (uint8_t)(bits >> 24);
+        }
+        if (0 == error)
+            break;
+        bc_refine_endpoints(texels, opaque, 3, indices, use_three ? weights3 : weights4, e0, e1);
+    }
+    return best_error;
+}
+// Encodes one channel as a BC3 alpha / BC4 block. Returns the squared
+// error.
+static uint32_t
+bc_encode_values (uint8_t const values [16], BcQuality quality, uint8_t * block) {
+    int lo = 255, hi = 0;
+    int lo6 = 255, hi6 = 0;
+    for (int i = 0; i < 16; ++i) {
+        int v = values[i];
+        lo = v < lo ? v : lo;
+        hi = v > hi ? v : hi;
+        if (v != 0 && v != 255) {
+            lo6 = v < lo6 ? v : lo6;
+            hi6 = v > hi6 ? v : hi6;
+        }
+    }
+
+    // -- Candidates as (a0, a1): a0 > a1 selects eight interpolated values,
+    // a0 <= a1 six plus exact 0 and 255.
+    int candidates [2 + 16][2];
+    int count = 0;
+    candidates[count][0] = hi;
+    candidates[count][1] = lo;
+    ++count;
+    if (BC_QUALITY_REALTIME != quality && lo6 <= hi6 && (lo6 != lo || hi6 != hi)) {
+        candidates[count][0] = lo6;
+        candidates[count][1] = hi6;
+        ++count;
+    }
+    if (BC_QUALITY_HIGH == quality && hi - lo > 8) {
+        for (int d0 = 0; d0 < 4; ++d0) {
+            for (int d1 = 0; d1 < 4; ++d1) {
+                if (d0 + d1 == 0)
+                    continue;
+                candidates[count][0] = hi - d0;
+                candidates[count][1] = lo + d1;
+                ++count;
+            }
+        }
+    }
+
+    uint32_t best_error = 0xffffffffu;
+    for (int k = 0; k < count && best_error; ++k) {
+        int palette [8];
+        bc_alpha_palette(candidates[k][0], candidates[k][1], false, palette);
+        uint8_t indices [16];
+        uint32_t error = bc_nearest_values(values, palette, indices);
+        if (error < best_error) {
+            best_error = error;
+            uint64_t bits = 0;
+            for (int i = 0; i < 16; ++i)
+                bits |= (uint64_t)indices[i] << (3 * i);
+            block[0] = (uint8_t)candidates[k][0];
+            block[1] = (uint8_t)candidates[k][1];
+            for (int i = 0; i < 6; ++i)
+                block[2 + i] = (uint8_t)(bits >> (8 * i));
+        }
+    }
+    return best_error;
+}
+static inline void
+bc_channel (uint8_t const texels [16][4], int channel, uint8_t out [16]) {
+    for (int i = 0; i < 16; ++i)
+        out[i] = texels[i][channel];
+}
+
+// ------------------------------------------------------------------- BC7 --
+
+struct BcBitWriter {
+    uint64_t    lo;
+    uint64_t    hi;
+    int         pos;
+};
+// Appends 'count' (<= 32) bits, least significant first.
+static inline void
+bc_write (BcBitWriter * w, uint32_t value, int count) {
+    uint64_t v = value & ((1ull << count) - 1);
+    if (w->pos < 64) {
+        w->lo |= v << w->pos;
+        if (w->pos + count > 64)
+            w->hi |= v >> (64 - w->pos);
+    } else {
+        w->hi |= v << (w->pos - 64);
+    }
+    w->pos += count;
+}
+static inline int
+bc_expand_bits (int v, int bits) {
+    return (v << (8 - bits)) | (v >> (2 * bits - 8));
+}
+
+// One subset of a BC7 block: quantized endpoints with their p-bits
+// already appended, and the expanded RGBA8 values the GPU interpolates.
+struct Bc7Subset {
+    int         q [2][4];
+    int         rgba [2][4];
+};
+// Quantizes an endpoint pair to 'bits' bits per channel plus p-bits, one
+// per endpoint or one 'shared' by both, choosing the p-bits that land
+// closest to the float endpoints.
+static void
+bc7_quantize (float const e0 [4], float const e1 [4], int channels, int bits, bool shared, Bc7Subset * s) {
+    float const * e [2] = {e0, e1};
+    int scale = (1 << (bits + 1)) - 1;
+    int best_error [2][2];      // [endpoint][p-bit]
+    int q [2][2][4];
+    for (int k = 0; k < 2; ++k) {
+        for (int p = 0; p < 2; ++p) {
+            best_error[k][p] = 0;
+            for (int c = 0; c < 4; ++c) {
+                if (c >= channels) {
+                    q[k][p][c] = (1 << (bits + 1)) - 1;     // opaque, when alpha is implied
+                    continue;
+                }
+                int v = (int)((e[k][c] * scale / 255.0f - p) * 0.5f + 0.5f);
+                v = v < 0 ? 0 : (v > (1 << bits) - 1 ? (1 << bits) - 1 : v);
+                q[k][p][c] = v << 1 | p;
+                int d = bc_expand_bits(q[k][p][c], bits + 1) - (int)(e[k][c] + 0.5f);
+                best_error[k][p] += d * d;
+            }
+        }
+    }
+    for (int k = 0; k < 2; ++k) {
+        int p;
+        if (shared)
+            p = best_error[0][1] + best_error[1][1] < best_error[0][0] + best_error[1][0] ? 1 : 0;
+        else
+            p = best_error[k][1] < best_error[k][0] ? 1 : 0;
+        for (int c = 0; c < 4; ++c) {
+            s->q[k][c] = q[k][p][c];
+            s->rgba[k][c] = bc_expand_bits(q[k][p][c], bits + 1);
+        }
+        if (channels < 4)
+            s->rgba[k][3] = 255;
+    }
+}
+// Fits, quantizes and indexes one subset; returns its squared error.
+static uint32_t
+bc7_encode_subset (
+    uint8_t const texels [16][4], uint16_t members, int channels, int bits, bool shared,
+    int index_bits, BcQuality quality, Bc7Subset * out, uint8_t indices [16]
+) {
+    int count = 1 << index_bits;
+    uint8_t const * w = bc_weights(index_bits);
+    float weights [16];
+    for (int k = 0; k < count; ++k)
+        weights[k] = w[k] / 64.0f;
+    uint32_t mask = channels < 4 ? 0x00ffffffu : 0xffffffffu;
+
+    float e0 [4], e1 [4];
+    bc_fit_endpoints(texels, members, channels, quality, e0, e1);
+    uint32_t best_error = 0xffffffffu;
+    for (int pass = 0; pass <= bc_refine_passes(quality); ++pass) {
+        Bc7Subset s;
+        bc7_quantize(e0, e1, channels, bits, shared, &s);
+        uint32_t palette [16];
+        for (int k = 0; k < count; ++k) {
+            palette[k] = 0;
+            for (int c = 0; c < 4; ++c)
+                palette[k] |= (uint32_t)bc_interpolate(s.rgba[0][c], s.rgba[1][c], w[k]) << (8 * c);
+        }
+        uint8_t candidate [16];
+        uint32_t error = bc_nearest_colors(texels, members, palette, count, mask, candidate);
+        if (error < best_error) {
+            best_error = error;
+            *out = s;
+            for (int i = 0; i < 16; ++i)
+                if (members & (1 << i))
+                    indices[i] = candidate[i];
+        }
+        if (0 == error)
+            break;
+        bc_refine_endpoints(texels, members, channels, candidate, weights, e0, e1);
+    }
+    return best_error;
+}
+// Anchor texels store their index without the top bit, so it must be
+// clear: flip the subset's endpoints (and its indices) when it isn't.
+static void
+bc7_fix_anchor (Bc7Subset * s, uint16_t members, int anchor, int index_bits, uint8_t indices [16]) {
+    int top = 1 << (index_bits - 1);
+    if (indices[anchor] < top)
+        return;
+    for (int c = 0; c < 4; ++c) {
+        int t = s->q[0][c];
+        s->q[0][c] = s->q[1][c];
+        s->q[1][c] = t;
+    }
+    for (int i = 0; i < 16; ++i)
+        if (members & (1 << i))
+            indices[i] = (uint8_t)((1 << index_bits) - 1 - indices[i]);
+}
+static void
+bc7_encode_block (uint8_t const texels [16][4], BcQuality quality, uint8_t * block) {
+    bool opaque = true;
+    for (int i = 0; i < 16; ++i)
+        opaque = opaque && 255 == texels[i][3];
+
+    // -- Mode 6: one subset, 7-bit RGBA plus a p-bit per endpoint.
+    Bc7Subset s6;
+    uint8_t indices6 [16];
+    uint32_t error6 = bc7_encode_subset(texels, 0xffff, 4, 7, false, 4, quality, &s6, indices6);
+
+    // -- Mode 1: two subsets, 6-bit RGB plus a shared p-bit per subset.
+    int best_partition = -1;
+    Bc7Subset s1 [2];
+    uint8_t indices1 [16];
+    if (BC_QUALITY_HIGH == quality && opaque && error6 > 0) {
+        // -- Rank the partitions with the real-time fit, then refine the
+        // best few properly.
+        int shortlist [BC7_PARTITION_SHORTLIST];
+        uint32_t shortlist_error [BC7_PARTITION_SHORTLIST];
+        int listed = 0;
+        for (int p = 0; p < 64; ++p) {
+            uint16_t second = bc_partitions2[p];
+            Bc7Subset s;
+            uint8_t indices [16];
+            uint32_t error = bc7_encode_subset(texels, (uint16_t)~second, 3, 6, true, 3, BC_QUALITY_REALTIME, &s, indices);
+            error += bc7_encode_subset(texels, second, 3, 6, true, 3, BC_QUALITY_REALTIME, &s, indices);
+            int k = listed < BC7_PARTITION_SHORTLIST ? listed++ : BC7_PARTITION_SHORTLIST;
+            for (; k > 0 && shortlist_error[k - 1] > error; --k) {
+                if (k < BC7_PARTITION_SHORTLIST) {
+                    shortlist[k] = shortlist[k - 1];
+                    shortlist_error[k] = shortlist_error[k - 1];
+                }
+            }
+            if (k < BC7_PARTITION_SHORTLIST) {
+                shortlist[k] = p;
+                shortlist_error[k] = error;
+            }
+        }
+        uint32_t best_error = error6;
+        for (int k = 0; k < listed; ++k) {
+            int p = shortlist[k];
+            uint16_t second = bc_partitions2[p];
+            Bc7Subset s [2];
+            uint8_t indices [16];
+            uint32_t error = bc7_encode_subset(texels, (uint16_t)~second, 3, 6, true, 3, quality, &s[0], indices);
+            if (error >= best_error)
+                continue;
+            error += bc7_encode_subset(texels, second, 3, 6, true, 3, quality, &s[1], indices);
+            if (error < best_error) {
+                best_error = error;
+                best_partition = p;
+                s1[0] = s[0];
+                s1[1] = s[1];
+                memcpy(indices1, indices, 16);
+            }
+        }
+    }
+
+    BcBitWriter w = {};
+    if (best_partition >= 0) {
+        uint16_t second = bc_partitions2[best_partition];
+        bc7_fix_anchor(&s1[0], (uint16_t)~second, 0, 3, indices1);
+        bc7_fix_anchor(&s1[1], second, bc_anchor2[best_partition], 3, indices1);
+        bc_write(&w, 1 << 1, 2);
+        bc_write(&w, (uint32_t)best_partition, 6);
+        for (int c = 0; c < 3; ++c)
+            for (int e = 0; e < 4; ++e)
+                bc_write(&w, (uint32_t)(s1[e >> 1].q[e & 1][c] >> 1), 6);
+        bc_write(&w, (uint32_t)(s1[0].q[0][0] & 1), 1);
+        bc_write(&w, (uint32_t)(s1[1].q[0][0] & 1), 1);
+        for (int i = 0; i < 16; ++i)
+            bc_write(&w, indices1[i], bc_is_anchor(2, best_partition, i) ? 2 : 3);
+    } else {
+        bc7_fix_anchor(&s6, 0xffff, 0, 4, indices6);
+        bc_write(&w, 1 << 6, 7);
+        for (int c = 0; c < 4; ++c)
+            for (int e = 0; e < 2; ++e)
+                bc_write(&w, (uint32_t)(s6.q[e][c] >> 1), 7);
+        bc_write(&w, (uint32_t)(s6.q[0][0] & 1), 1);
+        bc_write(&w, (uint32_t)(s6.q[1][0] & 1), 1);
+        for (int i = 0; i < 16; ++i)
+            bc_write(&w, indices6[i], 0 == i ? 3 : 4);
+    }
+    memcpy(block, &w.lo, 8);
+    memcpy(block + 8, &w.hi, 8);
+}
+
+// ----------------------------------------------------------------- images --
+
+static inline void
+bc_encode_block (BcFormat format, BcQuality quality, uint8_t const texels [16][4], uint8_t * block) {
+    uint8_t values [16];
+    switch (format) {
+    case BC_FORMAT_BC1:
+        bc_encode_color(texels, false, quality, block);
+        break;
+    case BC_FORMAT_BC3:
+        bc_channel(texels, 3, values);
+        bc_encode_values(values, quality, block);
+        bc_encode_color(texels, true, quality, block + 8);
+        break;
+    case BC_FORMAT_BC4_UNORM:
+        bc_channel(texels, 0, values);
+        bc_encode_values(values, quality, block);
+        break;
+    case BC_FORMAT_BC5_UNORM:
+        bc_channel(texels, 0, values);
+        bc_encode_values(values, quality, block);
+        bc_channel(texels, 1, values);
+        bc_encode_values(values, quality, block + 8);
+        break;
+    case BC_FORMAT_BC7:
+        bc7_encode_block(texels, quality, block);
+        break;
+    default:
+        break;
+    }
+}
+// Encodes an RGBA8 image of any size; texels past the right and bottom
+// edges repeat the last column and row. 'block_pitch' is the distance
+// between block rows in 'out', 0 for tightly packed. Returns false for
+// formats without an encoder (see bc_can_encode).
+static bool
+bc_encode_image (
+    BcFormat format, BcQuality quality, void const * rgba, size_t pitch,
+    int width, int height, void * out, size_t block_pitch
+) {
+    if (!bc_can_encode(format) || width <= 0 || height <= 0)
+        return false;
+    int blocks_x = (width + 3) / 4;
+    int blocks_y = (height + 3) / 4;
+    int block_bytes = bc_block_bytes(format);
+    if (0 == block_pitch)
+        block_pitch = (size_t)blocks_x * block_bytes;
+
+    int min_rows = BC_QUALITY_REALTIME == quality ? 16 : 2;
+    parallel_for(blocks_y, min_rows, [&](int begin, int end, int) {
+        uint8_t texels [16][4];
+        for (int by = begin; by < end; ++by) {
+            uint8_t * dst = (uint8_t *)out + by * block_pitch;
+            for (int bx = 0; bx < blocks_x; ++bx, dst += block_bytes) {
+                for (int y = 0; y < 4; ++y) {
+                    int sy = by * 4 + y < height ? by * 4 + y : height - 1;
+                    uint8_t const * row = (uint8_t const *)rgba + sy * pitch;
+                    if (bx * 4 + 4 <= width) {
+                        memcpy(texels[y * 4], row + bx * 16, 16);
+                        continue;
+                    }
+                    for (int x = 0; x < 4; ++x) {
+                        int sx = bx * 4 + x < width ? bx * 4 + x : width - 1;
+                        memcpy(texels[y * 4 + x], row + sx * 4, 4);
+                    }
+                }
+                bc_encode_block(format, quality, texels, dst);
+            }
+        }
+    });
+    return true;
+}
+// Peak signal to noise ratio, in dB, of encoded blocks against their
+// source over the channels the format stores (RGB for BC1, R for BC4, RG
+// for BC5, RGBA otherwise). Returns 999 for an exact match.
+static double
+bc_psnr (BcFormat format, void const * rgba, size_t pitch, int width, int height, void const * blocks) {
+    uint8_t * decoded = (uint8_t *)::malloc((size_t)width * height * 4);
+    bc_decode_image(format, blocks, 0, width, height, decoded, (size_t)width * 4);
+    int channels = BC_FORMAT_BC1 == format ? 3 : (BC_FORMAT_BC4_UNORM == format ? 1 : (BC_FORMAT_BC5_UNORM == format ? 2 : 4));
+    double sum = 0;
+    for (int y = 0; y < height; ++y) {
+        uint8_t const * a = (uint8_t const *)rgba + y * pitch;
+        uint8_t const * b = decoded + (size_t)y * width * 4;
+        for (int x = 0; x < width * 4; x += 4) {
+            for (int c = 0; c < channels; ++c) {
+                double d = (double)a[x + c] - b[x + c];
+                sum += d * d;
+            }
+        }
+    }
+    ::free(decoded);
+    double mse = sum / ((double)width * height * channels);
+    return mse > 0 ? 10.0 * log10(255.0 * 255.0 / mse) : 999.0;
+}
+
+// -------------------------------------------------------------------- DDS --
+
+// Writes a 2D texture as a DDS file with the DX10 extension header.
+// 'data' holds 'mip_count' levels back to back, each packed as
+// bc_encode_image writes it (bc_encoded_size bytes, halving down to 1x1).
+static bool
+bc_save_dds (
+    char const * path, BcFormat format, bool srgb, int width, int height,
+    int mip_count, void const * data
+) {
+    uint32_t dxgi_format;
+    switch (format) {
+    case BC_FORMAT_BC1:         dxgi_format = srgb ? 72 : 71; break;    // DXGI_FORMAT_BC1_UNORM(_SRGB)
+    case BC_FORMAT_BC2:         dxgi_format = srgb ? 75 : 74; break;
+    case BC_FORMAT_BC3:         dxgi_format = srgb ? 78 : 77; break;
+    case BC_FORMAT_BC4_UNORM:   dxgi_format = 80; break;
+    case BC_FORMAT_BC4_SNORM:   dxgi_format = 81; break;
+    case BC_FORMAT_BC5_UNORM:   dxgi_format = 83; break;
+    case BC_FORMAT_BC5_SNORM:   dxgi_format = 84; break;
+    case BC_FORMAT_BC6H_UF16:   dxgi_format = 95; break;
+    case BC_FORMAT_BC6H_SF16:   dxgi_format = 96; break;
+    case BC_FORMAT_BC7:         dxgi_format = srgb ? 99 : 98; break;
+    default:                    return false;
+    }
+
+    // -- DDS_HEADER and DDS_HEADER_DXT10 as 32-bit words.
+    uint32_t header [1 + 31 + 5] = {};
+    header[0] = 0x20534444u;                    // "DDS "
+    uint32_t * h = header + 1;
+    h[0] = 124;                                 // dwSize
+    h[1] = 0x1 | 0x2 | 0x4 | 0x1000 | 0x80000;  // CAPS, HEIGHT, WIDTH, PIXELFORMAT, LINEARSIZE
+    if (mip_count > 1)
+        h[1] |= 0x20000;                        // MIPMAPCOUNT
+    h[2] = (uint32_t)height;
+    h[3] = (uint32_t)width;
+    h[4] = (uint32_t)bc_encoded_size(format, width, height);
+    h[6] = (uint32_t)mip_count;
+    h[18] = 32;                                 // ddspf.dwSize
+    h[19] = 0x4;                                // DDPF_FOURCC
+    h[20] = 0x30315844u;                        // "DX10"
+    h[26] = 0x1000;                             // DDSCAPS_TEXTURE
+    if (mip_count > 1)
+        h[26] |= 0x8 | 0x400000;                // COMPLEX, MIPMAP
+    uint32_t * dx10 = header + 32;
+    dx10[0] = dxgi_format;
+    dx10[1] = 3;                                // D3D11_RESOURCE_DIMENSION_TEXTURE2D
+    dx10[3] = 1;                                // arraySize
+
+    size_t size = 0;
+    for (int level = 0; level < mip_count; ++level) {
+        int w = width >> level;
+        int hh = height >> level;
+        size += bc_encoded_size(format, w > 0 ? w : 1, hh > 0 ? hh : 1);
+    }
+
+    FILE * f = nullptr;
+#if defined(_MSC_VER)
+    if (fopen_s(&f, path, "wb") != 0)
+        f = nullptr;
+#else
+    f = fopen(path, "wb");
+#endif
+    if (nullptr == f)
+        return false;
+    bool ok = fwrite(header, 1, sizeof(header), f) == sizeof(header);
+    ok = ok && fwrite(data, 1, size, f) == size;
+    fclose(f);
+    if (!ok)
+        remove(path);
+    return ok;
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <DirectXMath.h>
+using namespace DirectX;
+
+#include <float.h>
+
+// Per-mesh bounding volumes in mesh local space.
+// The box is stored as center/extents so it can be transformed without
+// visiting its eight corners.
+struct MeshBounds {
+    XMFLOAT3    aabb_center;
+    XMFLOAT3    aabb_extents;
+    XMFLOAT3    sphere_center;
+    float       sphere_radius;
+};
+
+// Running state used by the generators while they write vertices out.
+// The sphere is centered on a pivot chosen up front (all the shapes in
+// geometry.h are symmetric about the local origin) so that it can grow in
+// the same pass as the box instead of needing a second traversal.
+struct BoundsBuilder {
+    XMVECTOR    vmin;
+    XMVECTOR    vmax;
+    XMVECTOR    pivot;
+    XMVECTOR    max_dist_sq;
+};
+
+static void
+bounds_begin (BoundsBuilder * builder, XMFLOAT3 pivot) {
+    builder->vmin = XMVectorReplicate(+FLT_MAX);
+    builder->vmax = XMVectorReplicate(-FLT_MAX);
+    builder->pivot = XMLoadFloat3(&pivot);
+    builder->max_dist_sq = XMVectorZero();
+}
+static void
+bounds_add (BoundsBuilder * builder, XMFLOAT3 const & p) {
+    XMVECTOR v = XMLoadFloat3(&p);
+    builder->vmin = XMVectorMin(builder->vmin, v);
+    builder->vmax = XMVectorMax(builder->vmax, v);
+    builder->max_dist_sq = XMVectorMax(builder->max_dist_sq, XMVector3LengthSq(XMVectorSubtract(v, builder->pivot)));
+}
+static void
+bounds_end (BoundsBuilder const * builder, MeshBounds * out_bounds) {
+    if (nullptr == out_bounds)
+        return;
+    XMVECTOR half = XMVectorReplicate(0.5f);
+    XMStoreFloat3(&out_bounds->aabb_center, XMVectorMultiply(XMVectorAdd(builder->vmin, builder->vmax), half));
+    XMStoreFloat3(&out_bounds->aabb_extents, XMVectorMultiply(XMVectorSubtract(builder->vmax, builder->vmin), half));
+    XMStoreFloat3(&out_bounds->sphere_center, builder->pivot);
+    out_bounds->sphere_radius = sqrtf(XMVectorGetX(builder->max_dist_sq));
+}
+// One item of transform_bounds; in and *out may alias.
+static void
+transform_bounds_one (MeshBounds const & in, XMFLOAT4X4 const & world, MeshBounds * out) {
+    XMMATRIX M = XMLoadFloat4x4(&world);
+
+    XMVECTOR r0 = M.r[0];
+    XMVECTOR r1 = M.r[1];
+    XMVECTOR r2 = M.r[2];
+
+    XMVECTOR c = XMLoadFloat3(&in.aabb_center);
+    XMVECTOR e = XMLoadFloat3(&in.aabb_extents);
+    XMVECTOR sc = XMLoadFloat3(&in.sphere_center);
+    float sr = in.sphere_radius;
+
+    XMVECTOR new_c = XMVector3Transform(c, M);
+    XMVECTOR new_e = XMVectorMultiply(XMVectorSplatX(e), XMVectorAbs(r0));
+    new_e = XMVectorMultiplyAdd(XMVectorSplatY(e), XMVectorAbs(r1), new_e);
+    new_e = XMVectorMultiplyAdd(XMVectorSplatZ(e), XMVectorAbs(r2), new_e);
+
+    XMVECTOR new_sc = XMVector3Transform(sc, M);
+    XMVECTOR max_scale_sq = XMVectorMax(XMVectorMax(XMVector3LengthSq(r0), XMVector3LengthSq(r1)), XMVector3LengthSq(r2));
+
+    XMStoreFloat3(&out->aabb_center, new_c);
+    XMStoreFloat3(&out->aabb_extents, new_e);
+    XMStoreFloat3(&out->sphere_center, new_sc);
+    out->sphere_radius = sr * sqrtf(XMVectorGetX(max_scale_sq));
+}
+// Rows r[0..2] of the result hold x, y and z of the four points.
+static XMMATRIX
+bounds_load_soa (XMFLOAT3 const & a, XMFLOAT3 const & b, XMFLOAT3 const & c, XMFLOAT3 const & d) {
+    return XMMatrixTranspose(XMMATRIX(XMLoadFloat3(&a), XMLoadFloat3(&b), XMLoadFloat3(&c), XMLoadFloat3(&d)));
+}
+static void
+bounds_store_soa (XMVECTOR x, XMVECTOR y, XMVECTOR z, MeshBounds out [], XMFLOAT3 MeshBounds::* field) {
+    XMMATRIX aos = XMMatrixTranspose(XMMATRIX(x, y, z, XMVectorZero()));
+    for (int k = 0; k < 4; ++k)
+        XMStoreFloat3(&(out[k].*field), aos.r[k]);
+}
+// Transform 'count' local bounds by their matching world matrices.
+// The box uses the absolute-matrix form (Arvo) so the result stays a tight
+// fit around the transformed box, and the sphere radius is scaled by the
+// largest axis scale of the matrix. in_bounds and out_bounds may alias.
+//
+// Four items go per iteration in SoA form: their matrices and boxes are
+// transposed so that each register holds one component of all four, the
+// math is done lane-wise, and the results are transposed back. The last
+// count % 4 items go one by one.
+static void
+transform_bounds (MeshBounds const in_bounds [], XMFLOAT4X4 const worlds [], int count, MeshBounds out_bounds []) {
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        MeshBounds const * in = in_bounds + i;
+        XMFLOAT4X4 const * w = worlds + i;
+
+        // m[r].r[j] is element (r, j) of the four matrices
+        XMMATRIX m [4];
+        for (int r = 0; r < 4; ++r) {
+            m[r] = XMMatrixTranspose(XMMATRIX(
+                XMLoadFloat4((XMFLOAT4 const *)w[0].m[r]), XMLoadFloat4((XMFLOAT4 const *)w[1].m[r]),
+                XMLoadFloat4((XMFLOAT4 const *)w[2].m[r]), XMLoadFloat4((XMFLOAT4 const *)w[3].m[r])
+            ));
+        }
+        XMMATRIX c = bounds_load_soa(in[0].aabb_center, in[1].aabb_center, in[2].aabb_center, in[3].aabb_center);
+        XMMATRIX e = bounds_load_soa(in[0].aabb_extents, in[1].aabb_extents, in[2].aabb_extents, in[3].aabb_extents);
+        XMMATRIX sc = bounds_load_soa(in[0].sphere_center, in[1].sphere_center, in[2].sphere_center, in[3].sphere_center);
+        XMVECTOR sr = XMVectorSet(in[0].sphere_radius, in[1].sphere_radius, in[2].sphere_radius, in[3].sphere_radius);
+
+        XMVECTOR new_c [3];
+        XMVECTOR new_e [3];
+        XMVECTOR new_sc [3];
+        for (int j = 0; j < 3; ++j) {
+            new_c[j] = XMVectorMultiplyAdd(c.r[0], m[0].r[j], XMVectorMultiplyAdd(c.r[1], m[1].r[j], XMVectorMultiplyAdd(c.r[2], m[2].r[j], m[3].r[j])));
+            new_sc[j] = XMVectorMultiplyAdd(sc.r[0], m[0].r[j], XMVectorMultiplyAdd(sc.r[1], m[1].r[j], XMVectorMultiplyAdd(sc.r[2], m[2].r[j], m[3].r[j])));
+            new_e[j] = XMVectorMultiplyAdd(e.r[0], XMVectorAbs(m[0].r[j]), XMVectorMultiplyAdd(e.r[1], XMVectorAbs(m[1].r[j]), XMVectorMultiply(e.r[2], XMVectorAbs(m[2].r[j]))));
+        }
+        XMVECTOR max_scale_sq = XMVectorZero();
+        for (int r = 0; r < 3; ++r) {
+            XMVECTOR len_sq = XMVectorMultiplyAdd(m[r].r[0], m[r].r[0], XMVectorMultiplyAdd(m[r].r[1], m[r].r[1], XMVectorMultiply(m[r].r[2], m[r].r[2])));
+            max_scale_sq = XMVectorMax(max_scale_sq, len_sq);
+        }
+        XMFLOAT4 radius;
+        XMStoreFloat4(&radius, XMVectorMultiply(sr, XMVectorSqrt(max_scale_sq)));
+
+        // Every input is in registers by now, so aliased output is safe
+        MeshBounds * out = out_bounds + i;
+        bounds_store_soa(new_c[0], new_c[1], new_c[2], out, &MeshBounds::aabb_center);
+        bounds_store_soa(new_e[0], new_e[1], new_e[2], out, &MeshBounds::aabb_extents);
+        bounds_store_soa(new_sc[0], new_sc[1], new_sc[2], out, &MeshBounds::sphere_center);
+        out[0].sphere_radius = radius.x;
+        out[1].sphere_radius = radius.y;
+        out[2].sphere_radius = radius.z;
+        out[3].sphere_radius = radius.w;
+    }
+    for (; i < count; ++i)
+        transform_bounds_one(in_bounds[i], worlds[i], &out_bounds[i]);
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+// Removes degenerate triangles from an indexed triangle list: triangles
+// repeating an index, triangles whose corners coincide or line up (zero
+// area), and slivers whose area is negligible next to their longest edge.
+// None of them covers a pixel sample reliably, but each still costs
+// rasterizer setup.
+//
+// The area test runs on four triangles at a time with SSE2: twice the area
+// is |e1 x e2|, and a triangle is kept when
+//     |e1 x e2| > min_ratio * longest_edge^2
+// so the threshold is scale-free (the ratio is twice the height over the
+// longest edge). Surviving triangles are compacted in place, in order;
+// vertices are left alone.
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define DEGENERATE_SSE2 1
+#endif
+
+#define DEGENERATE_MIN_RATIO    1e-5f
+
+struct DegenerateStats {
+    int     triangles;          // before stripping
+    int     collapsed;          // an index repeated
+    int     zero_area;          // distinct indices, exactly zero area
+    int     slivers;            // non-zero area under the ratio
+};
+
+static inline int
+degenerate_removed (DegenerateStats const * stats) {
+    return stats->collapsed + stats->zero_area + stats->slivers;
+}
+
+// -- The area test on four triangles given as p[corner][axis][lane]. Bit k
+// of *keep_mask is set when triangle k passes the ratio, bit k of
+// *zero_mask when its area is exactly zero. The scalar form is the
+// reference the SSE2 form must agree with, lane for lane.
+static inline void
+degenerate_masks_scalar (float const p [3][3][4], float min_ratio_sq, int * keep_mask, int * zero_mask) {
+    *keep_mask = 0;
+    *zero_mask = 0;
+    for (int k = 0; k < 4; ++k) {
+        float e1 [3], e2 [3], e3 [3];
+        for (int a = 0; a < 3; ++a) {
+            e1[a] = p[1][a][k] - p[0][a][k];
+            e2[a] = p[2][a][k] - p[0][a][k];
+            e3[a] = p[2][a][k] - p[1][a][k];
+        }
+        float cx = e1[1] * e2[2] - e1[2] * e2[1];
+        float cy = e1[2] * e2[0] - e1[0] * e2[2];
+        float cz = e1[0] * e2[1] - e1[1] * e2[0];
+        float cross_sq = cx * cx + cy * cy + cz * cz;
+        float l1 = e1[0] * e1[0] + e1[1] * e1[1] + e1[2] * e1[2];
+        float l2 = e2[0] * e2[0] + e2[1] * e2[1] + e2[2] * e2[2];
+        float l3 = e3[0] * e3[0] + e3[1] * e3[1] + e3[2] * e3[2];
+        float longest_sq = l1 > l2 ? (l1 > l3 ? l1 : l3) : (l2 > l3 ? l2 : l3);
+        *keep_mask |= (cross_sq > longest_sq * longest_sq * min_ratio_sq ? 1 : 0) << k;
+        *zero_mask |= (cross_sq == 0.0f ? 1 : 0) << k;
+    }
+}
+#if defined(DEGENERATE_SSE2)
+static inline void
+degenerate_masks_sse2 (float const p [3][3][4], float min_ratio_sq, int * keep_mask, int * zero_mask) {
+    __m128 e1 [3], e2 [3], e3 [3];
+    for (int a = 0; a < 3; ++a) {
+        __m128 p0 = _mm_loadu_ps(p[0][a]);
+        __m128 p1 = _mm_loadu_ps(p[1][a]);
+        __m128 p2 = _mm_loadu_ps(p[2][a]);
+        e1[a] = _mm_sub_ps(p1, p0);
+        e2[a] = _mm_sub_ps(p2, p0);
+        e3[a] = _mm_sub_ps(p2, p1);
+    }
+    __m128 cx = _mm_sub_ps(_mm_mul_ps(e1[1], e2[2]), _mm_mul_ps(e1[2], e2[1]));
+    __m128 cy = _mm_sub_ps(_mm_mul_ps(e1[2], e2[0]), _mm_mul_ps(e1[0], e2[2]));
+    __m128 cz = _mm_sub_ps(_mm_mul_ps(e1[0], e2[1]), _mm_mul_ps(e1[1], e2[0]));
+    __m128 cross_sq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, cx), _mm_mul_ps(cy, cy)), _mm_mul_ps(cz, cz));
+    __m128 l1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1[0], e1[0]), _mm_mul_ps(e1[1], e1[1])), _mm_mul_ps(e1[2], e1[2]));
+    __m128 l2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e2[0], e2[0]), _mm_mul_ps(e2[1], e2[1])), _mm_mul_ps(e2[2], e2[2]));
+    __m128 l3 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e3[0], e3[0]), _mm_mul_ps(e3[1], e3[1])), _mm_mul_ps(e3[2], e3[2]));
+    __m128 longest_sq = _mm_max_ps(_mm_max_ps(l1, l2), l3);
+    __m128 limit = _mm_mul_ps(_mm_mul_ps(longest_sq, longest_sq), _mm_set1_ps(min_ratio_sq));
+    *keep_mask = _mm_movemask_ps(_mm_cmpgt_ps(cross_sq, limit));
+    *zero_mask = _mm_movemask_ps(_mm_cmpeq_ps(cross_sq, _mm_setzero_ps()));
+}
+#endif
+
+// Strips 'index_count / 3' triangles over positions given as x, y, z
+// floats every 'stride' bytes. Returns the new index count; 'stats' may be
+// nullptr.
+static int
+strip_degenerate_triangles (
+    float const * positions, size_t stride, int indices [], int index_count,
+    float min_ratio, DegenerateStats * stats
+) {
+    DegenerateStats st = {};
+    int tri_count = index_count / 3;
+    st.triangles = tri_count;
+    float min_ratio_sq = min_ratio * min_ratio;
+    int out = 0;
+
+    for (int t = 0; t < tri_count; t += 4) {
+        int n = tri_count - t < 4 ? tri_count - t : 4;
+
+        // -- Gather four triangles' corners as structure of arrays; missing
+        // lanes repeat the first triangle and are ignored.
+        float p [3][3][4];
+        for (int k = 0; k < 4; ++k) {
+            int const * tri = indices + (t + (k < n ? k : 0)) * 3;
+            for (int c = 0; c < 3; ++c) {
+                float const * v = (float const *)((uint8_t const *)positions + (size_t)tri[c] * stride);
+                p[c][0][k] = v[0];
+                p[c][1][k] = v[1];
+                p[c][2][k] = v[2];
+            }
+        }
+
+        int keep_mask;
+        int zero_mask;
+#if defined(DEGENERATE_SSE2)
+        degenerate_masks_sse2(p, min_ratio_sq, &keep_mask, &zero_mask);
+#else
+        degenerate_masks_scalar(p, min_ratio_sq, &keep_mask, &zero_mask);
+#endif
+
+        // -- Classify and compact.
+        for (int k = 0; k < n; ++k) {
+            int const * tri = indices + (t + k) * 3;
+            if (tri[0] == tri[1] || tri[1] == tri[2] || tri[2] == tri[0]) {
+                ++st.collapsed;
+            } else if (zero_mask & (1 << k)) {
+                ++st.zero_area;
+            } else if (!(keep_mask & (1 << k))) {
+                ++st.slivers;
+            } else {
+                int a = tri[0], b = tri[1], c = tri[2];
+                indices[out++] = a;
+                indices[out++] = b;
+                indices[out++] = c;
+            }
+        }
+    }
+    if (stats)
+        *stats = st;
+    return out;
+}
@@ -3,6 +3,8 @@
 #include <DirectXMath.h>
 using namespace DirectX;
 
+#include "bounds.h"
+
 struct Vertex {
     XMFLOAT3 position;
     XMFLOAT3 normal;
@@ -11,7 +13,7 @@ struct Vertex {
 };
 
 static void
-create_box (float width, float height, float depth, Vertex out_vtx [], int out_idx []) {
+create_box (float width, float height, float depth, Vertex out_vtx [], int out_idx [], MeshBounds * out_bounds) {
 
     // Creating Vertices
 
@@ -80,9 +82,17 @@ create_box (float width, float height, float depth, Vertex out_vtx [], int out_i
     // Fill in the right face index data
     out_idx[30] = 20; out_idx[31] = 21; out_idx[32] = 22;
     out_idx[33] = 20; out_idx[34] = 22; out_idx[35] = 23;
+
+    // -- Bounds: the corners are the extremes, so no need to visit the vertices.
+    if (out_bounds) {
+        out_bounds->aabb_center = XMFLOAT3(0.0f, 0.0f, 0.0f);
+        out_bounds->aabb_extents = XMFLOAT3(half_width, half_height, half_depth);
+        out_bounds->sphere_center = XMFLOAT3(0.0f, 0.0f, 0.0f);
+        out_bounds->sphere_radius = sqrtf(half_width * half_width + half_height * half_height + half_depth * half_depth);
+    }
 }
 static void
-create_sphere (float radius, Vertex out_vtx [], int out_idx []) {
+create_sphere (float radius, Vertex out_vtx [], int out_idx [], MeshBounds * out_bounds) {
 
     // TODO(omid): add some validation for array sizes
     /* out_vtx [401], out_idx [2280] */
@@ -90,7 +100,6 @@ create_sphere (float radius, Vertex out_vtx [], int out_idx []) {
     // -- Compute the vertices stating at the top pole and moving down the stacks.
     int n_stack = 20;
     int n_slice = 20;
-    int n_vtx = n_stack * n_slice;
     float phi_step = XM_PI / n_stack;
     float theta_step = 2.0f * XM_PI / n_slice;
 
@@ -101,16 +110,21 @@ create_sphere (float radius, Vertex out_vtx [], int out_idx []) {
     Vertex bottom = {.position = {0.0f, -radius, 0.0f}, .normal = {0.0f, -1.0f, 0.0f}, .tangent_u = {1.0f, 0.0f, 0.0f}, .texc = {0.0f, 1.0f}};
 
     out_vtx[0] = top;
-    out_vtx[n_vtx + 1] = bottom;
+
+    BoundsBuilder bounds;
+    bounds_begin(&bounds, XMFLOAT3(0.0f, 0.0f, 0.0f));
+    bounds_add(&bounds, top.position);
+    bounds_add(&bounds, bottom.position);
 
     // -- Compute vertices for each stack ring (do not count the poles as rings).
     int _curr_idx = 1;
     for (int i = 1; i <= n_stack - 1; ++i) {
         float phi = i * phi_step;
 
-        // Vertices of ring.
+        // Vertices of ring. The last one closes the seam at the angle of the
+        // first, so both land on bit-identical positions.
         for (int j = 0; j <= n_slice; ++j) {
-            float theta = j * theta_step;
+            float theta = (j % n_slice) * theta_step;
 
             Vertex v = {};
 
@@ -130,12 +144,17 @@ create_sphere (float radius, Vertex out_vtx [], int out_idx []) {
             XMVECTOR p = XMLoadFloat3(&v.position);
             XMStoreFloat3(&v.normal, XMVector3Normalize(p));
 
-            v.texc.x = theta / XM_2PI;
+            v.texc.x = (float)j / n_slice;
             v.texc.y = phi / XM_PI;
 
             out_vtx[_curr_idx++] = v;
+            bounds_add(&bounds, v.position);
         }
     }
+    // The bottom pole follows the last ring.
+    int south_pole_index = _curr_idx;
+    out_vtx[_curr_idx++] = bottom;
+    bounds_end(&bounds, out_bounds);
 
     // -- Compute indices for top stack.  The top stack was written first to the vertex buffer and connects the top pole to the first ring.
 
@@ -167,9 +186,6 @@ create_sphere (float radius, Vertex out_vtx [], int out_idx []) {
 
     // -- Compute indices for bottom stack.  The bottom stack was written last to the vertex buffer and connects the bottom pole to the bottom ring.
 
-    // South pole vertex was added last.
-    int south_pole_index = (int)n_vtx - 1;
-
     // offset the indices to the index of the first vertex in the last ring.
     base_index = south_pole_index - ring_vtx_cnt;
 
@@ -180,7 +196,7 @@ create_sphere (float radius, Vertex out_vtx [], int out_idx []) {
     }
 }
 static void
-create_cylinder (float bottom_radius, float top_radius, float height, Vertex out_vtx [], int out_idx []) {
+create_cylinder (float bottom_radius, float top_radius, float height, Vertex out_vtx [], int out_idx [], MeshBounds * out_bounds) {
 
     // TODO(omid): add some validation for array sizes
     /* out_vtx [485], out_idx [2520] */
@@ -197,18 +213,24 @@ create_cylinder (float bottom_radius, float top_radius, float height, Vertex out
     int _vtx_cnt = 0;
     int _idx_cnt = 0;
 
+    // Cap rings share their positions with the first and last stack rings,
+    // so the side vertices alone give the bounds.
+    BoundsBuilder bounds;
+    bounds_begin(&bounds, XMFLOAT3(0.0f, 0.0f, 0.0f));
+
     // Compute vertices for each stack ring starting at the bottom and moving up.
     for (int i = 0; i < ring_cnt; ++i) {
         float y = -0.5f * height + i * stack_height;
         float r = bottom_radius + i * radius_step;
 
-        // vertices of ring
+        // vertices of ring (the seam vertex reuses angle 0 so its position
+        // matches the first one exactly)
         float dtheta = 2.0f * XM_PI / n_slice;
         for (int j = 0; j <= n_slice; ++j) {
             Vertex vertex = {};
 
-            float c = cosf(j * dtheta);
-            float s = sinf(j * dtheta);
+            float c = cosf((j % n_slice) * dtheta);
+            float s = sinf((j % n_slice) * dtheta);
 
             vertex.position = XMFLOAT3(r * c, y, r * s);
 
@@ -227,8 +249,10 @@ create_cylinder (float bottom_radius, float top_radius, float height, Vertex out
             XMStoreFloat3(&vertex.normal, N);
 
             out_vtx[_vtx_cnt++] = vertex;
+            bounds_add(&bounds, vertex.position);
         }
     }
+    bounds_end(&bounds, out_bounds);
 
     // Add one because we duplicate the first and last vertex per ring
     // since the texture coordinates are different.
@@ -254,8 +278,8 @@ create_cylinder (float bottom_radius, float top_radius, float height, Vertex out
 
     // Duplicate cap ring vertices because the texture coordinates and normals differ.
     for (int i = 0; i <= n_slice; ++i) {
-        float x = top_radius * cosf(i * dtheta);
-        float z = top_radius * sinf(i * dtheta);
+        float x = top_radius * cosf((i % n_slice) * dtheta);
+        float z = top_radius * sinf((i % n_slice) * dtheta);
 
         // Scale down by the height to try and make top cap texture coord area
         // proportional to base.
@@ -285,8 +309,8 @@ create_cylinder (float bottom_radius, float top_radius, float height, Vertex out
     // vertices of ring
     //float dTheta = 2.0f * XM_PI / n_slice; // not used
     for (int i = 0; i <= n_slice; ++i) {
-        float x = bottom_radius * cosf(i * dtheta);
-        float z = bottom_radius * sinf(i * dtheta);
+        float x = bottom_radius * cosf((i % n_slice) * dtheta);
+        float z = bottom_radius * sinf((i % n_slice) * dtheta);
 
         // Scale down by the height to try and make top cap texture coord area
         // proportional to base.
@@ -310,7 +334,7 @@ create_cylinder (float bottom_radius, float top_radius, float height, Vertex out
 
 }
 static void
-create_grid (float width, float depth, int m, int n, Vertex out_vtx [], int out_idx []) {
+create_grid (float width, float depth, int m, int n, Vertex out_vtx [], int out_idx [], MeshBounds * out_bounds) {
 
     // -- Create the vertices.
 
@@ -323,6 +347,9 @@ create_grid (float width, float depth, int m, int n, Vertex out_vtx [], int out_
     float du = 1.0f / (n - 1);
     float dv = 1.0f / (m - 1);
 
+    BoundsBuilder bounds;
+    bounds_begin(&bounds, XMFLOAT3(0.0f, 0.0f, 0.0f));
+
     for (int i = 0; i < m; ++i) {
         float z = half_depth - i * dz;
         for (int j = 0; j < n; ++j) {
@@ -335,8 +362,11 @@ create_grid (float width, float depth, int m, int n, Vertex out_vtx [], int out_
             // Stretch texture over grid.
             out_vtx[i * n + j].texc.x = j * du;
             out_vtx[i * n + j].texc.y = i * dv;
+
+            bounds_add(&bounds, out_vtx[i * n + j].position);
         }
     }
+    bounds_end(&bounds, out_bounds);
 
     // -- Create the indices.
 
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <d3d11.h>
+
+#include "range_allocator.h"
+
+// One big vertex buffer / index buffer pair that meshes are streamed in and
+// out of. Regions are handed out by two RangeAllocators that count in
+// elements (vertices and 32 bit indices) rather than bytes, so an allocation
+// offset is directly a DrawIndexed base vertex / first index.
+struct GeometryPool {
+    ID3D11Buffer *  vb;
+    ID3D11Buffer *  ib;
+    ID3D11Buffer *  scratch;        // staging area for overlapping defrag moves
+    UINT            scratch_bytes;
+
+    UINT            vertex_stride;
+
+    RangeAllocator  vtx_alloc;
+    RangeAllocator  idx_alloc;
+};
+
+struct GeometryAlloc {
+    uint32_t        vtx_block;
+    uint32_t        idx_block;
+    int             base_vertex;
+    UINT            first_index;
+};
+
+static bool
+geometry_pool_create (
+    GeometryPool * pool, ID3D11Device * device,
+    UINT vertex_stride, UINT vtx_capacity, UINT idx_capacity, UINT max_meshes
+) {
+    memset(pool, 0, sizeof(*pool));
+    pool->vertex_stride = vertex_stride;
+
+    if (!range_allocator_init(&pool->vtx_alloc, vtx_capacity, max_meshes) ||
+        !range_allocator_init(&pool->idx_alloc, idx_capacity, max_meshes))
+        return false;
+
+    // DEFAULT usage so regions can be rewritten with UpdateSubresource and
+    // moved around with CopySubresourceRegion.
+    D3D11_BUFFER_DESC vb_desc;
+    vb_desc.Usage = D3D11_USAGE_DEFAULT;
+    vb_desc.ByteWidth = vtx_capacity * vertex_stride;
+    vb_desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+    vb_desc.CPUAccessFlags = 0;
+    vb_desc.MiscFlags = 0;
+    vb_desc.StructureByteStride = 0;
+    if (FAILED(device->CreateBuffer(&vb_desc, nullptr, &pool->vb)))
+        return false;
+
+    D3D11_BUFFER_DESC ib_desc = vb_desc;
+    ib_desc.ByteWidth = idx_capacity * sizeof(int);
+    ib_desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+    if (FAILED(device->CreateBuffer(&ib_desc, nullptr, &pool->ib)))
+        return false;
+
+    // Big enough to bounce any mesh up to 64K vertices in one go; larger
+    // overlapping moves fall back to chunked copies.
+    pool->scratch_bytes = max(65536u * vertex_stride, 65536u * (UINT)sizeof(int));
+    D3D11_BUFFER_DESC scratch_desc = vb_desc;
+    scratch_desc.ByteWidth = pool->scratch_bytes;
+    scratch_desc.BindFlags = 0;
+    if (FAILED(device->CreateBuffer(&scratch_desc, nullptr, &pool->scratch)))
+        return false;
+
+    return true;
+}
+static void
+geometry_pool_destroy (GeometryPool * pool) {
+    if (pool->scratch)
+        pool->scratch->Release();
+    if (pool->ib)
+        pool->ib->Release();
+    if (pool->vb)
+        pool->vb->Release();
+    range_allocator_destroy(&pool->vtx_alloc);
+    range_allocator_destroy(&pool->idx_alloc);
+    memset(pool, 0, sizeof(*pool));
+}
+// Copies vertex/index data into freshly allocated regions of the pool.
+// Returns false (and allocates nothing) when either buffer is out of room.
+// Either count may be zero for meshes that share the other part (streamed
+// terrain tiles all draw the same indices); that block is then
+// RANGE_ALLOC_INVALID.
+static bool
+geometry_pool_upload (
+    GeometryPool * pool, ID3D11DeviceContext * ctx,
+    void const * vertices, UINT vtx_count, int const * indices, UINT idx_count,
+    uint32_t user, GeometryAlloc * out_alloc
+) {
+    uint32_t vblock = RANGE_ALLOC_INVALID;
+    uint32_t iblock = RANGE_ALLOC_INVALID;
+    if (vtx_count > 0) {
+        vblock = range_allocator_alloc(&pool->vtx_alloc, vtx_count, user);
+        if (RANGE_ALLOC_INVALID == vblock)
+            return false;
+    }
+    if (idx_count > 0) {
+        iblock = range_allocator_alloc(&pool->idx_alloc, idx_count, user);
+        if (RANGE_ALLOC_INVALID == iblock) {
+            if (vblock != RANGE_ALLOC_INVALID)
+                range_allocator_free(&pool->vtx_alloc, vblock);
+            return false;
+        }
+    }
+
+    out_alloc->vtx_block = vblock;
+    out_alloc->idx_block = iblock;
+    out_alloc->base_vertex = vtx_count > 0 ? (int)range_allocator_offset(&pool->vtx_alloc, vblock) : 0;
+    out_alloc->first_index = idx_count > 0 ? range_allocator_offset(&pool->idx_alloc, iblock) : 0;
+
+    D3D11_BOX box = {};
+    box.bottom = 1;
+    box.back = 1;
+
+    if (vtx_count > 0) {
+        box.left = out_alloc->base_vertex * pool->vertex_stride;
+        box.right = box.left + vtx_count * pool->vertex_stride;
+        ctx->UpdateSubresource(pool->vb, 0, &box, vertices, 0, 0);
+    }
+    if (idx_count > 0) {
+        box.left = out_alloc->first_index * sizeof(int);
+        box.right = box.left + idx_count * sizeof(int);
+        ctx->UpdateSubresource(pool->ib, 0, &box, indices, 0, 0);
+    }
+
+    return true;
+}
+static void
+geometry_pool_release (GeometryPool * pool, GeometryAlloc const & alloc) {
+    if (alloc.vtx_block != RANGE_ALLOC_INVALID)
+        range_allocator_free(&pool->vtx_alloc, alloc.vtx_block);
+    if (alloc.idx_block != RANGE_ALLOC_INVALID)
+        range_allocator_free(&pool->idx_alloc, alloc.idx_block);
+}
+// Moves [src, src + bytes) to dst inside one buffer. D3D11 does not allow
+// overlapping copies within a resource, so those either bounce through the
+// scratch buffer or, when that is too small, go in chunks no larger than the
+// distance moved (defrag only ever moves data down, so chunks copied front to
+// back never read bytes that were already overwritten).
+static void
+geometry_pool_move_bytes (GeometryPool * pool, ID3D11DeviceContext * ctx, ID3D11Buffer * buffer, UINT src, UINT dst, UINT bytes) {
+    D3D11_BOX box = {};
+    box.bottom = 1;
+    box.back = 1;
+
+    UINT distance = src - dst;
+    if (distance >= bytes) {
+        box.left = src;
+        box.right = src + bytes;
+        ctx->CopySubresourceRegion(buffer, 0, dst, 0, 0, buffer, 0, &box);
+    } else if (bytes <= pool->scratch_bytes) {
+        box.left = src;
+        box.right = src + bytes;
+        ctx->CopySubresourceRegion(pool->scratch, 0, 0, 0, 0, buffer, 0, &box);
+        box.left = 0;
+        box.right = bytes;
+        ctx->CopySubresourceRegion(buffer, 0, dst, 0, 0, pool->scratch, 0, &box);
+    } else {
+        for (UINT done = 0; done < bytes; done += distance) {
+            UINT chunk = min(distance, bytes - done);
+            box.left = src + done;
+            box.right = box.left + chunk;
+            ctx->CopySubresourceRegion(buffer, 0, dst + done, 0, 0, buffer, 0, &box);
+        }
+    }
+}
+// One incremental compaction step over both buffers, moving at most
+// 'max_elements' vertices and as many indices. The executed moves are
+// returned so the caller can patch base vertex / first index of the meshes
+// they belong to (RangeMove::user is the tag passed to geometry_pool_upload).
+static void
+geometry_pool_defrag (
+    GeometryPool * pool, ID3D11DeviceContext * ctx, UINT max_elements,
+    RangeMove vtx_moves [], int * vtx_move_cnt,
+    RangeMove idx_moves [], int * idx_move_cnt, int max_moves
+) {
+    *vtx_move_cnt = range_allocator_defrag(&pool->vtx_alloc, max_elements, vtx_moves, max_moves);
+    for (int i = 0; i < *vtx_move_cnt; ++i) {
+        RangeMove const & m = vtx_moves[i];
+        geometry_pool_move_bytes(pool, ctx, pool->vb,
+            m.src_offset * pool->vertex_stride, m.dst_offset * pool->vertex_stride, m.size * pool->vertex_stride);
+    }
+
+    *idx_move_cnt = range_allocator_defrag(&pool->idx_alloc, max_elements, idx_moves, max_moves);
+    for (int i = 0; i < *idx_move_cnt; ++i) {
+        RangeMove const & m = idx_moves[i];
+        geometry_pool_move_bytes(pool, ctx, pool->ib,
+            m.src_offset * sizeof(int), m.dst_offset * sizeof(int), m.size * sizeof(int));
+    }
+}
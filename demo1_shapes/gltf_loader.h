@@ -0,0 +1,554 @@
+#pragma once
+
+// glTF 2.0 loader (.glb, or .gltf with external .bin buffers).
+//
+// Binary buffers are memory mapped and never copied: accessors are resolved
+// into GltfStream views pointing straight into the mapping, so a primitive
+// whose vertex layout already matches the target vertex struct can be
+// uploaded from the file as is (gltf_match_interleaved), and uint32 index
+// accessors are used directly (gltf_index_source). Anything else goes
+// through the gltf_read_* conversion helpers.
+//
+// Geometry stays in glTF's right-handed space. The RH -> LH conversion is a
+// z mirror folded into the node world matrices, so those have a negative
+// determinant and the renderer has to flip its front-face winding for them
+// (which glTF requires for mirrored nodes anyway).
+//
+// Files whose attribute counts disagree with POSITION, or whose indices
+// point past it, are rejected as a whole at load.
+//
+// Not supported: sparse accessors, data: URIs, non-triangle primitives.
+
+#include "bounds.h"
+#include "geometry.h"
+#include "json.h"
+#include "mapped_file.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GLTF_GLB_MAGIC      0x46546c67u     // "glTF"
+#define GLTF_CHUNK_JSON     0x4e4f534au     // "JSON"
+#define GLTF_CHUNK_BIN      0x004e4942u     // "BIN\0"
+#define GLTF_MAX_BUFFERS    16
+
+// accessor componentType
+#define GLTF_BYTE           5120
+#define GLTF_UNSIGNED_BYTE  5121
+#define GLTF_SHORT          5122
+#define GLTF_UNSIGNED_SHORT 5123
+#define GLTF_UNSIGNED_INT   5125
+#define GLTF_FLOAT          5126
+
+enum GltfAttribute {
+    GLTF_POSITION,
+    GLTF_NORMAL,
+    GLTF_TANGENT,
+    GLTF_TEXCOORD_0,
+    GLTF_COLOR_0,
+
+    GLTF_ATTRIBUTE_COUNT
+};
+
+// A resolved accessor: element i starts at data + i * stride.
+struct GltfStream {
+    uint8_t const * data;
+    uint32_t        stride;
+    uint32_t        count;
+    int             component_type;
+    int             components;
+    bool            normalized;
+    int             buffer_view;        // -1 if the stream is absent
+    uint32_t        view_offset;        // byte offset of data inside its view
+};
+
+struct GltfPrimitive {
+    GltfStream  attributes [GLTF_ATTRIBUTE_COUNT];
+    GltfStream  indices;
+    int         material;
+    MeshBounds  bounds;                 // from the POSITION accessor min/max
+};
+
+struct GltfMesh {
+    char        name [32];
+    int         first_primitive;
+    int         primitive_count;
+};
+
+struct GltfMaterial {
+    char        name [32];
+    XMFLOAT4    base_color;
+};
+
+// A node that references a mesh, with its flattened world transform.
+struct GltfInstance {
+    int         mesh;
+    XMFLOAT4X4  world;
+};
+
+struct GltfScene {
+    MappedFile      file;
+    MappedFile      buffers [GLTF_MAX_BUFFERS];
+    JsonDoc         json;
+
+    GltfMesh *      meshes;
+    int             mesh_count;
+    GltfPrimitive * primitives;
+    int             primitive_count;
+    GltfMaterial *  materials;
+    int             material_count;
+    GltfInstance *  instances;
+    int             instance_count;
+};
+
+static int
+gltf_component_size (int component_type) {
+    switch (component_type) {
+    case GLTF_BYTE: case GLTF_UNSIGNED_BYTE: return 1;
+    case GLTF_SHORT: case GLTF_UNSIGNED_SHORT: return 2;
+    case GLTF_UNSIGNED_INT: case GLTF_FLOAT: return 4;
+    }
+    return 0;
+}
+static int
+gltf_type_components (JsonDoc const * doc, int tok) {
+    static char const * const types [] = {"SCALAR", "VEC2", "VEC3", "VEC4"};
+    for (int i = 0; i < 4; ++i)
+        if (json_equals(doc, tok, types[i]))
+            return i + 1;
+    if (json_equals(doc, tok, "MAT4"))
+        return 16;
+    return 0;
+}
+
+// Resolves accessor 'index' against the mapped buffers. Leaves the stream
+// empty (data == nullptr) if it is missing, sparse or out of bounds.
+static void
+gltf_resolve_accessor (GltfScene const * scene, uint32_t const buffer_sizes [], int index, GltfStream * out) {
+    memset(out, 0, sizeof(*out));
+    out->buffer_view = -1;
+
+    JsonDoc const * doc = &scene->json;
+    int root = 0;
+    int acc = json_at(doc, json_get(doc, root, "accessors"), index);
+    if (acc < 0 || json_get(doc, acc, "sparse") >= 0)
+        return;
+    int view_index = json_int(doc, json_get(doc, acc, "bufferView"), -1);
+    int view = json_at(doc, json_get(doc, root, "bufferViews"), view_index);
+    if (view < 0)
+        return;
+    int buffer = json_int(doc, json_get(doc, view, "buffer"), -1);
+    if (buffer < 0 || buffer >= GLTF_MAX_BUFFERS || nullptr == scene->buffers[buffer].data)
+        return;
+
+    int component_type = json_int(doc, json_get(doc, acc, "componentType"), 0);
+    int components = gltf_type_components(doc, json_get(doc, acc, "type"));
+    int element_size = gltf_component_size(component_type) * components;
+    if (0 == element_size)
+        return;
+    uint32_t count = (uint32_t)json_int(doc, json_get(doc, acc, "count"), 0);
+    uint32_t acc_offset = (uint32_t)json_int(doc, json_get(doc, acc, "byteOffset"), 0);
+    uint64_t view_offset = (uint64_t)json_number(doc, json_get(doc, view, "byteOffset"), 0);
+    uint64_t view_length = (uint64_t)json_number(doc, json_get(doc, view, "byteLength"), 0);
+    uint32_t stride = (uint32_t)json_int(doc, json_get(doc, view, "byteStride"), 0);
+    if (0 == stride)
+        stride = element_size;
+
+    // Every element has to lie inside the view, and the view inside the buffer.
+    if (0 == count || view_offset + view_length > buffer_sizes[buffer] ||
+        acc_offset + (uint64_t)stride * (count - 1) + element_size > view_length)
+        return;
+
+    out->data = scene->buffers[buffer].data + view_offset + acc_offset;
+    out->stride = stride;
+    out->count = count;
+    out->component_type = component_type;
+    out->components = components;
+    out->normalized = json_bool(doc, json_get(doc, acc, "normalized"), false);
+    out->buffer_view = view_index;
+    out->view_offset = acc_offset;
+}
+// Every attribute has POSITION's count and every index is below it, so the
+// streams can be read and the triangles walked without further checks.
+static bool
+gltf_primitive_valid (GltfPrimitive const * prim) {
+    uint32_t vertex_count = prim->attributes[GLTF_POSITION].count;
+    for (int a = 0; a < GLTF_ATTRIBUTE_COUNT; ++a)
+        if (prim->attributes[a].data && prim->attributes[a].count != vertex_count)
+            return false;
+
+    GltfStream const & s = prim->indices;
+    if (nullptr == s.data)
+        return 0 == vertex_count % 3;
+    if (1 != s.components || 0 != s.count % 3)
+        return false;
+    for (uint32_t i = 0; i < s.count; ++i) {
+        uint8_t const * p = s.data + (size_t)i * s.stride;
+        uint32_t v;
+        switch (s.component_type) {
+        case GLTF_UNSIGNED_BYTE:    v = p[0]; break;
+        case GLTF_UNSIGNED_SHORT:   { uint16_t u; memcpy(&u, p, 2); v = u; } break;
+        case GLTF_UNSIGNED_INT:     memcpy(&v, p, 4); break;
+        default:                    return false;
+        }
+        if (v >= vertex_count)
+            return false;
+    }
+    return true;
+}
+
+static void
+gltf_local_matrix (JsonDoc const * doc, int node, XMMATRIX * out) {
+    float m [16];
+    if (16 == json_floats(doc, json_get(doc, node, "matrix"), m, 16)) {
+        // Column-major column-vector matrices read row by row are exactly
+        // DirectXMath's row-vector convention.
+        *out = XMLoadFloat4x4(reinterpret_cast<XMFLOAT4X4 const *>(m));
+        return;
+    }
+    float t [3] = {0.0f, 0.0f, 0.0f};
+    float r [4] = {0.0f, 0.0f, 0.0f, 1.0f};
+    float s [3] = {1.0f, 1.0f, 1.0f};
+    json_floats(doc, json_get(doc, node, "translation"), t, 3);
+    json_floats(doc, json_get(doc, node, "rotation"), r, 4);
+    json_floats(doc, json_get(doc, node, "scale"), s, 3);
+    *out =
+        XMMatrixScaling(s[0], s[1], s[2]) *
+        XMMatrixRotationQuaternion(XMVectorSet(r[0], r[1], r[2], r[3])) *
+        XMMatrixTranslation(t[0], t[1], t[2]);
+}
+
+static void
+free_gltf (GltfScene * scene) {
+    for (int i = 0; i < GLTF_MAX_BUFFERS; ++i) {
+        uint8_t const * data = scene->buffers[i].data;
+        bool in_glb = data >= scene->file.data && data < scene->file.data + scene->file.size;
+        if (data && !in_glb)
+            unmap_file(&scene->buffers[i]);
+    }
+    unmap_file(&scene->file);
+    json_free(&scene->json);
+    ::free(scene->meshes);
+    ::free(scene->primitives);
+    ::free(scene->materials);
+    ::free(scene->instances);
+    memset(scene, 0, sizeof(*scene));
+}
+// Parses the scene and resolves every accessor. The streams stay valid
+// until free_gltf. Returns false on unreadable or malformed files.
+static bool
+load_gltf (char const * path, GltfScene * scene) {
+    memset(scene, 0, sizeof(*scene));
+    if (!map_file(path, &scene->file))
+        return false;
+
+    // -- GLB container: 12 byte header, then a JSON chunk and an optional BIN chunk.
+    char const *    json_text = (char const *)scene->file.data;
+    uint32_t        json_length = (uint32_t)scene->file.size;
+    uint8_t const * bin = nullptr;
+    uint32_t        bin_length = 0;
+    uint32_t const * words = (uint32_t const *)scene->file.data;
+    if (scene->file.size >= 20 && GLTF_GLB_MAGIC == words[0]) {
+        uint32_t total = words[2] < scene->file.size ? words[2] : (uint32_t)scene->file.size;
+        json_length = words[3];
+        if (words[4] != GLTF_CHUNK_JSON || 20 + (uint64_t)json_length > total) {
+            free_gltf(scene);
+            return false;
+        }
+        json_text = (char const *)scene->file.data + 20;
+        uint64_t bin_header = 20 + (uint64_t)json_length;
+        if (bin_header + 8 <= total) {
+            uint32_t const * chunk = (uint32_t const *)(scene->file.data + bin_header);
+            if (GLTF_CHUNK_BIN == chunk[1] && bin_header + 8 + chunk[0] <= total) {
+                bin = scene->file.data + bin_header + 8;
+                bin_length = chunk[0];
+            }
+        }
+    }
+    if (!json_parse(json_text, (int)json_length, &scene->json)) {
+        free_gltf(scene);
+        return false;
+    }
+    JsonDoc const * doc = &scene->json;
+    int root = 0;
+
+    // -- Buffers: the GLB chunk is used in place, external files are mapped.
+    uint32_t buffer_sizes [GLTF_MAX_BUFFERS] = {};
+    int buffers = json_get(doc, root, "buffers");
+    int dir_len = 0;
+    for (int i = 0; path[i]; ++i)
+        if ('/' == path[i] || '\\' == path[i])
+            dir_len = i + 1;
+    for (int b = 0; b < json_size(doc, buffers) && b < GLTF_MAX_BUFFERS; ++b) {
+        int buf = json_at(doc, buffers, b);
+        int uri = json_get(doc, buf, "uri");
+        if (uri < 0) {
+            if (0 == b && bin) {
+                scene->buffers[b].data = bin;
+                scene->buffers[b].size = bin_length;
+                buffer_sizes[b] = bin_length;
+            }
+            continue;
+        }
+        // The raw token bounds the unescaped length; paths that don't fit
+        // are skipped like buffers that fail to map.
+        char buf_path [260];
+        int uri_len = doc->tokens[uri].end - doc->tokens[uri].start;
+        if ((size_t)(dir_len + uri_len) + 1 > sizeof(buf_path))
+            continue;
+        memcpy(buf_path, path, dir_len);
+        json_copy_string(doc, uri, buf_path + dir_len, (int)sizeof(buf_path) - dir_len);
+        if (0 == strncmp(buf_path + dir_len, "data:", 5))
+            continue;
+        if (map_file(buf_path, &scene->buffers[b]))
+            buffer_sizes[b] = (uint32_t)scene->buffers[b].size;
+    }
+
+    // -- Materials (only the base color is used by the demo).
+    int materials = json_get(doc, root, "materials");
+    scene->material_count = json_size(doc, materials);
+    scene->materials = (GltfMaterial *)::calloc(scene->material_count + 1, sizeof(GltfMaterial));
+    for (int m = 0; m < scene->material_count; ++m) {
+        int mat = json_at(doc, materials, m);
+        GltfMaterial * out = &scene->materials[m];
+        json_copy_string(doc, json_get(doc, mat, "name"), out->name, sizeof(out->name));
+        float c [4] = {1.0f, 1.0f, 1.0f, 1.0f};
+        json_floats(doc, json_get(doc, json_get(doc, mat, "pbrMetallicRoughness"), "baseColorFactor"), c, 4);
+        out->base_color = XMFLOAT4(c[0], c[1], c[2], c[3]);
+    }
+
+    // -- Meshes and their triangle primitives.
+    static char const * const attribute_names [GLTF_ATTRIBUTE_COUNT] = {
+        "POSITION", "NORMAL", "TANGENT", "TEXCOORD_0", "COLOR_0"
+    };
+    int meshes = json_get(doc, root, "meshes");
+    scene->mesh_count = json_size(doc, meshes);
+    scene->meshes = (GltfMesh *)::calloc(scene->mesh_count + 1, sizeof(GltfMesh));
+    int total_primitives = 0;
+    for (int m = 0; m < scene->mesh_count; ++m)
+        total_primitives += json_size(doc, json_get(doc, json_at(doc, meshes, m), "primitives"));
+    scene->primitives = (GltfPrimitive *)::calloc(total_primitives + 1, sizeof(GltfPrimitive));
+
+    for (int m = 0; m < scene->mesh_count; ++m) {
+        int mesh = json_at(doc, meshes, m);
+        GltfMesh * out = &scene->meshes[m];
+        json_copy_string(doc, json_get(doc, mesh, "name"), out->name, sizeof(out->name));
+        out->first_primitive = scene->primitive_count;
+
+        int prims = json_get(doc, mesh, "primitives");
+        for (int p = 0; p < json_size(doc, prims); ++p) {
+            int prim = json_at(doc, prims, p);
+            if (json_int(doc, json_get(doc, prim, "mode"), 4) != 4)
+                continue;   // points and lines are skipped
+            GltfPrimitive * dst = &scene->primitives[scene->primitive_count];
+            int attrs = json_get(doc, prim, "attributes");
+            for (int a = 0; a < GLTF_ATTRIBUTE_COUNT; ++a)
+                gltf_resolve_accessor(scene, buffer_sizes, json_int(doc, json_get(doc, attrs, attribute_names[a]), -1), &dst->attributes[a]);
+            GltfStream const & pos = dst->attributes[GLTF_POSITION];
+            if (nullptr == pos.data || pos.component_type != GLTF_FLOAT || pos.components != 3)
+                continue;
+            int indices = json_int(doc, json_get(doc, prim, "indices"), -1);
+            gltf_resolve_accessor(scene, buffer_sizes, indices, &dst->indices);
+            if (indices >= 0 && nullptr == dst->indices.data)
+                continue;
+            if (!gltf_primitive_valid(dst)) {
+                free_gltf(scene);
+                return false;
+            }
+            dst->material = json_int(doc, json_get(doc, prim, "material"), -1);
+
+            // POSITION min/max are mandatory, which gives bounds for free.
+            int acc = json_at(doc, json_get(doc, root, "accessors"), json_int(doc, json_get(doc, attrs, "POSITION"), -1));
+            float vmin [3], vmax [3];
+            if (3 == json_floats(doc, json_get(doc, acc, "min"), vmin, 3) && 3 == json_floats(doc, json_get(doc, acc, "max"), vmax, 3)) {
+                XMVECTOR lo = XMLoadFloat3((XMFLOAT3 *)vmin);
+                XMVECTOR hi = XMLoadFloat3((XMFLOAT3 *)vmax);
+                XMVECTOR extents = XMVectorScale(XMVectorSubtract(hi, lo), 0.5f);
+                XMStoreFloat3(&dst->bounds.aabb_center, XMVectorScale(XMVectorAdd(lo, hi), 0.5f));
+                XMStoreFloat3(&dst->bounds.aabb_extents, extents);
+                dst->bounds.sphere_center = dst->bounds.aabb_center;
+                dst->bounds.sphere_radius = XMVectorGetX(XMVector3Length(extents));
+            } else {
+                BoundsBuilder bb;
+                bounds_begin(&bb, XMFLOAT3(0.0f, 0.0f, 0.0f));
+                for (uint32_t i = 0; i < pos.count; ++i) {
+                    XMFLOAT3 p;
+                    memcpy(&p, pos.data + (size_t)i * pos.stride, sizeof(p));
+                    bounds_add(&bb, p);
+                }
+                bounds_end(&bb, &dst->bounds);
+            }
+            ++scene->primitive_count;
+        }
+        out->primitive_count = scene->primitive_count - out->first_primitive;
+    }
+
+    // -- Flatten the node hierarchy of the default scene.
+    int nodes = json_get(doc, root, "nodes");
+    int node_count = json_size(doc, nodes);
+    scene->instances = (GltfInstance *)::calloc(node_count + 1, sizeof(GltfInstance));
+    struct StackEntry { int node; XMFLOAT4X4 parent; int depth; };
+    int stack_capacity = node_count + 1;
+    StackEntry * stack = (StackEntry *)::malloc(sizeof(StackEntry) * stack_capacity);
+    int top = 0;
+
+    XMFLOAT4X4 rh_to_lh;
+    XMStoreFloat4x4(&rh_to_lh, XMMatrixScaling(1.0f, 1.0f, -1.0f));
+    int scenes = json_get(doc, root, "scenes");
+    int roots = json_get(doc, json_at(doc, scenes, json_int(doc, json_get(doc, root, "scene"), 0)), "nodes");
+    for (int i = json_size(doc, roots) - 1; i >= 0 && top < node_count; --i)
+        stack[top++] = {json_int(doc, json_at(doc, roots, i), -1), rh_to_lh, 0};
+    if (roots < 0) {
+        // No scene: draw every node that isn't somebody's child.
+        bool * is_child = (bool *)::calloc(node_count + 1, sizeof(bool));
+        for (int n = 0; n < node_count; ++n) {
+            int children = json_get(doc, json_at(doc, nodes, n), "children");
+            for (int c = 0; c < json_size(doc, children); ++c) {
+                int child = json_int(doc, json_at(doc, children, c), -1);
+                if (child >= 0 && child < node_count)
+                    is_child[child] = true;
+            }
+        }
+        for (int n = node_count - 1; n >= 0; --n)
+            if (!is_child[n])
+                stack[top++] = {n, rh_to_lh, 0};
+        ::free(is_child);
+    }
+    while (top > 0) {
+        StackEntry e = stack[--top];
+        int node = json_at(doc, nodes, e.node);
+        if (node < 0 || e.depth > node_count)
+            continue;       // bad index or a cycle
+        XMMATRIX local;
+        gltf_local_matrix(doc, node, &local);
+        XMMATRIX world = local * XMLoadFloat4x4(&e.parent);
+
+        int mesh = json_int(doc, json_get(doc, node, "mesh"), -1);
+        if (mesh >= 0 && mesh < scene->mesh_count && scene->instance_count < node_count) {
+            GltfInstance * inst = &scene->instances[scene->instance_count++];
+            inst->mesh = mesh;
+            XMStoreFloat4x4(&inst->world, world);
+        }
+        int children = json_get(doc, node, "children");
+        int child_count = json_size(doc, children);
+        if (top + child_count > stack_capacity) {
+            stack_capacity = top + child_count;
+            stack = (StackEntry *)::realloc(stack, sizeof(StackEntry) * stack_capacity);
+        }
+        for (int c = child_count - 1; c >= 0; --c) {
+            stack[top].node = json_int(doc, json_at(doc, children, c), -1);
+            XMStoreFloat4x4(&stack[top].parent, world);
+            stack[top].depth = e.depth + 1;
+            ++top;
+        }
+    }
+    ::free(stack);
+    return true;
+}
+
+// "<mesh>/<primitive>" into dst, the mesh name cut short where needed so the
+// primitive number always fits and the names of a mesh's primitives differ.
+static void
+gltf_primitive_name (char * dst, int dst_size, char const * mesh_name, int primitive) {
+    char suffix [16];
+    int suffix_len = snprintf(suffix, sizeof(suffix), "/%d", primitive);
+    int name_len = (int)strlen(mesh_name);
+    int room = dst_size - 1 - suffix_len;
+    if (name_len > room)
+        name_len = room > 0 ? room : 0;
+    snprintf(dst, dst_size, "%.*s%s", name_len, mesh_name, suffix);
+}
+
+// -- vertex and index sources
+
+// One float attribute of a vertex struct: 'components' floats at 'offset'.
+struct GltfVertexElement {
+    GltfAttribute   attribute;
+    uint32_t        offset;
+    int             components;
+};
+// Returns the address of vertex 0 if the primitive's attributes are already
+// interleaved in a single buffer view exactly like 'layout' with the given
+// stride, i.e. the mapped bytes can be uploaded as they are; else nullptr.
+static void const *
+gltf_match_interleaved (GltfPrimitive const * prim, GltfVertexElement const layout [], int element_count, uint32_t stride) {
+    GltfStream const & first = prim->attributes[layout[0].attribute];
+    if (nullptr == first.data || first.stride != stride)
+        return nullptr;
+    uint8_t const * base = first.data - layout[0].offset;
+    for (int i = 0; i < element_count; ++i) {
+        GltfStream const & s = prim->attributes[layout[i].attribute];
+        if (nullptr == s.data || s.buffer_view != first.buffer_view || s.stride != stride ||
+            s.component_type != GLTF_FLOAT || s.components != layout[i].components ||
+            s.count != first.count || s.data != base + layout[i].offset)
+            return nullptr;
+    }
+    return base;
+}
+// Reads element i of a stream as floats, applying normalization.
+static inline void
+gltf_read_element (GltfStream const & s, uint32_t i, float out [], int components) {
+    uint8_t const * p = s.data + (size_t)i * s.stride;
+    for (int c = 0; c < components; ++c) {
+        float v = 0.0f;
+        if (c < s.components) {
+            switch (s.component_type) {
+            case GLTF_FLOAT:            memcpy(&v, p + c * 4, 4); break;
+            case GLTF_UNSIGNED_BYTE:    v = s.normalized ? p[c] / 255.0f : (float)p[c]; break;
+            case GLTF_BYTE:             v = (float)((int8_t const *)p)[c]; if (s.normalized) v = (v < -127.0f) ? -1.0f : v / 127.0f; break;
+            case GLTF_UNSIGNED_SHORT:   { uint16_t u; memcpy(&u, p + c * 2, 2); v = s.normalized ? u / 65535.0f : (float)u; } break;
+            case GLTF_SHORT:            { int16_t u; memcpy(&u, p + c * 2, 2); v = (u < -32767 && s.normalized) ? -1.0f : (s.normalized ? u / 32767.0f : (float)u); } break;
+            case GLTF_UNSIGNED_INT:     { uint32_t u; memcpy(&u, p + c * 4, 4); v = (float)u; } break;
+            }
+        } else if (3 == c) {
+            v = 1.0f;       // alpha of an RGB color
+        }
+        out[c] = v;
+    }
+}
+// Converts one attribute into a strided float destination.
+static bool
+gltf_read_floats (GltfStream const & s, int components, void * dst, uint32_t dst_stride) {
+    if (nullptr == s.data)
+        return false;
+    uint8_t * out = (uint8_t *)dst;
+    for (uint32_t i = 0; i < s.count; ++i)
+        gltf_read_element(s, i, (float *)(out + (size_t)i * dst_stride), components);
+    return true;
+}
+// Vertex count of a primitive (that of its POSITION stream).
+static uint32_t
+gltf_vertex_count (GltfPrimitive const * prim) {
+    return prim->attributes[GLTF_POSITION].count;
+}
+static uint32_t
+gltf_index_count (GltfPrimitive const * prim) {
+    return prim->indices.data ? prim->indices.count : gltf_vertex_count(prim);
+}
+// Tightly packed uint32 indices can be used straight from the mapping.
+static int const *
+gltf_index_source (GltfPrimitive const * prim) {
+    GltfStream const & s = prim->indices;
+    if (s.data && GLTF_UNSIGNED_INT == s.component_type && 4 == s.stride && 0 == ((uintptr_t)s.data & 3))
+        return (int const *)s.data;
+    return nullptr;
+}
+// Widens (or generates, for non-indexed primitives) gltf_index_count indices.
+static void
+gltf_read_indices (GltfPrimitive const * prim, int dst []) {
+    GltfStream const & s = prim->indices;
+    uint32_t count = gltf_index_count(prim);
+    for (uint32_t i = 0; i < count; ++i) {
+        uint8_t const * p = s.data + (size_t)i * s.stride;
+        uint32_t v = i;
+        if (GLTF_UNSIGNED_BYTE == s.component_type)
+            v = p[0];
+        else if (GLTF_UNSIGNED_SHORT == s.component_type)
+            memcpy(&v, p, 2), v &= 0xffff;
+        else if (GLTF_UNSIGNED_INT == s.component_type)
+            memcpy(&v, p, 4);
+        dst[i] = (int)v;
+    }
+}
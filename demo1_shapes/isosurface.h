@@ -0,0 +1,467 @@
+#pragma once
+
+// Isosurface extraction from a sampled scalar field (signed distance
+// functions, metaballs, ...), using dual contouring with mass-point vertex
+// placement (surface nets): every cell whose corners straddle the iso value
+// gets one vertex at the average of its edge crossings, and every grid edge
+// with a sign change emits a quad joining the four cells around it.
+//
+// The volume is cut into ISO_BLOCK^3-cell blocks processed in parallel. A
+// block owns the vertices of its cells and welds them through a block-local
+// hash of cell ids; a quad that reaches into a lower neighbour is kept aside
+// and stitched once every block's table is built, so the output is one
+// welded mesh with no duplicated vertices along block borders.
+//
+// Convention: the field is negative inside and positive outside (an SDF);
+// normals come from the field gradient and point outward.
+
+#include "geometry.h"
+#include "parallel.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ISO_BLOCK   32
+
+// nx * ny * nz samples, x fastest; sample (i, j, k) sits at
+// origin + (i, j, k) * cell_size.
+struct IsoVolume {
+    float *     values;
+    int         nx;
+    int         ny;
+    int         nz;
+    XMFLOAT3    origin;
+    float       cell_size;
+};
+
+struct IsoMesh {
+    Vertex *    vertices;
+    int         vertex_count;
+    int *       indices;
+    int         index_count;
+    MeshBounds  bounds;
+};
+
+struct IsoMetaball {
+    XMFLOAT3    center;
+    float       radius;
+};
+
+// -- Fields
+static float
+iso_sdf_sphere (float x, float y, float z, float radius) {
+    return sqrtf(x * x + y * y + z * z) - radius;
+}
+static float
+iso_sdf_box (float x, float y, float z, float hx, float hy, float hz) {
+    float qx = fabsf(x) - hx;
+    float qy = fabsf(y) - hy;
+    float qz = fabsf(z) - hz;
+    float ox = fmaxf(qx, 0.0f);
+    float oy = fmaxf(qy, 0.0f);
+    float oz = fmaxf(qz, 0.0f);
+    return sqrtf(ox * ox + oy * oy + oz * oz) + fminf(fmaxf(qx, fmaxf(qy, qz)), 0.0f);
+}
+// Torus around the y axis.
+static float
+iso_sdf_torus (float x, float y, float z, float major_radius, float minor_radius) {
+    float q = sqrtf(x * x + z * z) - major_radius;
+    return sqrtf(q * q + y * y) - minor_radius;
+}
+// Polynomial smooth minimum; k is the blend distance.
+static float
+iso_smooth_union (float a, float b, float k) {
+    float h = fmaxf(k - fabsf(a - b), 0.0f) / k;
+    return fminf(a, b) - h * h * k * 0.25f;
+}
+// Sum of r^2/d^2 falloffs, remapped so the surface (sum == 1) is the zero
+// crossing and the inside is negative.
+static float
+iso_metaballs (IsoMetaball const balls [], int count, float x, float y, float z) {
+    float sum = 0.0f;
+    for (int i = 0; i < count; ++i) {
+        float dx = x - balls[i].center.x;
+        float dy = y - balls[i].center.y;
+        float dz = z - balls[i].center.z;
+        sum += balls[i].radius * balls[i].radius / (dx * dx + dy * dy + dz * dz + 1e-6f);
+    }
+    return 1.0f - sum;
+}
+
+// -- Volumes
+static void
+iso_volume_create (IsoVolume * volume, int nx, int ny, int nz, XMFLOAT3 origin, float cell_size) {
+    volume->values = (float *)::malloc(sizeof(float) * nx * ny * nz);
+    volume->nx = nx;
+    volume->ny = ny;
+    volume->nz = nz;
+    volume->origin = origin;
+    volume->cell_size = cell_size;
+}
+static void
+iso_volume_destroy (IsoVolume * volume) {
+    ::free(volume->values);
+    memset(volume, 0, sizeof(*volume));
+}
+// field(x, y, z) is evaluated at every sample, in parallel z slabs.
+template <typename Field>
+static void
+iso_sample_field (IsoVolume * volume, Field && field) {
+    int nx = volume->nx;
+    int ny = volume->ny;
+    float h = volume->cell_size;
+    XMFLOAT3 o = volume->origin;
+    parallel_for(volume->nz, 4, [&](int begin, int end, int) {
+        for (int k = begin; k < end; ++k) {
+            float * out = volume->values + (size_t)k * nx * ny;
+            for (int j = 0; j < ny; ++j)
+                for (int i = 0; i < nx; ++i)
+                    *out++ = field(o.x + i * h, o.y + j * h, o.z + k * h);
+        }
+    });
+}
+
+// -- Extraction
+// Per-block output. Local triangles index 'vertices'; border quads hold
+// the global ids of their four cells, already in winding order.
+struct IsoBlock {
+    Vertex *    vertices;
+    int *       cells;              // global cell id of every vertex
+    int         vertex_count;
+    int         vertex_capacity;
+
+    int *       hash_keys;          // cell id -> local vertex, open addressing
+    int *       hash_values;
+    int         hash_mask;
+
+    int *       indices;
+    int         index_count;
+    int         index_capacity;
+
+    int *       border;
+    int         border_count;       // quads
+    int         border_capacity;
+
+    int         vertex_base;
+    int         index_base;
+    XMFLOAT3    vmin;               // not XMVECTOR: blocks are calloc'd
+    XMFLOAT3    vmax;
+};
+
+static inline int
+iso_hash_slot (int cell, int mask) {
+    return (int)(((unsigned)cell * 2654435761u) >> 7) & mask;
+}
+static int
+iso_block_find (IsoBlock const * block, int cell) {
+    for (int s = iso_hash_slot(cell, block->hash_mask); ; s = (s + 1) & block->hash_mask) {
+        int key = block->hash_keys[s];
+        if (key == cell)
+            return block->hash_values[s];
+        if (key < 0)
+            return -1;
+    }
+}
+static void
+iso_block_build_hash (IsoBlock * block) {
+    int size = 16;
+    while (size < block->vertex_count * 2)
+        size *= 2;
+    block->hash_mask = size - 1;
+    block->hash_keys = (int *)::malloc(sizeof(int) * size);
+    block->hash_values = (int *)::malloc(sizeof(int) * size);
+    memset(block->hash_keys, 0xff, sizeof(int) * size);
+    for (int v = 0; v < block->vertex_count; ++v) {
+        int s = iso_hash_slot(block->cells[v], block->hash_mask);
+        while (block->hash_keys[s] >= 0)
+            s = (s + 1) & block->hash_mask;
+        block->hash_keys[s] = block->cells[v];
+        block->hash_values[s] = v;
+    }
+}
+template <typename T>
+static T *
+iso_grow (T * data, int count, int * capacity, int needed) {
+    if (count + needed <= *capacity)
+        return data;
+    int new_capacity = *capacity > 0 ? *capacity * 2 : 256;
+    while (new_capacity < count + needed)
+        new_capacity *= 2;
+    *capacity = new_capacity;
+    return (T *)::realloc(data, sizeof(T) * new_capacity);
+}
+
+// Field gradient at sample (i, j, k): central differences, one-sided on the
+// volume faces.
+static XMVECTOR
+iso_sample_gradient (IsoVolume const * volume, int i, int j, int k) {
+    int nx = volume->nx;
+    int ny = volume->ny;
+    int nz = volume->nz;
+    size_t sx = 1;
+    size_t sy = (size_t)nx;
+    size_t sz = (size_t)nx * ny;
+    float const * v = volume->values + i * sx + j * sy + k * sz;
+    int i0 = i > 0 ? 1 : 0, i1 = i < nx - 1 ? 1 : 0;
+    int j0 = j > 0 ? 1 : 0, j1 = j < ny - 1 ? 1 : 0;
+    int k0 = k > 0 ? 1 : 0, k1 = k < nz - 1 ? 1 : 0;
+    float gx = (v[i1 * sx] - v[-(ptrdiff_t)(i0 * sx)]) / (float)(i0 + i1);
+    float gy = (v[j1 * sy] - v[-(ptrdiff_t)(j0 * sy)]) / (float)(j0 + j1);
+    float gz = (v[k1 * sz] - v[-(ptrdiff_t)(k0 * sz)]) / (float)(k0 + k1);
+    return XMVectorSet(gx, gy, gz, 0.0f);
+}
+
+// Emits the vertices and quads of the cells in [c0, c1).
+static void
+iso_extract_block (IsoVolume const * volume, float iso, int const c0 [3], int const c1 [3], IsoBlock * block) {
+    static int const corner_offsets [8][3] = {
+        {0, 0, 0}, {1, 0, 0}, {0, 1, 0}, {1, 1, 0},
+        {0, 0, 1}, {1, 0, 1}, {0, 1, 1}, {1, 1, 1},
+    };
+    static int const cell_edges [12][2] = {
+        {0, 1}, {2, 3}, {4, 5}, {6, 7},     // along x
+        {0, 2}, {1, 3}, {4, 6}, {5, 7},     // along y
+        {0, 4}, {1, 5}, {2, 6}, {3, 7},     // along z
+    };
+    int nx = volume->nx;
+    int ny = volume->ny;
+    int nz = volume->nz;
+    int cx = nx - 1;
+    int cy = ny - 1;
+    int dims [3] = {nx, ny, nz};
+    size_t stride [3] = {1, (size_t)nx, (size_t)nx * ny};
+    float h = volume->cell_size;
+    float extent_x = cx * h;
+    float extent_z = (nz - 1) * h;
+
+    XMVECTOR vmin = XMVectorReplicate(+FLT_MAX);
+    XMVECTOR vmax = XMVectorReplicate(-FLT_MAX);
+
+    // -- One vertex per cell crossed by the surface.
+    for (int z = c0[2]; z < c1[2]; ++z)
+    for (int y = c0[1]; y < c1[1]; ++y)
+    for (int x = c0[0]; x < c1[0]; ++x) {
+        float const * base = volume->values + x + y * stride[1] + z * stride[2];
+        float corner [8];
+        int mask = 0;
+        for (int c = 0; c < 8; ++c) {
+            corner[c] = base[corner_offsets[c][0] + corner_offsets[c][1] * stride[1] + corner_offsets[c][2] * stride[2]];
+            mask |= (corner[c] < iso ? 1 : 0) << c;
+        }
+        if (0 == mask || 0xff == mask)
+            continue;
+
+        float px = 0.0f, py = 0.0f, pz = 0.0f;
+        int crossings = 0;
+        for (int e = 0; e < 12; ++e) {
+            int a = cell_edges[e][0];
+            int b = cell_edges[e][1];
+            if (((mask >> a) & 1) == ((mask >> b) & 1))
+                continue;
+            float t = (iso - corner[a]) / (corner[b] - corner[a]);
+            px += corner_offsets[a][0] + t * (corner_offsets[b][0] - corner_offsets[a][0]);
+            py += corner_offsets[a][1] + t * (corner_offsets[b][1] - corner_offsets[a][1]);
+            pz += corner_offsets[a][2] + t * (corner_offsets[b][2] - corner_offsets[a][2]);
+            ++crossings;
+        }
+        float u = px / crossings;
+        float v = py / crossings;
+        float w = pz / crossings;
+
+        // Trilinear blend of the corner gradients at the vertex.
+        XMVECTOR g = XMVectorZero();
+        for (int c = 0; c < 8; ++c) {
+            float weight =
+                (corner_offsets[c][0] ? u : 1.0f - u) *
+                (corner_offsets[c][1] ? v : 1.0f - v) *
+                (corner_offsets[c][2] ? w : 1.0f - w);
+            XMVECTOR gc = iso_sample_gradient(volume, x + corner_offsets[c][0], y + corner_offsets[c][1], z + corner_offsets[c][2]);
+            g = XMVectorMultiplyAdd(XMVectorReplicate(weight), gc, g);
+        }
+        XMVECTOR n = XMVectorGetX(XMVector3LengthSq(g)) > 1e-20f ? XMVector3Normalize(g) : XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+        // Tangent: +x projected onto the tangent plane (+z where the normal
+        // is along x), matching texture coordinates planar in xz.
+        XMVECTOR axis = fabsf(XMVectorGetX(n)) < 0.99f ? XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f) : XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f);
+        XMVECTOR tangent = XMVector3Normalize(XMVectorSubtract(axis, XMVectorMultiply(n, XMVector3Dot(n, axis))));
+
+        int capacity = block->vertex_capacity;
+        block->vertices = iso_grow(block->vertices, block->vertex_count, &block->vertex_capacity, 1);
+        if (capacity != block->vertex_capacity)
+            block->cells = (int *)::realloc(block->cells, sizeof(int) * block->vertex_capacity);
+        Vertex & out = block->vertices[block->vertex_count];
+        out.position.x = volume->origin.x + (x + u) * h;
+        out.position.y = volume->origin.y + (y + v) * h;
+        out.position.z = volume->origin.z + (z + w) * h;
+        XMStoreFloat3(&out.normal, n);
+        XMStoreFloat3(&out.tangent_u, tangent);
+        out.texc.x = (x + u) * h / extent_x;
+        out.texc.y = (z + w) * h / extent_z;
+        block->cells[block->vertex_count++] = x + y * cx + z * cx * cy;
+
+        XMVECTOR p = XMLoadFloat3(&out.position);
+        vmin = XMVectorMin(vmin, p);
+        vmax = XMVectorMax(vmax, p);
+    }
+    XMStoreFloat3(&block->vmin, vmin);
+    XMStoreFloat3(&block->vmax, vmax);
+    iso_block_build_hash(block);
+
+    // -- One quad per sign-changing grid edge starting at a sample of this
+    // block. The four cells around the edge run +b then +c, (a, b, c)
+    // cyclic, which faces +a: keep that order when the edge leaves the
+    // inside, flip it otherwise.
+    for (int z = c0[2]; z < c1[2]; ++z)
+    for (int y = c0[1]; y < c1[1]; ++y)
+    for (int x = c0[0]; x < c1[0]; ++x) {
+        int p [3] = {x, y, z};
+        float const * sample = volume->values + x + y * stride[1] + z * stride[2];
+        bool inside = *sample < iso;
+        for (int a = 0; a < 3; ++a) {
+            int b = (a + 1) % 3;
+            int c = (a + 2) % 3;
+            if (0 == p[b] || 0 == p[c] || p[b] >= dims[b] - 1 || p[c] >= dims[c] - 1)
+                continue;
+            if ((sample[stride[a]] < iso) == inside)
+                continue;
+
+            int q [4][3];
+            for (int s = 0; s < 4; ++s) {
+                q[s][0] = x;
+                q[s][1] = y;
+                q[s][2] = z;
+            }
+            q[0][b] -= 1; q[0][c] -= 1;
+            q[1][c] -= 1;
+            q[3][b] -= 1;
+            int ids [4];
+            bool local = true;
+            for (int s = 0; s < 4; ++s) {
+                ids[s] = q[s][0] + q[s][1] * cx + q[s][2] * cx * cy;
+                local = local && q[s][b] >= c0[b] && q[s][c] >= c0[c];
+            }
+            if (!inside) {
+                int t = ids[1];
+                ids[1] = ids[3];
+                ids[3] = t;
+            }
+            if (local) {
+                block->indices = iso_grow(block->indices, block->index_count, &block->index_capacity, 6);
+                int l [4];
+                for (int s = 0; s < 4; ++s)
+                    l[s] = iso_block_find(block, ids[s]);
+                int * out = block->indices + block->index_count;
+                out[0] = l[0]; out[1] = l[1]; out[2] = l[2];
+                out[3] = l[0]; out[4] = l[2]; out[5] = l[3];
+                block->index_count += 6;
+            } else {
+                block->border = iso_grow(block->border, block->border_count * 4, &block->border_capacity, 4);
+                memcpy(block->border + block->border_count * 4, ids, sizeof(ids));
+                ++block->border_count;
+            }
+        }
+    }
+}
+
+// Extracts the surface field == iso into 'out_mesh' (allocated here,
+// released with free_iso_mesh). Returns false for volumes under 2^3 samples.
+static bool
+extract_isosurface (IsoVolume const * volume, float iso, IsoMesh * out_mesh) {
+    memset(out_mesh, 0, sizeof(*out_mesh));
+    if (volume->nx < 2 || volume->ny < 2 || volume->nz < 2)
+        return false;
+
+    int cells [3] = {volume->nx - 1, volume->ny - 1, volume->nz - 1};
+    int blocks [3];
+    for (int a = 0; a < 3; ++a)
+        blocks[a] = (cells[a] + ISO_BLOCK - 1) / ISO_BLOCK;
+    int block_count = blocks[0] * blocks[1] * blocks[2];
+    IsoBlock * block_data = (IsoBlock *)::calloc(block_count, sizeof(IsoBlock));
+
+    parallel_for(block_count, 1, [&](int begin, int end, int) {
+        for (int b = begin; b < end; ++b) {
+            int coord [3] = {b % blocks[0], (b / blocks[0]) % blocks[1], b / (blocks[0] * blocks[1])};
+            int c0 [3], c1 [3];
+            for (int a = 0; a < 3; ++a) {
+                c0[a] = coord[a] * ISO_BLOCK;
+                c1[a] = c0[a] + ISO_BLOCK < cells[a] ? c0[a] + ISO_BLOCK : cells[a];
+            }
+            iso_extract_block(volume, iso, c0, c1, &block_data[b]);
+        }
+    });
+
+    // -- Place every block in the output.
+    int vertex_count = 0;
+    int index_count = 0;
+    XMVECTOR vmin = XMVectorReplicate(+FLT_MAX);
+    XMVECTOR vmax = XMVectorReplicate(-FLT_MAX);
+    for (int b = 0; b < block_count; ++b) {
+        IsoBlock & block = block_data[b];
+        block.vertex_base = vertex_count;
+        block.index_base = index_count;
+        vertex_count += block.vertex_count;
+        index_count += block.index_count + block.border_count * 6;
+        vmin = XMVectorMin(vmin, XMLoadFloat3(&block.vmin));
+        vmax = XMVectorMax(vmax, XMLoadFloat3(&block.vmax));
+    }
+    out_mesh->vertices = (Vertex *)::malloc(sizeof(Vertex) * (vertex_count + 1));
+    out_mesh->indices = (int *)::malloc(sizeof(int) * (index_count + 1));
+    out_mesh->vertex_count = vertex_count;
+    out_mesh->index_count = index_count;
+
+    // -- Copy out and stitch the border quads through the owning blocks'
+    // tables, which are read-only by now.
+    parallel_for(block_count, 1, [&](int begin, int end, int) {
+        for (int b = begin; b < end; ++b) {
+            IsoBlock const & block = block_data[b];
+            if (block.vertex_count > 0)
+                memcpy(out_mesh->vertices + block.vertex_base, block.vertices, sizeof(Vertex) * block.vertex_count);
+            int * out = out_mesh->indices + block.index_base;
+            for (int i = 0; i < block.index_count; ++i)
+                *out++ = block.indices[i] + block.vertex_base;
+            for (int q = 0; q < block.border_count; ++q) {
+                int l [4];
+                for (int s = 0; s < 4; ++s) {
+                    int id = block.border[q * 4 + s];
+                    int x = id % cells[0];
+                    int y = (id / cells[0]) % cells[1];
+                    int z = id / (cells[0] * cells[1]);
+                    int owner = x / ISO_BLOCK + (y / ISO_BLOCK) * blocks[0] + (z / ISO_BLOCK) * blocks[0] * blocks[1];
+                    l[s] = iso_block_find(&block_data[owner], id) + block_data[owner].vertex_base;
+                }
+                out[0] = l[0]; out[1] = l[1]; out[2] = l[2];
+                out[3] = l[0]; out[4] = l[2]; out[5] = l[3];
+                out += 6;
+            }
+        }
+    });
+
+    for (int b = 0; b < block_count; ++b) {
+        IsoBlock & block = block_data[b];
+        ::free(block.vertices);
+        ::free(block.cells);
+        ::free(block.hash_keys);
+        ::free(block.hash_values);
+        ::free(block.indices);
+        ::free(block.border);
+    }
+    ::free(block_data);
+
+    // The sphere is centered on the box the blocks gathered.
+    if (vertex_count > 0) {
+        XMFLOAT3 pivot;
+        XMStoreFloat3(&pivot, XMVectorMultiply(XMVectorAdd(vmin, vmax), XMVectorReplicate(0.5f)));
+        BoundsBuilder builder;
+        bounds_begin(&builder, pivot);
+        for (int v = 0; v < vertex_count; ++v)
+            bounds_add(&builder, out_mesh->vertices[v].position);
+        bounds_end(&builder, &out_mesh->bounds);
+    }
+    return true;
+}
+static void
+free_iso_mesh (IsoMesh * mesh) {
+    ::free(mesh->vertices);
+    ::free(mesh->indices);
+    memset(mesh, 0, sizeof(*mesh));
+}
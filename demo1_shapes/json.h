@@ -0,0 +1,267 @@
+#pragma once
+
+// Small JSON reader: the text is tokenized into one flat array, each token
+// pointing back into the source. Containers record how many children they
+// have and where their subtree ends, so lookups walk siblings without
+// recursion. Array elements are also listed in a side table once parsing
+// is done, so json_at is a lookup rather than a walk: glTF indexes its
+// accessors, views and nodes by position, and those arrays get long.
+// Strings keep their escapes; json_equals and json_copy_string only decode
+// the simple ones, which is all glTF needs.
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum JsonType : uint8_t {
+    JSON_NULL,
+    JSON_BOOL,
+    JSON_NUMBER,
+    JSON_STRING,
+    JSON_ARRAY,
+    JSON_OBJECT,
+};
+
+struct JsonToken {
+    JsonType    type;
+    int         start;      // strings: first char after the quote
+    int         end;
+    int         size;       // arrays: elements, objects: key/value pairs
+    int         next;       // first token after this subtree
+    int         elements;   // arrays: first entry in JsonDoc::elements
+};
+
+struct JsonDoc {
+    char const *    text;
+    JsonToken *     tokens;
+    int             count;
+    int             capacity;
+    int *           elements;   // token of every array element, array by array
+};
+
+#define JSON_MAX_DEPTH  64
+
+static int
+json_push (JsonDoc * doc, JsonType type, int start) {
+    if (doc->count == doc->capacity) {
+        doc->capacity = doc->capacity ? doc->capacity * 2 : 256;
+        doc->tokens = (JsonToken *)::realloc(doc->tokens, sizeof(JsonToken) * doc->capacity);
+    }
+    JsonToken * t = &doc->tokens[doc->count];
+    t->type = type;
+    t->start = start;
+    t->end = start;
+    t->size = 0;
+    t->next = 0;
+    t->elements = 0;
+    return doc->count++;
+}
+static inline int
+json_skip_ws (char const * s, int pos, int len) {
+    while (pos < len && (' ' == s[pos] || '\t' == s[pos] || '\n' == s[pos] || '\r' == s[pos]))
+        ++pos;
+    return pos;
+}
+// Parses one value at 'pos'; returns the position after it or -1.
+static int
+json_parse_value (JsonDoc * doc, int pos, int len, int depth) {
+    char const * s = doc->text;
+    pos = json_skip_ws(s, pos, len);
+    if (pos >= len || depth > JSON_MAX_DEPTH)
+        return -1;
+
+    char c = s[pos];
+    if ('{' == c || '[' == c) {
+        bool object = '{' == c;
+        int tok = json_push(doc, object ? JSON_OBJECT : JSON_ARRAY, pos);
+        int count = 0;
+        pos = json_skip_ws(s, pos + 1, len);
+        if (pos < len && s[pos] == (object ? '}' : ']')) {
+            ++pos;
+        } else {
+            for (;;) {
+                if (object) {
+                    pos = json_skip_ws(s, pos, len);
+                    if (pos >= len || s[pos] != '"')
+                        return -1;
+                    pos = json_parse_value(doc, pos, len, depth + 1);
+                    if (pos < 0)
+                        return -1;
+                    pos = json_skip_ws(s, pos, len);
+                    if (pos >= len || s[pos] != ':')
+                        return -1;
+                    ++pos;
+                }
+                pos = json_parse_value(doc, pos, len, depth + 1);
+                if (pos < 0)
+                    return -1;
+                ++count;
+                pos = json_skip_ws(s, pos, len);
+                if (pos < len && ',' == s[pos]) {
+                    ++pos;
+                    continue;
+                }
+                if (pos < len && s[pos] == (object ? '}' : ']')) {
+                    ++pos;
+                    break;
+                }
+                return -1;
+            }
+        }
+        doc->tokens[tok].size = count;
+        doc->tokens[tok].end = pos;
+        doc->tokens[tok].next = doc->count;
+        return pos;
+    }
+    if ('"' == c) {
+        int tok = json_push(doc, JSON_STRING, pos + 1);
+        ++pos;
+        while (pos < len && s[pos] != '"')
+            pos += ('\\' == s[pos]) ? 2 : 1;
+        if (pos >= len)
+            return -1;
+        doc->tokens[tok].end = pos;
+        doc->tokens[tok].next = doc->count;
+        return pos + 1;
+    }
+    // number, true, false, null
+    int tok = json_push(doc, JSON_NUMBER, pos);
+    if ('t' == c || 'f' == c)
+        doc->tokens[tok].type = JSON_BOOL;
+    else if ('n' == c)
+        doc->tokens[tok].type = JSON_NULL;
+    while (pos < len && s[pos] != ',' && s[pos] != '}' && s[pos] != ']' &&
+           s[pos] != ' ' && s[pos] != '\t' && s[pos] != '\n' && s[pos] != '\r')
+        ++pos;
+    if (pos == doc->tokens[tok].start)
+        return -1;
+    doc->tokens[tok].end = pos;
+    doc->tokens[tok].next = doc->count;
+    return pos;
+}
+static void
+json_free (JsonDoc * doc) {
+    ::free(doc->tokens);
+    ::free(doc->elements);
+    memset(doc, 0, sizeof(*doc));
+}
+// Lists the elements of every array in one pass; each token is some array's
+// element at most once, so the table never outgrows the token count.
+static void
+json_index_arrays (JsonDoc * doc) {
+    doc->elements = (int *)::malloc(sizeof(int) * (doc->count + 1));
+    int n = 0;
+    for (int a = 0; a < doc->count; ++a) {
+        JsonToken * arr = &doc->tokens[a];
+        if (arr->type != JSON_ARRAY)
+            continue;
+        arr->elements = n;
+        int t = a + 1;
+        for (int i = 0; i < arr->size; ++i) {
+            doc->elements[n++] = t;
+            t = doc->tokens[t].next;
+        }
+    }
+}
+// 'text' must outlive the document. Returns false on malformed input.
+static bool
+json_parse (char const * text, int len, JsonDoc * doc) {
+    memset(doc, 0, sizeof(*doc));
+    doc->text = text;
+    if (json_parse_value(doc, 0, len, 0) < 0) {
+        json_free(doc);
+        return false;
+    }
+    json_index_arrays(doc);
+    return true;
+}
+
+// -- lookups; token indices, -1 when absent
+
+static bool
+json_equals (JsonDoc const * doc, int tok, char const * str) {
+    if (tok < 0 || doc->tokens[tok].type != JSON_STRING)
+        return false;
+    int len = doc->tokens[tok].end - doc->tokens[tok].start;
+    return (int)strlen(str) == len && 0 == memcmp(doc->text + doc->tokens[tok].start, str, len);
+}
+static int
+json_get (JsonDoc const * doc, int obj, char const * key) {
+    if (obj < 0 || doc->tokens[obj].type != JSON_OBJECT)
+        return -1;
+    int t = obj + 1;
+    for (int i = 0; i < doc->tokens[obj].size; ++i) {
+        int value = doc->tokens[t].next;
+        if (json_equals(doc, t, key))
+            return value;
+        t = doc->tokens[value].next;
+    }
+    return -1;
+}
+static int
+json_at (JsonDoc const * doc, int arr, int index) {
+    if (arr < 0 || doc->tokens[arr].type != JSON_ARRAY || index < 0 || index >= doc->tokens[arr].size)
+        return -1;
+    return doc->elements[doc->tokens[arr].elements + index];
+}
+static int
+json_size (JsonDoc const * doc, int tok) {
+    return tok < 0 ? 0 : doc->tokens[tok].size;
+}
+static double
+json_number (JsonDoc const * doc, int tok, double fallback) {
+    if (tok < 0 || doc->tokens[tok].type != JSON_NUMBER)
+        return fallback;
+    char buf [64];
+    int len = doc->tokens[tok].end - doc->tokens[tok].start;
+    if (len > 63)
+        len = 63;
+    memcpy(buf, doc->text + doc->tokens[tok].start, len);
+    buf[len] = 0;
+    return strtod(buf, nullptr);
+}
+// Out of int range (or NaN) is treated as absent rather than cast, which
+// would be undefined; fractions are truncated.
+static int
+json_int (JsonDoc const * doc, int tok, int fallback) {
+    double v = json_number(doc, tok, fallback);
+    if (!(v > (double)INT_MIN - 1.0 && v < (double)INT_MAX + 1.0))
+        return fallback;
+    return (int)v;
+}
+static bool
+json_bool (JsonDoc const * doc, int tok, bool fallback) {
+    if (tok < 0 || doc->tokens[tok].type != JSON_BOOL)
+        return fallback;
+    return 't' == doc->text[doc->tokens[tok].start];
+}
+// Copies a string value into dst (truncating), decoding simple escapes.
+static void
+json_copy_string (JsonDoc const * doc, int tok, char * dst, int dst_size) {
+    int n = 0;
+    if (tok >= 0 && doc->tokens[tok].type == JSON_STRING) {
+        char const * s = doc->text;
+        for (int i = doc->tokens[tok].start; i < doc->tokens[tok].end && n < dst_size - 1; ++i) {
+            char c = s[i];
+            if ('\\' == c && i + 1 < doc->tokens[tok].end) {
+                c = s[++i];
+                if ('n' == c) c = '\n';
+                else if ('t' == c) c = '\t';
+            }
+            dst[n++] = c;
+        }
+    }
+    dst[n] = 0;
+}
+// Reads up to 'count' numbers from an array into dst; returns how many.
+static int
+json_floats (JsonDoc const * doc, int arr, float dst [], int count) {
+    int n = json_size(doc, arr) < count ? json_size(doc, arr) : count;
+    int t = arr + 1;
+    for (int i = 0; i < n; ++i) {
+        dst[i] = (float)json_number(doc, t, 0.0);
+        t = doc->tokens[t].next;
+    }
+    return n;
+}
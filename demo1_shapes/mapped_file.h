@@ -0,0 +1,89 @@
+#pragma once
+
+// Read-only memory mapping of a whole file, Win32 or POSIX.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+struct MappedFile {
+    uint8_t const * data;
+    size_t          size;
+#if defined(_WIN32)
+    HANDLE          file;
+    HANDLE          mapping;
+#else
+    int             fd;
+#endif
+};
+
+static void
+unmap_file (MappedFile * mf) {
+#if defined(_WIN32)
+    if (mf->data)
+        UnmapViewOfFile(mf->data);
+    if (mf->mapping)
+        CloseHandle(mf->mapping);
+    if (mf->file && mf->file != INVALID_HANDLE_VALUE)
+        CloseHandle(mf->file);
+#else
+    if (mf->data)
+        munmap((void *)mf->data, mf->size);
+    if (mf->fd >= 0)
+        close(mf->fd);
+#endif
+    memset(mf, 0, sizeof(*mf));
+#if !defined(_WIN32)
+    mf->fd = -1;
+#endif
+}
+// Returns false if the file can't be opened or is empty.
+static bool
+map_file (char const * path, MappedFile * mf) {
+    memset(mf, 0, sizeof(*mf));
+#if defined(_WIN32)
+    mf->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (INVALID_HANDLE_VALUE == mf->file) {
+        mf->file = nullptr;
+        return false;
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(mf->file, &file_size) || 0 == file_size.QuadPart) {
+        unmap_file(mf);
+        return false;
+    }
+    mf->size = (size_t)file_size.QuadPart;
+    mf->mapping = CreateFileMappingA(mf->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (nullptr == mf->mapping) {
+        unmap_file(mf);
+        return false;
+    }
+    mf->data = (uint8_t const *)MapViewOfFile(mf->mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+    mf->fd = open(path, O_RDONLY);
+    if (mf->fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(mf->fd, &st) != 0 || 0 == st.st_size) {
+        unmap_file(mf);
+        return false;
+    }
+    mf->size = (size_t)st.st_size;
+    void * p = mmap(nullptr, mf->size, PROT_READ, MAP_PRIVATE, mf->fd, 0);
+    mf->data = (MAP_FAILED == p) ? nullptr : (uint8_t const *)p;
+#endif
+    if (nullptr == mf->data) {
+        unmap_file(mf);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,256 @@
+#pragma once
+
+// Binary mesh cache: one file holding the vertex and index data of every
+// mesh plus the mesh table describing where each one goes. Each mesh is
+// compressed with the codecs in mesh_codec.h; the file is mapped and the
+// meshes are decoded in parallel straight from the mapping.
+//
+// Layout (all sections start on a MESH_CACHE_ALIGN boundary):
+//   MeshCacheHeader
+//   MeshCacheEntry [mesh_count]
+//   vertex blob    encoded vertex streams, one per mesh
+//   index blob     encoded index streams, one per mesh
+//
+// The header carries a key hashed from everything the content was built
+// from (generator parameters, vertex layout, format version); a cache whose
+// key or version doesn't match is ignored and rebuilt.
+
+#include "bounds.h"
+#include "mapped_file.h"
+#include "mesh_codec.h"
+#include "parallel.h"
+
+#include <atomic>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define MESH_CACHE_MAGIC    0x4853454du // "MESH"
+#define MESH_CACHE_VERSION  2
+#define MESH_CACHE_ALIGN    64
+
+struct MeshCacheHeader {
+    uint32_t    magic;
+    uint32_t    version;
+    uint64_t    key;
+
+    uint32_t    mesh_count;
+    uint32_t    vertex_stride;
+    uint32_t    vertex_count;       // decoded totals
+    uint32_t    index_count;
+
+    uint64_t    entries_offset;
+    uint64_t    vertices_offset;
+    uint64_t    indices_offset;
+    uint64_t    file_size;
+};
+
+// base_vertex/first_index place the decoded mesh in the packed arrays; the
+// *_data fields locate its encoded streams inside the vertex/index blobs.
+struct MeshCacheEntry {
+    char        name [32];
+    int         base_vertex;
+    uint32_t    vertex_count;
+    uint32_t    first_index;
+    uint32_t    index_count;
+    MeshBounds  bounds;
+
+    uint32_t    vertex_data_offset;
+    uint32_t    vertex_data_size;
+    uint32_t    index_data_offset;
+    uint32_t    index_data_size;
+};
+
+// A mapped cache file; the pointers reference the mapping directly.
+struct MeshCache {
+    MappedFile              file;
+    MeshCacheHeader const * header;
+    MeshCacheEntry const *  entries;
+    uint8_t const *         vertex_data;
+    uint8_t const *         index_data;
+};
+
+// -- Cache keys: FNV-1a 64 over the bytes of every input.
+static uint64_t
+mesh_cache_key_begin () {
+    uint64_t key = 14695981039346656037ull;
+    uint32_t version = MESH_CACHE_VERSION;
+    uint8_t const * p = (uint8_t const *)&version;
+    for (size_t i = 0; i < sizeof(version); ++i)
+        key = (key ^ p[i]) * 1099511628211ull;
+    return key;
+}
+static uint64_t
+mesh_cache_key_add (uint64_t key, void const * data, size_t size) {
+    uint8_t const * p = (uint8_t const *)data;
+    for (size_t i = 0; i < size; ++i)
+        key = (key ^ p[i]) * 1099511628211ull;
+    return key;
+}
+
+static inline uint64_t
+mesh_cache_align (uint64_t offset) {
+    return (offset + MESH_CACHE_ALIGN - 1) & ~(uint64_t)(MESH_CACHE_ALIGN - 1);
+}
+// 'entries' describe the meshes packed in 'vertices'/'indices'; their
+// *_data fields are filled in here.
+static bool
+mesh_cache_write (
+    char const * path, uint64_t key,
+    MeshCacheEntry const entries [], uint32_t mesh_count,
+    void const * vertices, uint32_t vertex_stride, uint32_t vertex_count,
+    int const indices [], uint32_t index_count
+) {
+    // -- Encode every mesh into two blobs.
+    size_t vertex_capacity = 0;
+    size_t index_capacity = 0;
+    for (uint32_t m = 0; m < mesh_count; ++m) {
+        vertex_capacity += encode_vertex_buffer_bound(entries[m].vertex_count, vertex_stride);
+        index_capacity += encode_index_buffer_bound(entries[m].index_count);
+    }
+    MeshCacheEntry * out_entries = (MeshCacheEntry *)::malloc(sizeof(MeshCacheEntry) * (mesh_count + 1));
+    uint8_t * vertex_blob = (uint8_t *)::malloc(vertex_capacity + 1);
+    uint8_t * index_blob = (uint8_t *)::malloc(index_capacity + 1);
+    size_t vertex_size = 0;
+    size_t index_size = 0;
+    bool ok = true;
+    for (uint32_t m = 0; m < mesh_count && ok; ++m) {
+        MeshCacheEntry & e = out_entries[m];
+        e = entries[m];
+        uint8_t const * mesh_vertices = (uint8_t const *)vertices + (size_t)e.base_vertex * vertex_stride;
+        int const * mesh_indices = indices + e.first_index;
+        size_t vsz = encode_vertex_buffer(vertex_blob + vertex_size, vertex_capacity - vertex_size, mesh_vertices, e.vertex_count, vertex_stride);
+        size_t isz = encode_index_buffer(index_blob + index_size, index_capacity - index_size, mesh_indices, e.index_count);
+        ok = vsz > 0 && isz > 0;
+        e.vertex_data_offset = (uint32_t)vertex_size;
+        e.vertex_data_size = (uint32_t)vsz;
+        e.index_data_offset = (uint32_t)index_size;
+        e.index_data_size = (uint32_t)isz;
+        vertex_size += vsz;
+        index_size += isz;
+
+        // Round-trip every mesh written, so a codec bug fails the write
+        // instead of producing a cache that decodes to something else.
+        ok = ok && mesh_codec_round_trip(
+            mesh_vertices, e.vertex_count, vertex_stride, mesh_indices, e.index_count,
+            vertex_blob + e.vertex_data_offset, vsz, index_blob + e.index_data_offset, isz
+        );
+    }
+
+    MeshCacheHeader header = {};
+    header.magic = MESH_CACHE_MAGIC;
+    header.version = MESH_CACHE_VERSION;
+    header.key = key;
+    header.mesh_count = mesh_count;
+    header.vertex_stride = vertex_stride;
+    header.vertex_count = vertex_count;
+    header.index_count = index_count;
+    header.entries_offset = mesh_cache_align(sizeof(header));
+    header.vertices_offset = mesh_cache_align(header.entries_offset + sizeof(MeshCacheEntry) * mesh_count);
+    header.indices_offset = mesh_cache_align(header.vertices_offset + vertex_size);
+    header.file_size = header.indices_offset + index_size;
+
+    FILE * f = nullptr;
+    if (ok) {
+#if defined(_MSC_VER)
+        if (fopen_s(&f, path, "wb") != 0)
+            f = nullptr;
+#else
+        f = fopen(path, "wb");
+#endif
+    }
+    if (nullptr == f) {
+        ::free(index_blob);
+        ::free(vertex_blob);
+        ::free(out_entries);
+        return false;
+    }
+
+    static uint8_t const zeros [MESH_CACHE_ALIGN] = {};
+    struct { void const * data; uint64_t offset; uint64_t size; } sections [] = {
+        {&header,       0,                          sizeof(header)},
+        {out_entries,   header.entries_offset,      sizeof(MeshCacheEntry) * mesh_count},
+        {vertex_blob,   header.vertices_offset,     vertex_size},
+        {index_blob,    header.indices_offset,      index_size},
+    };
+    uint64_t pos = 0;
+    for (int i = 0; i < 4 && ok; ++i) {
+        ok = fwrite(zeros, 1, (size_t)(sections[i].offset - pos), f) == sections[i].offset - pos;
+        ok = ok && fwrite(sections[i].data, 1, (size_t)sections[i].size, f) == sections[i].size;
+        pos = sections[i].offset + sections[i].size;
+    }
+    fclose(f);
+    if (!ok)
+        remove(path);
+
+    ::free(index_blob);
+    ::free(vertex_blob);
+    ::free(out_entries);
+    return ok;
+}
+// Maps the cache and validates it against the expected key and vertex
+// stride. On success the caller owns 'cache' and releases it with
+// mesh_cache_close once the blobs have been uploaded.
+static bool
+mesh_cache_open (char const * path, uint64_t key, uint32_t vertex_stride, MeshCache * cache) {
+    memset(cache, 0, sizeof(*cache));
+    if (!map_file(path, &cache->file))
+        return false;
+
+    MeshCacheHeader const * header = (MeshCacheHeader const *)cache->file.data;
+    bool valid =
+        cache->file.size >= sizeof(MeshCacheHeader) &&
+        header->magic == MESH_CACHE_MAGIC &&
+        header->version == MESH_CACHE_VERSION &&
+        header->key == key &&
+        header->vertex_stride == vertex_stride &&
+        header->file_size == cache->file.size &&
+        header->entries_offset + sizeof(MeshCacheEntry) * (uint64_t)header->mesh_count <= header->vertices_offset &&
+        header->vertices_offset <= header->indices_offset &&
+        header->indices_offset <= header->file_size;
+
+    // Every mesh has to decode inside the packed arrays, from inside its blob.
+    MeshCacheEntry const * entries = (MeshCacheEntry const *)(cache->file.data + header->entries_offset);
+    for (uint32_t m = 0; valid && m < header->mesh_count; ++m) {
+        MeshCacheEntry const & e = entries[m];
+        valid =
+            e.base_vertex >= 0 &&
+            (uint64_t)e.base_vertex + e.vertex_count <= header->vertex_count &&
+            (uint64_t)e.first_index + e.index_count <= header->index_count &&
+            header->vertices_offset + e.vertex_data_offset + (uint64_t)e.vertex_data_size <= header->indices_offset &&
+            header->indices_offset + e.index_data_offset + (uint64_t)e.index_data_size <= header->file_size;
+    }
+    if (!valid) {
+        unmap_file(&cache->file);
+        return false;
+    }
+
+    cache->header = header;
+    cache->entries = entries;
+    cache->vertex_data = cache->file.data + header->vertices_offset;
+    cache->index_data = cache->file.data + header->indices_offset;
+    return true;
+}
+// Decodes every mesh into packed arrays of header->vertex_count vertices
+// and header->index_count indices, one mesh per task.
+static bool
+mesh_cache_decode (MeshCache const * cache, void * vertices, int indices []) {
+    std::atomic<bool> failed(false);
+    uint32_t stride = cache->header->vertex_stride;
+    parallel_for((int)cache->header->mesh_count, 1, [&](int begin, int end, int) {
+        for (int m = begin; m < end; ++m) {
+            MeshCacheEntry const & e = cache->entries[m];
+            uint8_t * mesh_vertices = (uint8_t *)vertices + (size_t)e.base_vertex * stride;
+            if (!decode_vertex_buffer(mesh_vertices, e.vertex_count, stride, cache->vertex_data + e.vertex_data_offset, e.vertex_data_size) ||
+                !decode_index_buffer(indices + e.first_index, e.index_count, e.vertex_count, cache->index_data + e.index_data_offset, e.index_data_size))
+                failed = true;
+        }
+    });
+    return !failed;
+}
+static void
+mesh_cache_close (MeshCache * cache) {
+    unmap_file(&cache->file);
+    memset(cache, 0, sizeof(*cache));
+}
@@ -0,0 +1,515 @@
+#pragma once
+
+// Geometry codecs for the on-disk mesh format.
+//
+// Index codec: triangles are coded against a FIFO of recently seen edges and
+// a FIFO of recently seen vertices. A triangle sharing an edge with a recent
+// one costs a single code byte when its third vertex is new or still in the
+// vertex FIFO; everything else falls back to varint-coded deltas. The
+// decoder may return triangles rotated (a,b,c -> b,c,a), never rewound.
+//
+// Vertex codec: vertices are cut into blocks of MESH_CODEC_BLOCK. Inside a
+// block every 32-bit word of the vertex (one float component) is delta coded
+// against the same word of the previous vertex and zigzagged, then split into
+// four byte planes. Each plane is stored as groups of 16 bytes packed to 0, 2,
+// 4 or 8 bits per byte, picked per group by a 2-bit header. Blocks don't
+// depend on each other, so they can be decoded in parallel. The output is
+// also laid out to suit a general purpose entropy coder on top.
+//
+// Both encoders return the encoded size, or 0 if 'dst_capacity' (see the
+// *_bound functions) is too small; decoders return false on corrupt input.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define MESH_CODEC_SSE2 1
+#endif
+
+#define MESH_CODEC_INDEX_HEADER     0xe1
+#define MESH_CODEC_VERTEX_HEADER    0xa1
+#define MESH_CODEC_BLOCK            1024
+#define MESH_CODEC_MAX_STRIDE       256
+
+// ---------------------------------------------------------------- indices --
+
+static inline uint8_t *
+mesh_codec_write_varint (uint8_t * p, uint32_t v) {
+    while (v >= 0x80) {
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+static inline uint8_t const *
+mesh_codec_read_varint (uint8_t const * p, uint8_t const * end, uint32_t * v) {
+    uint32_t result = 0;
+    for (int shift = 0; shift < 35 && p < end; shift += 7) {
+        uint8_t b = *p++;
+        result |= (uint32_t)(b & 0x7f) << shift;
+        if (b < 0x80) {
+            *v = result;
+            return p;
+        }
+    }
+    return nullptr;
+}
+static inline uint32_t
+mesh_codec_zigzag (int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+static inline int32_t
+mesh_codec_unzigzag (uint32_t v) {
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+// Shared encoder/decoder state; both sides update it identically.
+struct IndexCodecState {
+    uint32_t    edges [16][2];
+    uint32_t    vertices [16];
+    uint32_t    edge_head;
+    uint32_t    vertex_head;
+    uint32_t    next;           // next never-seen vertex, if referenced in order
+    uint32_t    last;           // last explicitly coded vertex
+};
+static inline void
+index_codec_push_edge (IndexCodecState * s, uint32_t a, uint32_t b) {
+    s->edges[s->edge_head & 15][0] = a;
+    s->edges[s->edge_head & 15][1] = b;
+    ++s->edge_head;
+}
+static inline void
+index_codec_push_vertex (IndexCodecState * s, uint32_t v) {
+    s->vertices[s->vertex_head & 15] = v;
+    ++s->vertex_head;
+}
+// Empty FIFO slots hold ~0, which no valid index matches.
+static inline void
+index_codec_init (IndexCodecState * s) {
+    memset(s->edges, 0xff, sizeof(s->edges));
+    memset(s->vertices, 0xff, sizeof(s->vertices));
+    s->edge_head = 0;
+    s->vertex_head = 0;
+    s->next = 0;
+    s->last = 0;
+}
+// Slots are numbered from the most recent entry.
+static inline uint32_t
+index_codec_edge (IndexCodecState const * s, int slot, int k) {
+    return s->edges[(s->edge_head - 1 - slot) & 15][k];
+}
+static inline uint32_t
+index_codec_vertex (IndexCodecState const * s, int slot) {
+    return s->vertices[(s->vertex_head - 1 - slot) & 15];
+}
+// Triangles sharing an edge with a recent one see it reversed.
+static inline void
+index_codec_push_triangle (IndexCodecState * s, uint32_t a, uint32_t b, uint32_t c) {
+    index_codec_push_edge(s, b, a);
+    index_codec_push_edge(s, c, b);
+    index_codec_push_edge(s, a, c);
+}
+
+static size_t
+encode_index_buffer_bound (size_t index_count) {
+    return 1 + index_count / 3 + index_count * 5;
+}
+// Vertex code of the three-vertex form: 0 = new, 1..16 = vertex FIFO slot,
+// 17+ = explicit zigzag delta.
+static inline uint8_t *
+index_codec_encode_vertex (IndexCodecState * s, uint8_t * data, uint32_t v) {
+    if (v == s->next) {
+        ++s->next;
+        index_codec_push_vertex(s, v);
+        return mesh_codec_write_varint(data, 0);
+    }
+    for (int i = 0; i < 16; ++i)
+        if (index_codec_vertex(s, i) == v)
+            return mesh_codec_write_varint(data, 1 + i);
+    uint32_t delta = mesh_codec_zigzag((int32_t)(v - s->last));
+    s->last = v;
+    index_codec_push_vertex(s, v);
+    return mesh_codec_write_varint(data, 17 + delta);
+}
+static size_t
+encode_index_buffer (uint8_t * dst, size_t dst_capacity, int const indices [], size_t index_count) {
+    if (index_count % 3 != 0 || dst_capacity < encode_index_buffer_bound(index_count))
+        return 0;
+    size_t tri_count = index_count / 3;
+    uint8_t * codes = dst + 1;
+    uint8_t * data = codes + tri_count;
+    dst[0] = MESH_CODEC_INDEX_HEADER;
+
+    IndexCodecState s;
+    index_codec_init(&s);
+
+    for (size_t t = 0; t < tri_count; ++t) {
+        uint32_t tri [3] = {(uint32_t)indices[t * 3], (uint32_t)indices[t * 3 + 1], (uint32_t)indices[t * 3 + 2]};
+
+        // Look for a rotation whose first edge is in the FIFO (slot 15 is
+        // reserved for the no-edge code).
+        int edge_slot = -1;
+        uint32_t a = tri[0], b = tri[1], c = tri[2];
+        for (int r = 0; r < 3 && edge_slot < 0; ++r) {
+            uint32_t ra = tri[r], rb = tri[(r + 1) % 3], rc = tri[(r + 2) % 3];
+            for (int i = 0; i < 15; ++i) {
+                if (index_codec_edge(&s, i, 0) == ra && index_codec_edge(&s, i, 1) == rb) {
+                    edge_slot = i;
+                    a = ra; b = rb; c = rc;
+                    break;
+                }
+            }
+        }
+
+        if (edge_slot >= 0) {
+            int cv = 15;
+            if (c == s.next) {
+                cv = 0;
+                ++s.next;
+            } else {
+                for (int i = 0; i < 14; ++i) {
+                    if (index_codec_vertex(&s, i) == c) {
+                        cv = 1 + i;
+                        break;
+                    }
+                }
+            }
+            if (15 == cv) {
+                data = mesh_codec_write_varint(data, mesh_codec_zigzag((int32_t)(c - s.last)));
+                s.last = c;
+            }
+            if (0 == cv || 15 == cv)
+                index_codec_push_vertex(&s, c);
+            codes[t] = (uint8_t)((edge_slot << 4) | cv);
+        } else if (a == s.next && b == s.next + 1 && c == s.next + 2) {
+            s.next += 3;
+            index_codec_push_vertex(&s, a);
+            index_codec_push_vertex(&s, b);
+            index_codec_push_vertex(&s, c);
+            codes[t] = 0xf0;
+        } else {
+            data = index_codec_encode_vertex(&s, data, a);
+            data = index_codec_encode_vertex(&s, data, b);
+            data = index_codec_encode_vertex(&s, data, c);
+            codes[t] = 0xff;
+        }
+        index_codec_push_triangle(&s, a, b, c);
+    }
+    return (size_t)(data - dst);
+}
+
+static inline uint8_t const *
+index_codec_decode_vertex (IndexCodecState * s, uint8_t const * data, uint8_t const * end, uint32_t * v) {
+    uint32_t code;
+    data = mesh_codec_read_varint(data, end, &code);
+    if (nullptr == data)
+        return nullptr;
+    if (0 == code) {
+        *v = s->next++;
+        index_codec_push_vertex(s, *v);
+    } else if (code <= 16) {
+        *v = index_codec_vertex(s, code - 1);
+    } else {
+        *v = s->last + (uint32_t)mesh_codec_unzigzag(code - 17);
+        s->last = *v;
+        index_codec_push_vertex(s, *v);
+    }
+    return data;
+}
+// Decodes 'index_count' indices; every index is checked against vertex_count.
+static bool
+decode_index_buffer (int dst [], size_t index_count, uint32_t vertex_count, uint8_t const * src, size_t src_size) {
+    size_t tri_count = index_count / 3;
+    if (index_count % 3 != 0 || src_size < 1 + tri_count || src[0] != MESH_CODEC_INDEX_HEADER)
+        return false;
+    uint8_t const * codes = src + 1;
+    uint8_t const * data = codes + tri_count;
+    uint8_t const * end = src + src_size;
+
+    IndexCodecState s;
+    index_codec_init(&s);
+
+    for (size_t t = 0; t < tri_count; ++t) {
+        uint32_t code = codes[t];
+        uint32_t a, b, c;
+        if ((code >> 4) < 15) {
+            a = index_codec_edge(&s, code >> 4, 0);
+            b = index_codec_edge(&s, code >> 4, 1);
+            uint32_t cv = code & 15;
+            if (0 == cv) {
+                c = s.next++;
+                index_codec_push_vertex(&s, c);
+            } else if (cv < 15) {
+                c = index_codec_vertex(&s, cv - 1);
+            } else {
+                uint32_t delta;
+                data = mesh_codec_read_varint(data, end, &delta);
+                if (nullptr == data)
+                    return false;
+                c = s.last + (uint32_t)mesh_codec_unzigzag(delta);
+                s.last = c;
+                index_codec_push_vertex(&s, c);
+            }
+        } else if (0xf0 == code) {
+            a = s.next++;
+            b = s.next++;
+            c = s.next++;
+            index_codec_push_vertex(&s, a);
+            index_codec_push_vertex(&s, b);
+            index_codec_push_vertex(&s, c);
+        } else if (0xff == code) {
+            data = index_codec_decode_vertex(&s, data, end, &a);
+            data = data ? index_codec_decode_vertex(&s, data, end, &b) : nullptr;
+            data = data ? index_codec_decode_vertex(&s, data, end, &c) : nullptr;
+            if (nullptr == data)
+                return false;
+        } else {
+            return false;
+        }
+        if (a >= vertex_count || b >= vertex_count || c >= vertex_count)
+            return false;
+        dst[t * 3 + 0] = (int)a;
+        dst[t * 3 + 1] = (int)b;
+        dst[t * 3 + 2] = (int)c;
+        index_codec_push_triangle(&s, a, b, c);
+    }
+    return data == end;
+}
+
+// --------------------------------------------------------------- vertices --
+
+static size_t
+encode_vertex_buffer_bound (size_t vertex_count, size_t vertex_stride) {
+    size_t blocks = (vertex_count + MESH_CODEC_BLOCK - 1) / MESH_CODEC_BLOCK;
+    size_t groups = MESH_CODEC_BLOCK / 16;
+    // per block and byte plane: 2-bit headers plus at most 16 bytes per group
+    return 1 + blocks * vertex_stride * (groups / 4 + groups * 16);
+}
+// Bits per byte for each 2-bit group header.
+static int const mesh_codec_group_bits [4] = {0, 2, 4, 8};
+
+static inline uint8_t *
+vertex_codec_encode_plane (uint8_t * out, uint8_t const plane [], int group_count) {
+    uint8_t * headers = out;
+    out += (group_count + 3) / 4;
+    memset(headers, 0, (group_count + 3) / 4);
+    for (int g = 0; g < group_count; ++g) {
+        uint8_t const * in = plane + g * 16;
+        uint8_t max_byte = 0;
+        for (int i = 0; i < 16; ++i)
+            max_byte |= in[i];
+        int mode = 0 == max_byte ? 0 : (max_byte < 4 ? 1 : (max_byte < 16 ? 2 : 3));
+        headers[g / 4] |= (uint8_t)(mode << ((g % 4) * 2));
+
+        int bits = mesh_codec_group_bits[mode];
+        if (8 == bits) {
+            memcpy(out, in, 16);
+        } else if (bits) {
+            int per_byte = 8 / bits;
+            for (int i = 0; i < 16 / per_byte; ++i) {
+                uint8_t packed = 0;
+                for (int k = 0; k < per_byte; ++k)
+                    packed |= (uint8_t)(in[i * per_byte + k] << (k * bits));
+                out[i] = packed;
+            }
+        }
+        out += bits * 2;
+    }
+    return out;
+}
+static size_t
+encode_vertex_buffer (uint8_t * dst, size_t dst_capacity, void const * vertices, size_t vertex_count, size_t vertex_stride) {
+    if (0 == vertex_stride || vertex_stride % 4 != 0 || vertex_stride > MESH_CODEC_MAX_STRIDE ||
+        dst_capacity < encode_vertex_buffer_bound(vertex_count, vertex_stride))
+        return 0;
+    uint8_t const * src = (uint8_t const *)vertices;
+    uint8_t * out = dst;
+    *out++ = MESH_CODEC_VERTEX_HEADER;
+
+    uint8_t planes [4][MESH_CODEC_BLOCK];
+    size_t words = vertex_stride / 4;
+    for (size_t base = 0; base < vertex_count; base += MESH_CODEC_BLOCK) {
+        int n = (int)(vertex_count - base < MESH_CODEC_BLOCK ? vertex_count - base : MESH_CODEC_BLOCK);
+        int group_count = (n + 15) / 16;
+        for (size_t w = 0; w < words; ++w) {
+            memset(planes, 0, sizeof(planes));
+            uint32_t prev = 0;
+            for (int i = 0; i < n; ++i) {
+                uint32_t v;
+                memcpy(&v, src + (base + i) * vertex_stride + w * 4, 4);
+                uint32_t z = mesh_codec_zigzag((int32_t)(v - prev));
+                prev = v;
+                planes[0][i] = (uint8_t)z;
+                planes[1][i] = (uint8_t)(z >> 8);
+                planes[2][i] = (uint8_t)(z >> 16);
+                planes[3][i] = (uint8_t)(z >> 24);
+            }
+            for (int p = 0; p < 4; ++p)
+                out = vertex_codec_encode_plane(out, planes[p], group_count);
+        }
+    }
+    return (size_t)(out - dst);
+}
+
+static inline uint8_t const *
+vertex_codec_decode_plane (uint8_t const * in, uint8_t const * end, uint8_t plane [], int group_count) {
+    uint8_t const * headers = in;
+    in += (group_count + 3) / 4;
+    if (in > end)
+        return nullptr;
+    for (int g = 0; g < group_count; ++g) {
+        int mode = (headers[g / 4] >> ((g % 4) * 2)) & 3;
+        int bits = mesh_codec_group_bits[mode];
+        uint8_t * out = plane + g * 16;
+        if (in + bits * 2 > end)
+            return nullptr;
+        if (8 == bits) {
+            memcpy(out, in, 16);
+        } else if (0 == bits) {
+            memset(out, 0, 16);
+        } else {
+#if defined(MESH_CODEC_SSE2)
+            // Spread the packed fields to one byte each: shift copies of the
+            // input and interleave them back into order.
+            int word;
+            memcpy(&word, in, 4);
+            __m128i packed = 4 == bits ? _mm_loadl_epi64((__m128i const *)in) : _mm_cvtsi32_si128(word);
+            __m128i result;
+            if (4 == bits) {
+                __m128i lo = _mm_and_si128(packed, _mm_set1_epi8(0x0f));
+                __m128i hi = _mm_and_si128(_mm_srli_epi16(packed, 4), _mm_set1_epi8(0x0f));
+                result = _mm_unpacklo_epi8(lo, hi);
+            } else {
+                __m128i mask = _mm_set1_epi8(0x03);
+                __m128i f0 = _mm_and_si128(packed, mask);
+                __m128i f1 = _mm_and_si128(_mm_srli_epi16(packed, 2), mask);
+                __m128i f2 = _mm_and_si128(_mm_srli_epi16(packed, 4), mask);
+                __m128i f3 = _mm_and_si128(_mm_srli_epi16(packed, 6), mask);
+                __m128i f01 = _mm_unpacklo_epi8(f0, f1);
+                __m128i f23 = _mm_unpacklo_epi8(f2, f3);
+                result = _mm_unpacklo_epi16(f01, f23);
+            }
+            _mm_storeu_si128((__m128i *)out, result);
+#else
+            int per_byte = 8 / bits;
+            uint8_t mask = (uint8_t)((1 << bits) - 1);
+            for (int i = 0; i < 16; ++i)
+                out[i] = (uint8_t)((in[i / per_byte] >> ((i % per_byte) * bits)) & mask);
+#endif
+        }
+        in += bits * 2;
+    }
+    return in;
+}
+// Reassembles one word column of a block from its byte planes: undo the
+// zigzag and the delta (a prefix sum) and store with the vertex stride.
+static void
+vertex_codec_decode_column (uint8_t planes [4][MESH_CODEC_BLOCK], int n, uint8_t * dst, size_t vertex_stride) {
+    int i = 0;
+    uint32_t prev = 0;
+#if defined(MESH_CODEC_SSE2)
+    __m128i carry = _mm_setzero_si128();
+    __m128i one = _mm_set1_epi32(1);
+    for (; i + 16 <= n; i += 16) {
+        __m128i p0 = _mm_loadu_si128((__m128i const *)(planes[0] + i));
+        __m128i p1 = _mm_loadu_si128((__m128i const *)(planes[1] + i));
+        __m128i p2 = _mm_loadu_si128((__m128i const *)(planes[2] + i));
+        __m128i p3 = _mm_loadu_si128((__m128i const *)(planes[3] + i));
+        __m128i lo01 = _mm_unpacklo_epi8(p0, p1);
+        __m128i hi01 = _mm_unpackhi_epi8(p0, p1);
+        __m128i lo23 = _mm_unpacklo_epi8(p2, p3);
+        __m128i hi23 = _mm_unpackhi_epi8(p2, p3);
+        __m128i v [4] = {
+            _mm_unpacklo_epi16(lo01, lo23), _mm_unpackhi_epi16(lo01, lo23),
+            _mm_unpacklo_epi16(hi01, hi23), _mm_unpackhi_epi16(hi01, hi23),
+        };
+        for (int k = 0; k < 4; ++k) {
+            __m128i z = v[k];
+            __m128i d = _mm_xor_si128(_mm_srli_epi32(z, 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(z, one)));
+            d = _mm_add_epi32(d, _mm_slli_si128(d, 4));
+            d = _mm_add_epi32(d, _mm_slli_si128(d, 8));
+            d = _mm_add_epi32(d, carry);
+            carry = _mm_shuffle_epi32(d, _MM_SHUFFLE(3, 3, 3, 3));
+
+            uint32_t lanes [4];
+            _mm_storeu_si128((__m128i *)lanes, d);
+            uint8_t * out = dst + (size_t)(i + k * 4) * vertex_stride;
+            for (int l = 0; l < 4; ++l)
+                memcpy(out + l * vertex_stride, &lanes[l], 4);
+        }
+    }
+    prev = (uint32_t)_mm_cvtsi128_si32(carry);
+#endif
+    for (; i < n; ++i) {
+        uint32_t z = planes[0][i] | (planes[1][i] << 8) | (planes[2][i] << 16) | ((uint32_t)planes[3][i] << 24);
+        prev += (uint32_t)mesh_codec_unzigzag(z);
+        memcpy(dst + (size_t)i * vertex_stride, &prev, 4);
+    }
+}
+// Decodes blocks [first_block, first_block + block_count). 'src' must point
+// at the start of first_block.
+static bool
+vertex_codec_decode_blocks (
+    void * vertices, size_t vertex_count, size_t vertex_stride,
+    size_t first_block, size_t block_count, uint8_t const * src, uint8_t const * end
+) {
+    uint8_t planes [4][MESH_CODEC_BLOCK];
+    uint8_t * dst = (uint8_t *)vertices;
+    size_t words = vertex_stride / 4;
+    for (size_t b = first_block; b < first_block + block_count; ++b) {
+        size_t base = b * MESH_CODEC_BLOCK;
+        int n = (int)(vertex_count - base < MESH_CODEC_BLOCK ? vertex_count - base : MESH_CODEC_BLOCK);
+        int group_count = (n + 15) / 16;
+        for (size_t w = 0; w < words; ++w) {
+            for (int p = 0; p < 4 && src; ++p)
+                src = vertex_codec_decode_plane(src, end, planes[p], group_count);
+            if (nullptr == src)
+                return false;
+            vertex_codec_decode_column(planes, n, dst + base * vertex_stride + w * 4, vertex_stride);
+        }
+    }
+    return true;
+}
+static bool
+decode_vertex_buffer (void * vertices, size_t vertex_count, size_t vertex_stride, uint8_t const * src, size_t src_size) {
+    if (0 == vertex_stride || vertex_stride % 4 != 0 || vertex_stride > MESH_CODEC_MAX_STRIDE ||
+        src_size < 1 || src[0] != MESH_CODEC_VERTEX_HEADER)
+        return false;
+    size_t blocks = (vertex_count + MESH_CODEC_BLOCK - 1) / MESH_CODEC_BLOCK;
+    return vertex_codec_decode_blocks(vertices, vertex_count, vertex_stride, 0, blocks, src + 1, src + src_size);
+}
+
+// ------------------------------------------------------------- round trip --
+
+// Decodes freshly encoded streams and compares them with their source: the
+// vertices byte for byte, the triangles up to the rotation the index codec
+// may apply.
+static bool
+mesh_codec_round_trip (
+    void const * vertices, uint32_t vertex_count, uint32_t vertex_stride,
+    int const indices [], uint32_t index_count,
+    uint8_t const * vertex_data, size_t vertex_size,
+    uint8_t const * index_data, size_t index_size
+) {
+    size_t vertex_bytes = (size_t)vertex_count * vertex_stride;
+    uint8_t * check_vertices = (uint8_t *)::malloc(vertex_bytes + 1);
+    int * check_indices = (int *)::malloc(sizeof(int) * (index_count + 1));
+    bool ok =
+        decode_vertex_buffer(check_vertices, vertex_count, vertex_stride, vertex_data, vertex_size) &&
+        0 == memcmp(check_vertices, vertices, vertex_bytes) &&
+        decode_index_buffer(check_indices, index_count, vertex_count, index_data, index_size);
+    for (uint32_t t = 0; ok && t + 2 < index_count; t += 3) {
+        int const * a = indices + t;
+        int const * b = check_indices + t;
+        bool same = false;
+        for (int r = 0; r < 3; ++r)
+            same = same || (a[0] == b[r] && a[1] == b[(r + 1) % 3] && a[2] == b[(r + 2) % 3]);
+        ok = same;
+    }
+    ::free(check_indices);
+    ::free(check_vertices);
+    return ok;
+}
@@ -0,0 +1,225 @@
+#pragma once
+
+#include "bounds.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Handle to a mesh registered in a MeshTable (index into its columns).
+typedef int MeshHandle;
+#define INVALID_MESH_HANDLE (-1)
+
+// Registry of every mesh living in the shared vertex/index buffer pair.
+// Columns are kept as separate arrays (SoA) so the draw loop only touches
+// the data it needs, and a handle is just the row number.
+//
+// LOD chains are stored as consecutive rows: lod_first is the handle of the
+// most detailed level and lod_count the number of levels that follow it.
+//
+// Removed rows go on a free list threaded through next_free and are handed
+// out again by mesh_table_add, so 'count' is the number of rows ever used,
+// not the number of live meshes. A free row has no name and draws nothing.
+struct MeshTable {
+    int             count;
+    int             capacity;
+    MeshHandle      free_head;
+
+    uint32_t *      name_hash;
+    char **         name;
+    int *           base_vertex;
+    uint32_t *      first_index;
+    uint32_t *      index_count;
+    MeshBounds *    bounds;
+    MeshHandle *    lod_first;
+    int *           lod_count;
+
+    // regions of the geometry pool backing the mesh
+    uint32_t *      vtx_block;
+    uint32_t *      idx_block;
+
+    MeshHandle *    next_free;
+};
+
+// Instances to draw: a mesh handle plus its world transform, again SoA.
+struct RenderItems {
+    int             count;
+    int             capacity;
+
+    MeshHandle *    mesh;
+    XMFLOAT4X4 *    world;
+};
+
+// FNV-1a, compared first so lookups only touch the strings on a hash match
+static uint32_t
+hash_name (char const * name) {
+    uint32_t h = 2166136261u;
+    for (; *name; ++name) {
+        h ^= (uint8_t)*name;
+        h *= 16777619u;
+    }
+    return h;
+}
+static void
+mesh_table_grow (MeshTable * table, int new_capacity) {
+    table->name_hash    = (uint32_t *)::realloc(table->name_hash, sizeof(uint32_t) * new_capacity);
+    table->name         = (char **)::realloc(table->name, sizeof(char *) * new_capacity);
+    table->base_vertex  = (int *)::realloc(table->base_vertex, sizeof(int) * new_capacity);
+    table->first_index  = (uint32_t *)::realloc(table->first_index, sizeof(uint32_t) * new_capacity);
+    table->index_count  = (uint32_t *)::realloc(table->index_count, sizeof(uint32_t) * new_capacity);
+    table->bounds       = (MeshBounds *)::realloc(table->bounds, sizeof(MeshBounds) * new_capacity);
+    table->lod_first    = (MeshHandle *)::realloc(table->lod_first, sizeof(MeshHandle) * new_capacity);
+    table->lod_count    = (int *)::realloc(table->lod_count, sizeof(int) * new_capacity);
+    table->vtx_block    = (uint32_t *)::realloc(table->vtx_block, sizeof(uint32_t) * new_capacity);
+    table->idx_block    = (uint32_t *)::realloc(table->idx_block, sizeof(uint32_t) * new_capacity);
+    table->next_free    = (MeshHandle *)::realloc(table->next_free, sizeof(MeshHandle) * new_capacity);
+    table->capacity = new_capacity;
+}
+static void
+mesh_table_init (MeshTable * table, int capacity) {
+    memset(table, 0, sizeof(*table));
+    table->free_head = INVALID_MESH_HANDLE;
+    mesh_table_grow(table, capacity > 0 ? capacity : 16);
+}
+static void
+mesh_table_free (MeshTable * table) {
+    for (int i = 0; i < table->count; ++i)
+        ::free(table->name[i]);
+    ::free(table->name_hash);
+    ::free(table->name);
+    ::free(table->base_vertex);
+    ::free(table->first_index);
+    ::free(table->index_count);
+    ::free(table->bounds);
+    ::free(table->lod_first);
+    ::free(table->lod_count);
+    ::free(table->vtx_block);
+    ::free(table->idx_block);
+    ::free(table->next_free);
+    memset(table, 0, sizeof(*table));
+    table->free_head = INVALID_MESH_HANDLE;
+}
+// The handle the next mesh_table_add will return, for callers that tag the
+// geometry pool regions with it before registering the mesh.
+static MeshHandle
+mesh_table_next_handle (MeshTable const * table) {
+    return INVALID_MESH_HANDLE != table->free_head ? table->free_head : table->count;
+}
+static MeshHandle
+mesh_table_add (
+    MeshTable * table, char const * name,
+    int base_vertex, uint32_t first_index, uint32_t index_count,
+    MeshBounds const & bounds
+) {
+    MeshHandle h = table->free_head;
+    if (INVALID_MESH_HANDLE != h) {
+        table->free_head = table->next_free[h];
+    } else {
+        if (table->count == table->capacity)
+            mesh_table_grow(table, table->capacity * 2);
+        h = table->count++;
+    }
+
+    size_t name_len = strlen(name) + 1;
+    table->name_hash[h]     = hash_name(name);
+    table->name[h]          = (char *)::malloc(name_len);
+    memcpy(table->name[h], name, name_len);
+    table->base_vertex[h]   = base_vertex;
+    table->first_index[h]   = first_index;
+    table->index_count[h]   = index_count;
+    table->bounds[h]        = bounds;
+    table->lod_first[h]     = h;
+    table->lod_count[h]     = 1;
+    table->vtx_block[h]     = 0xffffffffu;
+    table->idx_block[h]     = 0xffffffffu;
+    table->next_free[h]     = INVALID_MESH_HANDLE;
+    return h;
+}
+// Puts a row on the free list. The caller has already returned its pool
+// regions and must not draw the handle again.
+static void
+mesh_table_remove (MeshTable * table, MeshHandle h) {
+    if (h < 0 || h >= table->count || nullptr == table->name[h])
+        return;
+    ::free(table->name[h]);
+    table->name[h]          = nullptr;
+    table->name_hash[h]     = 0;
+    table->index_count[h]   = 0;
+    table->lod_first[h]     = h;
+    table->lod_count[h]     = 1;
+    table->vtx_block[h]     = 0xffffffffu;
+    table->idx_block[h]     = 0xffffffffu;
+    table->next_free[h]     = table->free_head;
+    table->free_head        = h;
+}
+// Mark rows [lod0, lod0 + lod_count) as the LOD chain of lod0.
+static void
+mesh_table_set_lods (MeshTable * table, MeshHandle lod0, int lod_count) {
+    for (int i = 0; i < lod_count; ++i) {
+        table->lod_first[lod0 + i] = lod0;
+        table->lod_count[lod0 + i] = lod_count;
+    }
+}
+static MeshHandle
+mesh_table_find (MeshTable const * table, char const * name) {
+    uint32_t h = hash_name(name);
+    for (int i = 0; i < table->count; ++i)
+        if (table->name_hash[i] == h && nullptr != table->name[i] && 0 == strcmp(table->name[i], name))
+            return i;
+    return INVALID_MESH_HANDLE;
+}
+
+static void
+render_items_init (RenderItems * items, int capacity) {
+    memset(items, 0, sizeof(*items));
+    items->capacity = capacity > 0 ? capacity : 16;
+    items->mesh = (MeshHandle *)::malloc(sizeof(MeshHandle) * items->capacity);
+    items->world = (XMFLOAT4X4 *)::malloc(sizeof(XMFLOAT4X4) * items->capacity);
+}
+static void
+render_items_free (RenderItems * items) {
+    ::free(items->mesh);
+    ::free(items->world);
+    memset(items, 0, sizeof(*items));
+}
+static void
+render_items_add (RenderItems * items, MeshHandle mesh, CXMMATRIX world) {
+    if (items->count == items->capacity) {
+        items->capacity *= 2;
+        items->mesh = (MeshHandle *)::realloc(items->mesh, sizeof(MeshHandle) * items->capacity);
+        items->world = (XMFLOAT4X4 *)::realloc(items->world, sizeof(XMFLOAT4X4) * items->capacity);
+    }
+    items->mesh[items->count] = mesh;
+    XMStoreFloat4x4(&items->world[items->count], world);
+    ++items->count;
+}
+// Counting sort by mesh handle so the draw loop walks the mesh table in order
+// and consecutive draws hit the same rows. Items whose handle is not a row
+// (INVALID_MESH_HANDLE, say) would have nothing to draw and are dropped.
+static void
+render_items_sort_by_mesh (RenderItems * items, int mesh_count) {
+    int n = items->count;
+    int * offsets = (int *)::calloc(mesh_count + 1, sizeof(int));
+    MeshHandle * sorted_mesh = (MeshHandle *)::malloc(sizeof(MeshHandle) * items->capacity);
+    XMFLOAT4X4 * sorted_world = (XMFLOAT4X4 *)::malloc(sizeof(XMFLOAT4X4) * items->capacity);
+
+    for (int i = 0; i < n; ++i)
+        if (items->mesh[i] >= 0 && items->mesh[i] < mesh_count)
+            ++offsets[items->mesh[i] + 1];
+    for (int i = 0; i < mesh_count; ++i)
+        offsets[i + 1] += offsets[i];
+    for (int i = 0; i < n; ++i) {
+        if (items->mesh[i] < 0 || items->mesh[i] >= mesh_count)
+            continue;
+        int dst = offsets[items->mesh[i]]++;
+        sorted_mesh[dst] = items->mesh[i];
+        sorted_world[dst] = items->world[i];
+    }
+
+    ::free(items->mesh);
+    ::free(items->world);
+    items->count = offsets[mesh_count > 0 ? mesh_count - 1 : 0];
+    ::free(offsets);
+    items->mesh = sorted_mesh;
+    items->world = sorted_world;
+}
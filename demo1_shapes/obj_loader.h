@@ -0,0 +1,666 @@
+#pragma once
+
+// Wavefront OBJ (+ MTL) importer producing the demo's Vertex layout.
+//
+// The file is memory mapped and cut into line-aligned chunks that are parsed
+// in parallel. Each chunk collects its own v/vt/vn/f data; face indices are
+// global in OBJ, except the negative (relative) ones which are kept relative
+// to the chunk until the per-chunk counts are prefix-summed. Then the chunks
+// are stitched into global arrays, corners are deduplicated by hashing their
+// (position, texcoord, normal) triplet, and tangents are generated.
+//
+// Positions and normals are mirrored on z and triangles rewound so that the
+// right-handed, counter-clockwise OBJ data matches the left-handed,
+// clockwise convention used by the renderer. v is flipped for D3D texcoords.
+
+#include "geometry.h"
+#include "mapped_file.h"
+#include "parallel.h"
+#include "tangents.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct ObjMaterial {
+    char        name [64];
+    XMFLOAT3    ambient;
+    XMFLOAT3    diffuse;
+    XMFLOAT3    specular;
+    float       shininess;
+    float       opacity;
+    char        diffuse_map [260];
+    char        normal_map [260];
+};
+
+// Triangles [first_index, first_index + index_count) use 'material'.
+struct ObjSubmesh {
+    int         material;
+    uint32_t    first_index;
+    uint32_t    index_count;
+};
+
+struct ObjMesh {
+    Vertex *        vertices;
+    int             vertex_count;
+    int *           indices;
+    int             index_count;
+
+    ObjSubmesh *    submeshes;
+    int             submesh_count;
+    ObjMaterial *   materials;
+    int             material_count;
+
+    MeshBounds      bounds;
+};
+
+// -- growable array used by the parser
+template <typename T>
+struct ObjArray {
+    T *     data;
+    int     count;
+    int     capacity;
+};
+template <typename T>
+static T *
+obj_push (ObjArray<T> * a) {
+    if (a->count == a->capacity) {
+        a->capacity = a->capacity ? a->capacity * 2 : 1024;
+        a->data = (T *)::realloc(a->data, sizeof(T) * a->capacity);
+    }
+    return &a->data[a->count++];
+}
+template <typename T>
+static void
+obj_release (ObjArray<T> * a) {
+    ::free(a->data);
+    memset(a, 0, sizeof(*a));
+}
+
+// A face corner. Indices >= 0 are global (already zero based), OBJ_NONE marks
+// a missing component, anything below it is OBJ_RELATIVE plus an index
+// relative to the first element of the chunk the face was parsed in.
+#define OBJ_NONE        (-1)
+#define OBJ_RELATIVE    (-(1 << 30))
+
+struct ObjCorner {
+    int p;
+    int t;
+    int n;
+};
+struct ObjMaterialSwitch {
+    int             first_triangle;     // chunk local until stitched
+    char const *    name;
+    int             name_len;
+};
+struct ObjChunk {
+    char const *                begin;
+    char const *                end;
+
+    ObjArray<XMFLOAT3>          positions;
+    ObjArray<XMFLOAT2>          texcoords;
+    ObjArray<XMFLOAT3>          normals;
+    ObjArray<ObjCorner>         corners;    // 3 per triangle
+    ObjArray<ObjMaterialSwitch> switches;
+    ObjArray<ObjMaterialSwitch> mtllibs;
+
+    // XMFLOAT3 rather than XMVECTOR: chunks live in a calloc'd array,
+    // which only guarantees 8-byte alignment on Win32
+    XMFLOAT3                    vmin;
+    XMFLOAT3                    vmax;
+};
+
+// -- number parsing
+
+static inline bool
+obj_is_space (char c) {
+    return ' ' == c || '\t' == c || '\r' == c;
+}
+static inline char const *
+obj_skip_space (char const * p, char const * end) {
+    while (p < end && obj_is_space(*p))
+        ++p;
+    return p;
+}
+static inline bool
+obj_starts_with (char const * p, char const * end, char const * keyword, int len) {
+    return end - p > len && 0 == memcmp(p, keyword, len) && obj_is_space(p[len]);
+}
+static inline char const *
+obj_skip_line (char const * p, char const * end) {
+    while (p < end && *p != '\n')
+        ++p;
+    return p < end ? p + 1 : end;
+}
+// Decimal float parser. Up to 19 significant digits are accumulated in an
+// integer and scaled by an exactly representable power of ten, which is
+// correctly rounded for everything an exporter writes; longer or extreme
+// inputs go through strtod.
+static char const *
+obj_parse_float (char const * p, char const * end, float * out) {
+    static double const pow10 [] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    char const * start = p;
+    bool neg = false;
+    if (p < end && ('-' == *p || '+' == *p))
+        neg = '-' == *p++;
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exp10 = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+            if (mantissa)
+                ++digits;
+        } else {
+            ++exp10;
+        }
+        ++p;
+    }
+    if (p < end && '.' == *p) {
+        ++p;
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                if (mantissa)
+                    ++digits;
+                --exp10;
+            }
+            ++p;
+        }
+    }
+    if (p < end && ('e' == *p || 'E' == *p)) {
+        ++p;
+        bool eneg = false;
+        if (p < end && ('-' == *p || '+' == *p))
+            eneg = '-' == *p++;
+        int e = 0;
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (e < 10000)
+                e = e * 10 + (*p - '0');
+            ++p;
+        }
+        exp10 += eneg ? -e : e;
+    }
+
+    double v;
+    if (digits >= 19 || exp10 < -22 || exp10 > 22) {
+        char buf [64];
+        int len = (int)(p - start) < 63 ? (int)(p - start) : 63;
+        memcpy(buf, start, len);
+        buf[len] = 0;
+        v = strtod(buf, nullptr);
+        *out = (float)v;
+        return p;
+    }
+    v = (double)mantissa;
+    v = exp10 < 0 ? v / pow10[-exp10] : v * pow10[exp10];
+    *out = (float)(neg ? -v : v);
+    return p;
+}
+static char const *
+obj_parse_int (char const * p, char const * end, int * out) {
+    bool neg = false;
+    if (p < end && ('-' == *p || '+' == *p))
+        neg = '-' == *p++;
+    int v = 0;
+    while (p < end && *p >= '0' && *p <= '9')
+        v = v * 10 + (*p++ - '0');
+    *out = neg ? -v : v;
+    return p;
+}
+// Converts a raw OBJ index (1 based, or negative = relative to the last
+// element seen) into the ObjCorner encoding.
+static inline int
+obj_encode_index (int raw, int local_count) {
+    if (raw > 0)
+        return raw - 1;
+    if (raw < 0)
+        return OBJ_RELATIVE + (local_count + raw);
+    return OBJ_NONE;
+}
+static inline int
+obj_decode_index (int encoded, int chunk_base) {
+    if (encoded >= 0 || OBJ_NONE == encoded)
+        return encoded;
+    return chunk_base + (encoded - OBJ_RELATIVE);
+}
+static char const *
+obj_parse_corner (char const * p, char const * end, ObjChunk * chunk, ObjCorner * c) {
+    int raw;
+    p = obj_parse_int(p, end, &raw);
+    c->p = obj_encode_index(raw, chunk->positions.count);
+    c->t = OBJ_NONE;
+    c->n = OBJ_NONE;
+    if (p < end && '/' == *p) {
+        ++p;
+        if (p < end && *p != '/') {
+            p = obj_parse_int(p, end, &raw);
+            c->t = obj_encode_index(raw, chunk->texcoords.count);
+        }
+        if (p < end && '/' == *p) {
+            ++p;
+            p = obj_parse_int(p, end, &raw);
+            c->n = obj_encode_index(raw, chunk->normals.count);
+        }
+    }
+    return p;
+}
+static char const *
+obj_parse_name (char const * p, char const * end, char const ** name, int * len) {
+    p = obj_skip_space(p, end);
+    char const * s = p;
+    while (p < end && *p != '\n')
+        ++p;
+    char const * e = p;
+    while (e > s && obj_is_space(e[-1]))
+        --e;
+    *name = s;
+    *len = (int)(e - s);
+    return p;
+}
+static void
+obj_parse_chunk (ObjChunk * chunk) {
+    XMVECTOR vmin = XMVectorReplicate(+FLT_MAX);
+    XMVECTOR vmax = XMVectorReplicate(-FLT_MAX);
+
+    char const * p = chunk->begin;
+    char const * end = chunk->end;
+    while (p < end) {
+        p = obj_skip_space(p, end);
+        if (p >= end)
+            break;
+
+        char c0 = *p;
+        char c1 = (p + 1 < end) ? p[1] : 0;
+        if ('v' == c0 && obj_is_space(c1)) {
+            XMFLOAT3 * v = obj_push(&chunk->positions);
+            p = obj_parse_float(obj_skip_space(p + 2, end), end, &v->x);
+            p = obj_parse_float(obj_skip_space(p, end), end, &v->y);
+            p = obj_parse_float(obj_skip_space(p, end), end, &v->z);
+            v->z = -v->z;
+            XMVECTOR pv = XMLoadFloat3(v);
+            vmin = XMVectorMin(vmin, pv);
+            vmax = XMVectorMax(vmax, pv);
+        } else if ('v' == c0 && 't' == c1) {
+            XMFLOAT2 * t = obj_push(&chunk->texcoords);
+            p = obj_parse_float(obj_skip_space(p + 2, end), end, &t->x);
+            p = obj_parse_float(obj_skip_space(p, end), end, &t->y);
+            t->y = 1.0f - t->y;
+        } else if ('v' == c0 && 'n' == c1) {
+            XMFLOAT3 * n = obj_push(&chunk->normals);
+            p = obj_parse_float(obj_skip_space(p + 2, end), end, &n->x);
+            p = obj_parse_float(obj_skip_space(p, end), end, &n->y);
+            p = obj_parse_float(obj_skip_space(p, end), end, &n->z);
+            n->z = -n->z;
+        } else if ('f' == c0 && obj_is_space(c1)) {
+            // Triangulate polygons as a fan, rewinding each triangle.
+            ObjCorner first, prev, curr;
+            int corner_cnt = 0;
+            p = obj_skip_space(p + 2, end);
+            while (p < end && *p != '\n') {
+                char const * corner_start = p;
+                p = obj_parse_corner(p, end, chunk, &curr);
+                if (p == corner_start)
+                    break;      // trailing comment or garbage
+                if (corner_cnt >= 2) {
+                    ObjCorner * tri = obj_push(&chunk->corners);
+                    *tri = first;
+                    tri = obj_push(&chunk->corners);
+                    *tri = curr;
+                    tri = obj_push(&chunk->corners);
+                    *tri = prev;
+                } else if (0 == corner_cnt) {
+                    first = curr;
+                }
+                prev = curr;
+                ++corner_cnt;
+                p = obj_skip_space(p, end);
+            }
+        } else if (obj_starts_with(p, end, "usemtl", 6)) {
+            ObjMaterialSwitch * s = obj_push(&chunk->switches);
+            s->first_triangle = chunk->corners.count / 3;
+            p = obj_parse_name(p + 6, end, &s->name, &s->name_len);
+        } else if (obj_starts_with(p, end, "mtllib", 6)) {
+            ObjMaterialSwitch * s = obj_push(&chunk->mtllibs);
+            s->first_triangle = 0;
+            p = obj_parse_name(p + 6, end, &s->name, &s->name_len);
+        }
+        p = obj_skip_line(p, end);
+    }
+    XMStoreFloat3(&chunk->vmin, vmin);
+    XMStoreFloat3(&chunk->vmax, vmax);
+}
+
+// -- MTL
+
+static void
+obj_default_material (ObjMaterial * m, char const * name, int name_len) {
+    memset(m, 0, sizeof(*m));
+    if (name_len > (int)sizeof(m->name) - 1)
+        name_len = (int)sizeof(m->name) - 1;
+    memcpy(m->name, name, name_len);
+    m->ambient = XMFLOAT3(0.2f, 0.2f, 0.2f);
+    m->diffuse = XMFLOAT3(0.8f, 0.8f, 0.8f);
+    m->specular = XMFLOAT3(0.0f, 0.0f, 0.0f);
+    m->shininess = 1.0f;
+    m->opacity = 1.0f;
+}
+static void
+obj_copy_path (char * dst, size_t dst_size, char const * dir, int dir_len, char const * name, int name_len) {
+    if ((size_t)(dir_len + name_len) + 1 > dst_size) {
+        dst[0] = 0;
+        return;
+    }
+    memcpy(dst, dir, dir_len);
+    memcpy(dst + dir_len, name, name_len);
+    dst[dir_len + name_len] = 0;
+}
+static void
+obj_parse_mtl (char const * path, char const * dir, int dir_len, ObjArray<ObjMaterial> * materials) {
+    MappedFile mf;
+    if (!map_file(path, &mf))
+        return;
+
+    char const * p = (char const *)mf.data;
+    char const * end = p + mf.size;
+    ObjMaterial * m = nullptr;
+    while (p < end) {
+        p = obj_skip_space(p, end);
+        if (p >= end)
+            break;
+        char const * name;
+        int len;
+        if (obj_starts_with(p, end, "newmtl", 6)) {
+            p = obj_parse_name(p + 6, end, &name, &len);
+            m = obj_push(materials);
+            obj_default_material(m, name, len);
+        } else if (m && end - p > 2 && 'K' == p[0] && ('a' == p[1] || 'd' == p[1] || 's' == p[1])) {
+            XMFLOAT3 * k = 'a' == p[1] ? &m->ambient : ('d' == p[1] ? &m->diffuse : &m->specular);
+            p = obj_parse_float(obj_skip_space(p + 2, end), end, &k->x);
+            p = obj_parse_float(obj_skip_space(p, end), end, &k->y);
+            p = obj_parse_float(obj_skip_space(p, end), end, &k->z);
+        } else if (m && obj_starts_with(p, end, "Ns", 2)) {
+            p = obj_parse_float(obj_skip_space(p + 2, end), end, &m->shininess);
+        } else if (m && obj_starts_with(p, end, "d", 1)) {
+            p = obj_parse_float(obj_skip_space(p + 1, end), end, &m->opacity);
+        } else if (m && obj_starts_with(p, end, "Tr", 2)) {
+            float tr;
+            p = obj_parse_float(obj_skip_space(p + 2, end), end, &tr);
+            m->opacity = 1.0f - tr;
+        } else if (m && obj_starts_with(p, end, "map_Kd", 6)) {
+            p = obj_parse_name(p + 6, end, &name, &len);
+            obj_copy_path(m->diffuse_map, sizeof(m->diffuse_map), dir, dir_len, name, len);
+        } else if (m && (obj_starts_with(p, end, "map_Bump", 8) || obj_starts_with(p, end, "map_bump", 8))) {
+            p = obj_parse_name(p + 8, end, &name, &len);
+            obj_copy_path(m->normal_map, sizeof(m->normal_map), dir, dir_len, name, len);
+        } else if (m && (obj_starts_with(p, end, "bump", 4) || obj_starts_with(p, end, "norm", 4))) {
+            p = obj_parse_name(p + 4, end, &name, &len);
+            obj_copy_path(m->normal_map, sizeof(m->normal_map), dir, dir_len, name, len);
+        }
+        p = obj_skip_line(p, end);
+    }
+    unmap_file(&mf);
+}
+static int
+obj_find_material (ObjArray<ObjMaterial> * materials, char const * name, int len) {
+    for (int i = 0; i < materials->count; ++i)
+        if ((int)strlen(materials->data[i].name) == len && 0 == memcmp(materials->data[i].name, name, len))
+            return i;
+    // Referenced but never defined: give it default values.
+    obj_default_material(obj_push(materials), name, len);
+    return materials->count - 1;
+}
+
+// -- vertex deduplication
+
+static inline uint32_t
+obj_hash_corner (ObjCorner const & c) {
+    uint32_t h = (uint32_t)c.p * 0x9e3779b1u;
+    h ^= (uint32_t)c.t * 0x85ebca77u + (h << 6) + (h >> 2);
+    h ^= (uint32_t)c.n * 0xc2b2ae3du + (h << 6) + (h >> 2);
+    return h ^ (h >> 15);
+}
+
+static void
+free_obj (ObjMesh * mesh) {
+    ::free(mesh->vertices);
+    ::free(mesh->indices);
+    ::free(mesh->submeshes);
+    ::free(mesh->materials);
+    memset(mesh, 0, sizeof(*mesh));
+}
+// Returns false if the file can't be read or holds no triangles.
+// chunk_bytes is the parallel work unit; a value at least the file size
+// parses it as one chunk on the calling thread, which gives the same mesh.
+static bool
+load_obj (char const * path, ObjMesh * out_mesh, size_t chunk_bytes = 1 << 20) {
+    memset(out_mesh, 0, sizeof(*out_mesh));
+
+    MappedFile mf;
+    if (!map_file(path, &mf))
+        return false;
+
+    // -- Split into line-aligned chunks of roughly chunk_bytes, parse them in parallel.
+    size_t const chunk_target = chunk_bytes > 0 ? chunk_bytes : 1;
+    int chunk_cnt = (int)(mf.size / chunk_target + (0 != mf.size % chunk_target));
+    ObjChunk * chunks = (ObjChunk *)::calloc(chunk_cnt, sizeof(ObjChunk));
+    char const * text = (char const *)mf.data;
+    char const * text_end = text + mf.size;
+    char const * cursor = text;
+    for (int c = 0; c < chunk_cnt; ++c) {
+        char const * end = (c == chunk_cnt - 1) ? text_end : text + (c + 1) * chunk_target;
+        if (end < cursor)
+            end = cursor;
+        while (end < text_end && end[-1] != '\n')
+            ++end;
+        chunks[c].begin = cursor;
+        chunks[c].end = end;
+        cursor = end;
+    }
+    parallel_for(chunk_cnt, 1, [&](int begin, int end, int) {
+        for (int c = begin; c < end; ++c)
+            obj_parse_chunk(&chunks[c]);
+    });
+
+    // -- Prefix sum the per-chunk counts to find each chunk's global offsets.
+    int * pos_base = (int *)::malloc(sizeof(int) * 4 * (chunk_cnt + 1));
+    int * tex_base = pos_base + (chunk_cnt + 1);
+    int * nrm_base = tex_base + (chunk_cnt + 1);
+    int * tri_base = nrm_base + (chunk_cnt + 1);
+    pos_base[0] = tex_base[0] = nrm_base[0] = tri_base[0] = 0;
+    XMVECTOR vmin = XMVectorReplicate(+FLT_MAX);
+    XMVECTOR vmax = XMVectorReplicate(-FLT_MAX);
+    for (int c = 0; c < chunk_cnt; ++c) {
+        pos_base[c + 1] = pos_base[c] + chunks[c].positions.count;
+        tex_base[c + 1] = tex_base[c] + chunks[c].texcoords.count;
+        nrm_base[c + 1] = nrm_base[c] + chunks[c].normals.count;
+        tri_base[c + 1] = tri_base[c] + chunks[c].corners.count / 3;
+        vmin = XMVectorMin(vmin, XMLoadFloat3(&chunks[c].vmin));
+        vmax = XMVectorMax(vmax, XMLoadFloat3(&chunks[c].vmax));
+    }
+    int pos_cnt = pos_base[chunk_cnt];
+    int tex_cnt = tex_base[chunk_cnt];
+    int nrm_cnt = nrm_base[chunk_cnt];
+    int tri_cnt = tri_base[chunk_cnt];
+
+    // -- Materials: load every referenced library, then resolve the switches
+    // into submesh ranges. A chunk starts with the material the previous
+    // chunk ended with.
+    ObjArray<ObjMaterial> materials = {};
+    int dir_len = 0;
+    for (int i = 0; path[i]; ++i)
+        if ('/' == path[i] || '\\' == path[i])
+            dir_len = i + 1;
+    for (int c = 0; c < chunk_cnt; ++c) {
+        for (int i = 0; i < chunks[c].mtllibs.count; ++i) {
+            char mtl_path [260];
+            obj_copy_path(mtl_path, sizeof(mtl_path), path, dir_len, chunks[c].mtllibs.data[i].name, chunks[c].mtllibs.data[i].name_len);
+            if (mtl_path[0])
+                obj_parse_mtl(mtl_path, path, dir_len, &materials);
+        }
+    }
+    ObjArray<ObjSubmesh> submeshes = {};
+    int current_material = -1;
+    for (int c = 0; c < chunk_cnt; ++c) {
+        for (int i = 0; i < chunks[c].switches.count; ++i) {
+            ObjMaterialSwitch const & s = chunks[c].switches.data[i];
+            current_material = obj_find_material(&materials, s.name, s.name_len);
+            ObjSubmesh * sm = obj_push(&submeshes);
+            sm->material = current_material;
+            sm->first_index = (uint32_t)(tri_base[c] + s.first_triangle) * 3;
+        }
+    }
+    if (0 == submeshes.count || submeshes.data[0].first_index > 0) {
+        // Faces before the first usemtl get a default material.
+        ObjSubmesh * sm = obj_push(&submeshes);
+        memmove(submeshes.data + 1, submeshes.data, sizeof(ObjSubmesh) * (submeshes.count - 1));
+        sm = &submeshes.data[0];
+        sm->material = obj_find_material(&materials, "default", 7);
+        sm->first_index = 0;
+    }
+
+    // -- Stitch the chunks into global arrays, resolving relative indices.
+    XMFLOAT3 *  positions = (XMFLOAT3 *)::malloc(sizeof(XMFLOAT3) * (pos_cnt + 1));
+    XMFLOAT2 *  texcoords = (XMFLOAT2 *)::malloc(sizeof(XMFLOAT2) * (tex_cnt + 1));
+    XMFLOAT3 *  normals = (XMFLOAT3 *)::malloc(sizeof(XMFLOAT3) * (nrm_cnt + 1));
+    ObjCorner * corners = (ObjCorner *)::malloc(sizeof(ObjCorner) * ((size_t)tri_cnt * 3 + 1));
+    parallel_for(chunk_cnt, 1, [&](int begin, int end, int) {
+        for (int c = begin; c < end; ++c) {
+            ObjChunk const & ch = chunks[c];
+            memcpy(positions + pos_base[c], ch.positions.data, sizeof(XMFLOAT3) * ch.positions.count);
+            memcpy(texcoords + tex_base[c], ch.texcoords.data, sizeof(XMFLOAT2) * ch.texcoords.count);
+            memcpy(normals + nrm_base[c], ch.normals.data, sizeof(XMFLOAT3) * ch.normals.count);
+            ObjCorner * dst = corners + (size_t)tri_base[c] * 3;
+            for (int i = 0; i < ch.corners.count; ++i) {
+                ObjCorner k = ch.corners.data[i];
+                k.p = obj_decode_index(k.p, pos_base[c]);
+                k.t = obj_decode_index(k.t, tex_base[c]);
+                k.n = obj_decode_index(k.n, nrm_base[c]);
+                // Out of range references are treated as missing.
+                if ((unsigned)k.p >= (unsigned)pos_cnt) k.p = OBJ_NONE;
+                if ((unsigned)k.t >= (unsigned)tex_cnt) k.t = OBJ_NONE;
+                if ((unsigned)k.n >= (unsigned)nrm_cnt) k.n = OBJ_NONE;
+                dst[i] = k;
+            }
+        }
+    });
+    for (int c = 0; c < chunk_cnt; ++c) {
+        obj_release(&chunks[c].positions);
+        obj_release(&chunks[c].texcoords);
+        obj_release(&chunks[c].normals);
+        obj_release(&chunks[c].corners);
+        obj_release(&chunks[c].switches);
+        obj_release(&chunks[c].mtllibs);
+    }
+    ::free(chunks);
+    unmap_file(&mf);
+
+    // -- Deduplicate corners into vertices (open addressing on the triplet).
+    int corner_cnt = tri_cnt * 3;
+    uint32_t table_size = 1024;
+    while (table_size < (uint32_t)corner_cnt * 2)
+        table_size <<= 1;
+    int * table = (int *)::malloc(sizeof(int) * table_size);
+    memset(table, 0xff, sizeof(int) * table_size);
+    ObjCorner * unique = (ObjCorner *)::malloc(sizeof(ObjCorner) * (corner_cnt + 1));
+    int * indices = (int *)::malloc(sizeof(int) * (corner_cnt + 1));
+    int vertex_cnt = 0;
+    int index_cnt = 0;
+    bool missing_normals = false;
+    int next_submesh = 0;
+    for (int i = 0; i < corner_cnt; ++i) {
+        // Submesh ranges move down by the triangles dropped before them.
+        while (next_submesh < submeshes.count && submeshes.data[next_submesh].first_index == (uint32_t)i)
+            submeshes.data[next_submesh++].first_index = (uint32_t)index_cnt;
+        ObjCorner const & k = corners[i];
+        if (0 == i % 3 && (OBJ_NONE == k.p || OBJ_NONE == corners[i + 1].p || OBJ_NONE == corners[i + 2].p)) {
+            // Drop triangles referencing positions that don't exist.
+            i += 2;
+            continue;
+        }
+        uint32_t slot = obj_hash_corner(k) & (table_size - 1);
+        for (;;) {
+            int v = table[slot];
+            if (v < 0) {
+                table[slot] = vertex_cnt;
+                unique[vertex_cnt] = k;
+                indices[index_cnt++] = vertex_cnt++;
+                missing_normals |= OBJ_NONE == k.n;
+                break;
+            }
+            if (unique[v].p == k.p && unique[v].t == k.t && unique[v].n == k.n) {
+                indices[index_cnt++] = v;
+                break;
+            }
+            slot = (slot + 1) & (table_size - 1);
+        }
+    }
+    ::free(table);
+    ::free(corners);
+    while (next_submesh < submeshes.count)
+        submeshes.data[next_submesh++].first_index = (uint32_t)index_cnt;
+    for (int i = 0; i < submeshes.count; ++i) {
+        uint32_t next = (i + 1 < submeshes.count) ? submeshes.data[i + 1].first_index : (uint32_t)index_cnt;
+        submeshes.data[i].index_count = next - submeshes.data[i].first_index;
+    }
+
+    // -- Build the output vertices.
+    Vertex * vertices = (Vertex *)::malloc(sizeof(Vertex) * (vertex_cnt + 1));
+    parallel_for(vertex_cnt, 4096, [&](int begin, int end, int) {
+        for (int i = begin; i < end; ++i) {
+            ObjCorner const & k = unique[i];
+            vertices[i].position = positions[k.p];
+            vertices[i].normal = (k.n >= 0) ? normals[k.n] : XMFLOAT3(0.0f, 0.0f, 0.0f);
+            vertices[i].texc = (k.t >= 0) ? texcoords[k.t] : XMFLOAT2(0.0f, 0.0f);
+        }
+    });
+    if (missing_normals) {
+        // Area weighted face normals for the vertices the file left without one.
+        for (int i = 0; i + 2 < index_cnt; i += 3) {
+            XMVECTOR p0 = XMLoadFloat3(&vertices[indices[i + 0]].position);
+            XMVECTOR p1 = XMLoadFloat3(&vertices[indices[i + 1]].position);
+            XMVECTOR p2 = XMLoadFloat3(&vertices[indices[i + 2]].position);
+            XMVECTOR n = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+            for (int j = 0; j < 3; ++j) {
+                if (OBJ_NONE == unique[indices[i + j]].n) {
+                    XMFLOAT3 & dst = vertices[indices[i + j]].normal;
+                    XMStoreFloat3(&dst, XMVectorAdd(XMLoadFloat3(&dst), n));
+                }
+            }
+        }
+        for (int i = 0; i < vertex_cnt; ++i)
+            if (OBJ_NONE == unique[i].n)
+                XMStoreFloat3(&vertices[i].normal, XMVector3Normalize(XMLoadFloat3(&vertices[i].normal)));
+    }
+    generate_tangents(vertices, vertex_cnt, indices, index_cnt);
+
+    ::free(unique);
+    ::free(positions);
+    ::free(texcoords);
+    ::free(normals);
+    ::free(pos_base);
+
+    // -- Bounds: box from the parse pass, sphere around the box center.
+    BoundsBuilder bounds;
+    XMFLOAT3 center;
+    XMStoreFloat3(&center, XMVectorScale(XMVectorAdd(vmin, vmax), 0.5f));
+    bounds_begin(&bounds, center);
+    for (int i = 0; i < vertex_cnt; ++i)
+        bounds_add(&bounds, vertices[i].position);
+    bounds_end(&bounds, &out_mesh->bounds);
+
+    out_mesh->vertices = vertices;
+    out_mesh->vertex_count = vertex_cnt;
+    out_mesh->indices = indices;
+    out_mesh->index_count = index_cnt;
+    out_mesh->submeshes = submeshes.data;
+    out_mesh->submesh_count = submeshes.count;
+    out_mesh->materials = materials.data;
+    out_mesh->material_count = materials.count;
+    return index_cnt > 0;
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+// Minimal fork/join helper: splits [0, count) into contiguous ranges and runs
+// them on plain std::threads, the calling thread taking the first range.
+//
+// Starting threads costs tens of microseconds each, which is fine for loads
+// but not for kernels that run every frame. Those take a WorkerPool, whose
+// threads are started once and sleep between calls, and split their ranges
+// the same way.
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#define WORKER_POOL_MAX_THREADS 64
+
+static int
+worker_count () {
+    unsigned n = std::thread::hardware_concurrency();
+    return n > 0 ? (int)n : 1;
+}
+// fn(begin, end, worker) is called once per range; 'worker' is in
+// [0, task count) and can index per-thread scratch. Ranges hold at least
+// min_per_task items so tiny inputs don't pay for thread start-up.
+// Returns the number of ranges that were run.
+template <typename Fn>
+static int
+parallel_for (int count, int min_per_task, Fn && fn) {
+    if (count <= 0)
+        return 0;
+    if (min_per_task < 1)
+        min_per_task = 1;
+    int tasks = worker_count();
+    int max_tasks = (count + min_per_task - 1) / min_per_task;
+    if (tasks > max_tasks)
+        tasks = max_tasks;
+    if (tasks > WORKER_POOL_MAX_THREADS)
+        tasks = WORKER_POOL_MAX_THREADS;
+
+    std::thread threads [WORKER_POOL_MAX_THREADS];
+    int per_task = count / tasks;
+    int extra = count % tasks;
+    int begin = 0;
+    int first_end = 0;
+    for (int t = 0; t < tasks; ++t) {
+        int end = begin + per_task + (t < extra ? 1 : 0);
+        if (0 == t)
+            first_end = end;
+        else
+            threads[t] = std::thread(fn, begin, end, t);
+        begin = end;
+    }
+    fn(0, first_end, 0);
+    for (int t = 1; t < tasks; ++t)
+        threads[t].join();
+    return tasks;
+}
+
+// -- persistent workers
+
+struct WorkerPool {
+    std::thread                 threads [WORKER_POOL_MAX_THREADS];
+    int                         thread_count;   // besides the calling thread
+
+    std::mutex                  lock;
+    std::condition_variable     start;
+    std::condition_variable     done;
+    uint64_t                    generation;     // bumped for every job
+    int                         running;        // workers still on the current job
+    bool                        quit;
+
+    // the current job: task t runs run(ctx, t) for t in [1, task_count)
+    void                        (*run) (void * ctx, int task);
+    void *                      ctx;
+    int                         task_count;
+};
+
+static void
+worker_pool_thread (WorkerPool * pool, int index) {
+    uint64_t seen = 0;
+    for (;;) {
+        void (*run) (void *, int);
+        void * ctx;
+        int task_count;
+        {
+            std::unique_lock<std::mutex> guard(pool->lock);
+            pool->start.wait(guard, [pool, seen] { return pool->quit || pool->generation != seen; });
+            if (pool->quit)
+                return;
+            seen = pool->generation;
+            run = pool->run;
+            ctx = pool->ctx;
+            task_count = pool->task_count;
+        }
+        if (index < task_count)
+            run(ctx, index);
+        std::lock_guard<std::mutex> guard(pool->lock);
+        if (0 == --pool->running)
+            pool->done.notify_one();
+    }
+}
+// 'threads' counts the calling thread too; 0 uses every hardware thread.
+// The pool holds a mutex and threads, so it lives on the heap.
+static WorkerPool *
+worker_pool_create (int threads) {
+    if (threads <= 0)
+        threads = worker_count();
+    if (threads > WORKER_POOL_MAX_THREADS)
+        threads = WORKER_POOL_MAX_THREADS;
+    WorkerPool * pool = new WorkerPool();
+    pool->thread_count = threads - 1;
+    pool->generation = 0;
+    pool->running = 0;
+    pool->quit = false;
+    pool->run = nullptr;
+    pool->ctx = nullptr;
+    pool->task_count = 0;
+    for (int t = 0; t < pool->thread_count; ++t)
+        pool->threads[t] = std::thread(worker_pool_thread, pool, t + 1);
+    return pool;
+}
+static void
+worker_pool_destroy (WorkerPool * pool) {
+    if (nullptr == pool)
+        return;
+    {
+        std::lock_guard<std::mutex> guard(pool->lock);
+        pool->quit = true;
+    }
+    pool->start.notify_all();
+    for (int t = 0; t < pool->thread_count; ++t)
+        pool->threads[t].join();
+    delete pool;
+}
+// Range of task t when 'count' items are split into 'tasks' ranges, the
+// first count % tasks of them one item longer.
+static inline void
+parallel_range (int count, int tasks, int t, int * begin, int * end) {
+    int per_task = count / tasks;
+    int extra = count % tasks;
+    *begin = t * per_task + (t < extra ? t : extra);
+    *end = *begin + per_task + (t < extra ? 1 : 0);
+}
+// parallel_for on the pool's threads: same ranges, same fn(begin, end,
+// worker) contract. One caller at a time, and fn must not use the pool
+// itself. A null pool falls back to the fork/join version.
+template <typename Fn>
+static int
+parallel_for (WorkerPool * pool, int count, int min_per_task, Fn && fn) {
+    if (nullptr == pool)
+        return parallel_for(count, min_per_task, fn);
+    if (count <= 0)
+        return 0;
+    if (min_per_task < 1)
+        min_per_task = 1;
+    int tasks = pool->thread_count + 1;
+    int max_tasks = (count + min_per_task - 1) / min_per_task;
+    if (tasks > max_tasks)
+        tasks = max_tasks;
+
+    struct Job {
+        Fn *    fn;
+        int     count;
+        int     tasks;
+    };
+    Job job = {&fn, count, tasks};
+    if (tasks > 1) {
+        {
+            std::lock_guard<std::mutex> guard(pool->lock);
+            pool->run = [](void * ctx, int t) {
+                Job const * j = (Job const *)ctx;
+                int begin, end;
+                parallel_range(j->count, j->tasks, t, &begin, &end);
+                (*j->fn)(begin, end, t);
+            };
+            pool->ctx = &job;
+            pool->task_count = tasks;
+            pool->running = pool->thread_count;
+            ++pool->generation;
+        }
+        pool->start.notify_all();
+    }
+
+    int begin, end;
+    parallel_range(count, tasks, 0, &begin, &end);
+    fn(begin, end, 0);
+
+    if (tasks > 1) {
+        std::unique_lock<std::mutex> guard(pool->lock);
+        pool->done.wait(guard, [pool] { return 0 == pool->running; });
+    }
+    return tasks;
+}
@@ -0,0 +1,370 @@
+#pragma once
+
+// Two-level segregated fit (TLSF) allocator over an abstract range of units.
+// It never touches the memory it manages, so it can hand out regions of a GPU
+// buffer (or anything else) and be exercised without a device.
+//
+// Sizes are binned with a tiny float (5 bit exponent, 3 bit mantissa): the
+// exponent picks the first level, the mantissa the second level, giving 256
+// bins with at most 12.5% internal waste per bin. Free lists are doubly linked
+// through a node pool and bitmasks find the first non-empty bin in O(1).
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#define RANGE_ALLOC_TOP_BINS        32
+#define RANGE_ALLOC_BINS_PER_TOP    8
+#define RANGE_ALLOC_BIN_COUNT       (RANGE_ALLOC_TOP_BINS * RANGE_ALLOC_BINS_PER_TOP)
+#define RANGE_ALLOC_MANTISSA_BITS   3
+
+#define RANGE_ALLOC_INVALID         0xffffffffu
+
+struct RangeNode {
+    uint32_t    offset;
+    uint32_t    size;
+    uint32_t    user;           // caller tag, reported back by defrag moves
+    uint32_t    bin_prev;       // free list links (free nodes only)
+    uint32_t    bin_next;
+    uint32_t    phys_prev;      // neighbours in address order
+    uint32_t    phys_next;
+    bool        used;
+};
+
+struct RangeAllocator {
+    uint32_t    total_size;
+    uint32_t    free_size;
+
+    uint32_t    used_bins_top;
+    uint8_t     used_bins [RANGE_ALLOC_TOP_BINS];
+    uint32_t    bin_heads [RANGE_ALLOC_BIN_COUNT];
+
+    uint32_t    phys_head;      // node at offset 0
+
+    RangeNode * nodes;
+    uint32_t *  free_nodes;     // stack of unused node slots
+    uint32_t    free_node_top;
+    uint32_t    max_nodes;
+};
+
+// One block relocated by range_allocator_defrag; the caller copies the data.
+struct RangeMove {
+    uint32_t    node;
+    uint32_t    user;
+    uint32_t    src_offset;
+    uint32_t    dst_offset;
+    uint32_t    size;
+};
+
+static inline uint32_t
+range_alloc_highest_bit (uint32_t v) {
+#if defined(_MSC_VER)
+    unsigned long r;
+    _BitScanReverse(&r, v);
+    return (uint32_t)r;
+#else
+    return 31u - (uint32_t)__builtin_clz(v);
+#endif
+}
+static inline uint32_t
+range_alloc_lowest_bit (uint32_t v) {
+#if defined(_MSC_VER)
+    unsigned long r;
+    _BitScanForward(&r, v);
+    return (uint32_t)r;
+#else
+    return (uint32_t)__builtin_ctz(v);
+#endif
+}
+static uint32_t
+range_alloc_bin_round_up (uint32_t size) {
+    uint32_t exp = 0;
+    uint32_t mantissa = 0;
+    if (size < RANGE_ALLOC_BINS_PER_TOP) {
+        mantissa = size;
+    } else {
+        uint32_t mantissa_start = range_alloc_highest_bit(size) - RANGE_ALLOC_MANTISSA_BITS;
+        exp = mantissa_start + 1;
+        mantissa = (size >> mantissa_start) & (RANGE_ALLOC_BINS_PER_TOP - 1);
+        uint32_t low_mask = (1u << mantissa_start) - 1;
+        if (size & low_mask)
+            ++mantissa;     // a carry rolls over into the exponent on purpose
+    }
+    return (exp << RANGE_ALLOC_MANTISSA_BITS) + mantissa;
+}
+static uint32_t
+range_alloc_bin_round_down (uint32_t size) {
+    uint32_t exp = 0;
+    uint32_t mantissa = 0;
+    if (size < RANGE_ALLOC_BINS_PER_TOP) {
+        mantissa = size;
+    } else {
+        uint32_t mantissa_start = range_alloc_highest_bit(size) - RANGE_ALLOC_MANTISSA_BITS;
+        exp = mantissa_start + 1;
+        mantissa = (size >> mantissa_start) & (RANGE_ALLOC_BINS_PER_TOP - 1);
+    }
+    return (exp << RANGE_ALLOC_MANTISSA_BITS) | mantissa;
+}
+static void
+range_alloc_bin_insert (RangeAllocator * ra, uint32_t n) {
+    uint32_t bin = range_alloc_bin_round_down(ra->nodes[n].size);
+    uint32_t top = bin >> RANGE_ALLOC_MANTISSA_BITS;
+    uint32_t leaf = bin & (RANGE_ALLOC_BINS_PER_TOP - 1);
+
+    if (RANGE_ALLOC_INVALID == ra->bin_heads[bin]) {
+        ra->used_bins[top] |= 1u << leaf;
+        ra->used_bins_top |= 1u << top;
+    }
+    uint32_t head = ra->bin_heads[bin];
+    ra->nodes[n].bin_prev = RANGE_ALLOC_INVALID;
+    ra->nodes[n].bin_next = head;
+    if (head != RANGE_ALLOC_INVALID)
+        ra->nodes[head].bin_prev = n;
+    ra->bin_heads[bin] = n;
+    ra->free_size += ra->nodes[n].size;
+}
+static void
+range_alloc_bin_remove (RangeAllocator * ra, uint32_t n) {
+    RangeNode * node = &ra->nodes[n];
+    if (node->bin_prev != RANGE_ALLOC_INVALID) {
+        ra->nodes[node->bin_prev].bin_next = node->bin_next;
+    } else {
+        uint32_t bin = range_alloc_bin_round_down(node->size);
+        ra->bin_heads[bin] = node->bin_next;
+        if (RANGE_ALLOC_INVALID == node->bin_next) {
+            uint32_t top = bin >> RANGE_ALLOC_MANTISSA_BITS;
+            uint32_t leaf = bin & (RANGE_ALLOC_BINS_PER_TOP - 1);
+            ra->used_bins[top] &= ~(1u << leaf);
+            if (0 == ra->used_bins[top])
+                ra->used_bins_top &= ~(1u << top);
+        }
+    }
+    if (node->bin_next != RANGE_ALLOC_INVALID)
+        ra->nodes[node->bin_next].bin_prev = node->bin_prev;
+    ra->free_size -= node->size;
+}
+static uint32_t
+range_alloc_new_node (RangeAllocator * ra, uint32_t offset, uint32_t size) {
+    if (0 == ra->free_node_top)
+        return RANGE_ALLOC_INVALID;
+    uint32_t n = ra->free_nodes[--ra->free_node_top];
+    RangeNode * node = &ra->nodes[n];
+    memset(node, 0, sizeof(*node));
+    node->offset = offset;
+    node->size = size;
+    node->bin_prev = node->bin_next = RANGE_ALLOC_INVALID;
+    node->phys_prev = node->phys_next = RANGE_ALLOC_INVALID;
+    return n;
+}
+static void
+range_alloc_delete_node (RangeAllocator * ra, uint32_t n) {
+    ra->free_nodes[ra->free_node_top++] = n;
+}
+static bool
+range_allocator_init (RangeAllocator * ra, uint32_t total_size, uint32_t max_allocs) {
+    memset(ra, 0, sizeof(*ra));
+    // Worst case every allocation is separated by a free block.
+    ra->max_nodes = max_allocs * 2 + 1;
+    ra->nodes = (RangeNode *)::malloc(sizeof(RangeNode) * ra->max_nodes);
+    ra->free_nodes = (uint32_t *)::malloc(sizeof(uint32_t) * ra->max_nodes);
+    if (nullptr == ra->nodes || nullptr == ra->free_nodes)
+        return false;
+    for (uint32_t i = 0; i < ra->max_nodes; ++i)
+        ra->free_nodes[i] = ra->max_nodes - i - 1;
+    ra->free_node_top = ra->max_nodes;
+    for (uint32_t i = 0; i < RANGE_ALLOC_BIN_COUNT; ++i)
+        ra->bin_heads[i] = RANGE_ALLOC_INVALID;
+
+    ra->total_size = total_size;
+    ra->phys_head = range_alloc_new_node(ra, 0, total_size);
+    range_alloc_bin_insert(ra, ra->phys_head);
+    return true;
+}
+static void
+range_allocator_destroy (RangeAllocator * ra) {
+    ::free(ra->nodes);
+    ::free(ra->free_nodes);
+    memset(ra, 0, sizeof(*ra));
+}
+// Returns a node handle, or RANGE_ALLOC_INVALID when no free block is big enough.
+static uint32_t
+range_allocator_alloc (RangeAllocator * ra, uint32_t size, uint32_t user) {
+    if (0 == size || size > ra->free_size)
+        return RANGE_ALLOC_INVALID;
+
+    // Round up so that any block in the chosen bin is large enough.
+    uint32_t min_bin = range_alloc_bin_round_up(size);
+    uint32_t top = min_bin >> RANGE_ALLOC_MANTISSA_BITS;
+    uint32_t leaf = min_bin & (RANGE_ALLOC_BINS_PER_TOP - 1);
+    if (top >= RANGE_ALLOC_TOP_BINS)
+        return RANGE_ALLOC_INVALID;
+
+    uint32_t bin = RANGE_ALLOC_INVALID;
+    if (ra->used_bins_top & (1u << top)) {
+        uint32_t leaf_mask = ra->used_bins[top] & (0xffu << leaf);
+        if (leaf_mask)
+            bin = (top << RANGE_ALLOC_MANTISSA_BITS) | range_alloc_lowest_bit(leaf_mask);
+    }
+    if (RANGE_ALLOC_INVALID == bin) {
+        uint32_t top_mask = (top + 1 < 32) ? (ra->used_bins_top & (0xffffffffu << (top + 1))) : 0;
+        if (top_mask) {
+            top = range_alloc_lowest_bit(top_mask);
+            bin = (top << RANGE_ALLOC_MANTISSA_BITS) | range_alloc_lowest_bit(ra->used_bins[top]);
+        }
+    }
+
+    uint32_t n = RANGE_ALLOC_INVALID;
+    if (RANGE_ALLOC_INVALID != bin) {
+        n = ra->bin_heads[bin];
+    } else {
+        // Nothing in the bins that always fit. The bin holding 'size' itself
+        // can still have a block large enough, e.g. one freed by an earlier
+        // allocation of the same size; without this look a pool streaming
+        // equal-sized meshes could never reuse their blocks.
+        for (uint32_t c = ra->bin_heads[range_alloc_bin_round_down(size)]; c != RANGE_ALLOC_INVALID; c = ra->nodes[c].bin_next) {
+            if (ra->nodes[c].size >= size) {
+                n = c;
+                break;
+            }
+        }
+        if (RANGE_ALLOC_INVALID == n)
+            return RANGE_ALLOC_INVALID;
+    }
+    range_alloc_bin_remove(ra, n);
+
+    RangeNode * node = &ra->nodes[n];
+    uint32_t remainder = node->size - size;
+    if (remainder > 0) {
+        uint32_t r = range_alloc_new_node(ra, node->offset + size, remainder);
+        if (RANGE_ALLOC_INVALID == r) {
+            range_alloc_bin_insert(ra, n);
+            return RANGE_ALLOC_INVALID;
+        }
+        node = &ra->nodes[n];
+        RangeNode * rest = &ra->nodes[r];
+        rest->phys_prev = n;
+        rest->phys_next = node->phys_next;
+        if (node->phys_next != RANGE_ALLOC_INVALID)
+            ra->nodes[node->phys_next].phys_prev = r;
+        node->phys_next = r;
+        node->size = size;
+        range_alloc_bin_insert(ra, r);
+    }
+    node->used = true;
+    node->user = user;
+    return n;
+}
+static void
+range_allocator_free (RangeAllocator * ra, uint32_t n) {
+    RangeNode * node = &ra->nodes[n];
+    node->used = false;
+
+    // Coalesce with free neighbours.
+    uint32_t prev = node->phys_prev;
+    if (prev != RANGE_ALLOC_INVALID && !ra->nodes[prev].used) {
+        range_alloc_bin_remove(ra, prev);
+        node->offset = ra->nodes[prev].offset;
+        node->size += ra->nodes[prev].size;
+        node->phys_prev = ra->nodes[prev].phys_prev;
+        if (node->phys_prev != RANGE_ALLOC_INVALID)
+            ra->nodes[node->phys_prev].phys_next = n;
+        if (ra->phys_head == prev)
+            ra->phys_head = n;
+        range_alloc_delete_node(ra, prev);
+    }
+    uint32_t next = node->phys_next;
+    if (next != RANGE_ALLOC_INVALID && !ra->nodes[next].used) {
+        range_alloc_bin_remove(ra, next);
+        node->size += ra->nodes[next].size;
+        node->phys_next = ra->nodes[next].phys_next;
+        if (node->phys_next != RANGE_ALLOC_INVALID)
+            ra->nodes[node->phys_next].phys_prev = n;
+        range_alloc_delete_node(ra, next);
+    }
+    range_alloc_bin_insert(ra, n);
+}
+static inline uint32_t
+range_allocator_offset (RangeAllocator const * ra, uint32_t n) {
+    return ra->nodes[n].offset;
+}
+// Size of the largest free block, i.e. the biggest allocation that would
+// currently succeed (up to bin granularity).
+static uint32_t
+range_allocator_largest_free (RangeAllocator const * ra) {
+    if (0 == ra->used_bins_top)
+        return 0;
+    uint32_t top = range_alloc_highest_bit(ra->used_bins_top);
+    uint32_t bin = (top << RANGE_ALLOC_MANTISSA_BITS) | range_alloc_highest_bit(ra->used_bins[top]);
+    uint32_t largest = 0;
+    for (uint32_t n = ra->bin_heads[bin]; n != RANGE_ALLOC_INVALID; n = ra->nodes[n].bin_next)
+        if (ra->nodes[n].size > largest)
+            largest = ra->nodes[n].size;
+    return largest;
+}
+// 0 when all free space is one block, approaching 1 as it gets shredded.
+static float
+range_allocator_fragmentation (RangeAllocator const * ra) {
+    if (0 == ra->free_size)
+        return 0.0f;
+    return 1.0f - (float)range_allocator_largest_free(ra) / (float)ra->free_size;
+}
+// Incremental compaction: slides used blocks down into the free block in
+// front of them until either no such pair is left or 'max_units' worth of
+// data has been moved, so it can be spread over several frames. The moves
+// are written to out_moves (at most max_moves) in the order they have to be
+// executed; node handles stay valid and pick up their new offsets.
+// Returns the number of moves.
+static int
+range_allocator_defrag (RangeAllocator * ra, uint32_t max_units, RangeMove out_moves [], int max_moves) {
+    uint32_t n = ra->phys_head;
+    int move_cnt = 0;
+    uint32_t moved = 0;
+    while (n != RANGE_ALLOC_INVALID && move_cnt < max_moves && moved < max_units) {
+        uint32_t next = ra->nodes[n].phys_next;
+        if (ra->nodes[n].used || RANGE_ALLOC_INVALID == next) {
+            n = next;
+            continue;
+        }
+        // n is free and next must be used (free neighbours are always merged).
+        uint32_t f = n;
+        uint32_t u = next;
+        RangeNode * fn = &ra->nodes[f];
+        RangeNode * un = &ra->nodes[u];
+
+        out_moves[move_cnt++] = {u, un->user, un->offset, fn->offset, un->size};
+        moved += un->size;
+
+        // Swap the two blocks in address order: u takes f's offset, f follows u.
+        range_alloc_bin_remove(ra, f);
+        un->offset = fn->offset;
+        fn->offset = un->offset + un->size;
+
+        un->phys_prev = fn->phys_prev;
+        if (un->phys_prev != RANGE_ALLOC_INVALID)
+            ra->nodes[un->phys_prev].phys_next = u;
+        fn->phys_next = un->phys_next;
+        if (fn->phys_next != RANGE_ALLOC_INVALID)
+            ra->nodes[fn->phys_next].phys_prev = f;
+        un->phys_next = f;
+        fn->phys_prev = u;
+        if (ra->phys_head == f)
+            ra->phys_head = u;
+
+        // The free block may now touch another free block.
+        uint32_t after = fn->phys_next;
+        if (after != RANGE_ALLOC_INVALID && !ra->nodes[after].used) {
+            range_alloc_bin_remove(ra, after);
+            fn->size += ra->nodes[after].size;
+            fn->phys_next = ra->nodes[after].phys_next;
+            if (fn->phys_next != RANGE_ALLOC_INVALID)
+                ra->nodes[fn->phys_next].phys_prev = f;
+            range_alloc_delete_node(ra, after);
+        }
+        range_alloc_bin_insert(ra, f);
+        n = f;
+    }
+    return move_cnt;
+}
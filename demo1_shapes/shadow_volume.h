@@ -0,0 +1,352 @@
+#pragma once
+
+// CPU stencil shadow volumes. A caster keeps a welded copy of a mesh laid
+// out for the per-light pass: positions, face planes and edges (with the
+// planes of the two faces on either side) as structure-of-arrays streams
+// padded to four, so light-facing tests run four faces or four edges at a
+// time with SSE2.
+//
+// For one light the pass marks the faces that see it, then emits a closed
+// z-fail volume: the lit faces as the front cap, the same faces pushed away
+// from the light as the back cap, and a side quad along every silhouette
+// edge (an edge between a lit face and an unlit or missing one). Lights
+// are homogeneous positions in the caster's object space: (x, y, z, 1) for
+// a point light, (towards-light direction, 0) for a directional one.
+// Volumes of many casters and lights are built in parallel.
+
+#include <DirectXMath.h>
+using namespace DirectX;
+
+#include "adjacency.h"
+#include "parallel.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SHADOW_SSE2 1
+#endif
+
+struct ShadowCaster {
+    int         vertex_count;       // welded
+    int         triangle_count;
+    int         edge_count;
+
+    float *     positions;          // x, y, z streams of padded vertex count
+    int *       triangles;          // 3 welded ids per triangle
+    float *     face_planes;        // nx, ny, nz, d streams (unnormalized)
+    int *       edges;              // v0, v1 per edge, in face 0's winding
+    float *     edge_planes;        // face 0 plane streams, then face 1's
+};
+
+// One volume to build: 'light' is already in the caster's object space.
+struct ShadowJob {
+    ShadowCaster const *    caster;
+    XMFLOAT4                light;
+};
+
+// Where a job's volume landed in the output buffers.
+struct ShadowDraw {
+    int     base_vertex;
+    int     first_index;
+    int     index_count;
+};
+
+static inline int
+shadow_pad4 (int count) {
+    return (count + 3) & ~3;
+}
+static int
+shadow_caster_vertex_bound (ShadowCaster const * caster) {
+    return caster->vertex_count * 2;
+}
+// Both caps plus a quad per edge.
+static int
+shadow_caster_index_bound (ShadowCaster const * caster) {
+    return caster->triangle_count * 6 + caster->edge_count * 6;
+}
+
+// Builds a caster from 'index_count / 3' triangles; positions are x, y, z
+// floats every 'stride' bytes. Release with shadow_caster_destroy.
+static void
+shadow_caster_create (
+    ShadowCaster * caster,
+    float const * positions, size_t stride, int vertex_count,
+    int const indices [], int index_count
+) {
+    memset(caster, 0, sizeof(*caster));
+    HalfEdgeMesh adjacency;
+    half_edge_build(indices, index_count, vertex_count, positions, stride, &adjacency);
+
+    // -- Compact the welded ids.
+    int * compact = (int *)::malloc(sizeof(int) * (vertex_count + 1));
+    int welded = 0;
+    for (int v = 0; v < vertex_count; ++v)
+        compact[v] = adjacency.remap[v] == v ? welded++ : compact[adjacency.remap[v]];
+
+    int tri_count = adjacency.triangle_count;
+    int pv = shadow_pad4(welded);
+    int pt = shadow_pad4(tri_count);
+    caster->vertex_count = welded;
+    caster->triangle_count = tri_count;
+    caster->positions = (float *)::calloc(pv * 3 + 1, sizeof(float));
+    caster->triangles = (int *)::malloc(sizeof(int) * (tri_count * 3 + 1));
+    caster->face_planes = (float *)::calloc(pt * 4 + 1, sizeof(float));
+
+    for (int v = 0; v < vertex_count; ++v) {
+        if (adjacency.remap[v] != v)
+            continue;
+        float const * p = (float const *)((uint8_t const *)positions + v * stride);
+        for (int c = 0; c < 3; ++c)
+            caster->positions[c * pv + compact[v]] = p[c];
+    }
+    for (int t = 0; t < tri_count; ++t) {
+        float const * p [3];
+        for (int k = 0; k < 3; ++k) {
+            int v = compact[indices[t * 3 + k]];
+            caster->triangles[t * 3 + k] = v;
+            p[k] = (float const *)((uint8_t const *)positions + indices[t * 3 + k] * stride);
+        }
+        float e1 [3] = {p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2]};
+        float e2 [3] = {p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2]};
+        float n [3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+        caster->face_planes[0 * pt + t] = n[0];
+        caster->face_planes[1 * pt + t] = n[1];
+        caster->face_planes[2 * pt + t] = n[2];
+        caster->face_planes[3 * pt + t] = -(n[0] * p[0][0] + n[1] * p[0][1] + n[2] * p[0][2]);
+    }
+
+    // -- One edge per twin pair or border half-edge. A border edge's
+    // missing face gets the plane (0, 0, 0, -1), which never sees a light.
+    int edge_count = 0;
+    for (int he = 0; he < tri_count * 3; ++he) {
+        int twin = adjacency.twin[he];
+        bool collapsed = caster->triangles[he] == caster->triangles[half_edge_next(he)];
+        edge_count += (!collapsed && (twin < 0 || he < twin)) ? 1 : 0;
+    }
+    int pe = shadow_pad4(edge_count);
+    caster->edges = (int *)::malloc(sizeof(int) * (edge_count * 2 + 1));
+    caster->edge_planes = (float *)::calloc(pe * 8 + 1, sizeof(float));
+    int e = 0;
+    for (int he = 0; he < tri_count * 3; ++he) {
+        int twin = adjacency.twin[he];
+        if (twin >= 0 && twin < he)
+            continue;
+        int a = caster->triangles[he];
+        int b = caster->triangles[half_edge_next(he)];
+        if (a == b)
+            continue;
+        caster->edges[e * 2 + 0] = a;
+        caster->edges[e * 2 + 1] = b;
+        for (int c = 0; c < 4; ++c) {
+            caster->edge_planes[c * pe + e] = caster->face_planes[c * pt + half_edge_face(he)];
+            caster->edge_planes[(4 + c) * pe + e] = twin >= 0 ? caster->face_planes[c * pt + half_edge_face(twin)] : (3 == c ? -1.0f : 0.0f);
+        }
+        ++e;
+    }
+    caster->edge_count = edge_count;
+
+    ::free(compact);
+    half_edge_destroy(&adjacency);
+}
+static void
+shadow_caster_destroy (ShadowCaster * caster) {
+    ::free(caster->positions);
+    ::free(caster->triangles);
+    ::free(caster->face_planes);
+    ::free(caster->edges);
+    ::free(caster->edge_planes);
+    memset(caster, 0, sizeof(*caster));
+}
+
+// -- Per-light kernels
+// Writes the near (light-side) vertices then the far ones, each pushed
+// 'extrusion' object units away from the light.
+static void
+shadow_extrude_vertices (ShadowCaster const * caster, XMFLOAT4 light, float extrusion, void * out_vertices, size_t stride) {
+    int vc = caster->vertex_count;
+    int pv = shadow_pad4(vc);
+    float const * xs = caster->positions;
+    float const * ys = caster->positions + pv;
+    float const * zs = caster->positions + pv * 2;
+    uint8_t * out_near = (uint8_t *)out_vertices;
+    uint8_t * out_far = (uint8_t *)out_vertices + vc * stride;
+#if defined(SHADOW_SSE2)
+    __m128 lx = _mm_set1_ps(light.x);
+    __m128 ly = _mm_set1_ps(light.y);
+    __m128 lz = _mm_set1_ps(light.z);
+    __m128 lw = _mm_set1_ps(light.w);
+    __m128 ext = _mm_set1_ps(extrusion);
+    __m128 tiny = _mm_set1_ps(1e-20f);
+    for (int i = 0; i < vc; i += 4) {
+        __m128 x = _mm_loadu_ps(xs + i);
+        __m128 y = _mm_loadu_ps(ys + i);
+        __m128 z = _mm_loadu_ps(zs + i);
+        // direction away from the light: p * w - l
+        __m128 dx = _mm_sub_ps(_mm_mul_ps(x, lw), lx);
+        __m128 dy = _mm_sub_ps(_mm_mul_ps(y, lw), ly);
+        __m128 dz = _mm_sub_ps(_mm_mul_ps(z, lw), lz);
+        __m128 len_sq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        __m128 scale = _mm_div_ps(ext, _mm_sqrt_ps(_mm_max_ps(len_sq, tiny)));
+        float fx [4], fy [4], fz [4];
+        _mm_storeu_ps(fx, _mm_add_ps(x, _mm_mul_ps(dx, scale)));
+        _mm_storeu_ps(fy, _mm_add_ps(y, _mm_mul_ps(dy, scale)));
+        _mm_storeu_ps(fz, _mm_add_ps(z, _mm_mul_ps(dz, scale)));
+        int n = vc - i < 4 ? vc - i : 4;
+        for (int k = 0; k < n; ++k) {
+            float * p = (float *)(out_near + (i + k) * stride);
+            float * q = (float *)(out_far + (i + k) * stride);
+            p[0] = xs[i + k];
+            p[1] = ys[i + k];
+            p[2] = zs[i + k];
+            q[0] = fx[k];
+            q[1] = fy[k];
+            q[2] = fz[k];
+        }
+    }
+#else
+    for (int i = 0; i < vc; ++i) {
+        float dx = xs[i] * light.w - light.x;
+        float dy = ys[i] * light.w - light.y;
+        float dz = zs[i] * light.w - light.z;
+        float len_sq = dx * dx + dy * dy + dz * dz;
+        float scale = extrusion / sqrtf(len_sq > 1e-20f ? len_sq : 1e-20f);
+        float * p = (float *)(out_near + i * stride);
+        float * q = (float *)(out_far + i * stride);
+        p[0] = xs[i];
+        p[1] = ys[i];
+        p[2] = zs[i];
+        q[0] = xs[i] + dx * scale;
+        q[1] = ys[i] + dy * scale;
+        q[2] = zs[i] + dz * scale;
+    }
+#endif
+}
+// Bit k of the result: plane[i + k] . light > 0, for the four planes at i
+// of 'count'-padded streams.
+static inline int
+shadow_facing4 (float const * planes, int padded, int i, XMFLOAT4 light) {
+#if defined(SHADOW_SSE2)
+    __m128 d = _mm_mul_ps(_mm_loadu_ps(planes + i), _mm_set1_ps(light.x));
+    d = _mm_add_ps(d, _mm_mul_ps(_mm_loadu_ps(planes + padded + i), _mm_set1_ps(light.y)));
+    d = _mm_add_ps(d, _mm_mul_ps(_mm_loadu_ps(planes + padded * 2 + i), _mm_set1_ps(light.z)));
+    d = _mm_add_ps(d, _mm_mul_ps(_mm_loadu_ps(planes + padded * 3 + i), _mm_set1_ps(light.w)));
+    return _mm_movemask_ps(_mm_cmpgt_ps(d, _mm_setzero_ps()));
+#else
+    int mask = 0;
+    for (int k = 0; k < 4; ++k) {
+        float d =
+            planes[i + k] * light.x + planes[padded + i + k] * light.y +
+            planes[padded * 2 + i + k] * light.z + planes[padded * 3 + i + k] * light.w;
+        mask |= (d > 0.0f ? 1 : 0) << k;
+    }
+    return mask;
+#endif
+}
+// Emits the caps and silhouette sides of one caster's volume; indices are
+// relative to the vertices from shadow_extrude_vertices. Returns the index
+// count, at most shadow_caster_index_bound.
+static int
+shadow_volume_indices (ShadowCaster const * caster, XMFLOAT4 light, int out_indices []) {
+    int vc = caster->vertex_count;
+    int pt = shadow_pad4(caster->triangle_count);
+    int pe = shadow_pad4(caster->edge_count);
+    int * out = out_indices;
+
+    // -- Caps: lit faces as they are, and reversed on the far side.
+    for (int t = 0; t < caster->triangle_count; t += 4) {
+        int lit = shadow_facing4(caster->face_planes, pt, t, light);
+        while (lit) {
+            int k = 0;
+            while (!(lit & (1 << k)))
+                ++k;
+            lit &= lit - 1;
+            int const * tri = caster->triangles + (t + k) * 3;
+            out[0] = tri[0];
+            out[1] = tri[1];
+            out[2] = tri[2];
+            out[3] = tri[0] + vc;
+            out[4] = tri[2] + vc;
+            out[5] = tri[1] + vc;
+            out += 6;
+        }
+    }
+    // -- Sides: a quad along every edge whose faces disagree, walking the
+    // edge against the lit face's winding.
+    for (int e = 0; e < caster->edge_count; e += 4) {
+        int lit0 = shadow_facing4(caster->edge_planes, pe, e, light);
+        int lit1 = shadow_facing4(caster->edge_planes + pe * 4, pe, e, light);
+        int silhouette = lit0 ^ lit1;
+        while (silhouette) {
+            int k = 0;
+            while (!(silhouette & (1 << k)))
+                ++k;
+            silhouette &= silhouette - 1;
+            int const * edge = caster->edges + (e + k) * 2;
+            bool forward = 0 != (lit0 & (1 << k));
+            int a = forward ? edge[0] : edge[1];
+            int b = forward ? edge[1] : edge[0];
+            out[0] = b;
+            out[1] = a;
+            out[2] = a + vc;
+            out[3] = b;
+            out[4] = a + vc;
+            out[5] = b + vc;
+            out += 6;
+        }
+    }
+    return (int)(out - out_indices);
+}
+static XMFLOAT4
+shadow_light_to_object (FXMVECTOR light, CXMMATRIX world) {
+    XMVECTOR det;
+    XMFLOAT4 out;
+    XMStoreFloat4(&out, XMVector4Transform(light, XMMatrixInverse(&det, world)));
+    return out;
+}
+
+// Builds the volumes of 'job_count' jobs in parallel. Every job gets
+// 2 * vertex_count vertices at consecutive offsets of 'out_vertices'
+// (positions written every 'stride' bytes); its indices are built in
+// 'scratch' (sum of shadow_caster_index_bound) and packed into
+// 'out_indices'. Runs on 'pool' (fork/join when null) since this is called
+// every frame. Returns the total index count.
+static int
+shadow_volumes_build (
+    WorkerPool * pool, ShadowJob const jobs [], int job_count, float extrusion,
+    void * out_vertices, size_t stride, int scratch [], int out_indices [],
+    ShadowDraw out_draws []
+) {
+    int * scratch_offsets = (int *)::malloc(sizeof(int) * (job_count + 1));
+    int vertex_offset = 0;
+    int scratch_offset = 0;
+    for (int j = 0; j < job_count; ++j) {
+        out_draws[j].base_vertex = vertex_offset;
+        scratch_offsets[j] = scratch_offset;
+        vertex_offset += shadow_caster_vertex_bound(jobs[j].caster);
+        scratch_offset += shadow_caster_index_bound(jobs[j].caster);
+    }
+
+    parallel_for(pool, job_count, 4, [&](int begin, int end, int) {
+        for (int j = begin; j < end; ++j) {
+            ShadowJob const & job = jobs[j];
+            shadow_extrude_vertices(job.caster, job.light, extrusion, (uint8_t *)out_vertices + out_draws[j].base_vertex * stride, stride);
+            out_draws[j].index_count = shadow_volume_indices(job.caster, job.light, scratch + scratch_offsets[j]);
+        }
+    });
+
+    int index_count = 0;
+    for (int j = 0; j < job_count; ++j) {
+        out_draws[j].first_index = index_count;
+        index_count += out_draws[j].index_count;
+    }
+    parallel_for(pool, job_count, 16, [&](int begin, int end, int) {
+        for (int j = begin; j < end; ++j)
+            memcpy(out_indices + out_draws[j].first_index, scratch + scratch_offsets[j], sizeof(int) * out_draws[j].index_count);
+    });
+    ::free(scratch_offsets);
+    return index_count;
+}
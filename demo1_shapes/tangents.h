@@ -0,0 +1,205 @@
+#pragma once
+
+#include "geometry.h"
+#include "parallel.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Area weighted vertex normals, for meshes that come without any.
+static void
+generate_normals (Vertex vertices [], int vertex_count, int const indices [], int index_count) {
+    for (int i = 0; i < vertex_count; ++i)
+        vertices[i].normal = XMFLOAT3(0.0f, 0.0f, 0.0f);
+    for (int i = 0; i + 2 < index_count; i += 3) {
+        Vertex & v0 = vertices[indices[i + 0]];
+        Vertex & v1 = vertices[indices[i + 1]];
+        Vertex & v2 = vertices[indices[i + 2]];
+        XMVECTOR p0 = XMLoadFloat3(&v0.position);
+        XMVECTOR n = XMVector3Cross(XMVectorSubtract(XMLoadFloat3(&v1.position), p0), XMVectorSubtract(XMLoadFloat3(&v2.position), p0));
+        XMStoreFloat3(&v0.normal, XMVectorAdd(XMLoadFloat3(&v0.normal), n));
+        XMStoreFloat3(&v1.normal, XMVectorAdd(XMLoadFloat3(&v1.normal), n));
+        XMStoreFloat3(&v2.normal, XMVectorAdd(XMLoadFloat3(&v2.normal), n));
+    }
+    for (int i = 0; i < vertex_count; ++i)
+        XMStoreFloat3(&vertices[i].normal, XMVector3Normalize(XMLoadFloat3(&vertices[i].normal)));
+}
+// Tangents for meshes that don't come with an analytic tangent_u, in the
+// spirit of MikkTSpace:
+//  - each triangle's dP/du is projected onto the tangent plane of every
+//    corner's normal and weighted by the corner angle, so the result does
+//    not depend on how a surface is triangulated;
+//  - vertices with identical position, normal and uv are treated as one, so
+//    unwelded duplicates get the same tangent, while vertices split at a UV
+//    seam keep their own;
+//  - triangles with mirrored UVs (negative uv winding) are accumulated apart
+//    from the others. Vertex has no bitangent sign, so a vertex shared by
+//    both keeps the orientation carrying the larger weight.
+//
+// Work is split so no two threads ever write the same slot: triangles are
+// processed in parallel into per-corner results, then each group of equal
+// vertices sums its own corners, found through a corner list sorted by
+// group (CSR).
+struct TangentCorner {
+    XMFLOAT3    tangent;        // unit tangent, scaled by the corner angle
+    float       orientation;    // +1, -1 for mirrored uvs, 0 for degenerate
+};
+
+static inline uint32_t
+tangent_hash_vertex (Vertex const & v) {
+    uint32_t words [8];
+    memcpy(words + 0, &v.position, sizeof(XMFLOAT3));
+    memcpy(words + 3, &v.normal, sizeof(XMFLOAT3));
+    memcpy(words + 6, &v.texc, sizeof(XMFLOAT2));
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < 8; ++i)
+        h = (h ^ words[i]) * 16777619u;
+    return h ^ (h >> 16);
+}
+static inline bool
+tangent_same_vertex (Vertex const & a, Vertex const & b) {
+    return
+        0 == memcmp(&a.position, &b.position, sizeof(XMFLOAT3)) &&
+        0 == memcmp(&a.normal, &b.normal, sizeof(XMFLOAT3)) &&
+        0 == memcmp(&a.texc, &b.texc, sizeof(XMFLOAT2));
+}
+static void
+generate_tangents (Vertex vertices [], int vertex_count, int const indices [], int index_count) {
+    if (vertex_count <= 0)
+        return;
+    index_count -= index_count % 3;
+    int tri_count = index_count / 3;
+
+    // -- Group identical vertices: group[v] is the first vertex equal to v.
+    int * group = (int *)::malloc(sizeof(int) * vertex_count);
+    uint32_t table_size = 1024;
+    while (table_size < (uint32_t)vertex_count * 2)
+        table_size <<= 1;
+    int * table = (int *)::malloc(sizeof(int) * table_size);
+    memset(table, 0xff, sizeof(int) * table_size);
+    for (int v = 0; v < vertex_count; ++v) {
+        uint32_t slot = tangent_hash_vertex(vertices[v]) & (table_size - 1);
+        for (;;) {
+            int g = table[slot];
+            if (g < 0) {
+                table[slot] = v;
+                group[v] = v;
+                break;
+            }
+            if (tangent_same_vertex(vertices[g], vertices[v])) {
+                group[v] = g;
+                break;
+            }
+            slot = (slot + 1) & (table_size - 1);
+        }
+    }
+    ::free(table);
+
+    // -- Corner lists per group (counting sort of the corners by group).
+    int * first_corner = (int *)::calloc(vertex_count + 1, sizeof(int));
+    int * corners = (int *)::malloc(sizeof(int) * (index_count + 1));
+    for (int c = 0; c < index_count; ++c)
+        ++first_corner[group[indices[c]] + 1];
+    for (int v = 0; v < vertex_count; ++v)
+        first_corner[v + 1] += first_corner[v];
+    int * cursor = (int *)::malloc(sizeof(int) * vertex_count);
+    memcpy(cursor, first_corner, sizeof(int) * vertex_count);
+    for (int c = 0; c < index_count; ++c)
+        corners[cursor[group[indices[c]]]++] = c;
+    ::free(cursor);
+
+    // -- Per-corner contributions, in parallel over triangle ranges.
+    TangentCorner * contrib = (TangentCorner *)::malloc(sizeof(TangentCorner) * (index_count + 1));
+    parallel_for(tri_count, 16384, [&](int begin, int end, int) {
+        for (int t = begin; t < end; ++t) {
+            Vertex const * v [3] = {
+                &vertices[indices[t * 3 + 0]], &vertices[indices[t * 3 + 1]], &vertices[indices[t * 3 + 2]]
+            };
+            XMVECTOR p0 = XMLoadFloat3(&v[0]->position);
+            XMVECTOR p1 = XMLoadFloat3(&v[1]->position);
+            XMVECTOR p2 = XMLoadFloat3(&v[2]->position);
+            XMVECTOR e1 = XMVectorSubtract(p1, p0);
+            XMVECTOR e2 = XMVectorSubtract(p2, p0);
+            float du1 = v[1]->texc.x - v[0]->texc.x;
+            float dv1 = v[1]->texc.y - v[0]->texc.y;
+            float du2 = v[2]->texc.x - v[0]->texc.x;
+            float dv2 = v[2]->texc.y - v[0]->texc.y;
+
+            // dP/du up to the sign of the uv determinant, which is kept as the
+            // triangle orientation instead.
+            float det = du1 * dv2 - du2 * dv1;
+            XMVECTOR t_dir = XMVectorSubtract(XMVectorScale(e1, dv2), XMVectorScale(e2, dv1));
+            float orientation = det > 0.0f ? 1.0f : -1.0f;
+            if (fabsf(det) < 1e-20f || XMVectorGetX(XMVector3LengthSq(t_dir)) < 1e-30f)
+                orientation = 0.0f;
+            else
+                t_dir = XMVectorScale(t_dir, orientation);
+
+            XMVECTOR p [3] = {p0, p1, p2};
+            for (int k = 0; k < 3; ++k) {
+                TangentCorner & out = contrib[t * 3 + k];
+                out.orientation = orientation;
+                out.tangent = XMFLOAT3(0.0f, 0.0f, 0.0f);
+                if (0.0f == orientation)
+                    continue;
+                XMVECTOR n = XMLoadFloat3(&v[k]->normal);
+                XMVECTOR tp = XMVectorSubtract(t_dir, XMVectorMultiply(n, XMVector3Dot(n, t_dir)));
+                float len_sq = XMVectorGetX(XMVector3LengthSq(tp));
+                if (len_sq < 1e-30f)
+                    continue;
+                XMVECTOR a = XMVectorSubtract(p[(k + 1) % 3], p[k]);
+                XMVECTOR b = XMVectorSubtract(p[(k + 2) % 3], p[k]);
+                float cos_angle = XMVectorGetX(XMVector3Dot(XMVector3Normalize(a), XMVector3Normalize(b)));
+                float angle = acosf(cos_angle < -1.0f ? -1.0f : (cos_angle > 1.0f ? 1.0f : cos_angle));
+                XMStoreFloat3(&out.tangent, XMVectorScale(tp, angle / sqrtf(len_sq)));
+            }
+        }
+    });
+
+    // -- Sum each group's corners, in parallel over groups.
+    parallel_for(vertex_count, 16384, [&](int begin, int end, int) {
+        for (int g = begin; g < end; ++g) {
+            if (group[g] != g)
+                continue;
+            XMVECTOR sum_pos = XMVectorZero();
+            XMVECTOR sum_neg = XMVectorZero();
+            float weight_pos = 0.0f;
+            float weight_neg = 0.0f;
+            for (int i = first_corner[g]; i < first_corner[g + 1]; ++i) {
+                TangentCorner const & c = contrib[corners[i]];
+                XMVECTOR t = XMLoadFloat3(&c.tangent);
+                float w = XMVectorGetX(XMVector3Length(t));
+                if (c.orientation > 0.0f) {
+                    sum_pos = XMVectorAdd(sum_pos, t);
+                    weight_pos += w;
+                } else if (c.orientation < 0.0f) {
+                    sum_neg = XMVectorAdd(sum_neg, t);
+                    weight_neg += w;
+                }
+            }
+            XMVECTOR n = XMLoadFloat3(&vertices[g].normal);
+            XMVECTOR t = weight_neg > weight_pos ? sum_neg : sum_pos;
+            t = XMVectorSubtract(t, XMVectorMultiply(n, XMVector3Dot(n, t)));
+            if (XMVectorGetX(XMVector3LengthSq(t)) < 1e-20f) {
+                // No usable UVs: any unit vector orthogonal to the normal will do.
+                XMVECTOR axis = fabsf(vertices[g].normal.x) < 0.9f ? XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f) : XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+                t = XMVector3Cross(n, axis);
+            }
+            XMStoreFloat3(&vertices[g].tangent_u, XMVector3Normalize(t));
+        }
+    });
+    // Duplicates take their group's result (groups point at a lower index,
+    // which was finished above).
+    parallel_for(vertex_count, 16384, [&](int begin, int end, int) {
+        for (int v = begin; v < end; ++v)
+            if (group[v] != v)
+                vertices[v].tangent_u = vertices[group[v]].tangent_u;
+    });
+
+    ::free(contrib);
+    ::free(corners);
+    ::free(first_corner);
+    ::free(group);
+}
@@ -0,0 +1,347 @@
+#pragma once
+
+// Terrain on top of create_grid: the grid provides the xz layout, texture
+// coordinates and indices, then heights come from a heightmap and/or fBm
+// gradient noise, and normals and tangents are rebuilt from central
+// differences of the height field.
+//
+// Heights and then normals are computed in parallel row bands (the normal
+// pass reads the neighbouring rows, so it runs after all heights are done).
+// The noise and normal kernels work on four columns at a time with SSE2.
+
+#include "geometry.h"
+#include "parallel.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define TERRAIN_SSE2 1
+#endif
+
+// Optional source heights, row major, sampled bilinearly over the grid's
+// texture coordinates (u along x, v along -z).
+struct Heightmap {
+    float const *   samples;
+    int             width;
+    int             height;
+};
+
+struct TerrainParams {
+    float       width;
+    float       depth;
+    int         m;              // rows (along z)
+    int         n;              // columns (along x)
+    float       center_x;       // where the grid's center samples the noise
+    float       center_z;
+
+    Heightmap   heightmap;      // samples == nullptr: no heightmap
+    float       height_scale;   // applied to heightmap samples
+
+    // fBm: sum of 'octaves' noise layers, each 'lacunarity' times the
+    // frequency and 'gain' times the amplitude of the previous one.
+    int         octaves;        // 0: no noise
+    float       frequency;      // of the first octave, in cycles per world unit
+    float       amplitude;
+    float       lacunarity;
+    float       gain;
+    uint32_t    seed;
+};
+
+// -- gradient noise
+
+static inline uint32_t
+terrain_hash (int32_t x, int32_t z, uint32_t seed) {
+    uint32_t h = (uint32_t)x * 0x8da6b343u ^ (uint32_t)z * 0xd8163841u ^ seed;
+    h ^= h >> 13;
+    h *= 0x85ebca6bu;
+    return h ^ (h >> 16);
+}
+// Corner gradient from two hash bits: one of the four diagonals.
+static inline float
+terrain_grad (uint32_t h, float fx, float fz) {
+    return ((h & 1) ? -fx : fx) + ((h & 2) ? -fz : fz);
+}
+static inline float
+terrain_fade (float t) {
+    return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+// 2D gradient noise, within [-1, 1].
+static float
+terrain_noise (float x, float z, uint32_t seed) {
+    float fx0 = floorf(x);
+    float fz0 = floorf(z);
+    int32_t ix = (int32_t)fx0;
+    int32_t iz = (int32_t)fz0;
+    float fx = x - fx0;
+    float fz = z - fz0;
+    float n00 = terrain_grad(terrain_hash(ix, iz, seed), fx, fz);
+    float n10 = terrain_grad(terrain_hash(ix + 1, iz, seed), fx - 1.0f, fz);
+    float n01 = terrain_grad(terrain_hash(ix, iz + 1, seed), fx, fz - 1.0f);
+    float n11 = terrain_grad(terrain_hash(ix + 1, iz + 1, seed), fx - 1.0f, fz - 1.0f);
+    float u = terrain_fade(fx);
+    float v = terrain_fade(fz);
+    float nx0 = n00 + u * (n10 - n00);
+    float nx1 = n01 + u * (n11 - n01);
+    return 0.5f * (nx0 + v * (nx1 - nx0));
+}
+
+#if defined(TERRAIN_SSE2)
+// SSE2 has no 32-bit low multiply; build it from two 32x32->64 products.
+static inline __m128i
+terrain_mullo_epi32 (__m128i a, __m128i b) {
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+static inline __m128i
+terrain_hash4 (__m128i x, __m128i z, __m128i seed) {
+    __m128i h = _mm_xor_si128(
+        _mm_xor_si128(terrain_mullo_epi32(x, _mm_set1_epi32((int)0x8da6b343u)), terrain_mullo_epi32(z, _mm_set1_epi32((int)0xd8163841u))),
+        seed
+    );
+    h = _mm_xor_si128(h, _mm_srli_epi32(h, 13));
+    h = terrain_mullo_epi32(h, _mm_set1_epi32((int)0x85ebca6bu));
+    return _mm_xor_si128(h, _mm_srli_epi32(h, 16));
+}
+// Flips the sign of fx / fz where hash bit 0 / bit 1 is set.
+static inline __m128
+terrain_grad4 (__m128i h, __m128 fx, __m128 fz) {
+    __m128 sx = _mm_castsi128_ps(_mm_slli_epi32(h, 31));
+    __m128 sz = _mm_castsi128_ps(_mm_slli_epi32(_mm_srli_epi32(h, 1), 31));
+    return _mm_add_ps(_mm_xor_ps(fx, sx), _mm_xor_ps(fz, sz));
+}
+static inline __m128
+terrain_fade4 (__m128 t) {
+    __m128 p = _mm_add_ps(_mm_mul_ps(t, _mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(6.0f)), _mm_set1_ps(15.0f))), _mm_set1_ps(10.0f));
+    return _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(t, t), t), p);
+}
+static inline __m128
+terrain_floor4 (__m128 x) {
+    __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+    return _mm_sub_ps(t, _mm_and_ps(_mm_cmplt_ps(x, t), _mm_set1_ps(1.0f)));
+}
+// Four lanes of terrain_noise, bit for bit the same hash.
+static inline __m128
+terrain_noise4 (__m128 x, __m128 z, uint32_t seed) {
+    __m128 fx0 = terrain_floor4(x);
+    __m128 fz0 = terrain_floor4(z);
+    __m128i ix = _mm_cvttps_epi32(fx0);
+    __m128i iz = _mm_cvttps_epi32(fz0);
+    __m128i one = _mm_set1_epi32(1);
+    __m128i s = _mm_set1_epi32((int)seed);
+    __m128 fx = _mm_sub_ps(x, fx0);
+    __m128 fz = _mm_sub_ps(z, fz0);
+    __m128 fx1 = _mm_sub_ps(fx, _mm_set1_ps(1.0f));
+    __m128 fz1 = _mm_sub_ps(fz, _mm_set1_ps(1.0f));
+    __m128i ix1 = _mm_add_epi32(ix, one);
+    __m128i iz1 = _mm_add_epi32(iz, one);
+    __m128 n00 = terrain_grad4(terrain_hash4(ix, iz, s), fx, fz);
+    __m128 n10 = terrain_grad4(terrain_hash4(ix1, iz, s), fx1, fz);
+    __m128 n01 = terrain_grad4(terrain_hash4(ix, iz1, s), fx, fz1);
+    __m128 n11 = terrain_grad4(terrain_hash4(ix1, iz1, s), fx1, fz1);
+    __m128 u = terrain_fade4(fx);
+    __m128 v = terrain_fade4(fz);
+    __m128 nx0 = _mm_add_ps(n00, _mm_mul_ps(u, _mm_sub_ps(n10, n00)));
+    __m128 nx1 = _mm_add_ps(n01, _mm_mul_ps(u, _mm_sub_ps(n11, n01)));
+    return _mm_mul_ps(_mm_set1_ps(0.5f), _mm_add_ps(nx0, _mm_mul_ps(v, _mm_sub_ps(nx1, nx0))));
+}
+#endif
+
+static float
+terrain_fbm (TerrainParams const * params, float x, float z) {
+    float sum = 0.0f;
+    float freq = params->frequency;
+    float amp = params->amplitude;
+    for (int o = 0; o < params->octaves; ++o) {
+        sum += amp * terrain_noise(x * freq, z * freq, params->seed + (uint32_t)o * 0x9e3779b9u);
+        freq *= params->lacunarity;
+        amp *= params->gain;
+    }
+    return sum;
+}
+// Bound on |terrain_fbm|: the noise stays within [-1, 1] in every octave.
+static float
+terrain_fbm_bound (TerrainParams const * params) {
+    float bound = 0.0f;
+    float amp = fabsf(params->amplitude);
+    for (int o = 0; o < params->octaves; ++o) {
+        bound += amp;
+        amp *= fabsf(params->gain);
+    }
+    return bound;
+}
+static float
+terrain_sample_heightmap (Heightmap const * hm, float u, float v) {
+    float fx = u * (hm->width - 1);
+    float fy = v * (hm->height - 1);
+    int x0 = (int)fx;
+    int y0 = (int)fy;
+    x0 = x0 < 0 ? 0 : (x0 > hm->width - 1 ? hm->width - 1 : x0);
+    y0 = y0 < 0 ? 0 : (y0 > hm->height - 1 ? hm->height - 1 : y0);
+    int x1 = x0 + 1 < hm->width ? x0 + 1 : x0;
+    int y1 = y0 + 1 < hm->height ? y0 + 1 : y0;
+    float tx = fx - x0;
+    float ty = fy - y0;
+    float const * s = hm->samples;
+    float h0 = s[y0 * hm->width + x0] + tx * (s[y0 * hm->width + x1] - s[y0 * hm->width + x0]);
+    float h1 = s[y1 * hm->width + x0] + tx * (s[y1 * hm->width + x1] - s[y1 * hm->width + x0]);
+    return h0 + ty * (h1 - h0);
+}
+
+// Heights of rows [row_begin, row_end) into heights[i * n + j]. Sample
+// positions are those create_grid gives vertex (i, j).
+static void
+terrain_heights (TerrainParams const * params, int row_begin, int row_end, float heights []) {
+    int m = params->m;
+    int n = params->n;
+    float half_width = 0.5f * params->width;
+    float half_depth = 0.5f * params->depth;
+    float dx = params->width / (n - 1);
+    float dz = params->depth / (m - 1);
+    float du = 1.0f / (n - 1);
+    float dv = 1.0f / (m - 1);
+    for (int i = row_begin; i < row_end; ++i) {
+        float * h = heights + i * n;
+        float z = params->center_z + half_depth - i * dz;
+        int j = 0;
+        if (params->heightmap.samples) {
+            for (j = 0; j < n; ++j)
+                h[j] = params->height_scale * terrain_sample_heightmap(&params->heightmap, j * du, i * dv);
+        } else {
+            for (j = 0; j < n; ++j)
+                h[j] = 0.0f;
+        }
+        if (params->octaves <= 0)
+            continue;
+
+        j = 0;
+#if defined(TERRAIN_SSE2)
+        __m128 z4 = _mm_set1_ps(z);
+        for (; j + 4 <= n; j += 4) {
+            __m128 x4 = _mm_add_ps(
+                _mm_set1_ps(params->center_x),
+                _mm_setr_ps(-half_width + j * dx, -half_width + (j + 1) * dx, -half_width + (j + 2) * dx, -half_width + (j + 3) * dx)
+            );
+            __m128 sum = _mm_loadu_ps(h + j);
+            float freq = params->frequency;
+            float amp = params->amplitude;
+            for (int o = 0; o < params->octaves; ++o) {
+                __m128 f = _mm_set1_ps(freq);
+                __m128 noise = terrain_noise4(_mm_mul_ps(x4, f), _mm_mul_ps(z4, f), params->seed + (uint32_t)o * 0x9e3779b9u);
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(amp), noise));
+                freq *= params->lacunarity;
+                amp *= params->gain;
+            }
+            _mm_storeu_ps(h + j, sum);
+        }
+#endif
+        for (; j < n; ++j)
+            h[j] += terrain_fbm(params, params->center_x + (-half_width + j * dx), z);
+    }
+}
+// The whole m * n height field, in parallel row bands.
+static void
+terrain_height_field (TerrainParams const * params, float heights []) {
+    parallel_for(params->m, 16, [&](int begin, int end, int) {
+        terrain_heights(params, begin, end, heights);
+    });
+}
+// Central differences (one-sided on the border) of the height field give
+// dh/dx and dh/dz; then N = normalize(-dh/dx, 1, -dh/dz) and the tangent
+// along +x (increasing u) is T = normalize(1, dh/dx, 0).
+static void
+terrain_normals (TerrainParams const * params, float const heights [], int row_begin, int row_end, Vertex vtx []) {
+    int m = params->m;
+    int n = params->n;
+    float dx = params->width / (n - 1);
+    float dz = params->depth / (m - 1);
+    for (int i = row_begin; i < row_end; ++i) {
+        // Rows run towards -z, so the row above (i - 1) is the +z neighbour.
+        float const * up = heights + (i > 0 ? i - 1 : i) * n;
+        float const * down = heights + (i < m - 1 ? i + 1 : i) * n;
+        float const * h = heights + i * n;
+        float inv_2dz = 1.0f / (((i > 0) + (i < m - 1)) * dz);
+        Vertex * row = vtx + i * n;
+
+        // Border columns use one-sided differences.
+        for (int j = 0; j < n; j += (j == 0 && n > 2) ? n - 1 : 1) {
+            int l = j > 0 ? j - 1 : j;
+            int r = j < n - 1 ? j + 1 : j;
+            float dhdx = (h[r] - h[l]) / ((r - l) * dx);
+            float dhdz = (up[j] - down[j]) * inv_2dz;
+            XMStoreFloat3(&row[j].normal, XMVector3Normalize(XMVectorSet(-dhdx, 1.0f, -dhdz, 0.0f)));
+            XMStoreFloat3(&row[j].tangent_u, XMVector3Normalize(XMVectorSet(1.0f, dhdx, 0.0f, 0.0f)));
+            row[j].position.y = h[j];
+        }
+
+        int j = 1;
+#if defined(TERRAIN_SSE2)
+        __m128 inv_2dx4 = _mm_set1_ps(0.5f / dx);
+        __m128 inv_2dz4 = _mm_set1_ps(inv_2dz);
+        __m128 one = _mm_set1_ps(1.0f);
+        __m128 neg = _mm_set1_ps(-0.0f);
+        for (; j + 4 <= n - 1; j += 4) {
+            __m128 dhdx = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(h + j + 1), _mm_loadu_ps(h + j - 1)), inv_2dx4);
+            __m128 dhdz = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(up + j), _mm_loadu_ps(down + j)), inv_2dz4);
+            // 1/sqrt via sqrt + div: exact enough to match the scalar border.
+            __m128 n_inv = _mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(one, _mm_add_ps(_mm_mul_ps(dhdx, dhdx), _mm_mul_ps(dhdz, dhdz)))));
+            __m128 t_inv = _mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(one, _mm_mul_ps(dhdx, dhdx))));
+            __m128 nx = _mm_xor_ps(_mm_mul_ps(dhdx, n_inv), neg);
+            __m128 nz = _mm_xor_ps(_mm_mul_ps(dhdz, n_inv), neg);
+            __m128 ty = _mm_mul_ps(dhdx, t_inv);
+            float nxs [4], nys [4], nzs [4], txs [4], tys [4], hs [4];
+            _mm_storeu_ps(nxs, nx);
+            _mm_storeu_ps(nys, n_inv);
+            _mm_storeu_ps(nzs, nz);
+            _mm_storeu_ps(txs, t_inv);
+            _mm_storeu_ps(tys, ty);
+            _mm_storeu_ps(hs, _mm_loadu_ps(h + j));
+            for (int k = 0; k < 4; ++k) {
+                row[j + k].position.y = hs[k];
+                row[j + k].normal = XMFLOAT3(nxs[k], nys[k], nzs[k]);
+                row[j + k].tangent_u = XMFLOAT3(txs[k], tys[k], 0.0f);
+            }
+        }
+#endif
+        for (; j < n - 1; ++j) {
+            float dhdx = (h[j + 1] - h[j - 1]) * (0.5f / dx);
+            float dhdz = (up[j] - down[j]) * inv_2dz;
+            XMStoreFloat3(&row[j].normal, XMVector3Normalize(XMVectorSet(-dhdx, 1.0f, -dhdz, 0.0f)));
+            XMStoreFloat3(&row[j].tangent_u, XMVector3Normalize(XMVectorSet(1.0f, dhdx, 0.0f, 0.0f)));
+            row[j].position.y = h[j];
+        }
+    }
+}
+
+// Same output layout as create_grid (m * n vertices, (m-1) * (n-1) * 6
+// indices).
+static void
+create_terrain (TerrainParams const * params, Vertex out_vtx [], int out_idx [], MeshBounds * out_bounds) {
+    int m = params->m;
+    int n = params->n;
+    MeshBounds flat;
+    create_grid(params->width, params->depth, m, n, out_vtx, out_idx, &flat);
+
+    float * heights = (float *)::malloc(sizeof(float) * m * n);
+    terrain_height_field(params, heights);
+    parallel_for(m, 16, [&](int begin, int end, int) {
+        terrain_normals(params, heights, begin, end, out_vtx);
+    });
+
+    float hmin = heights[0];
+    float hmax = heights[0];
+    for (int i = 1; i < m * n; ++i) {
+        hmin = heights[i] < hmin ? heights[i] : hmin;
+        hmax = heights[i] > hmax ? heights[i] : hmax;
+    }
+    ::free(heights);
+
+    // The grid is centered on the origin, only the height range is new.
+    out_bounds->aabb_center = XMFLOAT3(0.0f, 0.5f * (hmin + hmax), 0.0f);
+    out_bounds->aabb_extents = XMFLOAT3(0.5f * params->width, 0.5f * (hmax - hmin), 0.5f * params->depth);
+    out_bounds->sphere_center = out_bounds->aabb_center;
+    out_bounds->sphere_radius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&out_bounds->aabb_extents)));
+}
@@ -0,0 +1,458 @@
+#pragma once
+
+// CDLOD terrain: a quadtree over one big height field, where every selected
+// node is drawn with the same patch of patch x patch quads, scaled to the
+// node's size. Nodes are picked by distance to the eye, each LOD covering
+// twice the range of the next finer one. Towards the far end of its range a
+// node's odd vertices slide onto their even neighbours (the morph), so by
+// the time the coarser LOD takes over the geometry already matches it and
+// there are no pops or cracks.
+//
+// The effect here can't displace or morph vertices on the GPU, so each
+// selected node gets a slot of patch vertices that is filled on the CPU.
+// The patch indices are shared by all slots and ordered quadrant by
+// quadrant, so a node whose children are only partly selected draws just
+// the quadrants it still covers.
+//
+// Selection is cached across frames: nothing is redone while the eye stays
+// put, and when it moves a node keeps its slot (and its vertices, unless it
+// is inside its morph band) for as long as it stays selected.
+
+#include "terrain.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TERRAIN_LOD_MAX_LEVELS  12
+
+// How much of a LOD's own distance band is spent morphing into the next.
+#define TERRAIN_LOD_MORPH_RATIO 0.35f
+
+enum TerrainLodMorph : uint8_t {
+    TERRAIN_MORPH_NONE,     // whole node short of its morph band
+    TERRAIN_MORPH_FULL,     // whole node past it: vertices sit on the coarse grid
+    TERRAIN_MORPH_PARTIAL,  // changes whenever the eye moves
+};
+
+// One node to draw: its slot of vertices and which quadrants of the patch
+// to draw (bit qz * 2 + qx, qx/qz = 1 for the +x/+z half).
+struct TerrainLodDraw {
+    int         slot;
+    int         quadrants;
+};
+
+struct TerrainLodStats {
+    int         nodes;              // drawn nodes (full or partial)
+    int         draws;              // DrawIndexed calls
+    int         triangles;
+    int         full_triangles;     // of the height field as a single grid
+    int         rebuilt;            // slots refilled this update
+    int         dropped;            // selected nodes that found no free slot
+};
+
+struct TerrainLod {
+    TerrainParams   params;             // m == n == (1 << (levels - 1)) * patch + 1
+    float *         heights;            // params.m * params.n samples
+    int             patch;              // quads along a patch edge, power of two
+    int             patch_vertex_count; // (patch + 1)^2
+    int             patch_index_count;  // patch^2 * 6
+    int             levels;             // quadtree depth, level 0 is the root
+
+    // per node, level by level: level l starts at ((4^l) - 1) / 3 and holds
+    // (1 << l)^2 nodes, row (z) major
+    int             node_count;
+    float *         node_min_y;
+    float *         node_max_y;
+    int *           node_slot;          // -1 when not resident
+
+    // per LOD (0 is the finest, levels - 1 the root)
+    float           ranges [TERRAIN_LOD_MAX_LEVELS];
+    float           morph_start [TERRAIN_LOD_MAX_LEVELS];
+
+    // vertex slots, slot_count * patch_vertex_count positions
+    int             slot_count;
+    XMFLOAT3 *      slot_positions;
+    int *           slot_node;          // -1 when free
+    uint8_t *       slot_morph;         // TerrainLodMorph the slot was filled with
+    uint32_t *      slot_frame;         // last update the slot was selected in
+
+    // current selection, and the slots refilled by the last update
+    TerrainLodDraw *    draws;
+    int                 draw_count;
+    int *               dirty;
+    int                 dirty_count;
+
+    XMFLOAT3        eye;                // eye the selection was made for
+    bool            selected;
+    uint32_t        frame;
+    int             dropped;
+};
+
+static inline int
+terrain_lod_level_first (int level) {
+    return ((1 << (2 * level)) - 1) / 3;
+}
+// Patch indices, with create_grid's winding, ordered by quadrant so that
+// quadrant q is the range [q * count / 4, (q + 1) * count / 4). Rows run
+// from the node's +z edge towards -z, as in create_grid.
+static void
+terrain_lod_patch_indices (int patch, int out_idx []) {
+    int half = patch / 2;
+    int n = patch + 1;
+    int k = 0;
+    for (int q = 0; q < 4; ++q) {
+        int j0 = (q & 1) * half;
+        int i0 = (q & 2) ? 0 : half;
+        for (int i = i0; i < i0 + half; ++i) {
+            for (int j = j0; j < j0 + half; ++j) {
+                out_idx[k + 0] = i * n + j;
+                out_idx[k + 1] = i * n + j + 1;
+                out_idx[k + 2] = (i + 1) * n + j;
+
+                out_idx[k + 3] = (i + 1) * n + j;
+                out_idx[k + 4] = i * n + j + 1;
+                out_idx[k + 5] = (i + 1) * n + j + 1;
+                k += 6;
+            }
+        }
+    }
+}
+// 'params' describes the terrain as a whole (width, depth and the height
+// source); its m and n are replaced by the resolution the quadtree needs.
+// 'lod0_range' is how far from the eye the finest LOD reaches. A node must
+// be done morphing before its coarser neighbour starts to, so the range
+// should be at least about 1.5 / TERRAIN_LOD_MORPH_RATIO times the diagonal
+// of a leaf node.
+static bool
+terrain_lod_create (TerrainLod * t, TerrainParams const * params, int patch, int levels, float lod0_range, int slot_count) {
+    memset(t, 0, sizeof(*t));
+    if (levels < 1 || levels > TERRAIN_LOD_MAX_LEVELS || patch < 2 || (patch & (patch - 1)))
+        return false;
+
+    t->params = *params;
+    t->params.depth = params->width;
+    t->params.m = t->params.n = (1 << (levels - 1)) * patch + 1;
+    t->patch = patch;
+    t->patch_vertex_count = (patch + 1) * (patch + 1);
+    t->patch_index_count = patch * patch * 6;
+    t->levels = levels;
+
+    int n = t->params.n;
+    t->heights = (float *)::malloc(sizeof(float) * n * n);
+    terrain_height_field(&t->params, t->heights);
+
+    // -- Node height bounds: leaves from their samples, then up the tree.
+    t->node_count = terrain_lod_level_first(levels);
+    t->node_min_y = (float *)::malloc(sizeof(float) * t->node_count);
+    t->node_max_y = (float *)::malloc(sizeof(float) * t->node_count);
+    t->node_slot = (int *)::malloc(sizeof(int) * t->node_count);
+    memset(t->node_slot, 0xff, sizeof(int) * t->node_count);
+
+    int leaf_level = levels - 1;
+    int leaf_side = 1 << leaf_level;
+    int leaf_first = terrain_lod_level_first(leaf_level);
+    parallel_for(leaf_side, 4, [&](int begin, int end, int) {
+        for (int z = begin; z < end; ++z) {
+            for (int x = 0; x < leaf_side; ++x) {
+                // Node row z counts from -z; height field rows from +z.
+                int r0 = (leaf_side - 1 - z) * patch;
+                int c0 = x * patch;
+                float lo = t->heights[r0 * n + c0];
+                float hi = lo;
+                for (int r = r0; r <= r0 + patch; ++r) {
+                    for (int c = c0; c <= c0 + patch; ++c) {
+                        float h = t->heights[r * n + c];
+                        lo = h < lo ? h : lo;
+                        hi = h > hi ? h : hi;
+                    }
+                }
+                t->node_min_y[leaf_first + z * leaf_side + x] = lo;
+                t->node_max_y[leaf_first + z * leaf_side + x] = hi;
+            }
+        }
+    });
+    for (int level = leaf_level - 1; level >= 0; --level) {
+        int side = 1 << level;
+        int first = terrain_lod_level_first(level);
+        int child_first = terrain_lod_level_first(level + 1);
+        for (int z = 0; z < side; ++z) {
+            for (int x = 0; x < side; ++x) {
+                int c = child_first + (2 * z) * (2 * side) + 2 * x;
+                int children [4] = {c, c + 1, c + 2 * side, c + 2 * side + 1};
+                float lo = t->node_min_y[children[0]];
+                float hi = t->node_max_y[children[0]];
+                for (int k = 1; k < 4; ++k) {
+                    lo = t->node_min_y[children[k]] < lo ? t->node_min_y[children[k]] : lo;
+                    hi = t->node_max_y[children[k]] > hi ? t->node_max_y[children[k]] : hi;
+                }
+                t->node_min_y[first + z * side + x] = lo;
+                t->node_max_y[first + z * side + x] = hi;
+            }
+        }
+    }
+
+    // -- Distance bands, doubling per LOD; each ends in its morph band.
+    float range = lod0_range;
+    float prev = 0.0f;
+    for (int lod = 0; lod < levels; ++lod) {
+        t->ranges[lod] = range;
+        t->morph_start[lod] = range - TERRAIN_LOD_MORPH_RATIO * (range - prev);
+        prev = range;
+        range *= 2.0f;
+    }
+    // The root covers whatever is left.
+    t->ranges[levels - 1] = 3.4e38f;
+    t->morph_start[levels - 1] = 3.4e38f;
+
+    t->slot_count = slot_count;
+    t->slot_positions = (XMFLOAT3 *)::malloc(sizeof(XMFLOAT3) * slot_count * t->patch_vertex_count);
+    t->slot_node = (int *)::malloc(sizeof(int) * slot_count);
+    memset(t->slot_node, 0xff, sizeof(int) * slot_count);
+    t->slot_morph = (uint8_t *)::calloc(slot_count, 1);
+    t->slot_frame = (uint32_t *)::calloc(slot_count, sizeof(uint32_t));
+    t->draws = (TerrainLodDraw *)::malloc(sizeof(TerrainLodDraw) * t->node_count);
+    t->dirty = (int *)::malloc(sizeof(int) * slot_count);
+    return true;
+}
+static void
+terrain_lod_destroy (TerrainLod * t) {
+    ::free(t->heights);
+    ::free(t->node_min_y);
+    ::free(t->node_max_y);
+    ::free(t->node_slot);
+    ::free(t->slot_positions);
+    ::free(t->slot_node);
+    ::free(t->slot_morph);
+    ::free(t->slot_frame);
+    ::free(t->draws);
+    ::free(t->dirty);
+    memset(t, 0, sizeof(*t));
+}
+
+// -- selection
+
+struct TerrainLodNodeBox {
+    float   x0, z0, size;
+    float   y0, y1;
+};
+static inline TerrainLodNodeBox
+terrain_lod_node_box (TerrainLod const * t, int level, int x, int z) {
+    TerrainLodNodeBox b;
+    int node = terrain_lod_level_first(level) + z * (1 << level) + x;
+    b.size = t->params.width / (1 << level);
+    b.x0 = -0.5f * t->params.width + x * b.size;
+    b.z0 = -0.5f * t->params.width + z * b.size;
+    b.y0 = t->node_min_y[node];
+    b.y1 = t->node_max_y[node];
+    return b;
+}
+// Distance from the eye to the nearest and to the farthest point of a box.
+static inline void
+terrain_lod_distances (TerrainLodNodeBox const & b, XMFLOAT3 const & eye, float * out_min, float * out_max) {
+    float lo [3] = {b.x0, b.y0, b.z0};
+    float hi [3] = {b.x0 + b.size, b.y1, b.z0 + b.size};
+    float p [3] = {eye.x, eye.y, eye.z};
+    float near_sq = 0.0f;
+    float far_sq = 0.0f;
+    for (int k = 0; k < 3; ++k) {
+        float d_lo = lo[k] - p[k];
+        float d_hi = p[k] - hi[k];
+        float d = d_lo > d_hi ? d_lo : d_hi;
+        if (d > 0.0f)
+            near_sq += d * d;
+        float f = fabsf(d_lo) > fabsf(d_hi) ? d_lo : d_hi;
+        far_sq += f * f;
+    }
+    *out_min = sqrtf(near_sq);
+    *out_max = sqrtf(far_sq);
+}
+static void
+terrain_lod_add (TerrainLod * t, int node, int quadrants) {
+    TerrainLodDraw & d = t->draws[t->draw_count++];
+    d.slot = node;      // resolved to a slot once the selection is complete
+    d.quadrants = quadrants;
+}
+// Returns false when the node is out of its LOD's range, in which case the
+// parent draws that area itself.
+static bool
+terrain_lod_select_node (TerrainLod * t, XMFLOAT3 const & eye, int level, int x, int z) {
+    int lod = t->levels - 1 - level;
+    int node = terrain_lod_level_first(level) + z * (1 << level) + x;
+    float d_min, d_max;
+    terrain_lod_distances(terrain_lod_node_box(t, level, x, z), eye, &d_min, &d_max);
+    if (d_min > t->ranges[lod])
+        return false;
+    if (0 == lod || d_min > t->ranges[lod - 1]) {
+        terrain_lod_add(t, node, 0xf);
+        return true;
+    }
+    int quadrants = 0;
+    for (int q = 0; q < 4; ++q)
+        if (!terrain_lod_select_node(t, eye, level + 1, 2 * x + (q & 1), 2 * z + (q >> 1)))
+            quadrants |= 1 << q;
+    if (quadrants)
+        terrain_lod_add(t, node, quadrants);
+    return true;
+}
+
+// -- vertices
+
+static inline float
+terrain_lod_sample (TerrainLod const * t, float r, float c) {
+    int n = t->params.n;
+    int r0 = (int)r;
+    int c0 = (int)c;
+    int r1 = r0 + 1 < n ? r0 + 1 : r0;
+    int c1 = c0 + 1 < n ? c0 + 1 : c0;
+    float fr = r - r0;
+    float fc = c - c0;
+    float const * h = t->heights;
+    float h0 = h[r0 * n + c0] + fc * (h[r0 * n + c1] - h[r0 * n + c0]);
+    float h1 = h[r1 * n + c0] + fc * (h[r1 * n + c1] - h[r1 * n + c0]);
+    return h0 + fr * (h1 - h0);
+}
+// Fills a slot with the node's patch, morphed for the given eye: odd grid
+// lines move towards the even ones before them by k, which ramps from 0 at
+// morph_start to 1 at the end of the LOD's range, per vertex.
+static void
+terrain_lod_fill_slot (TerrainLod const * t, int slot, int node, XMFLOAT3 const & eye) {
+    int level = 0;
+    while (level + 1 < t->levels && terrain_lod_level_first(level + 1) <= node)
+        ++level;
+    int side = 1 << level;
+    int x = (node - terrain_lod_level_first(level)) % side;
+    int z = (node - terrain_lod_level_first(level)) / side;
+    int lod = t->levels - 1 - level;
+
+    int patch = t->patch;
+    int n = t->params.n;
+    int stride = 1 << lod;      // height field samples per patch quad
+    float spacing = t->params.width / (n - 1);
+    float half = 0.5f * t->params.width;
+    int r0 = (side - 1 - z) * patch * stride;
+    int c0 = x * patch * stride;
+    float morph_start = t->morph_start[lod];
+    float morph_scale = lod + 1 < t->levels ? 1.0f / (t->ranges[lod] - morph_start) : 0.0f;
+
+    XMFLOAT3 * out = t->slot_positions + slot * t->patch_vertex_count;
+    for (int i = 0; i <= patch; ++i) {
+        for (int j = 0; j <= patch; ++j) {
+            int r = r0 + i * stride;
+            int c = c0 + j * stride;
+            float px = -half + c * spacing;
+            float pz = half - r * spacing;
+            float py = t->heights[r * n + c];
+            float dx = px - eye.x;
+            float dy = py - eye.y;
+            float dz = pz - eye.z;
+            float k = (sqrtf(dx * dx + dy * dy + dz * dz) - morph_start) * morph_scale;
+            k = k < 0.0f ? 0.0f : (k > 1.0f ? 1.0f : k);
+
+            float mr = (float)r - ((i & 1) ? k * stride : 0.0f);
+            float mc = (float)c - ((j & 1) ? k * stride : 0.0f);
+            out[i * (patch + 1) + j] = XMFLOAT3(-half + mc * spacing, terrain_lod_sample(t, mr, mc), half - mr * spacing);
+        }
+    }
+}
+static TerrainLodMorph
+terrain_lod_node_morph (TerrainLod const * t, int node, XMFLOAT3 const & eye) {
+    int level = 0;
+    while (level + 1 < t->levels && terrain_lod_level_first(level + 1) <= node)
+        ++level;
+    int side = 1 << level;
+    int x = (node - terrain_lod_level_first(level)) % side;
+    int z = (node - terrain_lod_level_first(level)) / side;
+    int lod = t->levels - 1 - level;
+    if (lod + 1 == t->levels)
+        return TERRAIN_MORPH_NONE;
+    float d_min, d_max;
+    terrain_lod_distances(terrain_lod_node_box(t, level, x, z), eye, &d_min, &d_max);
+    if (d_max <= t->morph_start[lod])
+        return TERRAIN_MORPH_NONE;
+    if (d_min >= t->ranges[lod])
+        return TERRAIN_MORPH_FULL;
+    return TERRAIN_MORPH_PARTIAL;
+}
+
+// Reselects nodes for 'eye' (in terrain space) and refills the slots whose
+// vertices changed; those are listed in t->dirty for upload, filled on
+// 'pool' (fork/join when null). Returns false when nothing changed since the
+// last update.
+static bool
+terrain_lod_update (TerrainLod * t, XMFLOAT3 const & eye, WorkerPool * pool) {
+    t->dirty_count = 0;
+    if (t->selected && 0 == memcmp(&eye, &t->eye, sizeof(eye)))
+        return false;
+    t->eye = eye;
+    t->selected = true;
+    ++t->frame;
+
+    t->draw_count = 0;
+    if (!terrain_lod_select_node(t, eye, 0, 0, 0))
+        terrain_lod_add(t, 0, 0xf);
+
+    // -- Nodes that are still resident keep their slots.
+    for (int d = 0; d < t->draw_count; ++d) {
+        int slot = t->node_slot[t->draws[d].slot];
+        if (slot >= 0)
+            t->slot_frame[slot] = t->frame;
+    }
+    // -- The others take slots nobody selected this time.
+    int free_cursor = 0;
+    int kept = 0;
+    t->dropped = 0;
+    for (int d = 0; d < t->draw_count; ++d) {
+        int node = t->draws[d].slot;
+        int slot = t->node_slot[node];
+        TerrainLodMorph morph = terrain_lod_node_morph(t, node, eye);
+        if (slot < 0) {
+            while (free_cursor < t->slot_count && t->slot_frame[free_cursor] == t->frame)
+                ++free_cursor;
+            if (free_cursor == t->slot_count) {
+                ++t->dropped;
+                continue;
+            }
+            slot = free_cursor++;
+            if (t->slot_node[slot] >= 0)
+                t->node_slot[t->slot_node[slot]] = -1;
+            t->slot_node[slot] = node;
+            t->slot_frame[slot] = t->frame;
+            t->node_slot[node] = slot;
+            t->dirty[t->dirty_count++] = slot;
+        } else if (morph != t->slot_morph[slot] || TERRAIN_MORPH_PARTIAL == morph) {
+            t->dirty[t->dirty_count++] = slot;
+        }
+        t->slot_morph[slot] = (uint8_t)morph;
+        t->draws[kept].slot = slot;
+        t->draws[kept].quadrants = t->draws[d].quadrants;
+        ++kept;
+    }
+    t->draw_count = kept;
+
+    parallel_for(pool, t->dirty_count, 4, [&](int begin, int end, int) {
+        for (int d = begin; d < end; ++d)
+            terrain_lod_fill_slot(t, t->dirty[d], t->slot_node[t->dirty[d]], eye);
+    });
+    return true;
+}
+static void
+terrain_lod_stats (TerrainLod const * t, TerrainLodStats * out) {
+    memset(out, 0, sizeof(*out));
+    int quadrant_triangles = t->patch * t->patch / 2;
+    for (int d = 0; d < t->draw_count; ++d) {
+        int q = t->draws[d].quadrants;
+        ++out->nodes;
+        for (int k = 0; k < 4; ++k) {
+            if (q & (1 << k)) {
+                out->triangles += quadrant_triangles;
+                // Runs of adjacent quadrants share one draw.
+                if (0 == k || !(q & (1 << (k - 1))))
+                    ++out->draws;
+            }
+        }
+    }
+    out->full_triangles = 2 * (t->params.n - 1) * (t->params.n - 1);
+    out->rebuilt = t->dirty_count;
+    out->dropped = t->dropped;
+}
@@ -0,0 +1,530 @@
+#pragma once
+
+// Out-of-core terrain: a tiled heightfield file that is memory mapped and
+// streamed in around a point, one grid mesh per tile.
+//
+// File layout: a TiledHeightfieldHeader, then tiles_x * tiles_z tiles, row
+// (z) major, each (tile_size + 3)^2 16 bit samples in create_grid order
+// (rows from the tile's +z edge towards -z): the tile's (tile_size + 1)^2
+// vertices plus a one-sample apron all around. Neighbouring tiles repeat
+// their shared border and apron samples, so every tile is one contiguous
+// range of the file and builds its mesh, border normals included, without
+// touching any other.
+//
+// The streamer runs on the main thread except for its I/O threads: the main
+// thread asks for the tiles around the camera (nearest first), the workers
+// take jobs from a bounded queue, fault the tile's pages in, build its mesh
+// and hand it back through a second bounded queue, waiting when that one is
+// full. The caller uploads finished meshes at its own pace and reports them
+// resident; once resident and queued tiles go over the memory budget the
+// least recently wanted tiles are evicted.
+
+#include "terrain.h"
+#include "mapped_file.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#define TILED_HEIGHTFIELD_MAGIC     0x32464854u     // "THF2"
+#define TILE_STREAMER_MAX_THREADS   8
+#define TILE_STREAMER_PAGE          4096
+
+struct TiledHeightfieldHeader {
+    uint32_t    magic;
+    int32_t     tile_size;      // quads along a tile edge
+    int32_t     tiles_x;
+    int32_t     tiles_z;
+    float       spacing;        // world units between samples
+    float       height_min;     // height = height_min + sample * height_step
+    float       height_step;
+    uint32_t    reserved;
+};
+
+// Writes an fBm heightfield ('noise', with its width/depth/m/n ignored)
+// tile by tile, one row of tiles in memory at a time. Tile (tx, tz) spans
+// [x0, x0 + tile_size * spacing] with x0 = (tx - tiles_x / 2) * tile_size *
+// spacing, and likewise along z; its apron lies one spacing outside that.
+static bool
+write_tiled_heightfield (
+    char const * path, TerrainParams const * noise,
+    int tile_size, int tiles_x, int tiles_z, float spacing
+) {
+    FILE * f = nullptr;
+#if defined(_MSC_VER)
+    if (fopen_s(&f, path, "wb") != 0)
+        f = nullptr;
+#else
+    f = fopen(path, "wb");
+#endif
+    if (nullptr == f)
+        return false;
+
+    float bound = terrain_fbm_bound(noise);
+    TiledHeightfieldHeader header = {};
+    header.magic = TILED_HEIGHTFIELD_MAGIC;
+    header.tile_size = tile_size;
+    header.tiles_x = tiles_x;
+    header.tiles_z = tiles_z;
+    header.spacing = spacing;
+    header.height_min = -bound;
+    header.height_step = bound > 0.0f ? 2.0f * bound / 65535.0f : 1.0f;
+    bool ok = 1 == fwrite(&header, sizeof(header), 1, f);
+
+    int side = tile_size + 3;
+    size_t tile_samples = (size_t)side * side;
+    float tile_width = tile_size * spacing;
+    uint16_t * row = (uint16_t *)::malloc(sizeof(uint16_t) * tile_samples * tiles_x);
+    for (int tz = 0; tz < tiles_z && ok; ++tz) {
+        parallel_for(tiles_x, 1, [&](int begin, int end, int) {
+            float * heights = (float *)::malloc(sizeof(float) * tile_samples);
+            for (int tx = begin; tx < end; ++tx) {
+                TerrainParams p = *noise;
+                p.heightmap.samples = nullptr;
+                p.width = p.depth = tile_width + 2.0f * spacing;
+                p.m = p.n = side;
+                p.center_x = (tx - tiles_x / 2) * tile_width + 0.5f * tile_width;
+                p.center_z = (tz - tiles_z / 2) * tile_width + 0.5f * tile_width;
+                terrain_heights(&p, 0, side, heights);
+
+                uint16_t * out = row + tx * tile_samples;
+                for (size_t i = 0; i < tile_samples; ++i) {
+                    float q = (heights[i] - header.height_min) / header.height_step + 0.5f;
+                    out[i] = (uint16_t)(q < 0.0f ? 0.0f : (q > 65535.0f ? 65535.0f : q));
+                }
+            }
+            ::free(heights);
+        });
+        ok = tile_samples * tiles_x == fwrite(row, sizeof(uint16_t), tile_samples * tiles_x, f);
+    }
+    ::free(row);
+    ok = (0 == fclose(f)) && ok;
+    if (!ok)
+        remove(path);
+    return ok;
+}
+
+// -- streaming
+
+enum TileState : uint8_t {
+    TILE_EMPTY,
+    TILE_QUEUED,        // load job queued, running or finished but not popped
+    TILE_RESIDENT,      // uploaded by the caller
+};
+
+// A finished tile: create_grid's layout in world space, with heights and
+// normals from the samples (the apron gives the border central differences
+// too, so they match the neighbouring tile's).
+struct TileMesh {
+    int         tile;
+    Vertex *    vertices;
+};
+
+struct TileJob {
+    int         tile;
+    bool        load;           // false: only fault the pages in
+};
+
+struct TileStreamerStats {
+    int         resident;
+    int         queued;
+    int         loaded;         // totals since open
+    int         prefetched;
+    int         evicted;
+    size_t      resident_bytes;
+};
+
+struct TileStreamer {
+    MappedFile                      file;
+    TiledHeightfieldHeader const *  header;
+    uint16_t const *                samples;
+    int                             tile_count;
+    int                             tile_samples;   // per tile, (tile_size + 3)^2 with the apron
+    int                             vertex_count;   // per tile, (tile_size + 1)^2
+    int                             index_count;
+    int *                           indices;        // shared by all tiles
+    size_t                          tile_bytes;     // caller's cost of a resident tile
+    size_t                          budget;
+
+    // per tile, main thread only
+    TileState *     state;
+    uint8_t *       prefetched;
+    uint32_t *      last_wanted;    // frame the tile was last in range
+    uint32_t *      block;          // where the caller keeps it
+    int *           base_vertex;
+
+    int *           resident;       // tiles in TILE_RESIDENT, unordered
+    int             resident_count;
+    int             queued_count;
+    int *           evicted;        // tiles evicted by the last update
+    int             evicted_count;
+    TileStreamerStats   stats;
+
+    // bounded queues shared with the workers
+    std::mutex                  lock;
+    std::condition_variable     jobs_ready;
+    std::condition_variable     done_room;
+    TileJob *       jobs;
+    int             job_capacity;
+    int             job_head;
+    int             job_count;
+    TileMesh *      done;
+    int             done_capacity;
+    int             done_head;
+    int             done_count;
+    bool            quit;
+
+    std::thread     threads [TILE_STREAMER_MAX_THREADS];
+    int             thread_count;
+};
+
+static inline uint16_t const *
+tile_streamer_tile_samples (TileStreamer const * s, int tile) {
+    return s->samples + (size_t)tile * s->tile_samples;
+}
+// Touches one byte per page so the page faults happen on this thread.
+static inline uint32_t
+tile_streamer_touch (TileStreamer const * s, int tile) {
+    uint8_t const * p = (uint8_t const *)tile_streamer_tile_samples(s, tile);
+    size_t bytes = sizeof(uint16_t) * s->tile_samples;
+    uint32_t sum = 0;
+    for (size_t i = 0; i < bytes; i += TILE_STREAMER_PAGE)
+        sum += p[i];
+    return sum + p[bytes - 1];
+}
+// 'scratch_vtx' and 'scratch_heights' hold tile_samples entries.
+static void
+tile_streamer_build (TileStreamer const * s, int tile, Vertex out [], int scratch_idx [], Vertex scratch_vtx [], float scratch_heights []) {
+    TiledHeightfieldHeader const * h = s->header;
+    int side = h->tile_size + 1;
+    int apron_side = side + 2;
+    int tx = tile % h->tiles_x;
+    int tz = tile / h->tiles_x;
+    float tile_width = h->tile_size * h->spacing;
+
+    MeshBounds bounds;
+    create_grid(tile_width, tile_width, side, side, out, scratch_idx, &bounds);
+
+    // Normals over the apron grid, skipping its outer ring, then copied into
+    // the tile's vertices.
+    TerrainParams p = {};
+    p.width = p.depth = tile_width + 2.0f * h->spacing;
+    p.m = p.n = apron_side;
+    uint16_t const * src = tile_streamer_tile_samples(s, tile);
+    for (int i = 0; i < s->tile_samples; ++i)
+        scratch_heights[i] = h->height_min + src[i] * h->height_step;
+    terrain_normals(&p, scratch_heights, 1, apron_side - 1, scratch_vtx);
+    for (int i = 0; i < side; ++i) {
+        Vertex const * in = scratch_vtx + (i + 1) * apron_side + 1;
+        Vertex * row = out + i * side;
+        for (int j = 0; j < side; ++j) {
+            row[j].position.y = in[j].position.y;
+            row[j].normal = in[j].normal;
+            row[j].tangent_u = in[j].tangent_u;
+        }
+    }
+
+    float cx = (tx - h->tiles_x / 2) * tile_width + 0.5f * tile_width;
+    float cz = (tz - h->tiles_z / 2) * tile_width + 0.5f * tile_width;
+    for (int i = 0; i < side * side; ++i) {
+        out[i].position.x += cx;
+        out[i].position.z += cz;
+    }
+}
+static void
+tile_streamer_worker (TileStreamer * s) {
+    int * scratch_idx = (int *)::malloc(sizeof(int) * s->index_count);
+    Vertex * scratch_vtx = (Vertex *)::malloc(sizeof(Vertex) * s->tile_samples);
+    float * scratch_heights = (float *)::malloc(sizeof(float) * s->tile_samples);
+    volatile uint32_t sink = 0;
+    for (;;) {
+        TileJob job;
+        {
+            std::unique_lock<std::mutex> guard(s->lock);
+            s->jobs_ready.wait(guard, [s] { return s->quit || s->job_count > 0; });
+            if (s->quit)
+                break;
+            job = s->jobs[s->job_head];
+            s->job_head = (s->job_head + 1) % s->job_capacity;
+            --s->job_count;
+        }
+        if (!job.load) {
+            sink = sink + tile_streamer_touch(s, job.tile);
+            continue;
+        }
+
+        TileMesh mesh;
+        mesh.tile = job.tile;
+        mesh.vertices = (Vertex *)::malloc(sizeof(Vertex) * s->vertex_count);
+        tile_streamer_build(s, job.tile, mesh.vertices, scratch_idx, scratch_vtx, scratch_heights);
+
+        std::unique_lock<std::mutex> guard(s->lock);
+        s->done_room.wait(guard, [s] { return s->quit || s->done_count < s->done_capacity; });
+        if (s->quit) {
+            ::free(mesh.vertices);
+            break;
+        }
+        s->done[(s->done_head + s->done_count) % s->done_capacity] = mesh;
+        ++s->done_count;
+    }
+    ::free(scratch_heights);
+    ::free(scratch_vtx);
+    ::free(scratch_idx);
+}
+
+// 'vertex_bytes' is what the caller keeps per resident vertex; whole tiles
+// are counted against 'budget' together with the ones still on their way.
+// The streamer owns a mutex and threads, so it lives on the heap; nullptr if
+// the file can't be mapped or isn't a tiled heightfield.
+static TileStreamer *
+tile_streamer_open (char const * path, int thread_count, int queue_capacity, size_t vertex_bytes, size_t budget) {
+    TileStreamer * s = new TileStreamer();
+    if (!map_file(path, &s->file)) {
+        delete s;
+        return nullptr;
+    }
+
+    TiledHeightfieldHeader const * h = (TiledHeightfieldHeader const *)s->file.data;
+    bool valid =
+        s->file.size >= sizeof(TiledHeightfieldHeader) && TILED_HEIGHTFIELD_MAGIC == h->magic &&
+        h->tile_size >= 2 && h->tile_size <= 1024 && h->tiles_x > 0 && h->tiles_z > 0 &&
+        h->tiles_x <= 65536 / h->tiles_z && h->spacing > 0.0f;
+    // In 64 bits: 65536 tiles of 1027^2 samples overflow a 32 bit size_t.
+    uint64_t apron_side = valid ? (uint64_t)h->tile_size + 3 : 0;
+    if (!valid || (uint64_t)s->file.size < sizeof(*h) + apron_side * apron_side * sizeof(uint16_t) * h->tiles_x * h->tiles_z) {
+        unmap_file(&s->file);
+        delete s;
+        return nullptr;
+    }
+
+    s->header = h;
+    s->samples = (uint16_t const *)(s->file.data + sizeof(*h));
+    int side = h->tile_size + 1;
+    s->tile_count = h->tiles_x * h->tiles_z;
+    s->tile_samples = (int)(apron_side * apron_side);
+    s->vertex_count = side * side;
+    s->index_count = h->tile_size * h->tile_size * 6;
+    s->tile_bytes = vertex_bytes * s->vertex_count;
+    s->budget = budget;
+
+    // Every tile has create_grid's indices.
+    s->indices = (int *)::malloc(sizeof(int) * s->index_count);
+    Vertex * scratch = (Vertex *)::malloc(sizeof(Vertex) * s->vertex_count);
+    MeshBounds bounds;
+    create_grid(1.0f, 1.0f, side, side, scratch, s->indices, &bounds);
+    ::free(scratch);
+
+    s->state = (TileState *)::calloc(s->tile_count, sizeof(TileState));
+    s->prefetched = (uint8_t *)::calloc(s->tile_count, 1);
+    s->last_wanted = (uint32_t *)::calloc(s->tile_count, sizeof(uint32_t));
+    s->block = (uint32_t *)::calloc(s->tile_count, sizeof(uint32_t));
+    s->base_vertex = (int *)::calloc(s->tile_count, sizeof(int));
+    s->resident = (int *)::malloc(sizeof(int) * s->tile_count);
+    s->evicted = (int *)::malloc(sizeof(int) * s->tile_count);
+    s->resident_count = 0;
+    s->queued_count = 0;
+    s->evicted_count = 0;
+    memset(&s->stats, 0, sizeof(s->stats));
+
+    s->job_capacity = queue_capacity;
+    s->jobs = (TileJob *)::malloc(sizeof(TileJob) * queue_capacity);
+    s->job_head = s->job_count = 0;
+    s->done_capacity = queue_capacity;
+    s->done = (TileMesh *)::malloc(sizeof(TileMesh) * queue_capacity);
+    s->done_head = s->done_count = 0;
+    s->quit = false;
+
+    s->thread_count = thread_count < 1 ? 1 : (thread_count > TILE_STREAMER_MAX_THREADS ? TILE_STREAMER_MAX_THREADS : thread_count);
+    for (int t = 0; t < s->thread_count; ++t)
+        s->threads[t] = std::thread(tile_streamer_worker, s);
+    return s;
+}
+static void
+tile_streamer_close (TileStreamer * s) {
+    {
+        std::lock_guard<std::mutex> guard(s->lock);
+        s->quit = true;
+    }
+    s->jobs_ready.notify_all();
+    s->done_room.notify_all();
+    for (int t = 0; t < s->thread_count; ++t)
+        s->threads[t].join();
+    for (int i = 0; i < s->done_count; ++i)
+        ::free(s->done[(s->done_head + i) % s->done_capacity].vertices);
+
+    ::free(s->done);
+    ::free(s->jobs);
+    ::free(s->evicted);
+    ::free(s->resident);
+    ::free(s->base_vertex);
+    ::free(s->block);
+    ::free(s->last_wanted);
+    ::free(s->prefetched);
+    ::free(s->state);
+    ::free(s->indices);
+    unmap_file(&s->file);
+    delete s;
+}
+
+// Evicts the least recently wanted resident tile not wanted in 'frame'.
+static bool
+tile_streamer_evict_one (TileStreamer * s, uint32_t frame) {
+    int best = -1;
+    for (int r = 0; r < s->resident_count; ++r) {
+        int tile = s->resident[r];
+        if (s->last_wanted[tile] != frame && (best < 0 || s->last_wanted[tile] < s->last_wanted[s->resident[best]]))
+            best = r;
+    }
+    if (best < 0)
+        return false;
+    int tile = s->resident[best];
+    s->resident[best] = s->resident[--s->resident_count];
+    s->state[tile] = TILE_EMPTY;
+    s->prefetched[tile] = 0;
+    s->evicted[s->evicted_count++] = tile;
+    ++s->stats.evicted;
+    return true;
+}
+
+struct TileCandidate {
+    int     tile;
+    float   dist_sq;
+};
+static int
+tile_candidate_compare (void const * a, void const * b) {
+    float da = ((TileCandidate const *)a)->dist_sq;
+    float db = ((TileCandidate const *)b)->dist_sq;
+    return da < db ? -1 : (da > db ? 1 : 0);
+}
+
+// Marks the tiles within 'radius' of (x, z) wanted and queues loads for
+// those missing, nearest first, and page prefetches for the ring out to
+// 'prefetch_radius'. Tiles evicted to stay within budget are listed in
+// s->evicted for the caller to release. Queue slots that are full are
+// simply retried next frame.
+static void
+tile_streamer_update (TileStreamer * s, float x, float z, float radius, float prefetch_radius, uint32_t frame) {
+    TiledHeightfieldHeader const * h = s->header;
+    s->evicted_count = 0;
+    float tile_width = h->tile_size * h->spacing;
+    float x0 = -(h->tiles_x / 2) * tile_width;
+    float z0 = -(h->tiles_z / 2) * tile_width;
+
+    int tx_lo = (int)floorf((x - prefetch_radius - x0) / tile_width);
+    int tx_hi = (int)floorf((x + prefetch_radius - x0) / tile_width);
+    int tz_lo = (int)floorf((z - prefetch_radius - z0) / tile_width);
+    int tz_hi = (int)floorf((z + prefetch_radius - z0) / tile_width);
+    tx_lo = tx_lo < 0 ? 0 : tx_lo;
+    tz_lo = tz_lo < 0 ? 0 : tz_lo;
+    tx_hi = tx_hi >= h->tiles_x ? h->tiles_x - 1 : tx_hi;
+    tz_hi = tz_hi >= h->tiles_z ? h->tiles_z - 1 : tz_hi;
+    if (tx_lo > tx_hi || tz_lo > tz_hi)
+        return;
+
+    // -- Tiles in the prefetch square, by distance to the nearest point.
+    int capacity = (tx_hi - tx_lo + 1) * (tz_hi - tz_lo + 1);
+    TileCandidate * candidates = (TileCandidate *)::malloc(sizeof(TileCandidate) * capacity);
+    int count = 0;
+    for (int tz = tz_lo; tz <= tz_hi; ++tz) {
+        for (int tx = tx_lo; tx <= tx_hi; ++tx) {
+            float bx = x0 + tx * tile_width;
+            float bz = z0 + tz * tile_width;
+            float dx = x < bx ? bx - x : (x > bx + tile_width ? x - bx - tile_width : 0.0f);
+            float dz = z < bz ? bz - z : (z > bz + tile_width ? z - bz - tile_width : 0.0f);
+            float d = dx * dx + dz * dz;
+            if (d > prefetch_radius * prefetch_radius)
+                continue;
+            int tile = tz * h->tiles_x + tx;
+            candidates[count].tile = tile;
+            candidates[count].dist_sq = d;
+            ++count;
+            if (d <= radius * radius)
+                s->last_wanted[tile] = frame;
+        }
+    }
+    qsort(candidates, count, sizeof(TileCandidate), tile_candidate_compare);
+
+    // -- Queue what is missing while the job queue and the budget allow.
+    bool queued = false;
+    {
+        std::lock_guard<std::mutex> guard(s->lock);
+        for (int c = 0; c < count && s->job_count < s->job_capacity; ++c) {
+            int tile = candidates[c].tile;
+            bool wanted = candidates[c].dist_sq <= radius * radius;
+            TileJob job;
+            job.tile = tile;
+            if (wanted && TILE_EMPTY == s->state[tile]) {
+                size_t needed = (s->resident_count + s->queued_count + 1) * s->tile_bytes;
+                while (needed > s->budget && tile_streamer_evict_one(s, frame))
+                    needed -= s->tile_bytes;
+                if (needed > s->budget)
+                    break;
+                job.load = true;
+                s->state[tile] = TILE_QUEUED;
+                s->prefetched[tile] = 1;
+                ++s->queued_count;
+            } else if (!wanted && TILE_EMPTY == s->state[tile] && !s->prefetched[tile]) {
+                job.load = false;
+                s->prefetched[tile] = 1;
+                ++s->stats.prefetched;
+            } else {
+                continue;
+            }
+            s->jobs[(s->job_head + s->job_count) % s->job_capacity] = job;
+            ++s->job_count;
+            queued = true;
+        }
+    }
+    if (queued)
+        s->jobs_ready.notify_all();
+    ::free(candidates);
+
+    // -- Keep within budget even without new loads.
+    while ((s->resident_count + s->queued_count) * s->tile_bytes > s->budget && tile_streamer_evict_one(s, frame))
+        ;
+}
+// Takes one finished tile, if any. The caller uploads it and then calls
+// tile_streamer_resident, or tile_streamer_discard if it could not.
+static bool
+tile_streamer_pop (TileStreamer * s, TileMesh * out) {
+    {
+        std::lock_guard<std::mutex> guard(s->lock);
+        if (0 == s->done_count)
+            return false;
+        *out = s->done[s->done_head];
+        s->done_head = (s->done_head + 1) % s->done_capacity;
+        --s->done_count;
+    }
+    s->done_room.notify_one();
+    --s->queued_count;
+    return true;
+}
+static void
+tile_streamer_resident (TileStreamer * s, TileMesh * mesh, uint32_t block, int base_vertex) {
+    int tile = mesh->tile;
+    s->state[tile] = TILE_RESIDENT;
+    s->block[tile] = block;
+    s->base_vertex[tile] = base_vertex;
+    s->resident[s->resident_count++] = tile;
+    ++s->stats.loaded;
+    ::free(mesh->vertices);
+    mesh->vertices = nullptr;
+}
+static void
+tile_streamer_discard (TileStreamer * s, TileMesh * mesh) {
+    s->state[mesh->tile] = TILE_EMPTY;
+    ::free(mesh->vertices);
+    mesh->vertices = nullptr;
+}
+static void
+tile_streamer_stats (TileStreamer const * s, TileStreamerStats * out) {
+    *out = s->stats;
+    out->resident = s->resident_count;
+    out->queued = s->queued_count;
+    out->resident_bytes = s->resident_count * s->tile_bytes;
+}
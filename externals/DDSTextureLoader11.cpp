@@ -17,9 +17,35 @@
 #include "DDSTextureLoader11.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <list>
 #include <memory>
+#include <mutex>
 #include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <cwchar>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define DDS_SSE2
+#endif
 
 #ifdef __clang__
 #pragma clang diagnostic ignored "-Wcovered-switch-default"
@@ -203,128 +229,318 @@ namespace
 
 
     //--------------------------------------------------------------------------------------
-    HRESULT LoadTextureDataFromFile(
-        _In_z_ const wchar_t* fileName,
-        std::unique_ptr<uint8_t[]>& ddsData,
-        const DDS_HEADER** header,
-        const uint8_t** bitData,
-        size_t* bitSize) noexcept
+    // Opens a file for reading; files that are empty or do not fit 32 bits are rejected
+    //--------------------------------------------------------------------------------------
+#ifdef _WIN32
+    HRESULT OpenFileForRead(_In_z_ const wchar_t* fileName, ScopedHandle& file, size_t& fileSize) noexcept
     {
-        if (!header || !bitData || !bitSize)
-        {
-            return E_POINTER;
-        }
-
-        *bitSize = 0;
+        fileSize = 0;
 
-        // open the file
-#if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
-        ScopedHandle hFile(safe_handle(CreateFile2(fileName,
+    #if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
+        file.reset(safe_handle(CreateFile2(fileName,
             GENERIC_READ,
             FILE_SHARE_READ,
             OPEN_EXISTING,
             nullptr)));
-#else
-        ScopedHandle hFile(safe_handle(CreateFileW(fileName,
+    #else
+        file.reset(safe_handle(CreateFileW(fileName,
             GENERIC_READ,
             FILE_SHARE_READ,
             nullptr,
             OPEN_EXISTING,
             FILE_ATTRIBUTE_NORMAL,
             nullptr)));
-#endif
+    #endif
 
-        if (!hFile)
+        if (!file)
         {
             return HRESULT_FROM_WIN32(GetLastError());
         }
 
         // Get the file size
         FILE_STANDARD_INFO fileInfo;
-        if (!GetFileInformationByHandleEx(hFile.get(), FileStandardInfo, &fileInfo, sizeof(fileInfo)))
+        if (!GetFileInformationByHandleEx(file.get(), FileStandardInfo, &fileInfo, sizeof(fileInfo)))
         {
             return HRESULT_FROM_WIN32(GetLastError());
         }
 
-        // File is too big for 32-bit allocation, so reject read
+        // File is too big for 32-bit allocation and views, so reject it
         if (fileInfo.EndOfFile.HighPart > 0)
         {
             return E_FAIL;
         }
 
-        // Need at least enough data to fill the header and magic number to be a valid DDS
-        if (fileInfo.EndOfFile.LowPart < (sizeof(uint32_t) + sizeof(DDS_HEADER)))
+        // Empty files cannot be mapped
+        if (!fileInfo.EndOfFile.LowPart)
         {
             return E_FAIL;
         }
 
-        // create enough space for the file data
-        ddsData.reset(new (std::nothrow) uint8_t[fileInfo.EndOfFile.LowPart]);
-        if (!ddsData)
+        fileSize = fileInfo.EndOfFile.LowPart;
+        return S_OK;
+    }
+#else
+    HRESULT OpenFileForRead(_In_z_ const wchar_t* fileName, int& fd, size_t& fileSize) noexcept
+    {
+        fd = -1;
+        fileSize = 0;
+
+        // Paths are UTF-8 on POSIX systems
+        std::mbstate_t state = {};
+        const wchar_t* src = fileName;
+        size_t len = std::wcsrtombs(nullptr, &src, 0, &state);
+        if (len == static_cast<size_t>(-1))
+        {
+            return E_INVALIDARG;
+        }
+
+        std::unique_ptr<char[]> path(new (std::nothrow) char[len + 1]);
+        if (!path)
         {
             return E_OUTOFMEMORY;
         }
 
-        // read the data in
-        DWORD bytesRead = 0;
-        if (!ReadFile(hFile.get(),
-            ddsData.get(),
-            fileInfo.EndOfFile.LowPart,
-            &bytesRead,
-            nullptr
-        ))
+        src = fileName;
+        state = {};
+        std::wcsrtombs(path.get(), &src, len + 1, &state);
+
+        int file = open(path.get(), O_RDONLY | O_CLOEXEC);
+        if (file < 0)
         {
-            ddsData.reset();
-            return HRESULT_FROM_WIN32(GetLastError());
+            return (errno == ENOENT) ? HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND) : E_FAIL;
         }
 
-        if (bytesRead < fileInfo.EndOfFile.LowPart)
+        struct stat st;
+        if (fstat(file, &st) != 0 || st.st_size <= 0 || uint64_t(st.st_size) > UINT32_MAX)
         {
-            ddsData.reset();
+            close(file);
             return E_FAIL;
         }
 
-        // DDS files always start with the same magic number ("DDS ")
-        auto dwMagicNumber = *reinterpret_cast<const uint32_t*>(ddsData.get());
-        if (dwMagicNumber != DDS_MAGIC)
+        fd = file;
+        fileSize = size_t(st.st_size);
+        return S_OK;
+    }
+#endif
+
+
+    //--------------------------------------------------------------------------------------
+    // Read-only mapped view of a whole file. The subresource pointers handed to Direct3D
+    // point straight into the view, so the texel data is never copied into a heap buffer
+    // and pages are faulted in from the file cache as the runtime consumes them.
+    //--------------------------------------------------------------------------------------
+    class MappedFileView
+    {
+    public:
+        MappedFileView() noexcept : m_data(nullptr), m_size(0) {}
+        ~MappedFileView() { Reset(); }
+
+        MappedFileView(const MappedFileView&) = delete;
+        MappedFileView& operator=(const MappedFileView&) = delete;
+
+        HRESULT Open(_In_z_ const wchar_t* fileName) noexcept
         {
-            ddsData.reset();
-            return E_FAIL;
+            Reset();
+
+#ifdef _WIN32
+            ScopedHandle hFile;
+            size_t fileSize = 0;
+            HRESULT hr = OpenFileForRead(fileName, hFile, fileSize);
+            if (FAILED(hr))
+            {
+                return hr;
+            }
+
+            // The view keeps the mapping alive, so both handles can be closed once it exists
+            ScopedHandle hMapping(CreateFileMappingW(hFile.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+            if (!hMapping)
+            {
+                return HRESULT_FROM_WIN32(GetLastError());
+            }
+
+            void* view = MapViewOfFile(hMapping.get(), FILE_MAP_READ, 0, 0, 0);
+            if (!view)
+            {
+                return HRESULT_FROM_WIN32(GetLastError());
+            }
+
+            m_data = static_cast<const uint8_t*>(view);
+            m_size = fileSize;
+
+        #if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
+            // The loader walks the texel data front to back, so start reading it in now
+            WIN32_MEMORY_RANGE_ENTRY range = { view, m_size };
+            PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+        #endif
+#else
+            int fd = -1;
+            size_t fileSize = 0;
+            HRESULT hr = OpenFileForRead(fileName, fd, fileSize);
+            if (FAILED(hr))
+            {
+                return hr;
+            }
+
+            void* view = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (view == MAP_FAILED)
+            {
+                return (errno == ENOMEM) ? E_OUTOFMEMORY : E_FAIL;
+            }
+
+            m_data = static_cast<const uint8_t*>(view);
+            m_size = fileSize;
+
+            // The loader walks the texel data front to back, so start reading it in now
+            madvise(view, m_size, MADV_SEQUENTIAL);
+            madvise(view, m_size, MADV_WILLNEED);
+#endif
+
+            return S_OK;
+        }
+
+        void Reset() noexcept
+        {
+            if (m_data)
+            {
+#ifdef _WIN32
+                UnmapViewOfFile(m_data);
+#else
+                munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+            }
+            m_data = nullptr;
+            m_size = 0;
         }
 
-        auto hdr = reinterpret_cast<const DDS_HEADER*>(ddsData.get() + sizeof(uint32_t));
+        const uint8_t* GetData() const noexcept { return m_data; }
+        size_t GetSize() const noexcept { return m_size; }
 
-        // Verify header to validate DDS file
-        if (hdr->size != sizeof(DDS_HEADER) ||
-            hdr->ddspf.size != sizeof(DDS_PIXELFORMAT))
+    private:
+        const uint8_t*  m_data;
+        size_t          m_size;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Positioned reads from a file, for callers that only want some ranges of it; what is
+    // seeked over is never read.
+    //--------------------------------------------------------------------------------------
+    class FileReader
+    {
+    public:
+#ifdef _WIN32
+        FileReader() noexcept : m_size(0) {}
+#else
+        FileReader() noexcept : m_fd(-1), m_size(0) {}
+        ~FileReader() { if (m_fd >= 0) close(m_fd); }
+#endif
+
+        FileReader(const FileReader&) = delete;
+        FileReader& operator=(const FileReader&) = delete;
+
+        HRESULT Open(_In_z_ const wchar_t* fileName) noexcept
         {
-            ddsData.reset();
-            return E_FAIL;
+#ifdef _WIN32
+            return OpenFileForRead(fileName, m_file, m_size);
+#else
+            return OpenFileForRead(fileName, m_fd, m_size);
+#endif
         }
 
-        // Check for DX10 extension
-        bool bDXT10Header = false;
-        if ((hdr->ddspf.flags & DDS_FOURCC) &&
-            (MAKEFOURCC('D', 'X', '1', '0') == hdr->ddspf.fourCC))
+        HRESULT Read(size_t offset, _Out_writes_bytes_(size) void* dest, size_t size) noexcept
         {
-            // Must be long enough for both headers and magic value
-            if (fileInfo.EndOfFile.LowPart < (sizeof(uint32_t) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10)))
+            if (offset > m_size || size > m_size - offset)
             {
-                ddsData.reset();
-                return E_FAIL;
+                return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
             }
 
-            bDXT10Header = true;
+#ifdef _WIN32
+            LARGE_INTEGER position = {};
+            position.QuadPart = LONGLONG(offset);
+            if (!SetFilePointerEx(m_file.get(), position, nullptr, FILE_BEGIN))
+            {
+                return HRESULT_FROM_WIN32(GetLastError());
+            }
+
+            DWORD bytesRead = 0;
+            if (!ReadFile(m_file.get(), dest, static_cast<DWORD>(size), &bytesRead, nullptr))
+            {
+                return HRESULT_FROM_WIN32(GetLastError());
+            }
+
+            if (bytesRead < size)
+            {
+                return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+            }
+#else
+            auto ptr = static_cast<uint8_t*>(dest);
+            while (size > 0)
+            {
+                ssize_t n = pread(m_fd, ptr, size, off_t(offset));
+                if (n < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (n <= 0)
+                {
+                    return (n == 0) ? HRESULT_FROM_WIN32(ERROR_HANDLE_EOF) : E_FAIL;
+                }
+
+                ptr += n;
+                offset += size_t(n);
+                size -= size_t(n);
+            }
+#endif
+
+            return S_OK;
         }
 
-        // setup the pointers in the process request
-        *header = hdr;
-        auto offset = sizeof(uint32_t) + sizeof(DDS_HEADER)
-            + (bDXT10Header ? sizeof(DDS_HEADER_DXT10) : 0);
-        *bitData = ddsData.get() + offset;
-        *bitSize = fileInfo.EndOfFile.LowPart - offset;
+        size_t GetSize() const noexcept { return m_size; }
 
-        return S_OK;
+    private:
+#ifdef _WIN32
+        ScopedHandle    m_file;
+#else
+        int             m_fd;
+#endif
+        size_t          m_size;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Maps the file and validates it in place; header and bitData point into the view, which
+    // must stay open until the Direct3D resources have been created from it.
+    //--------------------------------------------------------------------------------------
+    HRESULT LoadTextureDataFromFile(
+        _In_z_ const wchar_t* fileName,
+        MappedFileView& ddsData,
+        const DDS_HEADER** header,
+        const uint8_t** bitData,
+        size_t* bitSize) noexcept
+    {
+        if (!header || !bitData || !bitSize)
+        {
+            return E_POINTER;
+        }
+
+        *bitSize = 0;
+
+        HRESULT hr = ddsData.Open(fileName);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        hr = LoadTextureDataFromMemory(ddsData.GetData(), ddsData.GetSize(),
+            header,
+            bitData,
+            bitSize
+        );
+        if (FAILED(hr))
+        {
+            ddsData.Reset();
+        }
+
+        return hr;
     }
 
 
@@ -652,7 +868,7 @@ namespace
                     return DXGI_FORMAT_B8G8R8X8_UNORM;
                 }
 
-                // No DXGI format maps to ISBITMASK(0x000000ff,0x0000ff00,0x00ff0000,0) aka D3DFMT_X8B8G8R8
+                // No DXGI format maps to ISBITMASK(0x000000ff,0x0000ff00,0x00ff0000,0) aka D3DFMT_X8B8G8R8; see ConvertLegacyImage
 
                 // Note that many common DDS reader/writers (including D3DX) swap the
                 // the RED/BLUE masks for 10:10:10:2 formats. We assume
@@ -681,7 +897,7 @@ namespace
                 break;
 
             case 24:
-                // No 24bpp DXGI formats aka D3DFMT_R8G8B8
+                // No 24bpp DXGI formats aka D3DFMT_R8G8B8; see ConvertLegacyImage
                 break;
 
             case 16:
@@ -694,16 +910,17 @@ namespace
                     return DXGI_FORMAT_B5G6R5_UNORM;
                 }
 
-                // No DXGI format maps to ISBITMASK(0x7c00,0x03e0,0x001f,0) aka D3DFMT_X1R5G5B5
+                // No DXGI format maps to ISBITMASK(0x7c00,0x03e0,0x001f,0) aka D3DFMT_X1R5G5B5; see ConvertLegacyImage
 
                 if (ISBITMASK(0x0f00, 0x00f0, 0x000f, 0xf000))
                 {
                     return DXGI_FORMAT_B4G4R4A4_UNORM;
                 }
 
-                // No DXGI format maps to ISBITMASK(0x0f00,0x00f0,0x000f,0) aka D3DFMT_X4R4G4B4
+                // No DXGI format maps to ISBITMASK(0x0f00,0x00f0,0x000f,0) aka D3DFMT_X4R4G4B4; see ConvertLegacyImage
 
                 // No 3:3:2, 3:3:2:8, or paletted DXGI formats aka D3DFMT_A8R3G3B2, D3DFMT_R3G3B2, D3DFMT_P8, D3DFMT_A8P8, etc.
+                // (ConvertLegacyImage expands the 3:3:2 ones)
                 break;
             }
         }
@@ -716,7 +933,7 @@ namespace
                     return DXGI_FORMAT_R8_UNORM; // D3DX10/11 writes this out as DX10 extension
                 }
 
-                // No DXGI format maps to ISBITMASK(0x0f,0x00,0x00,0xf0) aka D3DFMT_A4L4
+                // No DXGI format maps to ISBITMASK(0x0f,0x00,0x00,0xf0) aka D3DFMT_A4L4; see ConvertLegacyImage
 
                 if (ISBITMASK(0x00ff, 0, 0, 0xff00))
                 {
@@ -871,6 +1088,298 @@ namespace
         return DXGI_FORMAT_UNKNOWN;
     }
 
+    //--------------------------------------------------------------------------------------
+    // Legacy pixel formats without a DXGI equivalent are expanded into one that has one.
+    // Legacy writers store the levels tightly packed, so the whole payload is a single run
+    // of pixels and each conversion is one pass over it.
+    //--------------------------------------------------------------------------------------
+    enum LEGACY_CONVERSION
+    {
+        CONV_NONE = 0,
+        CONV_EXPAND_888,        // 24bpp -> 32bpp with opaque alpha
+        CONV_SET_BITS,          // unused X bits -> opaque alpha, same size
+        CONV_EXPAND_332,        // R3G3B2 / A8R3G3B2 -> B8G8R8A8
+        CONV_EXPAND_A4L4,       // A4L4 -> A8L8
+    };
+
+    struct LegacyFormat
+    {
+        LEGACY_CONVERSION   conversion;
+        size_t              srcBytes;
+        size_t              dstBytes;
+        uint32_t            setBits;    // CONV_SET_BITS: pattern or'ed into every 32 bits
+        DDS_PIXELFORMAT     target;     // a layout GetDXGIFormat maps
+    };
+
+    void SetPixelFormat(DDS_PIXELFORMAT& ddpf, uint32_t flags, uint32_t bitCount,
+        uint32_t r, uint32_t g, uint32_t b, uint32_t a) noexcept
+    {
+        ddpf = {};
+        ddpf.size = sizeof(DDS_PIXELFORMAT);
+        ddpf.flags = flags;
+        ddpf.RGBBitCount = bitCount;
+        ddpf.RBitMask = r;
+        ddpf.GBitMask = g;
+        ddpf.BBitMask = b;
+        ddpf.ABitMask = a;
+    }
+
+    bool GetLegacyFormat(const DDS_PIXELFORMAT& ddpf, LegacyFormat& out) noexcept
+    {
+        out = {};
+
+        if (ddpf.flags & DDS_RGB)
+        {
+            switch (ddpf.RGBBitCount)
+            {
+            case 32:
+                if (ISBITMASK(0x000000ff, 0x0000ff00, 0x00ff0000, 0))
+                {
+                    // D3DFMT_X8B8G8R8
+                    out.conversion = CONV_SET_BITS;
+                    out.srcBytes = out.dstBytes = 4;
+                    out.setBits = 0xff000000;
+                    SetPixelFormat(out.target, DDS_RGB, 32, 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000);
+                    return true;
+                }
+                break;
+
+            case 24:
+                if (ISBITMASK(0x00ff0000, 0x0000ff00, 0x000000ff, 0))
+                {
+                    // D3DFMT_R8G8B8: stored blue first, like B8G8R8A8
+                    out.conversion = CONV_EXPAND_888;
+                    out.srcBytes = 3;
+                    out.dstBytes = 4;
+                    SetPixelFormat(out.target, DDS_RGB, 32, 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000);
+                    return true;
+                }
+                if (ISBITMASK(0x000000ff, 0x0000ff00, 0x00ff0000, 0))
+                {
+                    // Red first, as some writers store it
+                    out.conversion = CONV_EXPAND_888;
+                    out.srcBytes = 3;
+                    out.dstBytes = 4;
+                    SetPixelFormat(out.target, DDS_RGB, 32, 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000);
+                    return true;
+                }
+                break;
+
+            case 16:
+                if (ISBITMASK(0x7c00, 0x03e0, 0x001f, 0))
+                {
+                    // D3DFMT_X1R5G5B5
+                    out.conversion = CONV_SET_BITS;
+                    out.srcBytes = out.dstBytes = 2;
+                    out.setBits = 0x80008000;
+                    SetPixelFormat(out.target, DDS_RGB, 16, 0x7c00, 0x03e0, 0x001f, 0x8000);
+                    return true;
+                }
+                if (ISBITMASK(0x0f00, 0x00f0, 0x000f, 0))
+                {
+                    // D3DFMT_X4R4G4B4
+                    out.conversion = CONV_SET_BITS;
+                    out.srcBytes = out.dstBytes = 2;
+                    out.setBits = 0xf000f000;
+                    SetPixelFormat(out.target, DDS_RGB, 16, 0x0f00, 0x00f0, 0x000f, 0xf000);
+                    return true;
+                }
+                if (ISBITMASK(0x00e0, 0x001c, 0x0003, 0xff00))
+                {
+                    // D3DFMT_A8R3G3B2
+                    out.conversion = CONV_EXPAND_332;
+                    out.srcBytes = 2;
+                    out.dstBytes = 4;
+                    SetPixelFormat(out.target, DDS_RGB, 32, 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000);
+                    return true;
+                }
+                break;
+
+            case 8:
+                if (ISBITMASK(0xe0, 0x1c, 0x03, 0))
+                {
+                    // D3DFMT_R3G3B2
+                    out.conversion = CONV_EXPAND_332;
+                    out.srcBytes = 1;
+                    out.dstBytes = 4;
+                    SetPixelFormat(out.target, DDS_RGB, 32, 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000);
+                    return true;
+                }
+                break;
+            }
+        }
+        else if ((ddpf.flags & DDS_LUMINANCE) && 8 == ddpf.RGBBitCount)
+        {
+            if (ISBITMASK(0x0f, 0, 0, 0xf0))
+            {
+                // D3DFMT_A4L4
+                out.conversion = CONV_EXPAND_A4L4;
+                out.srcBytes = 1;
+                out.dstBytes = 2;
+                SetPixelFormat(out.target, DDS_LUMINANCE, 16, 0x00ff, 0, 0, 0xff00);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    //--------------------------------------------------------------------------------------
+    void ExpandRGB888(_Out_writes_(count * 4) uint8_t* dst, _In_reads_(count * 3) const uint8_t* src, size_t count) noexcept
+    {
+        size_t i = 0;
+#ifdef DDS_SSE2
+        // Four pixels per step: shift each into lane 0 of its own register, then gather
+        // the lanes; the 16-byte load reads 4 bytes past the pixels, so stop short of the end
+        const __m128i rgbMask = _mm_set1_epi32(0x00ffffff);
+        const __m128i alpha = _mm_set1_epi32(int(0xff000000));
+        for (; i + 6 <= count; i += 4)
+        {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 3));
+            const __m128i p01 = _mm_unpacklo_epi32(v, _mm_srli_si128(v, 3));
+            const __m128i p23 = _mm_unpacklo_epi32(_mm_srli_si128(v, 6), _mm_srli_si128(v, 9));
+            const __m128i p = _mm_unpacklo_epi64(p01, p23);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_or_si128(_mm_and_si128(p, rgbMask), alpha));
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            dst[i * 4] = src[i * 3];
+            dst[i * 4 + 1] = src[i * 3 + 1];
+            dst[i * 4 + 2] = src[i * 3 + 2];
+            dst[i * 4 + 3] = 0xff;
+        }
+    }
+
+    void CopySetBits(_Out_writes_(size) uint8_t* dst, _In_reads_(size) const uint8_t* src, size_t size, uint32_t bits) noexcept
+    {
+        size_t i = 0;
+#ifdef DDS_SSE2
+        const __m128i pattern = _mm_set1_epi32(int(bits));
+        for (; i + 16 <= size; i += 16)
+        {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_or_si128(v, pattern));
+        }
+#endif
+        for (; i < size; ++i)
+        {
+            dst[i] = static_cast<uint8_t>(src[i] | (bits >> ((i & 3) * 8)));
+        }
+    }
+
+    void ExpandRGB332(_Out_writes_(count * 4) uint8_t* dst, _In_reads_(count * srcBytes) const uint8_t* src,
+        size_t count, size_t srcBytes) noexcept
+    {
+        // 256 entries cover every colour byte, so a table beats the arithmetic
+        uint32_t table[256];
+        for (uint32_t v = 0; v < 256; ++v)
+        {
+            const uint32_t r = (v >> 5) & 7;
+            const uint32_t g = (v >> 2) & 7;
+            const uint32_t b = v & 3;
+            table[v] = (((r << 5) | (r << 2) | (r >> 1)) << 16)
+                | (((g << 5) | (g << 2) | (g >> 1)) << 8)
+                | (b * 0x55);
+        }
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const uint32_t a = (srcBytes == 2) ? src[i * 2 + 1] : 0xffu;
+            const uint32_t v = table[src[i * srcBytes]] | (a << 24);
+            memcpy(dst + i * 4, &v, sizeof(v));
+        }
+    }
+
+    void ExpandA4L4(_Out_writes_(count * 2) uint8_t* dst, _In_reads_(count) const uint8_t* src, size_t count) noexcept
+    {
+        size_t i = 0;
+#ifdef DDS_SSE2
+        // x * 17 == x | x << 4 for a nibble; the 16-bit shifts never carry between bytes
+        const __m128i low = _mm_set1_epi8(0x0f);
+        for (; i + 16 <= count; i += 16)
+        {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            const __m128i l = _mm_and_si128(v, low);
+            const __m128i a = _mm_and_si128(_mm_srli_epi16(v, 4), low);
+            const __m128i l8 = _mm_or_si128(l, _mm_slli_epi16(l, 4));
+            const __m128i a8 = _mm_or_si128(a, _mm_slli_epi16(a, 4));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 2), _mm_unpacklo_epi8(l8, a8));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 2 + 16), _mm_unpackhi_epi8(l8, a8));
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            dst[i * 2] = static_cast<uint8_t>((src[i] & 0x0f) * 17);
+            dst[i * 2 + 1] = static_cast<uint8_t>((src[i] >> 4) * 17);
+        }
+    }
+
+    //--------------------------------------------------------------------------------------
+    // A legacy payload expanded to a DXGI-compatible one; header describes bits
+    //--------------------------------------------------------------------------------------
+    struct LegacyImage
+    {
+        DDS_HEADER                  header;
+        std::unique_ptr<uint8_t[]>  bits;
+        size_t                      bitSize;
+    };
+
+    // Returns false when header is not a legacy format this converts
+    bool ConvertLegacyImage(
+        _In_ const DDS_HEADER* header,
+        _In_reads_bytes_(bitSize) const uint8_t* bitData,
+        _In_ size_t bitSize,
+        _Out_ LegacyImage& image,
+        _Out_ HRESULT& hr) noexcept
+    {
+        hr = S_OK;
+        image.bitSize = 0;
+
+        LegacyFormat legacy;
+        if ((header->ddspf.flags & DDS_FOURCC) || !GetLegacyFormat(header->ddspf, legacy))
+        {
+            return false;
+        }
+
+        const size_t count = bitSize / legacy.srcBytes;
+        image.bits.reset(new (std::nothrow) uint8_t[std::max<size_t>(count * legacy.dstBytes, 1u)]);
+        if (!image.bits)
+        {
+            hr = E_OUTOFMEMORY;
+            return true;
+        }
+
+        switch (legacy.conversion)
+        {
+        case CONV_EXPAND_888:
+            ExpandRGB888(image.bits.get(), bitData, count);
+            break;
+
+        case CONV_SET_BITS:
+            CopySetBits(image.bits.get(), bitData, count * legacy.srcBytes, legacy.setBits);
+            break;
+
+        case CONV_EXPAND_332:
+            ExpandRGB332(image.bits.get(), bitData, count, legacy.srcBytes);
+            break;
+
+        case CONV_EXPAND_A4L4:
+            ExpandA4L4(image.bits.get(), bitData, count);
+            break;
+
+        case CONV_NONE:
+        default:
+            hr = E_UNEXPECTED;
+            return true;
+        }
+
+        memcpy(&image.header, header, sizeof(DDS_HEADER));
+        image.header.ddspf = legacy.target;
+        image.bitSize = count * legacy.dstBytes;
+        return true;
+    }
+
     #undef ISBITMASK
 
 
@@ -1239,22 +1748,25 @@ namespace
     }
 
     //--------------------------------------------------------------------------------------
-    HRESULT CreateTextureFromDDS(
-        _In_ ID3D11Device* d3dDevice,
-        _In_opt_ ID3D11DeviceContext* d3dContext,
+    // Texture description of a DDS header, validated against the Direct3D 11 limits
+    //--------------------------------------------------------------------------------------
+    struct TextureInfo
+    {
+        uint32_t    resDim;
+        UINT        width;
+        UINT        height;
+        UINT        depth;
+        size_t      mipCount;
+        UINT        arraySize;
+        DXGI_FORMAT format;
+        bool        isCubeMap;
+    };
+
+    HRESULT GetTextureInfo(
         _In_ const DDS_HEADER* header,
-        _In_reads_bytes_(bitSize) const uint8_t* bitData,
-        _In_ size_t bitSize,
-        _In_ size_t maxsize,
-        _In_ D3D11_USAGE usage,
-        _In_ unsigned int bindFlags,
-        _In_ unsigned int cpuAccessFlags,
-        _In_ unsigned int miscFlags,
-        _In_ bool forceSRGB,
-        _Outptr_opt_ ID3D11Resource** texture,
-        _Outptr_opt_ ID3D11ShaderResourceView** textureView) noexcept
+        _Out_ TextureInfo& info) noexcept
     {
-        HRESULT hr = S_OK;
+        info = {};
 
         UINT width = header->width;
         UINT height = header->height;
@@ -1422,6 +1934,67 @@ namespace
             return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
         }
 
+        info.resDim = resDim;
+        info.width = width;
+        info.height = height;
+        info.depth = depth;
+        info.mipCount = mipCount;
+        info.arraySize = arraySize;
+        info.format = format;
+        info.isCubeMap = isCubeMap;
+
+        return S_OK;
+    }
+
+    //--------------------------------------------------------------------------------------
+    HRESULT CreateTextureFromDDS(
+        _In_ ID3D11Device* d3dDevice,
+        _In_opt_ ID3D11DeviceContext* d3dContext,
+        _In_ const DDS_HEADER* header,
+        _In_reads_bytes_(bitSize) const uint8_t* bitData,
+        _In_ size_t bitSize,
+        _In_ size_t maxsize,
+        _In_ D3D11_USAGE usage,
+        _In_ unsigned int bindFlags,
+        _In_ unsigned int cpuAccessFlags,
+        _In_ unsigned int miscFlags,
+        _In_ bool forceSRGB,
+        _Outptr_opt_ ID3D11Resource** texture,
+        _Outptr_opt_ ID3D11ShaderResourceView** textureView) noexcept
+    {
+        LegacyImage legacy;
+        HRESULT hr = S_OK;
+        if (ConvertLegacyImage(header, bitData, bitSize, legacy, hr))
+        {
+            if (FAILED(hr))
+            {
+                return hr;
+            }
+
+            return CreateTextureFromDDS(d3dDevice, d3dContext,
+                &legacy.header, legacy.bits.get(), legacy.bitSize,
+                maxsize,
+                usage, bindFlags, cpuAccessFlags, miscFlags,
+                forceSRGB,
+                texture, textureView);
+        }
+
+        TextureInfo info;
+        hr = GetTextureInfo(header, info);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        const uint32_t resDim = info.resDim;
+        const UINT width = info.width;
+        const UINT height = info.height;
+        const UINT depth = info.depth;
+        const size_t mipCount = info.mipCount;
+        const UINT arraySize = info.arraySize;
+        const DXGI_FORMAT format = info.format;
+        const bool isCubeMap = info.isCubeMap;
+
         bool autogen = false;
         if (mipCount == 1 && d3dContext && textureView) // Must have context and shader-view to auto generate mipmaps
         {
@@ -1938,7 +2511,7 @@ HRESULT DirectX::CreateDDSTextureFromFileEx(
     const uint8_t* bitData = nullptr;
     size_t bitSize = 0;
 
-    std::unique_ptr<uint8_t[]> ddsData;
+    MappedFileView ddsData;
     HRESULT hr = LoadTextureDataFromFile(fileName,
         ddsData,
         &header,
@@ -1967,3 +2540,2824 @@ HRESULT DirectX::CreateDDSTextureFromFileEx(
 
     return hr;
 }
+
+
+//--------------------------------------------------------------------------------------
+namespace
+{
+    struct BatchItem
+    {
+        MappedFileView                              file;
+        const DDS_HEADER*                           header;
+        const uint8_t*                              bitData;
+        size_t                                      bitSize;
+        LegacyImage                                 legacy;     // header/bitData point here for legacy formats
+        TextureInfo                                 info;
+        std::unique_ptr<D3D11_SUBRESOURCE_DATA[]>   initData;
+        size_t                                      twidth;
+        size_t                                      theight;
+        size_t                                      tdepth;
+        size_t                                      skipMip;
+        HRESULT                                     hr;
+    };
+
+    // Everything short of creating the resource, which stays on the calling thread
+    void PrepareBatchItem(_In_z_ const wchar_t* fileName, size_t maxsize, BatchItem& item) noexcept
+    {
+        item.hr = LoadTextureDataFromFile(fileName,
+            item.file,
+            &item.header,
+            &item.bitData,
+            &item.bitSize
+        );
+        if (FAILED(item.hr))
+            return;
+
+        // Fault the texel data in here rather than in the driver on the calling thread
+        volatile uint8_t sink = 0;
+        for (size_t offset = 0; offset < item.bitSize; offset += 4096)
+        {
+            sink = sink + item.bitData[offset];
+        }
+
+        // Expand legacy pixel formats here too, so the sink only ever sees DXGI ones
+        HRESULT hr = S_OK;
+        if (ConvertLegacyImage(item.header, item.bitData, item.bitSize, item.legacy, hr))
+        {
+            item.hr = hr;
+            if (FAILED(hr))
+                return;
+
+            item.header = &item.legacy.header;
+            item.bitData = item.legacy.bits.get();
+            item.bitSize = item.legacy.bitSize;
+        }
+
+        item.hr = GetTextureInfo(item.header, item.info);
+        if (FAILED(item.hr))
+            return;
+
+        item.initData.reset(new (std::nothrow) D3D11_SUBRESOURCE_DATA[item.info.mipCount * item.info.arraySize]);
+        if (!item.initData)
+        {
+            item.hr = E_OUTOFMEMORY;
+            return;
+        }
+
+        item.hr = FillInitData(item.info.width, item.info.height, item.info.depth, item.info.mipCount, item.info.arraySize,
+            item.info.format, maxsize, item.bitSize, item.bitData,
+            item.twidth, item.theight, item.tdepth, item.skipMip, item.initData.get());
+    }
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::LoadDDSTexturesFromFiles(
+    const wchar_t* const* fileNames,
+    size_t count,
+    const DDSBatchOptions& options,
+    const DDSBatchSink& sink,
+    HRESULT* results) noexcept
+{
+    if (results)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            results[i] = E_ABORT;
+        }
+    }
+
+    if ((count && !fileNames) || !sink)
+    {
+        return E_INVALIDARG;
+    }
+
+    if (!count)
+    {
+        return S_OK;
+    }
+
+    const size_t queueDepth = std::min(std::max<size_t>(options.ioQueueDepth, 1u), count);
+    std::unique_ptr<BatchItem[]> items(new (std::nothrow) BatchItem[queueDepth]);
+    std::unique_ptr<size_t[]> freeSlots(new (std::nothrow) size_t[queueDepth]);
+    if (!items || !freeSlots)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    for (size_t slot = 0; slot < queueDepth; ++slot)
+    {
+        freeSlots[slot] = slot;
+    }
+
+    // Workers claim files in order while a slot is free; the calling thread consumes
+    // finished slots in completion order and hands them back
+    std::mutex mutex;
+    std::condition_variable wakeWorkers;
+    std::condition_variable wakeUploads;
+    size_t nextFile = 0;
+    size_t freeCount = queueDepth;
+    std::vector<std::pair<size_t, size_t>> finished; // (file, slot)
+    bool stop = false;
+
+    auto worker = [&]()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;)
+        {
+            wakeWorkers.wait(lock, [&]() { return stop || nextFile == count || freeCount > 0; });
+            if (stop || nextFile == count)
+                return;
+
+            size_t file = nextFile++;
+            size_t slot = freeSlots[--freeCount];
+            lock.unlock();
+
+            PrepareBatchItem(fileNames[file], options.maxsize, items[slot]);
+
+            lock.lock();
+            finished.emplace_back(file, slot);
+            wakeUploads.notify_one();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    try
+    {
+        finished.reserve(queueDepth);
+        const size_t threadCount = std::min(std::max<size_t>(options.workerThreads, 1u), count);
+        threads.reserve(threadCount);
+        for (size_t i = 0; i < threadCount; ++i)
+        {
+            threads.emplace_back(worker);
+        }
+    }
+    catch (...)
+    {
+        if (threads.empty())
+        {
+            return E_OUTOFMEMORY;
+        }
+    }
+
+    HRESULT hr = S_OK;
+    for (size_t done = 0; done < count; ++done)
+    {
+        size_t file = 0;
+        size_t slot = 0;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeUploads.wait(lock, [&]() { return !finished.empty(); });
+            file = finished.back().first;
+            slot = finished.back().second;
+            finished.pop_back();
+        }
+
+        BatchItem& item = items[slot];
+        HRESULT fileHr = item.hr;
+        if (SUCCEEDED(fileHr))
+        {
+            DDSBatchTexture texture = {};
+            texture.index = file;
+            texture.resDim = item.info.resDim;
+            texture.width = item.twidth;
+            texture.height = item.theight;
+            texture.depth = item.tdepth;
+            texture.mipCount = item.info.mipCount - item.skipMip;
+            texture.arraySize = item.info.arraySize;
+            texture.format = item.info.format;
+            texture.isCubeMap = item.info.isCubeMap;
+            texture.initData = item.initData.get();
+            texture.alphaMode = GetAlphaMode(item.header);
+            texture.ddsData = item.file.GetData();
+            texture.ddsDataSize = item.file.GetSize();
+
+            try
+            {
+                fileHr = sink(texture);
+            }
+            catch (...)
+            {
+                fileHr = E_UNEXPECTED;
+            }
+        }
+
+        if (results)
+        {
+            results[file] = fileHr;
+        }
+        if (FAILED(fileHr) && SUCCEEDED(hr))
+        {
+            hr = fileHr;
+        }
+
+        item.file.Reset();
+        item.initData.reset();
+        item.legacy.bits.reset();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            freeSlots[freeCount++] = slot;
+        }
+        wakeWorkers.notify_one();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    wakeWorkers.notify_all();
+
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+
+    return hr;
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::CreateDDSTexturesFromFiles(
+    ID3D11Device* d3dDevice,
+    const wchar_t* const* fileNames,
+    size_t count,
+    const DDSBatchOptions& options,
+    ID3D11Resource** textures,
+    ID3D11ShaderResourceView** textureViews,
+    HRESULT* results,
+    DDS_ALPHA_MODE* alphaModes) noexcept
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (textures)
+        {
+            textures[i] = nullptr;
+        }
+        if (textureViews)
+        {
+            textureViews[i] = nullptr;
+        }
+        if (results)
+        {
+            results[i] = E_ABORT;
+        }
+        if (alphaModes)
+        {
+            alphaModes[i] = DDS_ALPHA_MODE_UNKNOWN;
+        }
+    }
+
+    if (!d3dDevice || (count && !fileNames) || (!textures && !textureViews))
+    {
+        return E_INVALIDARG;
+    }
+
+    if (textureViews && !(options.bindFlags & D3D11_BIND_SHADER_RESOURCE))
+    {
+        return E_INVALIDARG;
+    }
+
+    // The upload stage: create each resource from the laid out subresources
+    auto upload = [&](const DDSBatchTexture& item) noexcept -> HRESULT
+    {
+        ID3D11Resource** texture = textures ? &textures[item.index] : nullptr;
+        ID3D11ShaderResourceView** textureView = textureViews ? &textureViews[item.index] : nullptr;
+
+        HRESULT hr = CreateD3DResources(d3dDevice,
+            item.resDim, item.width, item.height, item.depth, item.mipCount, item.arraySize,
+            item.format,
+            options.usage, options.bindFlags, options.cpuAccessFlags, options.miscFlags,
+            options.forceSRGB,
+            item.isCubeMap,
+            const_cast<D3D11_SUBRESOURCE_DATA*>(item.initData),
+            texture, textureView);
+
+        if (FAILED(hr) && !options.maxsize && (item.mipCount > 1))
+        {
+            // Let the single file path retry with a maxsize for the feature level
+            const DDS_HEADER* header = nullptr;
+            const uint8_t* bitData = nullptr;
+            size_t bitSize = 0;
+            hr = LoadTextureDataFromMemory(item.ddsData, item.ddsDataSize, &header, &bitData, &bitSize);
+            if (SUCCEEDED(hr))
+            {
+                hr = CreateTextureFromDDS(d3dDevice, nullptr,
+                    header, bitData, bitSize,
+                    options.maxsize,
+                    options.usage, options.bindFlags, options.cpuAccessFlags, options.miscFlags,
+                    options.forceSRGB,
+                    texture, textureView);
+            }
+        }
+
+        if (SUCCEEDED(hr))
+        {
+            SetDebugTextureInfo(fileNames[item.index], texture, textureView);
+
+            if (alphaModes)
+                alphaModes[item.index] = item.alphaMode;
+        }
+
+        return hr;
+    };
+
+    try
+    {
+        return LoadDDSTexturesFromFiles(fileNames, count, options, DDSBatchSink(upload), results);
+    }
+    catch (...)
+    {
+        return E_OUTOFMEMORY;
+    }
+}
+
+
+//======================================================================================
+// CPU mip generation
+//======================================================================================
+
+namespace
+{
+    // Texel layout of the formats the generator filters: 8-bit UNORM channels, the
+    // first three of them sRGB encoded when srgb is set (alpha is always linear)
+    struct MipFormat
+    {
+        size_t  channels;
+        bool    srgb;
+    };
+
+    bool GetMipFormat(_In_ DXGI_FORMAT format, _In_ bool srgb, _Out_ MipFormat& mipFormat) noexcept
+    {
+        switch (format)
+        {
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+        case DXGI_FORMAT_B8G8R8A8_UNORM:
+        case DXGI_FORMAT_B8G8R8X8_UNORM:
+            mipFormat = { 4, srgb };
+            return true;
+
+        case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+        case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+        case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+            mipFormat = { 4, true };
+            return true;
+
+        case DXGI_FORMAT_R8G8_UNORM:
+            mipFormat = { 2, false };
+            return true;
+
+        case DXGI_FORMAT_R8_UNORM:
+        case DXGI_FORMAT_A8_UNORM:
+            mipFormat = { 1, false };
+            return true;
+
+        default:
+            mipFormat = {};
+            return false;
+        }
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Conversions between 8-bit texels and linear floats, and the Kaiser taps
+    //--------------------------------------------------------------------------------------
+    constexpr size_t MIP_KAISER_TAPS = 8;
+    constexpr size_t MIP_BAND_ROWS = 16;
+
+    struct MipTables
+    {
+        float   toLinear[2][256];       // [srgb][code]
+        uint8_t fromLinear[65536];      // sRGB code of a linear value, in 1/65535 steps
+        float   kaiser[MIP_KAISER_TAPS];
+
+        MipTables() noexcept
+        {
+            for (size_t i = 0; i < 256; ++i)
+            {
+                const float v = float(i) / 255.0f;
+                toLinear[0][i] = v;
+                toLinear[1][i] = (v <= 0.04045f) ? v / 12.92f : powf((v + 0.055f) / 1.055f, 2.4f);
+            }
+            for (size_t i = 0; i < 65536; ++i)
+            {
+                const float v = float(i) / 65535.0f;
+                const float s = (v <= 0.0031308f) ? v * 12.92f : 1.055f * powf(v, 1.0f / 2.4f) - 0.055f;
+                fromLinear[i] = static_cast<uint8_t>(s * 255.0f + 0.5f);
+            }
+
+            // Windowed sinc for a 2:1 reduction: taps sit at source texel centres -3.5 .. 3.5
+            // around the destination centre, with a Kaiser window (alpha 4) over +/-4 texels
+            const float pi = 3.14159265358979f;
+            const float beta = 4.0f;
+            float sum = 0.0f;
+            for (size_t k = 0; k < MIP_KAISER_TAPS; ++k)
+            {
+                const float t = float(k) - 3.5f;
+                const float x = pi * t * 0.5f;
+                const float r = t / 4.0f;
+                kaiser[k] = (sinf(x) / x) * BesselI0(beta * sqrtf(1.0f - r * r)) / BesselI0(beta);
+                sum += kaiser[k];
+            }
+            for (size_t k = 0; k < MIP_KAISER_TAPS; ++k)
+            {
+                kaiser[k] /= sum;
+            }
+        }
+
+        static float BesselI0(float x) noexcept
+        {
+            float sum = 1.0f;
+            float term = 1.0f;
+            for (int k = 1; k < 20; ++k)
+            {
+                term *= (x * 0.5f / float(k)) * (x * 0.5f / float(k));
+                sum += term;
+            }
+            return sum;
+        }
+    };
+
+    const MipTables& GetMipTables() noexcept
+    {
+        static const MipTables tables;
+        return tables;
+    }
+
+    // Rows are held as four floats per texel whatever the channel count, so the filters
+    // below work on whole texels (one SSE register each)
+    void DecodeMipRow(
+        _In_reads_(width * mipFormat.channels) const uint8_t* src,
+        size_t width,
+        const MipFormat& mipFormat,
+        const MipTables& tables,
+        _Out_writes_(width * 4) float* out) noexcept
+    {
+        const float* color = tables.toLinear[mipFormat.srgb ? 1 : 0];
+        const float* alpha = tables.toLinear[0];
+        for (size_t x = 0; x < width; ++x, src += mipFormat.channels, out += 4)
+        {
+            for (size_t c = 0; c < 4; ++c)
+            {
+                out[c] = (c >= mipFormat.channels) ? 0.0f : ((c < 3) ? color[src[c]] : alpha[src[c]]);
+            }
+        }
+    }
+
+    void EncodeMipRow(
+        _In_reads_(width * 4) const float* in,
+        size_t width,
+        const MipFormat& mipFormat,
+        const MipTables& tables,
+        _Out_writes_(width * mipFormat.channels) uint8_t* dst) noexcept
+    {
+#ifdef DDS_SSE2
+        if (mipFormat.channels == 4 && !mipFormat.srgb)
+        {
+            // Same v * 255 + 0.5 then truncate as the scalar loop below, so
+            // the output doesn't depend on which path a pixel took
+            const __m128 scale = _mm_set1_ps(255.0f);
+            const __m128 half = _mm_set1_ps(0.5f);
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 one = _mm_set1_ps(1.0f);
+            size_t x = 0;
+            for (; x + 4 <= width; x += 4, in += 16, dst += 16)
+            {
+                __m128i q[4];
+                for (size_t k = 0; k < 4; ++k)
+                {
+                    const __m128 v = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + k * 4), zero), one);
+                    q[k] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, scale), half));
+                }
+                const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(q[0], q[1]), _mm_packs_epi32(q[2], q[3]));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), packed);
+            }
+            width -= x;
+        }
+#endif
+        for (size_t x = 0; x < width; ++x, in += 4, dst += mipFormat.channels)
+        {
+            for (size_t c = 0; c < mipFormat.channels; ++c)
+            {
+                const float v = std::min(std::max(in[c], 0.0f), 1.0f);
+                dst[c] = (c < 3 && mipFormat.srgb)
+                    ? tables.fromLinear[static_cast<size_t>(v * 65535.0f + 0.5f)]
+                    : static_cast<uint8_t>(v * 255.0f + 0.5f);
+            }
+        }
+    }
+
+    // acc = a * wa, or acc += a * wa when accumulating, four floats at a time
+    inline void MipMulAdd(float* acc, const float* a, float wa, bool accumulate) noexcept
+    {
+#ifdef DDS_SSE2
+        __m128 v = _mm_mul_ps(_mm_loadu_ps(a), _mm_set1_ps(wa));
+        if (accumulate)
+        {
+            v = _mm_add_ps(v, _mm_loadu_ps(acc));
+        }
+        _mm_storeu_ps(acc, v);
+#else
+        for (size_t c = 0; c < 4; ++c)
+        {
+            acc[c] = (accumulate ? acc[c] : 0.0f) + a[c] * wa;
+        }
+#endif
+    }
+
+    //--------------------------------------------------------------------------------------
+    // One band of destination rows [y0, y1) of a level from the level above it
+    //--------------------------------------------------------------------------------------
+    struct MipLevel
+    {
+        const uint8_t*  src;
+        uint8_t*        dst;
+        size_t          srcWidth;
+        size_t          srcHeight;
+        size_t          width;
+        size_t          height;
+    };
+
+    void FilterMipBand(
+        const MipLevel& level,
+        const MipFormat& mipFormat,
+        DDS_MIP_FILTER filter,
+        size_t y0,
+        size_t y1,
+        _Inout_ float* scratch) noexcept
+    {
+        const MipTables& tables = GetMipTables();
+        const size_t srcPitch = level.srcWidth * mipFormat.channels;
+        const size_t dstPitch = level.width * mipFormat.channels;
+        const size_t lastX = level.srcWidth - 1;
+        const size_t lastY = level.srcHeight - 1;
+
+        if (filter == DDS_MIP_FILTER_KAISER)
+        {
+            // Horizontal pass over every source row the band touches, then vertical
+            const ptrdiff_t first = std::max<ptrdiff_t>(ptrdiff_t(y0 * 2) - 3, 0);
+            const ptrdiff_t last = std::min<ptrdiff_t>(ptrdiff_t(y1 * 2) + 2, ptrdiff_t(lastY));
+            float* decoded = scratch;
+            float* rows = scratch + level.srcWidth * 4;
+            float* out = rows + size_t(last - first + 1) * level.width * 4;
+            for (ptrdiff_t sy = first; sy <= last; ++sy)
+            {
+                DecodeMipRow(level.src + size_t(sy) * srcPitch, level.srcWidth, mipFormat, tables, decoded);
+                float* row = rows + size_t(sy - first) * level.width * 4;
+                for (size_t x = 0; x < level.width; ++x)
+                {
+                    for (size_t k = 0; k < MIP_KAISER_TAPS; ++k)
+                    {
+                        const ptrdiff_t sx = std::min<ptrdiff_t>(std::max<ptrdiff_t>(ptrdiff_t(x * 2 + k) - 3, 0), ptrdiff_t(lastX));
+                        MipMulAdd(row + x * 4, decoded + size_t(sx) * 4, tables.kaiser[k], k > 0);
+                    }
+                }
+            }
+            for (size_t y = y0; y < y1; ++y)
+            {
+                for (size_t k = 0; k < MIP_KAISER_TAPS; ++k)
+                {
+                    const ptrdiff_t sy = std::min<ptrdiff_t>(std::max<ptrdiff_t>(ptrdiff_t(y * 2 + k) - 3, 0), ptrdiff_t(lastY));
+                    const float* row = rows + size_t(sy - first) * level.width * 4;
+                    for (size_t x = 0; x < level.width; ++x)
+                    {
+                        MipMulAdd(out + x * 4, row + x * 4, tables.kaiser[k], k > 0);
+                    }
+                }
+                EncodeMipRow(out, level.width, mipFormat, tables, level.dst + y * dstPitch);
+            }
+        }
+        else if (mipFormat.channels == 4 && !mipFormat.srgb)
+        {
+            // Linear 2x2 box straight on the bytes: (a + b + c + d + 2) / 4 per channel
+            for (size_t y = y0; y < y1; ++y)
+            {
+                const uint8_t* top = level.src + std::min(y * 2, lastY) * srcPitch;
+                const uint8_t* bottom = level.src + std::min(y * 2 + 1, lastY) * srcPitch;
+                uint8_t* dst = level.dst + y * dstPitch;
+                size_t x = 0;
+#ifdef DDS_SSE2
+                const __m128i zero = _mm_setzero_si128();
+                const __m128i two = _mm_set1_epi16(2);
+                for (; x + 2 <= level.width && x * 2 + 4 <= level.srcWidth; x += 2)
+                {
+                    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(top + x * 8));
+                    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bottom + x * 8));
+                    const __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+                    const __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+                    __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+                    sum = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+                    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + x * 4), _mm_packus_epi16(sum, sum));
+                }
+#endif
+                for (; x < level.width; ++x)
+                {
+                    const size_t x0 = std::min(x * 2, lastX) * 4;
+                    const size_t x1 = std::min(x * 2 + 1, lastX) * 4;
+                    for (size_t c = 0; c < 4; ++c)
+                    {
+                        dst[x * 4 + c] = static_cast<uint8_t>((top[x0 + c] + top[x1 + c] + bottom[x0 + c] + bottom[x1 + c] + 2) >> 2);
+                    }
+                }
+            }
+        }
+        else
+        {
+            // 2x2 box in linear light; odd sizes repeat the last row or column
+            float* top = scratch;
+            float* bottom = top + level.srcWidth * 4;
+            float* out = bottom + level.srcWidth * 4;
+            for (size_t y = y0; y < y1; ++y)
+            {
+                DecodeMipRow(level.src + std::min(y * 2, lastY) * srcPitch, level.srcWidth, mipFormat, tables, top);
+                DecodeMipRow(level.src + std::min(y * 2 + 1, lastY) * srcPitch, level.srcWidth, mipFormat, tables, bottom);
+                for (size_t x = 0; x < level.width; ++x)
+                {
+                    const size_t x0 = std::min(x * 2, lastX) * 4;
+                    const size_t x1 = std::min(x * 2 + 1, lastX) * 4;
+                    MipMulAdd(out + x * 4, top + x0, 0.25f, false);
+                    MipMulAdd(out + x * 4, top + x1, 0.25f, true);
+                    MipMulAdd(out + x * 4, bottom + x0, 0.25f, true);
+                    MipMulAdd(out + x * 4, bottom + x1, 0.25f, true);
+                }
+                EncodeMipRow(out, level.width, mipFormat, tables, level.dst + y * dstPitch);
+            }
+        }
+    }
+
+    // Runs job(index, scratch) for every index on up to threadCount threads (the calling
+    // thread included), each with its own scratch of scratchFloats floats. Returns false
+    // if some jobs never ran because no scratch could be allocated.
+    template<typename Job>
+    bool RunMipJobs(size_t jobCount, size_t threadCount, size_t scratchFloats, const Job& job) noexcept
+    {
+        std::atomic<size_t> next(0);
+        std::atomic<size_t> done(0);
+        auto worker = [&]() noexcept
+        {
+            std::unique_ptr<float[]> scratch(new (std::nothrow) float[scratchFloats]);
+            if (!scratch)
+                return;
+            for (size_t i = next++; i < jobCount; i = next++)
+            {
+                job(i, scratch.get());
+                ++done;
+            }
+        };
+
+        std::vector<std::thread> threads;
+        try
+        {
+            const size_t extra = std::min(threadCount, jobCount);
+            threads.reserve(extra);
+            for (size_t t = 1; t < extra; ++t)
+            {
+                threads.emplace_back(worker);
+            }
+        }
+        catch (...)
+        {
+            // Fewer threads is fine; the calling thread drains the rest
+        }
+
+        worker();
+        for (auto& t : threads)
+        {
+            t.join();
+        }
+        return done.load() == jobCount;
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Builds the full chain of every slice in FillInitData layout (all levels of slice 0,
+    // then slice 1, ...) from top levels stored back to back in bitData
+    //--------------------------------------------------------------------------------------
+    HRESULT GenerateMipChain(
+        const TextureInfo& info,
+        const MipFormat& mipFormat,
+        DDS_MIP_FILTER filter,
+        size_t threadCount,
+        _In_reads_bytes_(bitSize) const uint8_t* bitData,
+        size_t bitSize,
+        std::unique_ptr<uint8_t[]>& chain,
+        _Out_ size_t& chainSize,
+        _Out_ size_t& mipCount) noexcept
+    {
+        chainSize = 0;
+        mipCount = 1;
+        for (size_t size = std::max(info.width, info.height); size > 1; size >>= 1)
+        {
+            ++mipCount;
+        }
+
+        size_t offsets[D3D11_REQ_MIP_LEVELS + 1] = {};
+        for (size_t i = 0; i < mipCount; ++i)
+        {
+            const size_t w = std::max<size_t>(info.width >> i, 1u);
+            const size_t h = std::max<size_t>(info.height >> i, 1u);
+            offsets[i + 1] = offsets[i] + w * h * mipFormat.channels;
+        }
+        const size_t sliceSize = offsets[mipCount];
+        const size_t topSize = offsets[1];
+        if (topSize * info.arraySize > bitSize)
+        {
+            return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+        }
+
+        chainSize = sliceSize * info.arraySize;
+        chain.reset(new (std::nothrow) uint8_t[chainSize]);
+        if (!chain)
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        if (!threadCount)
+        {
+            threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+        }
+
+        for (size_t j = 0; j < info.arraySize; ++j)
+        {
+            memcpy(chain.get() + j * sliceSize, bitData + j * topSize, topSize);
+        }
+
+        // Levels depend on the one above, so they run in order; within a level every
+        // slice and band of rows is an independent job
+        const size_t kaiserRows = 2 * MIP_BAND_ROWS + MIP_KAISER_TAPS;
+        const size_t scratchFloats = (info.width + kaiserRows * (info.width / 2 + 1) + info.width) * 4;
+        for (size_t i = 1; i < mipCount; ++i)
+        {
+            MipLevel level = {};
+            level.srcWidth = std::max<size_t>(info.width >> (i - 1), 1u);
+            level.srcHeight = std::max<size_t>(info.height >> (i - 1), 1u);
+            level.width = std::max<size_t>(info.width >> i, 1u);
+            level.height = std::max<size_t>(info.height >> i, 1u);
+            const size_t bands = (level.height + MIP_BAND_ROWS - 1) / MIP_BAND_ROWS;
+            const size_t prevOffset = offsets[i - 1];
+            const size_t offset = offsets[i];
+
+            const bool ok = RunMipJobs(bands * info.arraySize, threadCount, scratchFloats,
+                [&](size_t job, float* scratch) noexcept
+                {
+                    const size_t slice = job / bands;
+                    const size_t band = job % bands;
+                    MipLevel sliceLevel = level;
+                    sliceLevel.src = chain.get() + slice * sliceSize + prevOffset;
+                    sliceLevel.dst = chain.get() + slice * sliceSize + offset;
+                    FilterMipBand(sliceLevel, mipFormat, filter,
+                        band * MIP_BAND_ROWS, std::min((band + 1) * MIP_BAND_ROWS, level.height),
+                        scratch);
+                });
+            if (!ok)
+            {
+                chain.reset();
+                return E_OUTOFMEMORY;
+            }
+        }
+
+        return S_OK;
+    }
+
+    //--------------------------------------------------------------------------------------
+    HRESULT CreateTextureWithMips(
+        _In_ ID3D11Device* d3dDevice,
+        _In_ const DDS_HEADER* header,
+        _In_reads_bytes_(bitSize) const uint8_t* bitData,
+        _In_ size_t bitSize,
+        _In_ size_t maxsize,
+        _In_ const DDSMipOptions& options,
+        _Outptr_opt_ ID3D11Resource** texture,
+        _Outptr_opt_ ID3D11ShaderResourceView** textureView) noexcept
+    {
+        // Legacy formats expand to ones the generator filters
+        LegacyImage legacy;
+        HRESULT hr = S_OK;
+        if (ConvertLegacyImage(header, bitData, bitSize, legacy, hr))
+        {
+            if (FAILED(hr))
+            {
+                return hr;
+            }
+
+            header = &legacy.header;
+            bitData = legacy.bits.get();
+            bitSize = legacy.bitSize;
+        }
+
+        TextureInfo info;
+        hr = GetTextureInfo(header, info);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        MipFormat mipFormat;
+        if (info.mipCount > 1
+            || info.resDim == D3D11_RESOURCE_DIMENSION_TEXTURE3D
+            || (info.width == 1 && info.height == 1)
+            || !GetMipFormat(info.format, options.forceSRGB || options.srgbFilter, mipFormat))
+        {
+            // Nothing to generate, or a format the generator doesn't filter: load as it is
+            return CreateTextureFromDDS(d3dDevice, nullptr,
+                header, bitData, bitSize,
+                maxsize,
+                D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0,
+                options.forceSRGB,
+                texture, textureView);
+        }
+
+        std::unique_ptr<uint8_t[]> chain;
+        size_t chainSize = 0;
+        size_t mipCount = 0;
+        hr = GenerateMipChain(info, mipFormat, options.filter, options.threads,
+            bitData, bitSize,
+            chain, chainSize, mipCount);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        // The regular path lays the chain out with FillInitData; it only needs the header
+        // to declare the levels
+        struct
+        {
+            DDS_HEADER          header;
+            DDS_HEADER_DXT10    ext;
+        } chainHeader = {};
+        memcpy(&chainHeader.header, header, sizeof(DDS_HEADER));
+        if ((header->ddspf.flags & DDS_FOURCC) &&
+            (MAKEFOURCC('D', 'X', '1', '0') == header->ddspf.fourCC))
+        {
+            memcpy(&chainHeader.ext, reinterpret_cast<const uint8_t*>(header) + sizeof(DDS_HEADER), sizeof(DDS_HEADER_DXT10));
+        }
+        chainHeader.header.mipMapCount = static_cast<uint32_t>(mipCount);
+
+        return CreateTextureFromDDS(d3dDevice, nullptr,
+            &chainHeader.header, chain.get(), chainSize,
+            maxsize,
+            D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0,
+            options.forceSRGB,
+            texture, textureView);
+    }
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::CreateDDSTextureFromMemoryWithMips(
+    ID3D11Device* d3dDevice,
+    const uint8_t* ddsData,
+    size_t ddsDataSize,
+    const DDSMipOptions& options,
+    ID3D11Resource** texture,
+    ID3D11ShaderResourceView** textureView,
+    size_t maxsize,
+    DDS_ALPHA_MODE* alphaMode) noexcept
+{
+    if (texture)
+    {
+        *texture = nullptr;
+    }
+    if (textureView)
+    {
+        *textureView = nullptr;
+    }
+    if (alphaMode)
+    {
+        *alphaMode = DDS_ALPHA_MODE_UNKNOWN;
+    }
+
+    if (!d3dDevice || !ddsData || (!texture && !textureView))
+    {
+        return E_INVALIDARG;
+    }
+
+    const DDS_HEADER* header = nullptr;
+    const uint8_t* bitData = nullptr;
+    size_t bitSize = 0;
+
+    HRESULT hr = LoadTextureDataFromMemory(ddsData, ddsDataSize,
+        &header,
+        &bitData,
+        &bitSize
+    );
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    hr = CreateTextureWithMips(d3dDevice, header, bitData, bitSize, maxsize, options, texture, textureView);
+    if (SUCCEEDED(hr))
+    {
+        if (texture && *texture)
+        {
+            SetDebugObjectName(*texture, "DDSTextureLoader");
+        }
+
+        if (textureView && *textureView)
+        {
+            SetDebugObjectName(*textureView, "DDSTextureLoader");
+        }
+
+        if (alphaMode)
+            *alphaMode = GetAlphaMode(header);
+    }
+
+    return hr;
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::CreateDDSTextureFromFileWithMips(
+    ID3D11Device* d3dDevice,
+    const wchar_t* fileName,
+    const DDSMipOptions& options,
+    ID3D11Resource** texture,
+    ID3D11ShaderResourceView** textureView,
+    size_t maxsize,
+    DDS_ALPHA_MODE* alphaMode) noexcept
+{
+    if (texture)
+    {
+        *texture = nullptr;
+    }
+    if (textureView)
+    {
+        *textureView = nullptr;
+    }
+    if (alphaMode)
+    {
+        *alphaMode = DDS_ALPHA_MODE_UNKNOWN;
+    }
+
+    if (!d3dDevice || !fileName || (!texture && !textureView))
+    {
+        return E_INVALIDARG;
+    }
+
+    const DDS_HEADER* header = nullptr;
+    const uint8_t* bitData = nullptr;
+    size_t bitSize = 0;
+
+    MappedFileView ddsData;
+    HRESULT hr = LoadTextureDataFromFile(fileName,
+        ddsData,
+        &header,
+        &bitData,
+        &bitSize
+    );
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    hr = CreateTextureWithMips(d3dDevice, header, bitData, bitSize, maxsize, options, texture, textureView);
+    if (SUCCEEDED(hr))
+    {
+        SetDebugTextureInfo(fileName, texture, textureView);
+
+        if (alphaMode)
+            *alphaMode = GetAlphaMode(header);
+    }
+
+    return hr;
+}
+
+
+//======================================================================================
+// Progressive mip streaming
+//======================================================================================
+
+class DDSTextureStreamer::Impl
+{
+public:
+    struct Stream
+    {
+        MappedFileView                              file;
+        ID3D11Resource*                             texture;
+        std::unique_ptr<D3D11_SUBRESOURCE_DATA[]>   initData;
+        size_t                                      mipCount;
+        size_t                                      arraySize;
+        size_t                                      depth;
+        uint32_t                                    residentMip;    // finest level uploaded; all coarser ones are too
+        uint32_t                                    minMip;         // finest level the renderer asked for
+        float                                       priority;
+        uint32_t                                    id;
+        bool                                        loading;        // an I/O thread is reading residentMip - 1
+        bool                                        ready;          // residentMip - 1 is read and waits for Update
+        bool                                        released;
+
+        Stream() noexcept :
+            texture(nullptr),
+            mipCount(0),
+            arraySize(0),
+            depth(0),
+            residentMip(0),
+            minMip(0),
+            priority(0.f),
+            id(0),
+            loading(false),
+            ready(false),
+            released(false)
+        {
+        }
+
+        ~Stream()
+        {
+            if (texture)
+            {
+                texture->Release();
+            }
+        }
+
+        Stream(const Stream&) = delete;
+        Stream& operator=(const Stream&) = delete;
+
+        bool Wants() const noexcept
+        {
+            return !loading && !ready && !released && residentMip > minMip;
+        }
+
+        // Bytes of one level across all array slices
+        size_t LevelSize(size_t mip) const noexcept
+        {
+            size_t d = std::max<size_t>(depth >> mip, 1u);
+            return size_t(initData[mip].SysMemSlicePitch) * d * arraySize;
+        }
+    };
+
+    Impl(_In_ ID3D11Device* d3dDevice, size_t ioThreads, DDSStreamReader reader) :
+        mDevice(d3dDevice),
+        mReader(reader ? std::move(reader) : DDSStreamReader(TouchLevel)),
+        mStop(false)
+    {
+        if (!d3dDevice)
+        {
+            throw std::invalid_argument("DDSTextureStreamer");
+        }
+
+        mDevice->AddRef();
+
+        ioThreads = std::max<size_t>(ioThreads, 1u);
+        for (size_t i = 0; i < ioThreads; ++i)
+        {
+            mThreads.emplace_back([this]() { IOThread(); });
+        }
+    }
+
+    ~Impl()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStop = true;
+        }
+        mWake.notify_all();
+
+        for (auto& t : mThreads)
+        {
+            t.join();
+        }
+
+        mStreams.clear();
+        mDevice->Release();
+    }
+
+    Impl(const Impl&) = delete;
+    Impl& operator=(const Impl&) = delete;
+
+    HRESULT CreateTexture(
+        _In_ ID3D11DeviceContext* d3dContext,
+        _In_z_ const wchar_t* fileName,
+        _In_ size_t tailSize,
+        _In_ bool forceSRGB,
+        _Outptr_opt_ ID3D11Resource** texture,
+        _Outptr_opt_ ID3D11ShaderResourceView** textureView,
+        _Out_ uint32_t* streamId,
+        _Out_opt_ DDS_ALPHA_MODE* alphaMode) noexcept
+    {
+        std::unique_ptr<Stream> stream(new (std::nothrow) Stream);
+        if (!stream)
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        const DDS_HEADER* header = nullptr;
+        const uint8_t* bitData = nullptr;
+        size_t bitSize = 0;
+
+        HRESULT hr = LoadTextureDataFromFile(fileName,
+            stream->file,
+            &header,
+            &bitData,
+            &bitSize
+        );
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        TextureInfo info;
+        hr = GetTextureInfo(header, info);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        stream->initData.reset(new (std::nothrow) D3D11_SUBRESOURCE_DATA[info.mipCount * info.arraySize]);
+        if (!stream->initData)
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        size_t skipMip = 0;
+        size_t twidth = 0;
+        size_t theight = 0;
+        size_t tdepth = 0;
+        hr = FillInitData(info.width, info.height, info.depth, info.mipCount, info.arraySize,
+            info.format, 0, bitSize, bitData,
+            twidth, theight, tdepth, skipMip, stream->initData.get());
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        // The levels are filled in below and by Update, so the texture starts out empty
+        ID3D11Resource* tex = nullptr;
+        hr = CreateD3DResources(mDevice,
+            info.resDim, info.width, info.height, info.depth, info.mipCount, info.arraySize,
+            info.format,
+            D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0,
+            forceSRGB,
+            info.isCubeMap,
+            nullptr,
+            &tex, textureView);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        stream->texture = tex;
+        stream->mipCount = info.mipCount;
+        stream->arraySize = info.arraySize;
+        stream->depth = info.depth;
+
+        // The tail starts at the first level whose every dimension is within tailSize
+        size_t tailMip = info.mipCount - 1;
+        while (tailMip > 0)
+        {
+            size_t w = std::max<size_t>(info.width >> (tailMip - 1), 1u);
+            size_t h = std::max<size_t>(info.height >> (tailMip - 1), 1u);
+            size_t d = std::max<size_t>(info.depth >> (tailMip - 1), 1u);
+            if (w > tailSize || h > tailSize || d > tailSize)
+                break;
+            --tailMip;
+        }
+
+        for (size_t mip = info.mipCount; mip-- > tailMip; )
+        {
+            UploadLevel(d3dContext, *stream, mip);
+        }
+        stream->residentMip = static_cast<uint32_t>(tailMip);
+        d3dContext->SetResourceMinLOD(tex, float(tailMip));
+
+        if (texture)
+        {
+            tex->AddRef();
+            *texture = tex;
+        }
+
+        if (alphaMode)
+        {
+            *alphaMode = GetAlphaMode(header);
+        }
+
+        SetDebugTextureInfo(fileName, texture, textureView);
+
+        if (!tailMip)
+        {
+            // Everything fit in the tail
+            *streamId = 0;
+            return S_OK;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            size_t slot = 0;
+            while (slot < mStreams.size() && mStreams[slot])
+            {
+                ++slot;
+            }
+
+            if (slot == mStreams.size())
+            {
+                mStreams.emplace_back();
+            }
+
+            stream->id = static_cast<uint32_t>(slot + 1);
+            mStreams[slot] = std::move(stream);
+            *streamId = static_cast<uint32_t>(slot + 1);
+        }
+        mWake.notify_one();
+
+        return S_OK;
+    }
+
+    void SetPriority(uint32_t streamId, float priority, uint32_t minMip) noexcept
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            Stream* stream = Find(streamId);
+            if (!stream)
+                return;
+
+            stream->priority = priority;
+            stream->minMip = minMip;
+        }
+        mWake.notify_all();
+    }
+
+    size_t Update(_In_ ID3D11DeviceContext* d3dContext, size_t maxBytes) noexcept
+    {
+        // Pick up the finished reads, highest priority first
+        std::vector<Stream*> ready;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            for (auto& s : mStreams)
+            {
+                if (s && s->ready)
+                {
+                    ready.push_back(s.get());
+                }
+            }
+
+            std::sort(ready.begin(), ready.end(), [](const Stream* a, const Stream* b)
+            {
+                return a->priority > b->priority;
+            });
+        }
+
+        // A ready stream is left alone by the I/O threads, so it can be uploaded unlocked
+        size_t bytes = 0;
+        size_t uploaded = 0;
+        for (Stream* stream : ready)
+        {
+            if (stream->released)
+                continue;
+
+            if (uploaded > 0 && bytes >= maxBytes)
+                break;
+
+            size_t mip = stream->residentMip - 1u;
+            UploadLevel(d3dContext, *stream, mip);
+            d3dContext->SetResourceMinLOD(stream->texture, float(mip));
+            bytes += stream->LevelSize(mip);
+            ++uploaded;
+
+            std::lock_guard<std::mutex> lock(mMutex);
+            stream->residentMip = static_cast<uint32_t>(mip);
+            stream->ready = false;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            for (auto& s : mStreams)
+            {
+                if (s && s->released && !s->loading)
+                {
+                    s.reset();
+                }
+            }
+        }
+        mWake.notify_all();
+
+        return bytes;
+    }
+
+    uint32_t GetResidentMip(uint32_t streamId) const noexcept
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        const Stream* stream = Find(streamId);
+        return stream ? stream->residentMip : 0u;
+    }
+
+    bool IsIdle() const noexcept
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        for (auto& s : mStreams)
+        {
+            if (s && (s->loading || s->ready || s->Wants()))
+                return false;
+        }
+
+        return true;
+    }
+
+    void Release(uint32_t streamId) noexcept
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        Stream* stream = Find(streamId);
+        if (!stream)
+            return;
+
+        if (stream->loading)
+        {
+            // Freed by Update once the I/O thread is done with it
+            stream->released = true;
+        }
+        else
+        {
+            mStreams[streamId - 1].reset();
+        }
+    }
+
+private:
+    ID3D11Device*                           mDevice;
+    DDSStreamReader                         mReader;
+    std::vector<std::unique_ptr<Stream>>    mStreams;
+    std::vector<std::thread>                mThreads;
+    mutable std::mutex                      mMutex;
+    std::condition_variable                 mWake;
+    bool                                    mStop;
+
+    Stream* Find(uint32_t streamId) const noexcept
+    {
+        if (!streamId || streamId > mStreams.size())
+            return nullptr;
+
+        Stream* stream = mStreams[streamId - 1].get();
+        return (stream && !stream->released) ? stream : nullptr;
+    }
+
+    // Highest priority first; between equals, the stream missing the coarser level
+    Stream* Next() const noexcept
+    {
+        Stream* best = nullptr;
+        for (auto& s : mStreams)
+        {
+            if (!s || !s->Wants())
+                continue;
+
+            if (!best
+                || s->priority > best->priority
+                || (s->priority == best->priority && s->residentMip > best->residentMip))
+            {
+                best = s.get();
+            }
+        }
+
+        return best;
+    }
+
+    void IOThread() noexcept
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+
+        for (;;)
+        {
+            Stream* stream = nullptr;
+            mWake.wait(lock, [&]() { return mStop || (stream = Next()) != nullptr; });
+            if (mStop)
+                return;
+
+            stream->loading = true;
+            const DDSStreamRead read = LevelRead(*stream, stream->residentMip - 1u);
+            lock.unlock();
+
+            try
+            {
+                mReader(read);
+            }
+            catch (...)
+            {
+                // The level is still in the mapped file, so Update uploads it regardless
+            }
+
+            lock.lock();
+            stream->loading = false;
+            stream->ready = true;
+        }
+    }
+
+    // Every array slice stores the same chain, so a level sits at a fixed stride from one
+    // slice to the next
+    static DDSStreamRead LevelRead(const Stream& stream, uint32_t mip) noexcept
+    {
+        const D3D11_SUBRESOURCE_DATA& first = stream.initData[mip];
+        DDSStreamRead read = {};
+        read.streamId = stream.id;
+        read.mip = mip;
+        read.data = static_cast<const uint8_t*>(first.pSysMem);
+        read.sliceSize = size_t(first.SysMemSlicePitch) * std::max<size_t>(stream.depth >> mip, 1u);
+        read.sliceCount = stream.arraySize;
+        if (stream.arraySize > 1)
+        {
+            read.sliceStride = size_t(static_cast<const uint8_t*>(stream.initData[stream.mipCount + mip].pSysMem) - read.data);
+        }
+        return read;
+    }
+
+    // The default reader: fault the level's pages in so the upload does not stall on them
+    static void TouchLevel(const DDSStreamRead& read) noexcept
+    {
+        volatile uint8_t sink = 0;
+        for (size_t item = 0; item < read.sliceCount; ++item)
+        {
+            const uint8_t* bits = read.data + item * read.sliceStride;
+            for (size_t offset = 0; offset < read.sliceSize; offset += 4096)
+            {
+                sink = sink + bits[offset];
+            }
+        }
+    }
+
+    static void UploadLevel(_In_ ID3D11DeviceContext* d3dContext, const Stream& stream, size_t mip) noexcept
+    {
+        for (size_t item = 0; item < stream.arraySize; ++item)
+        {
+            const D3D11_SUBRESOURCE_DATA& sub = stream.initData[item * stream.mipCount + mip];
+            UINT res = D3D11CalcSubresource(static_cast<UINT>(mip), static_cast<UINT>(item), static_cast<UINT>(stream.mipCount));
+            d3dContext->UpdateSubresource(stream.texture, res, nullptr, sub.pSysMem, sub.SysMemPitch, sub.SysMemSlicePitch);
+        }
+    }
+};
+
+
+//--------------------------------------------------------------------------------------
+DDSTextureStreamer::DDSTextureStreamer(ID3D11Device* d3dDevice, size_t ioThreads, DDSStreamReader reader) noexcept(false) :
+    pImpl(std::make_unique<Impl>(d3dDevice, ioThreads, std::move(reader)))
+{
+}
+
+DDSTextureStreamer::DDSTextureStreamer(DDSTextureStreamer&&) noexcept = default;
+DDSTextureStreamer& DDSTextureStreamer::operator= (DDSTextureStreamer&&) noexcept = default;
+DDSTextureStreamer::~DDSTextureStreamer() = default;
+
+_Use_decl_annotations_
+HRESULT DDSTextureStreamer::CreateTexture(
+    ID3D11DeviceContext* d3dContext,
+    const wchar_t* fileName,
+    size_t tailSize,
+    bool forceSRGB,
+    ID3D11Resource** texture,
+    ID3D11ShaderResourceView** textureView,
+    uint32_t* streamId,
+    DDS_ALPHA_MODE* alphaMode) noexcept
+{
+    if (texture)
+    {
+        *texture = nullptr;
+    }
+    if (textureView)
+    {
+        *textureView = nullptr;
+    }
+    if (streamId)
+    {
+        *streamId = 0;
+    }
+    if (alphaMode)
+    {
+        *alphaMode = DDS_ALPHA_MODE_UNKNOWN;
+    }
+
+    if (!d3dContext || !fileName || !streamId || (!texture && !textureView))
+    {
+        return E_INVALIDARG;
+    }
+
+    HRESULT hr = pImpl->CreateTexture(d3dContext, fileName, tailSize, forceSRGB, texture, textureView, streamId, alphaMode);
+    if (FAILED(hr) && textureView && *textureView)
+    {
+        (*textureView)->Release();
+        *textureView = nullptr;
+    }
+
+    return hr;
+}
+
+void DDSTextureStreamer::SetPriority(uint32_t streamId, float priority, uint32_t minMip) noexcept
+{
+    pImpl->SetPriority(streamId, priority, minMip);
+}
+
+_Use_decl_annotations_
+size_t DDSTextureStreamer::Update(ID3D11DeviceContext* d3dContext, size_t maxBytes) noexcept
+{
+    if (!d3dContext)
+        return 0;
+
+    return pImpl->Update(d3dContext, maxBytes);
+}
+
+uint32_t DDSTextureStreamer::GetResidentMip(uint32_t streamId) const noexcept
+{
+    return pImpl->GetResidentMip(streamId);
+}
+
+bool DDSTextureStreamer::IsIdle() const noexcept
+{
+    return pImpl->IsIdle();
+}
+
+void DDSTextureStreamer::Release(uint32_t streamId) noexcept
+{
+    pImpl->Release(streamId);
+}
+
+
+//======================================================================================
+// Texture cache
+//======================================================================================
+
+namespace
+{
+    //--------------------------------------------------------------------------------------
+    // Bytes of the levels FillInitData keeps for maxsize, with the size of the finest one
+    //--------------------------------------------------------------------------------------
+    HRESULT GetResidentSize(
+        _In_ const TextureInfo& info,
+        _In_ size_t maxsize,
+        _Out_ size_t& bytes,
+        _Out_ size_t& levels,
+        _Out_ size_t& topSize) noexcept
+    {
+        bytes = 0;
+        levels = 0;
+        topSize = 0;
+
+        size_t w = info.width;
+        size_t h = info.height;
+        size_t d = info.depth;
+        for (size_t i = 0; i < info.mipCount; ++i)
+        {
+            if ((info.mipCount <= 1) || !maxsize || (w <= maxsize && h <= maxsize && d <= maxsize))
+            {
+                size_t numBytes = 0;
+                HRESULT hr = GetSurfaceInfo(w, h, info.format, &numBytes, nullptr, nullptr);
+                if (FAILED(hr))
+                    return hr;
+
+                if (!levels)
+                {
+                    topSize = std::max(std::max(w, h), d);
+                }
+
+                bytes += numBytes * d * info.arraySize;
+                ++levels;
+            }
+
+            w = std::max<size_t>(w >> 1, 1u);
+            h = std::max<size_t>(h >> 1, 1u);
+            d = std::max<size_t>(d >> 1, 1u);
+        }
+
+        return levels ? S_OK : E_FAIL;
+    }
+
+    //--------------------------------------------------------------------------------------
+    // XXH64 (seed 0), fed in pieces as a file streams in. The four independent lanes keep it
+    // at memory speed, so hashing each piece while it is still in cache costs little next to
+    // reading it.
+    //--------------------------------------------------------------------------------------
+    const uint64_t c_xxPrime1 = 11400714785074694791ull;
+    const uint64_t c_xxPrime2 = 14029467366897019727ull;
+    const uint64_t c_xxPrime3 = 1609587929392839161ull;
+    const uint64_t c_xxPrime4 = 9650029242287828579ull;
+    const uint64_t c_xxPrime5 = 2870177450012600261ull;
+
+    // Pieces small enough to hash while they are still in the L2 cache
+    const size_t c_hashChunk = 256 * 1024;
+
+    inline uint64_t RotateLeft(uint64_t v, int bits) noexcept
+    {
+        return (v << bits) | (v >> (64 - bits));
+    }
+
+    inline uint64_t Read64(const uint8_t* p) noexcept
+    {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    inline uint64_t HashRound(uint64_t acc, uint64_t input) noexcept
+    {
+        acc += input * c_xxPrime2;
+        return RotateLeft(acc, 31) * c_xxPrime1;
+    }
+
+    inline uint64_t HashMerge(uint64_t acc, uint64_t lane) noexcept
+    {
+        acc ^= HashRound(0, lane);
+        return acc * c_xxPrime1 + c_xxPrime4;
+    }
+
+    class ContentHasher
+    {
+    public:
+        ContentHasher() noexcept :
+            m_v{ c_xxPrime1 + c_xxPrime2, c_xxPrime2, 0, 0 - c_xxPrime1 },
+            m_stripe{},
+            m_buffered(0),
+            m_total(0)
+        {
+        }
+
+        void Update(_In_reads_bytes_(size) const uint8_t* data, size_t size) noexcept
+        {
+            const uint8_t* p = data;
+            const uint8_t* end = data + size;
+            m_total += size;
+
+            // Finish a stripe left over from the last piece
+            if (m_buffered)
+            {
+                const size_t n = std::min<size_t>(sizeof(m_stripe) - m_buffered, size);
+                memcpy(m_stripe + m_buffered, p, n);
+                m_buffered += n;
+                p += n;
+                if (m_buffered < sizeof(m_stripe))
+                    return;
+
+                Consume(m_stripe);
+                m_buffered = 0;
+            }
+
+            for (; p + 32 <= end; p += 32)
+            {
+                Consume(p);
+            }
+
+            memcpy(m_stripe, p, size_t(end - p));
+            m_buffered = size_t(end - p);
+        }
+
+        uint64_t Digest() const noexcept
+        {
+            uint64_t h;
+            if (m_total >= 32)
+            {
+                h = RotateLeft(m_v[0], 1) + RotateLeft(m_v[1], 7) + RotateLeft(m_v[2], 12) + RotateLeft(m_v[3], 18);
+                h = HashMerge(h, m_v[0]);
+                h = HashMerge(h, m_v[1]);
+                h = HashMerge(h, m_v[2]);
+                h = HashMerge(h, m_v[3]);
+            }
+            else
+            {
+                h = c_xxPrime5;
+            }
+
+            h += m_total;
+
+            const uint8_t* p = m_stripe;
+            const uint8_t* end = m_stripe + m_buffered;
+            for (; p + 8 <= end; p += 8)
+            {
+                h ^= HashRound(0, Read64(p));
+                h = RotateLeft(h, 27) * c_xxPrime1 + c_xxPrime4;
+            }
+
+            if (p + 4 <= end)
+            {
+                uint32_t v;
+                memcpy(&v, p, sizeof(v));
+                h ^= uint64_t(v) * c_xxPrime1;
+                h = RotateLeft(h, 23) * c_xxPrime2 + c_xxPrime3;
+                p += 4;
+            }
+
+            for (; p < end; ++p)
+            {
+                h ^= uint64_t(*p) * c_xxPrime5;
+                h = RotateLeft(h, 11) * c_xxPrime1;
+            }
+
+            h ^= h >> 33;
+            h *= c_xxPrime2;
+            h ^= h >> 29;
+            h *= c_xxPrime3;
+            h ^= h >> 32;
+            return h;
+        }
+
+    private:
+        void Consume(const uint8_t* p) noexcept
+        {
+            m_v[0] = HashRound(m_v[0], Read64(p));
+            m_v[1] = HashRound(m_v[1], Read64(p + 8));
+            m_v[2] = HashRound(m_v[2], Read64(p + 16));
+            m_v[3] = HashRound(m_v[3], Read64(p + 24));
+        }
+
+        uint64_t    m_v[4];
+        uint8_t     m_stripe[32];
+        size_t      m_buffered;
+        uint64_t    m_total;
+    };
+}
+
+
+_Use_decl_annotations_
+uint64_t DirectX::DDSContentHash(const uint8_t* data, size_t size) noexcept
+{
+    ContentHasher hasher;
+    hasher.Update(data, size);
+    return hasher.Digest();
+}
+
+
+class DDSTextureCache::Impl
+{
+public:
+    struct Key
+    {
+        std::wstring    fileName;
+        DDSLoadOptions  options;
+
+        bool operator==(const Key& other) const noexcept
+        {
+            return fileName == other.fileName && SameOptions(options, other.options);
+        }
+    };
+
+    static bool SameOptions(const DDSLoadOptions& a, const DDSLoadOptions& b) noexcept
+    {
+        return a.maxsize == b.maxsize
+            && a.usage == b.usage
+            && a.bindFlags == b.bindFlags
+            && a.cpuAccessFlags == b.cpuAccessFlags
+            && a.miscFlags == b.miscFlags
+            && a.forceSRGB == b.forceSRGB;
+    }
+
+    static size_t HashOptions(size_t h, const DDSLoadOptions& options) noexcept
+    {
+        const size_t fields[] =
+        {
+            options.maxsize,
+            size_t(options.usage),
+            options.bindFlags,
+            options.cpuAccessFlags,
+            options.miscFlags,
+            size_t(options.forceSRGB),
+        };
+        for (size_t f : fields)
+        {
+            h ^= f + 0x9e3779b9u + (h << 6) + (h >> 2);
+        }
+        return h;
+    }
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const noexcept
+        {
+            return HashOptions(std::hash<std::wstring>()(key.fileName), key.options);
+        }
+    };
+
+    // Identifies a file by what it holds; a 64-bit hash collision between two files of the
+    // same size is taken to be impossible
+    struct ContentKey
+    {
+        uint64_t        hash;
+        size_t          size;
+        DDSLoadOptions  options;
+
+        bool operator==(const ContentKey& other) const noexcept
+        {
+            return hash == other.hash && size == other.size && SameOptions(options, other.options);
+        }
+    };
+
+    struct ContentKeyHash
+    {
+        size_t operator()(const ContentKey& key) const noexcept
+        {
+            return HashOptions(size_t(key.hash) ^ key.size, key.options);
+        }
+    };
+
+    struct Texture
+    {
+        ID3D11Resource*             texture;
+        ID3D11ShaderResourceView*   textureView;
+        DDS_ALPHA_MODE              alphaMode;
+        TextureInfo                 info;
+        size_t                      bytes;
+        size_t                      levels;
+        size_t                      topSize;        // largest dimension of the finest level
+
+        Texture() noexcept :
+            texture(nullptr),
+            textureView(nullptr),
+            alphaMode(DDS_ALPHA_MODE_UNKNOWN),
+            info{},
+            bytes(0),
+            levels(0),
+            topSize(0)
+        {
+        }
+
+        void Reset() noexcept
+        {
+            if (textureView)
+            {
+                textureView->Release();
+                textureView = nullptr;
+            }
+            if (texture)
+            {
+                texture->Release();
+                texture = nullptr;
+            }
+        }
+    };
+
+    struct Entry;
+    using EntryPtr = std::shared_ptr<Entry>;
+
+    struct Entry
+    {
+        std::vector<Key>                keys;       // every path with this content; the first one loaded it
+        ContentKey                      content;
+        Texture                         data;
+        std::list<EntryPtr>::iterator   lru;
+        EntryPtr                        alias;      // set instead of data when the content was already cached
+        HRESULT                         hr;
+        bool                            loading;    // first load in flight; data is not set yet
+        bool                            shrinking;  // reloading one level smaller; data stays usable
+        bool                            evicted;
+        bool                            hashed;     // content is in the content index
+
+        Entry() noexcept : content{}, hr(S_OK), loading(true), shrinking(false), evicted(false), hashed(false) {}
+        ~Entry() { data.Reset(); }
+
+        Entry(const Entry&) = delete;
+        Entry& operator=(const Entry&) = delete;
+    };
+
+    Impl(_In_ ID3D11Device* d3dDevice, size_t budgetBytes, DDS_CACHE_EVICTION eviction, bool shareContent) :
+        mDevice(d3dDevice),
+        mEviction(eviction),
+        mShareContent(shareContent),
+        mStats{}
+    {
+        if (!d3dDevice)
+        {
+            throw std::invalid_argument("DDSTextureCache");
+        }
+
+        mDevice->AddRef();
+        mStats.budgetBytes = budgetBytes;
+    }
+
+    ~Impl()
+    {
+        mLru.clear();
+        mContent.clear();
+        mEntries.clear();
+        mDevice->Release();
+    }
+
+    Impl(const Impl&) = delete;
+    Impl& operator=(const Impl&) = delete;
+
+    HRESULT GetTexture(
+        _In_z_ const wchar_t* fileName,
+        _In_ const DDSLoadOptions& options,
+        _Outptr_opt_ ID3D11Resource** texture,
+        _Outptr_opt_ ID3D11ShaderResourceView** textureView,
+        _Out_opt_ DDS_ALPHA_MODE* alphaMode) noexcept
+    {
+        EntryPtr entry;
+        Key key;
+        try
+        {
+            key.fileName = fileName;
+            key.options = options;
+
+            std::unique_lock<std::mutex> lock(mMutex);
+
+            auto it = mEntries.find(key);
+            if (it != mEntries.end())
+            {
+                entry = it->second;
+                ++mStats.hits;
+                if (entry->loading)
+                {
+                    ++mStats.sharedLoads;
+                    mLoaded.wait(lock, [&entry]() { return !entry->loading; });
+                }
+
+                if (entry->alias)
+                {
+                    entry = entry->alias;
+                }
+
+                if (FAILED(entry->hr))
+                {
+                    return entry->hr;
+                }
+
+                if (!entry->evicted)
+                {
+                    mLru.splice(mLru.begin(), mLru, entry->lru);
+                }
+                Output(entry->data, texture, textureView, alphaMode);
+                return S_OK;
+            }
+
+            ++mStats.misses;
+            entry = std::make_shared<Entry>();
+            entry->keys.push_back(key);
+            mEntries.emplace(key, entry);
+        }
+        catch (...)
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        // Hashing the file as it is read lets a copy stored under another path share the
+        // texture already made from it
+        Source source;
+        HRESULT hr = Open(key, source, mShareContent);
+        if (SUCCEEDED(hr) && mShareContent && Share(entry, key, source, texture, textureView, alphaMode))
+        {
+            mLoaded.notify_all();
+            return S_OK;
+        }
+
+        Texture loaded;
+        if (SUCCEEDED(hr))
+        {
+            hr = Create(key, source, options.maxsize, loaded);
+        }
+        source.Reset();
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            entry->loading = false;
+            entry->hr = hr;
+            if (SUCCEEDED(hr))
+            {
+                try
+                {
+                    mLru.push_front(entry);
+                    entry->lru = mLru.begin();
+                    entry->data = loaded;
+                    AddResident(loaded.bytes);
+                    Output(loaded, texture, textureView, alphaMode);
+                }
+                catch (...)
+                {
+                    loaded.Reset();
+                    entry->hr = hr = E_OUTOFMEMORY;
+                }
+            }
+
+            if (FAILED(hr))
+            {
+                mEntries.erase(key);
+                if (entry->hashed)
+                {
+                    mContent.erase(entry->content);
+                    entry->hashed = false;
+                }
+            }
+        }
+        mLoaded.notify_all();
+
+        if (SUCCEEDED(hr))
+        {
+            Trim(entry.get());
+        }
+
+        return hr;
+    }
+
+    void SetBudget(size_t budgetBytes) noexcept
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStats.budgetBytes = budgetBytes;
+        }
+
+        Trim(nullptr);
+    }
+
+    void Clear() noexcept
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        for (auto it = mLru.begin(); it != mLru.end(); )
+        {
+            EntryPtr entry = *it++;
+            if (!entry->shrinking)
+            {
+                Evict(entry);
+            }
+        }
+    }
+
+    DDSTextureCacheStats GetStats() const noexcept
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        DDSTextureCacheStats stats = mStats;
+        stats.textureCount = mLru.size();
+        return stats;
+    }
+
+private:
+    ID3D11Device*                                   mDevice;
+    DDS_CACHE_EVICTION                              mEviction;
+    bool                                            mShareContent;
+    mutable std::mutex                              mMutex;
+    std::condition_variable                         mLoaded;
+    std::unordered_map<Key, EntryPtr, KeyHash>      mEntries;
+    std::unordered_map<ContentKey, EntryPtr, ContentKeyHash> mContent;
+    std::list<EntryPtr>                             mLru;       // loaded entries, most recently used first
+    DDSTextureCacheStats                            mStats;
+
+    // A file to create from: mapped, or read into data when it had to be hashed
+    struct Source
+    {
+        MappedFileView              file;
+        std::unique_ptr<uint8_t[]>  data;
+        size_t                      size;
+        const DDS_HEADER*           header;
+        const uint8_t*              bitData;
+        size_t                      bitSize;
+        uint64_t                    hash;
+
+        Source() noexcept : size(0), header(nullptr), bitData(nullptr), bitSize(0), hash(0) {}
+
+        void Reset() noexcept
+        {
+            file.Reset();
+            data.reset();
+        }
+    };
+
+    HRESULT Open(const Key& key, Source& source, bool hash) noexcept
+    {
+        if (!hash)
+        {
+            HRESULT hr = LoadTextureDataFromFile(key.fileName.c_str(),
+                source.file,
+                &source.header,
+                &source.bitData,
+                &source.bitSize
+            );
+            source.size = source.file.GetSize();
+            return hr;
+        }
+
+        // Read the file a piece at a time and hash each piece as it lands, so the content
+        // is only brought in once instead of being faulted in by one pass and read by another
+        FileReader reader;
+        HRESULT hr = reader.Open(key.fileName.c_str());
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        source.size = reader.GetSize();
+        source.data.reset(new (std::nothrow) uint8_t[std::max<size_t>(source.size, 1u)]);
+        if (!source.data)
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        ContentHasher hasher;
+        for (size_t offset = 0; offset < source.size; offset += c_hashChunk)
+        {
+            const size_t bytes = std::min(c_hashChunk, source.size - offset);
+            hr = reader.Read(offset, source.data.get() + offset, bytes);
+            if (FAILED(hr))
+            {
+                return hr;
+            }
+
+            hasher.Update(source.data.get() + offset, bytes);
+        }
+        source.hash = hasher.Digest();
+
+        return LoadTextureDataFromMemory(source.data.get(), source.size,
+            &source.header,
+            &source.bitData,
+            &source.bitSize
+        );
+    }
+
+    // Resolves entry to a cached texture with the same content and returns true, or
+    // registers entry as the one that loads it and returns false
+    bool Share(
+        const EntryPtr& entry,
+        const Key& key,
+        const Source& source,
+        _Outptr_opt_ ID3D11Resource** texture,
+        _Outptr_opt_ ID3D11ShaderResourceView** textureView,
+        _Out_opt_ DDS_ALPHA_MODE* alphaMode) noexcept
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+
+        ContentKey content = {};
+        content.hash = source.hash;
+        content.size = source.size;
+        content.options = key.options;
+
+        try
+        {
+            for (;;)
+            {
+                auto it = mContent.find(content);
+                if (it == mContent.end())
+                {
+                    mContent.emplace(content, entry);
+                    entry->content = content;
+                    entry->hashed = true;
+                    return false;
+                }
+
+                // Failed and evicted entries leave the index, so the next lookup moves on
+                EntryPtr original = it->second;
+                if (original->loading)
+                {
+                    mLoaded.wait(lock, [&original]() { return !original->loading; });
+                    continue;
+                }
+
+                original->keys.push_back(key);
+                mEntries[key] = original;
+
+                entry->alias = original;
+                entry->loading = false;
+
+                ++mStats.duplicates;
+                mStats.dedupBytes += original->data.bytes;
+
+                mLru.splice(mLru.begin(), mLru, original->lru);
+                Output(original->data, texture, textureView, alphaMode);
+                return true;
+            }
+        }
+        catch (...)
+        {
+            // Without room to index it the texture is simply not shared
+            return false;
+        }
+    }
+
+    HRESULT Create(const Key& key, const Source& source, size_t maxsize, Texture& out) noexcept
+    {
+        const DDS_HEADER* header = source.header;
+        const uint8_t* bitData = source.bitData;
+        size_t bitSize = source.bitSize;
+
+        LegacyImage legacy;
+        HRESULT hr = S_OK;
+        if (ConvertLegacyImage(header, bitData, bitSize, legacy, hr))
+        {
+            if (FAILED(hr))
+            {
+                return hr;
+            }
+
+            header = &legacy.header;
+            bitData = legacy.bits.get();
+            bitSize = legacy.bitSize;
+        }
+
+        hr = GetTextureInfo(header, out.info);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        hr = GetResidentSize(out.info, maxsize, out.bytes, out.levels, out.topSize);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        const bool wantView = (key.options.bindFlags & D3D11_BIND_SHADER_RESOURCE) != 0;
+        hr = CreateTextureFromDDS(mDevice, nullptr,
+            header, bitData, bitSize,
+            maxsize,
+            key.options.usage, key.options.bindFlags, key.options.cpuAccessFlags, key.options.miscFlags,
+            key.options.forceSRGB,
+            &out.texture, wantView ? &out.textureView : nullptr);
+
+        if (FAILED(hr))
+        {
+            out.Reset();
+            return hr;
+        }
+
+        SetDebugTextureInfo(key.fileName.c_str(), &out.texture, wantView ? &out.textureView : nullptr);
+        out.alphaMode = GetAlphaMode(header);
+
+        return S_OK;
+    }
+
+    HRESULT Load(const Key& key, size_t maxsize, Texture& out) noexcept
+    {
+        Source source;
+        HRESULT hr = Open(key, source, false);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        return Create(key, source, maxsize, out);
+    }
+
+    static void Output(
+        const Texture& data,
+        _Outptr_opt_ ID3D11Resource** texture,
+        _Outptr_opt_ ID3D11ShaderResourceView** textureView,
+        _Out_opt_ DDS_ALPHA_MODE* alphaMode) noexcept
+    {
+        if (texture)
+        {
+            data.texture->AddRef();
+            *texture = data.texture;
+        }
+        if (textureView && data.textureView)
+        {
+            data.textureView->AddRef();
+            *textureView = data.textureView;
+        }
+        if (alphaMode)
+        {
+            *alphaMode = data.alphaMode;
+        }
+    }
+
+    void AddResident(size_t bytes) noexcept
+    {
+        mStats.residentBytes += bytes;
+        mStats.peakBytes = std::max(mStats.peakBytes, mStats.residentBytes);
+    }
+
+    void Evict(const EntryPtr& entry) noexcept
+    {
+        mStats.residentBytes -= entry->data.bytes;
+        mStats.dedupBytes -= (entry->keys.size() - 1) * entry->data.bytes;
+        ++mStats.evictions;
+
+        entry->evicted = true;
+        mLru.erase(entry->lru);
+        for (const Key& key : entry->keys)
+        {
+            mEntries.erase(key);
+        }
+        if (entry->hashed)
+        {
+            mContent.erase(entry->content);
+            entry->hashed = false;
+        }
+    }
+
+    // maxsize that drops just enough top levels to free excess bytes, or 0 when only
+    // releasing the texture would
+    static size_t ShrinkTo(const Texture& data, size_t excess) noexcept
+    {
+        size_t maxsize = data.topSize;
+        while (maxsize > 1)
+        {
+            maxsize >>= 1;
+
+            size_t bytes = 0;
+            size_t levels = 0;
+            size_t topSize = 0;
+            if (FAILED(GetResidentSize(data.info, maxsize, bytes, levels, topSize)) || bytes >= data.bytes)
+            {
+                return 0;
+            }
+
+            if (data.bytes - bytes >= excess)
+            {
+                return maxsize;
+            }
+
+            if (levels <= 1)
+            {
+                return 0;
+            }
+
+            maxsize = topSize;
+        }
+
+        return 0;
+    }
+
+    // Brings the resident size back within budget, never evicting keep
+    void Trim(_In_opt_ const Entry* keep) noexcept
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+
+        while (mStats.residentBytes > mStats.budgetBytes)
+        {
+            EntryPtr victim;
+            for (auto it = mLru.rbegin(); it != mLru.rend(); ++it)
+            {
+                if (!(*it)->shrinking && it->get() != keep)
+                {
+                    victim = *it;
+                    break;
+                }
+            }
+
+            if (!victim)
+            {
+                break;
+            }
+
+            size_t maxsize = 0;
+            if (mEviction == DDS_CACHE_EVICT_DROP_MIPS)
+            {
+                maxsize = ShrinkTo(victim->data, mStats.residentBytes - mStats.budgetBytes);
+            }
+
+            if (maxsize)
+            {
+                // The reload reads the file again, so it runs outside the lock; hits keep getting the current texture
+                victim->shrinking = true;
+                Key key;
+                try
+                {
+                    key = victim->keys.front();
+                }
+                catch (...)
+                {
+                    victim->shrinking = false;
+                    Evict(victim);
+                    continue;
+                }
+                lock.unlock();
+
+                Texture smaller;
+                HRESULT hr = Load(key, maxsize, smaller);
+
+                lock.lock();
+                victim->shrinking = false;
+                if (SUCCEEDED(hr) && smaller.bytes < victim->data.bytes)
+                {
+                    const size_t sharers = victim->keys.size() - 1;
+                    mStats.residentBytes -= victim->data.bytes;
+                    mStats.dedupBytes -= sharers * victim->data.bytes;
+                    mStats.dedupBytes += sharers * smaller.bytes;
+                    AddResident(smaller.bytes);
+                    ++mStats.mipDrops;
+
+                    std::swap(victim->data, smaller);
+                    smaller.Reset();
+                    continue;
+                }
+
+                smaller.Reset();
+            }
+
+            Evict(victim);
+        }
+    }
+};
+
+
+//--------------------------------------------------------------------------------------
+//--------------------------------------------------------------------------------------
+DDSTextureCache::DDSTextureCache(ID3D11Device* d3dDevice, size_t budgetBytes, DDS_CACHE_EVICTION eviction, bool shareContent) noexcept(false) :
+    pImpl(std::make_unique<Impl>(d3dDevice, budgetBytes, eviction, shareContent))
+{
+}
+
+DDSTextureCache::DDSTextureCache(DDSTextureCache&&) noexcept = default;
+DDSTextureCache& DDSTextureCache::operator= (DDSTextureCache&&) noexcept = default;
+DDSTextureCache::~DDSTextureCache() = default;
+
+_Use_decl_annotations_
+HRESULT DDSTextureCache::GetTexture(
+    const wchar_t* fileName,
+    const DDSLoadOptions& options,
+    ID3D11Resource** texture,
+    ID3D11ShaderResourceView** textureView,
+    DDS_ALPHA_MODE* alphaMode) noexcept
+{
+    if (texture)
+    {
+        *texture = nullptr;
+    }
+    if (textureView)
+    {
+        *textureView = nullptr;
+    }
+    if (alphaMode)
+    {
+        *alphaMode = DDS_ALPHA_MODE_UNKNOWN;
+    }
+
+    if (!fileName || (!texture && !textureView))
+    {
+        return E_INVALIDARG;
+    }
+
+    if (textureView && !(options.bindFlags & D3D11_BIND_SHADER_RESOURCE))
+    {
+        return E_INVALIDARG;
+    }
+
+    return pImpl->GetTexture(fileName, options, texture, textureView, alphaMode);
+}
+
+void DDSTextureCache::SetBudget(size_t budgetBytes) noexcept
+{
+    pImpl->SetBudget(budgetBytes);
+}
+
+void DDSTextureCache::Clear() noexcept
+{
+    pImpl->Clear();
+}
+
+DDSTextureCacheStats DDSTextureCache::GetStats() const noexcept
+{
+    return pImpl->GetStats();
+}
+
+
+//======================================================================================
+// Budget-driven load sizes
+//======================================================================================
+
+namespace
+{
+    //--------------------------------------------------------------------------------------
+    // Bytes of each level across all array slices, and the largest dimension of each
+    //--------------------------------------------------------------------------------------
+    HRESULT GetLevelSizes(
+        _In_ const TextureInfo& info,
+        _Out_writes_(D3D11_REQ_MIP_LEVELS) size_t* levelBytes,
+        _Out_writes_(D3D11_REQ_MIP_LEVELS) size_t* levelSize) noexcept
+    {
+        size_t w = info.width;
+        size_t h = info.height;
+        size_t d = info.depth;
+        for (size_t i = 0; i < info.mipCount; ++i)
+        {
+            size_t numBytes = 0;
+            HRESULT hr = GetSurfaceInfo(w, h, info.format, &numBytes, nullptr, nullptr);
+            if (FAILED(hr))
+                return hr;
+
+            levelBytes[i] = numBytes * d * info.arraySize;
+            levelSize[i] = std::max(std::max(w, h), d);
+
+            w = std::max<size_t>(w >> 1, 1u);
+            h = std::max<size_t>(h >> 1, 1u);
+            d = std::max<size_t>(d >> 1, 1u);
+        }
+
+        return S_OK;
+    }
+
+    //--------------------------------------------------------------------------------------
+    // First level to keep: the class cap applies first, then levels are dropped while the
+    // rest would not fit in available bytes and the next level still meets minSize
+    //--------------------------------------------------------------------------------------
+    size_t ChooseFirstMip(
+        _In_ const TextureInfo& info,
+        _In_reads_(D3D11_REQ_MIP_LEVELS) const size_t* levelBytes,
+        _In_reads_(D3D11_REQ_MIP_LEVELS) const size_t* levelSize,
+        _In_ const DDSSizeClass& sizeClass,
+        _In_ size_t available) noexcept
+    {
+        if (info.mipCount <= 1)
+        {
+            return 0;
+        }
+
+        size_t remaining = 0;
+        for (size_t i = 0; i < info.mipCount; ++i)
+        {
+            remaining += levelBytes[i];
+        }
+
+        const size_t last = info.mipCount - 1;
+        size_t first = 0;
+        while (first < last && sizeClass.maxSize && levelSize[first] > sizeClass.maxSize)
+        {
+            remaining -= levelBytes[first++];
+        }
+
+        while (first < last && remaining > available && levelSize[first + 1] >= sizeClass.minSize)
+        {
+            remaining -= levelBytes[first++];
+        }
+
+        return first;
+    }
+}
+
+
+class DDSSizePolicy::Impl
+{
+public:
+    Impl(_In_ ID3D11Device* d3dDevice, size_t budgetBytes) :
+        mDevice(d3dDevice),
+        mStats{}
+    {
+        if (!d3dDevice)
+        {
+            throw std::invalid_argument("DDSSizePolicy");
+        }
+
+        mDevice->AddRef();
+        mStats.budgetBytes = budgetBytes;
+    }
+
+    ~Impl()
+    {
+        mDevice->Release();
+    }
+
+    Impl(const Impl&) = delete;
+    Impl& operator=(const Impl&) = delete;
+
+    HRESULT CreateTexture(
+        _In_z_ const wchar_t* fileName,
+        _In_ const DDSSizeClass& sizeClass,
+        _In_ D3D11_USAGE usage,
+        _In_ unsigned int bindFlags,
+        _In_ unsigned int cpuAccessFlags,
+        _In_ unsigned int miscFlags,
+        _In_ bool forceSRGB,
+        _Outptr_opt_ ID3D11Resource** texture,
+        _Outptr_opt_ ID3D11ShaderResourceView** textureView,
+        _Out_ DDSSizeResult& result,
+        _Out_opt_ DDS_ALPHA_MODE* alphaMode) noexcept
+    {
+        FileReader file;
+        HRESULT hr = file.Open(fileName);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        // Header, with the DX10 extension when present; a copy of it describes the levels read
+        uint8_t headerData[sizeof(uint32_t) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10)] = {};
+        const size_t headerRead = std::min(file.GetSize(), sizeof(headerData));
+        hr = file.Read(0, headerData, headerRead);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        const DDS_HEADER* header = nullptr;
+        const uint8_t* bitData = nullptr;
+        size_t bitSize = 0;
+        hr = LoadTextureDataFromMemory(headerData, headerRead, &header, &bitData, &bitSize);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        const size_t dataOffset = size_t(bitData - headerData);
+
+        TextureInfo info;
+        hr = GetTextureInfo(header, info);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        size_t levelBytes[D3D11_REQ_MIP_LEVELS] = {};
+        size_t levelSize[D3D11_REQ_MIP_LEVELS] = {};
+        hr = GetLevelSizes(info, levelBytes, levelSize);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        size_t fileBytes = 0;
+        for (size_t i = 0; i < info.mipCount; ++i)
+        {
+            fileBytes += levelBytes[i];
+        }
+
+        if (fileBytes > file.GetSize() - dataOffset)
+        {
+            return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+        }
+
+        // Choose and reserve under the lock, so concurrent loads see each other's bytes
+        size_t first = 0;
+        size_t keptBytes = 0;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            const float share = std::min(std::max(sizeClass.priority, 0.f), 1.f);
+            const size_t limit = size_t(double(mStats.budgetBytes) * double(share));
+            const size_t available = (limit > mStats.committedBytes) ? limit - mStats.committedBytes : 0;
+
+            first = ChooseFirstMip(info, levelBytes, levelSize, sizeClass, available);
+            for (size_t i = first; i < info.mipCount; ++i)
+            {
+                keptBytes += levelBytes[i];
+            }
+
+            mStats.committedBytes += keptBytes;
+        }
+
+        hr = CreateFromLevels(file, headerData, dataOffset, info, levelBytes, first,
+            usage, bindFlags, cpuAccessFlags, miscFlags, forceSRGB,
+            texture, textureView);
+
+        if (FAILED(hr))
+        {
+            Release(keptBytes);
+            return hr;
+        }
+
+        SetDebugTextureInfo(fileName, texture, textureView);
+
+        if (alphaMode)
+            *alphaMode = GetAlphaMode(header);
+
+        result.maxsize = first ? levelSize[first] : 0;
+        result.skippedMips = static_cast<uint32_t>(first);
+        result.residentBytes = keptBytes;
+        result.bytesRead = dataOffset + keptBytes;
+        result.bytesSkipped = fileBytes - keptBytes;
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        ++mStats.textures;
+        mStats.skippedMips += first;
+        mStats.bytesRead += result.bytesRead;
+        mStats.bytesSkipped += result.bytesSkipped;
+
+        return S_OK;
+    }
+
+    void Release(size_t residentBytes) noexcept
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStats.committedBytes -= std::min(residentBytes, mStats.committedBytes);
+    }
+
+    void SetBudget(size_t budgetBytes) noexcept
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStats.budgetBytes = budgetBytes;
+    }
+
+    DDSSizePolicyStats GetStats() const noexcept
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mStats;
+    }
+
+private:
+    ID3D11Device*           mDevice;
+    mutable std::mutex      mMutex;
+    DDSSizePolicyStats      mStats;
+
+    // Reads levels first and finer of every array slice, seeking past the ones above, and
+    // creates the texture from them under a header rewritten to start at level first
+    HRESULT CreateFromLevels(
+        FileReader& file,
+        _In_reads_bytes_(dataOffset) const uint8_t* headerData,
+        size_t dataOffset,
+        const TextureInfo& info,
+        _In_reads_(D3D11_REQ_MIP_LEVELS) const size_t* levelBytes,
+        size_t first,
+        D3D11_USAGE usage,
+        unsigned int bindFlags,
+        unsigned int cpuAccessFlags,
+        unsigned int miscFlags,
+        bool forceSRGB,
+        _Outptr_opt_ ID3D11Resource** texture,
+        _Outptr_opt_ ID3D11ShaderResourceView** textureView) noexcept
+    {
+        // Each slice stores its whole chain before the next slice starts
+        size_t skipBytes = 0;
+        size_t keepBytes = 0;
+        for (size_t i = 0; i < info.mipCount; ++i)
+        {
+            (i < first ? skipBytes : keepBytes) += levelBytes[i] / info.arraySize;
+        }
+
+        std::unique_ptr<uint8_t[]> bits(new (std::nothrow) uint8_t[keepBytes * info.arraySize]);
+        if (!bits)
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        for (size_t item = 0; item < info.arraySize; ++item)
+        {
+            HRESULT hr = file.Read(dataOffset + item * (skipBytes + keepBytes) + skipBytes,
+                bits.get() + item * keepBytes, keepBytes);
+            if (FAILED(hr))
+            {
+                return hr;
+            }
+        }
+
+        uint8_t headerCopy[sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10)] = {};
+        memcpy(headerCopy, headerData + sizeof(uint32_t), dataOffset - sizeof(uint32_t));
+
+        auto header = reinterpret_cast<DDS_HEADER*>(headerCopy);
+        header->width = std::max<uint32_t>(header->width >> first, 1u);
+        header->height = std::max<uint32_t>(header->height >> first, 1u);
+        header->depth = std::max<uint32_t>(header->depth >> first, 1u);
+        header->mipMapCount = static_cast<uint32_t>(info.mipCount - first);
+
+        return CreateTextureFromDDS(mDevice, nullptr,
+            header, bits.get(), keepBytes * info.arraySize,
+            0,
+            usage, bindFlags, cpuAccessFlags, miscFlags,
+            forceSRGB,
+            texture, textureView);
+    }
+};
+
+
+//--------------------------------------------------------------------------------------
+DDSSizePolicy::DDSSizePolicy(ID3D11Device* d3dDevice, size_t budgetBytes) noexcept(false) :
+    pImpl(std::make_unique<Impl>(d3dDevice, budgetBytes))
+{
+}
+
+DDSSizePolicy::DDSSizePolicy(DDSSizePolicy&&) noexcept = default;
+DDSSizePolicy& DDSSizePolicy::operator= (DDSSizePolicy&&) noexcept = default;
+DDSSizePolicy::~DDSSizePolicy() = default;
+
+_Use_decl_annotations_
+HRESULT DDSSizePolicy::CreateTexture(
+    const wchar_t* fileName,
+    const DDSSizeClass& sizeClass,
+    D3D11_USAGE usage,
+    unsigned int bindFlags,
+    unsigned int cpuAccessFlags,
+    unsigned int miscFlags,
+    bool forceSRGB,
+    ID3D11Resource** texture,
+    ID3D11ShaderResourceView** textureView,
+    DDSSizeResult* result,
+    DDS_ALPHA_MODE* alphaMode) noexcept
+{
+    if (texture)
+    {
+        *texture = nullptr;
+    }
+    if (textureView)
+    {
+        *textureView = nullptr;
+    }
+    if (alphaMode)
+    {
+        *alphaMode = DDS_ALPHA_MODE_UNKNOWN;
+    }
+
+    DDSSizeResult local = {};
+    if (!result)
+    {
+        result = &local;
+    }
+    *result = {};
+
+    if (!fileName || (!texture && !textureView))
+    {
+        return E_INVALIDARG;
+    }
+
+    if (textureView && !(bindFlags & D3D11_BIND_SHADER_RESOURCE))
+    {
+        return E_INVALIDARG;
+    }
+
+    return pImpl->CreateTexture(fileName, sizeClass,
+        usage, bindFlags, cpuAccessFlags, miscFlags,
+        forceSRGB,
+        texture, textureView, *result, alphaMode);
+}
+
+void DDSSizePolicy::Release(size_t residentBytes) noexcept
+{
+    pImpl->Release(residentBytes);
+}
+
+void DDSSizePolicy::SetBudget(size_t budgetBytes) noexcept
+{
+    pImpl->SetBudget(budgetBytes);
+}
+
+DDSSizePolicyStats DDSSizePolicy::GetStats() const noexcept
+{
+    return pImpl->GetStats();
+}
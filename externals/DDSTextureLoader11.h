@@ -20,6 +20,8 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <memory>
 
 
 namespace DirectX
@@ -131,4 +133,343 @@ namespace DirectX
         _Outptr_opt_ ID3D11Resource** texture,
         _Outptr_opt_ ID3D11ShaderResourceView** textureView,
         _Out_opt_ DDS_ALPHA_MODE* alphaMode = nullptr) noexcept;
+
+    // Batch version
+    //
+    // Loads many files through a pipeline: worker threads map and read the files, validate
+    // the headers and lay out the subresources, while the calling thread creates the
+    // resources as the files complete. ioQueueDepth bounds how many files are mapped and in
+    // flight at once. Returns S_OK when every file loaded, otherwise the error of the first
+    // one that failed; results receives each file's own HRESULT.
+    struct DDSBatchOptions
+    {
+        size_t          ioQueueDepth = 16;
+        size_t          workerThreads = 4;
+        size_t          maxsize = 0;
+        D3D11_USAGE     usage = D3D11_USAGE_DEFAULT;
+        unsigned int    bindFlags = D3D11_BIND_SHADER_RESOURCE;
+        unsigned int    cpuAccessFlags = 0;
+        unsigned int    miscFlags = 0;
+        bool            forceSRGB = false;
+    };
+
+    HRESULT CreateDDSTexturesFromFiles(
+        _In_ ID3D11Device* d3dDevice,
+        _In_reads_(count) const wchar_t* const* szFileNames,
+        _In_ size_t count,
+        _In_ const DDSBatchOptions& options,
+        _Out_writes_opt_(count) ID3D11Resource** textures,
+        _Out_writes_opt_(count) ID3D11ShaderResourceView** textureViews,
+        _Out_writes_opt_(count) HRESULT* results = nullptr,
+        _Out_writes_opt_(count) DDS_ALPHA_MODE* alphaModes = nullptr) noexcept;
+
+    // The same pipeline with the upload stage left to the caller: the sink runs on the
+    // calling thread for each file that decoded, in completion order, and a failure it
+    // returns becomes that file's result. The subresources point into the mapped file, or
+    // into a copy expanded to a DXGI format for legacy pixel formats, and are only valid
+    // during the call. Only the ioQueueDepth, workerThreads and maxsize options apply; the
+    // rest are for the sink to honour.
+    struct DDSBatchTexture
+    {
+        size_t                          index;          // into szFileNames
+        uint32_t                        resDim;         // a D3D11_RESOURCE_DIMENSION
+        size_t                          width;          // after maxsize dropped top levels
+        size_t                          height;
+        size_t                          depth;
+        size_t                          mipCount;
+        size_t                          arraySize;      // six per cube for cube maps
+        DXGI_FORMAT                     format;
+        bool                            isCubeMap;
+        const D3D11_SUBRESOURCE_DATA*   initData;       // mipCount per slice, slice after slice
+        DDS_ALPHA_MODE                  alphaMode;
+        const uint8_t*                  ddsData;        // the whole file
+        size_t                          ddsDataSize;
+    };
+
+    using DDSBatchSink = std::function<HRESULT(const DDSBatchTexture& texture)>;
+
+    HRESULT LoadDDSTexturesFromFiles(
+        _In_reads_(count) const wchar_t* const* szFileNames,
+        _In_ size_t count,
+        _In_ const DDSBatchOptions& options,
+        _In_ const DDSBatchSink& sink,
+        _Out_writes_opt_(count) HRESULT* results = nullptr) noexcept;
+
+    // CPU mip generation
+    //
+    // For DDS files that store only their top level (mipMapCount 0 or 1), the rest of the
+    // chain is filtered on the CPU, every array slice and band of rows of a level in
+    // parallel, and the texture is created with all levels as initial data. Unlike the
+    // auto-gen overloads this needs no device context and no render target support for the
+    // format. Uncompressed 8-bit UNORM formats (RGBA, BGRA, BGRX, RG, R, A) are filtered;
+    // volumes, other formats and files that already have mips load as they are.
+    enum DDS_MIP_FILTER : uint32_t
+    {
+        DDS_MIP_FILTER_BOX      = 0,    // 2x2 average
+        DDS_MIP_FILTER_KAISER   = 1,    // 8-tap Kaiser-windowed sinc; keeps more detail than the box
+    };
+
+    struct DDSMipOptions
+    {
+        DDS_MIP_FILTER  filter = DDS_MIP_FILTER_BOX;
+        size_t          threads = 0;        // 0 uses every hardware thread
+        bool            forceSRGB = false;
+        bool            srgbFilter = false; // filter colour in linear light; implied by _SRGB formats and forceSRGB
+    };
+
+    HRESULT CreateDDSTextureFromMemoryWithMips(
+        _In_ ID3D11Device* d3dDevice,
+        _In_reads_bytes_(ddsDataSize) const uint8_t* ddsData,
+        _In_ size_t ddsDataSize,
+        _In_ const DDSMipOptions& options,
+        _Outptr_opt_ ID3D11Resource** texture,
+        _Outptr_opt_ ID3D11ShaderResourceView** textureView,
+        _In_ size_t maxsize = 0,
+        _Out_opt_ DDS_ALPHA_MODE* alphaMode = nullptr) noexcept;
+
+    HRESULT CreateDDSTextureFromFileWithMips(
+        _In_ ID3D11Device* d3dDevice,
+        _In_z_ const wchar_t* szFileName,
+        _In_ const DDSMipOptions& options,
+        _Outptr_opt_ ID3D11Resource** texture,
+        _Outptr_opt_ ID3D11ShaderResourceView** textureView,
+        _In_ size_t maxsize = 0,
+        _Out_opt_ DDS_ALPHA_MODE* alphaMode = nullptr) noexcept;
+
+    // Progressive mip streaming
+    //
+    // CreateTexture returns once the mip tail (every level no larger than tailSize) is
+    // uploaded; the finer levels are read on background threads, highest priority first,
+    // and uploaded by Update. Update also moves each texture's SetResourceMinLOD clamp down
+    // to its finest resident level, so sampling never touches a level that is not loaded.
+    // Levels are uploaded from the file as stored, so legacy formats that other loaders
+    // expand on load are not streamed. CreateTexture, Update and Release must be called
+    // from the thread that owns the immediate context.
+    //
+    // An I/O thread hands each level it picks to the read callback and marks the level
+    // ready for Update once the callback returns. The default faults the level's pages of
+    // the mapped file in; a caller can supply its own, e.g. to read from another source or
+    // to simulate I/O latency. Callbacks run concurrently when there are several I/O threads.
+    struct DDSStreamRead
+    {
+        uint32_t        streamId;
+        uint32_t        mip;
+        const uint8_t*  data;           // the level in the first array slice, in the mapped file
+        size_t          sliceSize;      // bytes of the level in each slice
+        size_t          sliceStride;    // from one slice's level to the next
+        size_t          sliceCount;
+    };
+
+    using DDSStreamReader = std::function<void(const DDSStreamRead& read)>;
+
+    class DDSTextureStreamer
+    {
+    public:
+        explicit DDSTextureStreamer(_In_ ID3D11Device* d3dDevice, size_t ioThreads = 1,
+            DDSStreamReader reader = nullptr) noexcept(false);
+
+        DDSTextureStreamer(DDSTextureStreamer&&) noexcept;
+        DDSTextureStreamer& operator= (DDSTextureStreamer&&) noexcept;
+
+        DDSTextureStreamer(DDSTextureStreamer const&) = delete;
+        DDSTextureStreamer& operator= (DDSTextureStreamer const&) = delete;
+
+        ~DDSTextureStreamer();
+
+        // streamId is 0 when the whole chain fit in the tail and nothing is left to stream
+        HRESULT CreateTexture(
+            _In_ ID3D11DeviceContext* d3dContext,
+            _In_z_ const wchar_t* szFileName,
+            _In_ size_t tailSize,
+            _In_ bool forceSRGB,
+            _Outptr_opt_ ID3D11Resource** texture,
+            _Outptr_opt_ ID3D11ShaderResourceView** textureView,
+            _Out_ uint32_t* streamId,
+            _Out_opt_ DDS_ALPHA_MODE* alphaMode = nullptr) noexcept;
+
+        // Higher priorities stream first; levels finer than minMip are not requested
+        void SetPriority(uint32_t streamId, float priority, uint32_t minMip = 0) noexcept;
+
+        // Uploads finished levels, at least one and then up to maxBytes worth; returns the bytes uploaded
+        size_t Update(_In_ ID3D11DeviceContext* d3dContext, size_t maxBytes) noexcept;
+
+        uint32_t GetResidentMip(uint32_t streamId) const noexcept;
+        bool IsIdle() const noexcept;
+
+        // Stops streaming the texture; its resident levels stay valid
+        void Release(uint32_t streamId) noexcept;
+
+    private:
+        class Impl;
+
+        std::unique_ptr<Impl> pImpl;
+    };
+
+    // Texture cache
+    //
+    // Shares textures between every request for the same file and load options. A request
+    // for a texture that another thread is still loading waits for that load instead of
+    // starting its own. Unless shareContent is false, each new file is hashed as it is
+    // read, so byte-identical files under other paths share one texture and view as well;
+    // without it files are mapped instead. The cache keeps its textures within a GPU memory
+    // budget, estimated from the GetSurfaceInfo sizes of the levels created (drivers add
+    // padding and alignment on top). Going over budget evicts the least recently used
+    // textures, or with DDS_CACHE_EVICT_DROP_MIPS first reloads them without as many top
+    // levels as it takes to get back within budget. Eviction only drops the cache's
+    // references: callers holding a texture keep it alive, and new requests get the smaller
+    // reload. The texture just loaded is never evicted, so one larger than the whole budget
+    // stays until the next trim. GetTexture may be called from any thread.
+    struct DDSLoadOptions
+    {
+        size_t          maxsize = 0;
+        D3D11_USAGE     usage = D3D11_USAGE_DEFAULT;
+        unsigned int    bindFlags = D3D11_BIND_SHADER_RESOURCE;
+        unsigned int    cpuAccessFlags = 0;
+        unsigned int    miscFlags = 0;
+        bool            forceSRGB = false;
+    };
+
+    enum DDS_CACHE_EVICTION : uint32_t
+    {
+        DDS_CACHE_EVICT_RELEASE     = 0,    // release the least recently used texture
+        DDS_CACHE_EVICT_DROP_MIPS   = 1,    // drop its top levels; release it when its smallest level alone would not do
+    };
+
+    struct DDSTextureCacheStats
+    {
+        uint64_t    hits;
+        uint64_t    misses;
+        uint64_t    sharedLoads;        // hits that waited on a load already in flight
+        uint64_t    evictions;
+        uint64_t    mipDrops;
+        uint64_t    duplicates;         // misses resolved to a texture loaded from identical content
+        size_t      dedupBytes;         // memory those duplicates would take on top of the textures held
+        size_t      textureCount;
+        size_t      residentBytes;
+        size_t      peakBytes;
+        size_t      budgetBytes;
+
+        float HitRate() const noexcept
+        {
+            const uint64_t requests = hits + misses;
+            return requests ? float(double(hits) / double(requests)) : 0.f;
+        }
+    };
+
+    class DDSTextureCache
+    {
+    public:
+        DDSTextureCache(_In_ ID3D11Device* d3dDevice, size_t budgetBytes,
+            DDS_CACHE_EVICTION eviction = DDS_CACHE_EVICT_RELEASE,
+            bool shareContent = true) noexcept(false);
+
+        DDSTextureCache(DDSTextureCache&&) noexcept;
+        DDSTextureCache& operator= (DDSTextureCache&&) noexcept;
+
+        DDSTextureCache(DDSTextureCache const&) = delete;
+        DDSTextureCache& operator= (DDSTextureCache const&) = delete;
+
+        ~DDSTextureCache();
+
+        HRESULT GetTexture(
+            _In_z_ const wchar_t* szFileName,
+            _In_ const DDSLoadOptions& options,
+            _Outptr_opt_ ID3D11Resource** texture,
+            _Outptr_opt_ ID3D11ShaderResourceView** textureView,
+            _Out_opt_ DDS_ALPHA_MODE* alphaMode = nullptr) noexcept;
+
+        // Evicts down to the new budget straight away
+        void SetBudget(size_t budgetBytes) noexcept;
+
+        // Releases every texture that is not being loaded
+        void Clear() noexcept;
+
+        DDSTextureCacheStats GetStats() const noexcept;
+
+    private:
+        class Impl;
+
+        std::unique_ptr<Impl> pImpl;
+    };
+
+    // XXH64 (seed 0) of a buffer, the content hash the cache identifies files by
+    uint64_t DDSContentHash(_In_reads_bytes_(size) const uint8_t* data, size_t size) noexcept;
+
+    // Budget-driven load sizes
+    //
+    // DDSSizePolicy chooses each texture's maxsize from a global memory budget instead of
+    // leaving it to the caller. A texture may bring the bytes the policy has handed out up
+    // to its class's priority times the budget, and drops top levels until it fits; it
+    // never goes below the class's minSize or past the last mip in the file, so files
+    // without mips load whole. Low-priority textures therefore give up detail first as the
+    // budget fills. Categories are DDSSizeClass values the caller keeps, such as one for UI
+    // and one for props. Only the levels kept are read; the skipped top levels of each
+    // array slice are seeked over, so legacy formats that other loaders expand on load
+    // (24bpp RGB, X1R5G5B5, A4L4, ...) are not supported here. CreateTexture may be called
+    // from any thread.
+    struct DDSSizeClass
+    {
+        float   priority = 1.f;     // share of the budget this class may fill, 0 to 1
+        size_t  minSize = 0;        // the budget does not shrink the top level below this
+        size_t  maxSize = 0;        // cap applied whatever the budget; 0 for none
+    };
+
+    struct DDSSizeResult
+    {
+        size_t      maxsize;            // equivalent CreateDDSTextureFromFileEx maxsize; 0 if nothing was skipped
+        uint32_t    skippedMips;
+        size_t      residentBytes;      // hand back to Release when the texture is freed
+        size_t      bytesRead;
+        size_t      bytesSkipped;
+    };
+
+    struct DDSSizePolicyStats
+    {
+        size_t      budgetBytes;
+        size_t      committedBytes;
+        uint64_t    textures;
+        uint64_t    skippedMips;
+        uint64_t    bytesRead;
+        uint64_t    bytesSkipped;       // I/O saved by the skipped levels
+    };
+
+    class DDSSizePolicy
+    {
+    public:
+        DDSSizePolicy(_In_ ID3D11Device* d3dDevice, size_t budgetBytes) noexcept(false);
+
+        DDSSizePolicy(DDSSizePolicy&&) noexcept;
+        DDSSizePolicy& operator= (DDSSizePolicy&&) noexcept;
+
+        DDSSizePolicy(DDSSizePolicy const&) = delete;
+        DDSSizePolicy& operator= (DDSSizePolicy const&) = delete;
+
+        ~DDSSizePolicy();
+
+        HRESULT CreateTexture(
+            _In_z_ const wchar_t* szFileName,
+            _In_ const DDSSizeClass& sizeClass,
+            _In_ D3D11_USAGE usage,
+            _In_ unsigned int bindFlags,
+            _In_ unsigned int cpuAccessFlags,
+            _In_ unsigned int miscFlags,
+            _In_ bool forceSRGB,
+            _Outptr_opt_ ID3D11Resource** texture,
+            _Outptr_opt_ ID3D11ShaderResourceView** textureView,
+            _Out_opt_ DDSSizeResult* result = nullptr,
+            _Out_opt_ DDS_ALPHA_MODE* alphaMode = nullptr) noexcept;
+
+        // Returns a freed texture's residentBytes to the budget
+        void Release(size_t residentBytes) noexcept;
+
+        // Applies to later loads; textures already created keep their size
+        void SetBudget(size_t budgetBytes) noexcept;
+
+        DDSSizePolicyStats GetStats() const noexcept;
+
+    private:
+        class Impl;
+
+        std::unique_ptr<Impl> pImpl;
+    };
 }